@@ -5,6 +5,7 @@
 #include <inttypes.h>   // ★ ใช้ PRIu32
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -12,135 +13,214 @@
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "espnow_disc.h"
+#include "link_track.h"
+#include "link_rto.h"
+#include "link_rate.h"
 
 #define DEVICE_NAME "ESP32_B"
 static const char *TAG = "ESP_NOW_CHAT_B";
 
-/* ★★ ใส่ MAC ของ “ฝั่ง A” ให้ถูกต้อง ★★ */
-static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 };
+/* MAC ของ “ฝั่ง A” — ได้จาก discovery (role CHAT) */
+static uint8_t partner_mac[6];
 
 #define CHANNEL 1
 
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;      // ESPNOW_MSG_CHAT
     char     sender_name[20];
     char     message[200];
     uint32_t msg_id;
-    bool     is_ack;
 } chat_message_t;
 
+/* ACK ไม่ต้องพกข้อความ 200 ไบต์ไปด้วย */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;      // ESPNOW_MSG_CHAT_ACK
+    char     sender_name[20];
+    uint32_t msg_id;
+} chat_ack_t;
+
 static void log_mac(const char *pfx, const uint8_t mac[6]) {
     ESP_LOGI(TAG, "%s %02X:%02X:%02X:%02X:%02X:%02X",
              pfx, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
+/* ส่งซ้ำได้กี่ครั้งต่อข้อความ (รวมครั้งแรก) — เวลารอแต่ละครั้งมาจาก RTO ที่วัดได้ */
+#define CHAT_MAX_TX  4
+
 static volatile uint32_t g_last_sent_id = 0;
 static volatile bool     g_last_sent_ack = false;
+static volatile int64_t  g_ack_us = 0;         // เวลาที่ได้ ACK (วัด RTT)
+static SemaphoreHandle_t g_ack_sem;
 static uint32_t          g_counter = 0;
+static uint32_t          g_retransmits = 0;
+static uint32_t          g_dup_acks = 0;       // ACK ซ้ำ = ส่งซ้ำโดยไม่จำเป็น (spurious)
+static uint32_t          g_last_rx_id = 0;     // กันแสดงข้อความที่ถูกส่งซ้ำ
 
 static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Send status: %s", status == ESP_NOW_SEND_SUCCESS ? "SUCCESS" : "FAIL");
+    espnow_boot_mark_first_tx();
+    espnow_link_sent_t r;
+    espnow_link_on_sent(info, status, &r);
+    espnow_disc_on_sent(info->des_addr, r.ok);   // FAIL ติดกัน -> กวาด channel ใหม่
+    if (r.matched) {
+        ESP_LOGI(TAG, "Send chat #%" PRIu32 ": %s (%lld us)", r.seq,
+                 r.ok ? "SUCCESS" : "FAIL", (long long)r.latency_us);
+    } else {
+        ESP_LOGI(TAG, "Send status: %s", r.ok ? "SUCCESS" : "FAIL");
+    }
 }
 
-static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-    if (!data || len <= 0) return;
-
-    if (info && info->src_addr) log_mac("📥 From", info->src_addr);
-
-    chat_message_t rx = {0};
-    int n = len < (int)sizeof(rx) ? len : (int)sizeof(rx);
-    memcpy(&rx, data, n);
+static void on_chat_ack(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    chat_ack_t rx;
+    memcpy(&rx, data, sizeof(rx));
+    rx.sender_name[sizeof(rx.sender_name) - 1] = '\0';
 
-    if (rx.is_ack) {
-        ESP_LOGI(TAG, "✅ ACK for msg_id=%" PRIu32 " from %s", rx.msg_id, rx.sender_name);
-        if (rx.msg_id == g_last_sent_id) g_last_sent_ack = true;
+    if (rx.msg_id != g_last_sent_id) return;
+    if (g_last_sent_ack) {
+        g_dup_acks++;
         return;
     }
+    g_ack_us = esp_timer_get_time();
+    g_last_sent_ack = true;
+    xSemaphoreGive(g_ack_sem);
+    ESP_LOGI(TAG, "✅ ACK for msg_id=%" PRIu32 " from %s", rx.msg_id, rx.sender_name);
+}
 
-    ESP_LOGI(TAG, "💬 %s (#%" PRIu32 "): %s", rx.sender_name, rx.msg_id, rx.message);
+static void on_chat(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    chat_message_t rx;
+    memcpy(&rx, data, sizeof(rx));
+    rx.sender_name[sizeof(rx.sender_name) - 1] = '\0';
+    rx.message[sizeof(rx.message) - 1] = '\0';
 
-    chat_message_t ack = {0};
+    // ข้อความซ้ำ (อีกฝั่ง retransmit เพราะ ACK หาย) -> ตอบ ACK อย่างเดียว
+    if (rx.msg_id != g_last_rx_id) {
+        g_last_rx_id = rx.msg_id;
+        ESP_LOGI(TAG, "💬 %s (#%" PRIu32 "): %s", rx.sender_name, rx.msg_id, rx.message);
+    }
+
+    chat_ack_t ack = {0};
+    ack.hdr.type = ESPNOW_MSG_CHAT_ACK;
     snprintf(ack.sender_name, sizeof(ack.sender_name), "%s", DEVICE_NAME);
-    snprintf(ack.message, sizeof(ack.message), "ACK:%" PRIu32, rx.msg_id);
     ack.msg_id = rx.msg_id;
-    ack.is_ack = true;
 
     const uint8_t *dst = (info && info->src_addr) ? info->src_addr : partner_mac;
-    esp_err_t er = esp_now_send(dst, (const uint8_t *)&ack, sizeof(ack));
+    esp_err_t er = espnow_link_send(dst, &ack, sizeof(ack), ack.msg_id, 0);
     if (er != ESP_OK) ESP_LOGE(TAG, "send ACK failed: %s", esp_err_to_name(er));
 }
 
-static void wifi_init_for_espnow(uint8_t ch) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    if (ch >= 1 && ch <= 13) {
-        wifi_config_t sta = {0};
-        sta.sta.channel = ch;
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta));
-    }
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", ch);
+static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (!data || len <= 0) return;
+
+    if (info && info->src_addr) log_mac("📥 From", info->src_addr);
+
+    espnow_msg_dispatch(info, data, len);
 }
 
 static void espnow_init_and_add_peer(uint8_t ch) {
-    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_CHAT,     sizeof(chat_message_t), on_chat));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_CHAT_ACK, sizeof(chat_ack_t),     on_chat_ack));
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
 
-    esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, partner_mac, 6);
-    peer.ifidx   = WIFI_IF_STA;
-    peer.channel = ch;
-    peer.encrypt = false;
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer));
+    // รอ partner จาก discovery (NVS = ทันที, ไม่งั้นรอ HELLO/REPLY)
+    ESP_ERROR_CHECK(espnow_disc_wait_peer(partner_mac, UINT32_MAX));
+    log_mac("🤝 Partner:", partner_mac);
+
+    ESP_ERROR_CHECK(espnow_boot_add_peer(partner_mac, ch));
     ESP_LOGI(TAG, "ESP-NOW ok & peer added");
 }
 
-static void send_chat(const char *text) {
-    chat_message_t tx = {0};
-    snprintf(tx.sender_name, sizeof(tx.sender_name), "%s", DEVICE_NAME);
-    snprintf(tx.message, sizeof(tx.message), "%s", text);
-    tx.msg_id = ++g_counter;
-    tx.is_ack = false;
+/* discovery ยืนยัน partner ตัวอื่นแทน (บอร์ดเดิมหาย/ถูกเปลี่ยน) -> ย้ายตาม ไม่ต้องลบ NVS */
+static void follow_partner(void) {
+    if (!espnow_disc_refresh_peer(partner_mac)) return;
+    log_mac("🔄 Partner changed:", partner_mac);
+    esp_err_t er = espnow_boot_add_peer(partner_mac, 0);
+    if (er == ESP_OK) er = espnow_link_rate_enable(partner_mac);
+    if (er != ESP_OK) ESP_LOGW(TAG, "follow partner: %s", esp_err_to_name(er));
+}
+
+static void build_chat(chat_message_t *tx, const char *text) {
+    memset(tx, 0, sizeof(*tx));
+    tx->hdr.type = ESPNOW_MSG_CHAT;
+    snprintf(tx->sender_name, sizeof(tx->sender_name), "%s", DEVICE_NAME);
+    snprintf(tx->message, sizeof(tx->message), "%s", text);
+    tx->msg_id = ++g_counter;
+}
 
-    g_last_sent_id = tx.msg_id;
+/* ส่งแล้วรอ ACK ตาม RTO ของ peer; หมดเวลา -> RTO x2 แล้วส่งซ้ำ (ไม่เกิน CHAT_MAX_TX ครั้ง) */
+static bool chat_send_with_rto(const chat_message_t *tx) {
+    g_last_sent_id = tx->msg_id;
     g_last_sent_ack = false;
+    xSemaphoreTake(g_ack_sem, 0);
+
+    for (int n = 0; n < CHAT_MAX_TX; n++) {
+        uint32_t rto = espnow_link_rto_ms(partner_mac);
+        if (n == 0) {
+            ESP_LOGI(TAG, "📤 Send #%" PRIu32 ": %s (rto %" PRIu32 " ms)", tx->msg_id, tx->message, rto);
+        } else {
+            ESP_LOGW(TAG, "🔁 Retransmit #%" PRIu32 " (try %d, rto %" PRIu32 " ms)", tx->msg_id, n + 1, rto);
+            g_retransmits++;
+        }
 
-    ESP_LOGI(TAG, "📤 Send #%" PRIu32 ": %s", tx.msg_id, tx.message);
-    esp_err_t er = esp_now_send(partner_mac, (const uint8_t *)&tx, sizeof(tx));
-    if (er != ESP_OK) ESP_LOGE(TAG, "esp_now_send: %s", esp_err_to_name(er));
-}
+        int64_t t_tx = esp_timer_get_time();
+        esp_err_t er = espnow_link_send(partner_mac, tx, sizeof(*tx), tx->msg_id, (uint8_t)n);
+        if (er != ESP_OK) ESP_LOGE(TAG, "esp_now_send: %s", esp_err_to_name(er));
 
-void app_main(void) {
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
+        if (xSemaphoreTake(g_ack_sem, pdMS_TO_TICKS(rto) + 1) == pdTRUE) {
+            // Karn: ถ้าเคยส่งซ้ำ ไม่รู้ว่า ACK ตอบครั้งไหน -> ไม่เอา RTT มาคิด
+            espnow_link_rto_sample(partner_mac, g_ack_us - t_tx, n > 0);
+            return true;
+        }
+        espnow_link_rto_backoff(partner_mac);
     }
+    ESP_LOGW(TAG, "No ACK for msg_id=%" PRIu32 " after %d tries", tx->msg_id, CHAT_MAX_TX);
+    return false;
+}
 
-    wifi_init_for_espnow(CHANNEL);
+void app_main(void) {
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel = CHANNEL;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    g_ack_sem = xSemaphoreCreateBinary();
+    // ★ ไม่ต้อง hardcode MAC: หา partner ด้วย discovery (จำไว้ใน NVS)
+    espnow_disc_config_t disc_cfg = {
+        .my_role   = ESPNOW_DISC_ROLE_CHAT,
+        .want_role = ESPNOW_DISC_ROLE_CHAT,
+        .channel   = CHANNEL,
+        .use_nvs   = true,
+        .scan      = true,
+    };
+    ESP_ERROR_CHECK(espnow_disc_init(&disc_cfg));
     espnow_init_and_add_peer(CHANNEL);
 
     uint8_t my[6];
     esp_wifi_get_mac(WIFI_IF_STA, my);
     log_mac("📍 My MAC:", my);
     ESP_LOGI(TAG, "Chat name: %s", DEVICE_NAME);
+    espnow_boot_report();
+    espnow_disc_report();
+    ESP_ERROR_CHECK(espnow_link_rate_enable(partner_mac));
+    ESP_ERROR_CHECK(espnow_link_start_report(30000));
 
     while (1) {
+        follow_partner();
         char text[80];
         uint32_t ms = (uint32_t)(esp_timer_get_time()/1000ULL);
         snprintf(text, sizeof(text), "Hi from %s! Time=%" PRIu32 " ms", DEVICE_NAME, ms);
-        send_chat(text);
-
-        int wait = 0;
-        while (!g_last_sent_ack && wait < 20) { // ~2s
-            vTaskDelay(pdMS_TO_TICKS(100));
-            wait++;
-        }
-        if (!g_last_sent_ack) {
-            ESP_LOGW(TAG, "No ACK for msg_id=%" PRIu32, g_last_sent_id);
+        chat_message_t msg;
+        build_chat(&msg, text);
+        chat_send_with_rto(&msg);
+
+        if (msg.msg_id % 10 == 0) {
+            espnow_link_rto_stats_t st;
+            if (espnow_link_rto_get_stats(partner_mac, &st)) {
+                ESP_LOGI(TAG, "📊 RTO: srtt=%lld us rttvar=%lld us rto=%" PRIu32 " ms samples=%" PRIu32
+                         " karn_skip=%" PRIu32 " timeouts=%" PRIu32 " retx=%" PRIu32 " dup_ack=%" PRIu32,
+                         (long long)st.srtt_us, (long long)st.rttvar_us, st.rto_ms, st.samples,
+                         st.karn_skipped, st.timeouts, g_retransmits, g_dup_acks);
+            }
         }
 
         vTaskDelay(pdMS_TO_TICKS(7000));
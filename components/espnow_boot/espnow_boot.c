@@ -0,0 +1,192 @@
+// components/espnow_boot/espnow_boot.c
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "espnow_boot.h"
+
+static const char *TAG = "ESPNOW_BOOT";
+
+static const char *const s_step_name[ESPNOW_BOOT_STEP_MAX] = {
+    [ESPNOW_BOOT_STEP_APP_START]   = "app start",
+    [ESPNOW_BOOT_STEP_NVS]         = "nvs",
+    [ESPNOW_BOOT_STEP_NETIF]       = "netif",
+    [ESPNOW_BOOT_STEP_EVENT_LOOP]  = "event loop",
+    [ESPNOW_BOOT_STEP_WIFI_INIT]   = "wifi init",
+    [ESPNOW_BOOT_STEP_WIFI_START]  = "wifi start",
+    [ESPNOW_BOOT_STEP_ESPNOW_INIT] = "esp_now init",
+    [ESPNOW_BOOT_STEP_PEER_ADD]    = "peer add",
+    [ESPNOW_BOOT_STEP_FIRST_TX]    = "first TX",
+};
+
+static int64_t     s_step_us[ESPNOW_BOOT_STEP_MAX];
+static atomic_bool s_first_tx_done = false;
+static bool        s_fast_boot = false;
+
+/* LRU ของ espnow_boot_touch_peer */
+static struct {
+    uint8_t mac[6];
+    int64_t used_us;            // 0 = ว่าง
+} s_lru[ESPNOW_BOOT_LRU_PEERS];
+static SemaphoreHandle_t s_lru_lock;
+static uint32_t          s_evictions;
+_Static_assert(ESPNOW_BOOT_LRU_PEERS >= ESP_NOW_MAX_TOTAL_PEER_NUM, "LRU must not fill before the ESP-NOW table");
+
+static inline void mark(espnow_boot_step_t step) {
+    s_step_us[step] = esp_timer_get_time();
+}
+
+static esp_err_t nvs_init_with_erase(void) {
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_RETURN_ON_ERROR(nvs_flash_erase(), TAG, "nvs erase");
+        err = nvs_flash_init();
+    }
+    return err;
+}
+
+esp_err_t espnow_boot_init(const espnow_boot_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "cfg is NULL");
+    // fast boot ไม่สร้าง event loop/netif -> ต่อ AP ไม่ได้อยู่ดี
+    ESP_RETURN_ON_FALSE(!(cfg->fast_boot && cfg->sta_netif), ESP_ERR_INVALID_ARG, TAG, "sta_netif needs fast_boot = false");
+
+    for (int i = 0; i < ESPNOW_BOOT_STEP_MAX; i++) s_step_us[i] = -1;
+    if (!s_lru_lock) s_lru_lock = xSemaphoreCreateMutex();
+    mark(ESPNOW_BOOT_STEP_APP_START);
+    s_fast_boot = cfg->fast_boot;
+
+    // NVS ต้องมาก่อนเสมอ: PHY calibration data ถูกอ่านจาก NVS ตอน wifi start
+    ESP_RETURN_ON_ERROR(nvs_init_with_erase(), TAG, "nvs init");
+    mark(ESPNOW_BOOT_STEP_NVS);
+
+    if (!cfg->fast_boot) {
+        ESP_RETURN_ON_ERROR(esp_netif_init(), TAG, "netif init");
+        mark(ESPNOW_BOOT_STEP_NETIF);
+        ESP_RETURN_ON_ERROR(esp_event_loop_create_default(), TAG, "event loop");
+        mark(ESPNOW_BOOT_STEP_EVENT_LOOP);
+        // netif ต้องผูกก่อน esp_wifi_start ไม่งั้นพลาด event STA_START (ไม่ได้ DHCP ตอนต่อ AP)
+        if (cfg->sta_netif) ESP_RETURN_ON_FALSE(esp_netif_create_default_wifi_sta(), ESP_FAIL, TAG, "sta netif");
+    }
+
+    wifi_init_config_t wcfg = WIFI_INIT_CONFIG_DEFAULT();
+    if (cfg->fast_boot) {
+        wcfg.nvs_enable = 0;  // ไม่ต้องอ่าน/เขียน Wi-Fi config ใน NVS (ไม่ได้ต่อ AP)
+    }
+    ESP_RETURN_ON_ERROR(esp_wifi_init(&wcfg), TAG, "wifi init");
+    ESP_RETURN_ON_ERROR(esp_wifi_set_storage(WIFI_STORAGE_RAM), TAG, "wifi storage");
+    ESP_RETURN_ON_ERROR(esp_wifi_set_mode(WIFI_MODE_STA), TAG, "wifi mode");
+    if (cfg->channel >= 1 && cfg->channel <= 13) {
+        wifi_config_t sta_cfg = {0};
+        sta_cfg.sta.channel = cfg->channel;
+        ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg), TAG, "wifi config");
+    }
+    mark(ESPNOW_BOOT_STEP_WIFI_INIT);
+
+    ESP_RETURN_ON_ERROR(esp_wifi_start(), TAG, "wifi start");
+    mark(ESPNOW_BOOT_STEP_WIFI_START);
+
+    ESP_RETURN_ON_ERROR(esp_now_init(), TAG, "esp_now init");
+    mark(ESPNOW_BOOT_STEP_ESPNOW_INIT);
+
+#if !CONFIG_ESP_PHY_CALIBRATION_AND_DATA_STORAGE
+    // fast boot พึ่ง PHY calibration ที่เก็บใน NVS (partial cal แทน full cal) — แจ้งตอนรันแทน #warning
+    if (cfg->fast_boot) {
+        ESP_LOGW(TAG, "CONFIG_ESP_PHY_CALIBRATION_AND_DATA_STORAGE is off: every boot runs a full RF calibration");
+    }
+#endif
+    ESP_LOGI(TAG, "WiFi STA + ESP-NOW ready (channel=%u, %s boot) in %" PRId64 " ms",
+             cfg->channel, cfg->fast_boot ? "fast" : "normal",
+             (s_step_us[ESPNOW_BOOT_STEP_ESPNOW_INIT] - s_step_us[ESPNOW_BOOT_STEP_APP_START]) / 1000);
+    return ESP_OK;
+}
+
+esp_err_t espnow_boot_add_peer(const uint8_t mac[6], uint8_t channel) {
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.ifidx   = WIFI_IF_STA;
+    peer.channel = channel;
+    peer.encrypt = false;
+
+    esp_err_t er = esp_now_add_peer(&peer);
+    if (er != ESP_OK && er != ESP_ERR_ESPNOW_EXIST) return er;
+
+    if (s_step_us[ESPNOW_BOOT_STEP_PEER_ADD] < 0) mark(ESPNOW_BOOT_STEP_PEER_ADD);
+    return ESP_OK;
+}
+
+esp_err_t espnow_boot_touch_peer(const uint8_t mac[6]) {
+    ESP_RETURN_ON_FALSE(s_lru_lock, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    int64_t now = esp_timer_get_time();
+    esp_err_t er = ESP_OK;
+
+    xSemaphoreTake(s_lru_lock, portMAX_DELAY);
+    int hit = -1, oldest = 0;
+    for (int i = 0; i < ESPNOW_BOOT_LRU_PEERS; i++) {
+        if (s_lru[i].used_us && memcmp(s_lru[i].mac, mac, 6) == 0) { hit = i; break; }
+        if (s_lru[i].used_us < s_lru[oldest].used_us) oldest = i;
+    }
+    if (hit < 0 && esp_now_is_peer_exist(mac)) {
+        // peer ที่ที่อื่นเพิ่มไว้ (partner, discovery, ...) — ไม่ใช่ของเรา ไม่เคยลบ
+    } else if (hit < 0) {
+        er = espnow_boot_add_peer(mac, 0);
+        if (er == ESP_ERR_ESPNOW_FULL && s_lru[oldest].used_us) {
+            // ตาราง ESP-NOW เต็มจริง -> ปล่อยตัวที่ไม่ได้ใช้นานสุดแล้วลองใหม่
+            esp_now_del_peer(s_lru[oldest].mac);
+            s_lru[oldest].used_us = 0;
+            s_evictions++;
+            er = espnow_boot_add_peer(mac, 0);
+        }
+        // add ผ่าน = ตารางยังไม่เต็ม -> LRU (ขนาดเท่าตาราง) มีช่องว่างแน่ และ oldest คือช่องว่างนั้น
+        if (er == ESP_OK && !s_lru[oldest].used_us) {
+            memcpy(s_lru[oldest].mac, mac, 6);
+            hit = oldest;
+        }
+    } else if (!esp_now_is_peer_exist(mac)) {
+        er = espnow_boot_add_peer(mac, 0);      // ถูกลบจากที่อื่น
+    }
+    if (hit >= 0) s_lru[hit].used_us = now;
+    xSemaphoreGive(s_lru_lock);
+    return er;
+}
+
+uint32_t espnow_boot_peer_evictions(void) {
+    return s_evictions;
+}
+
+void espnow_boot_mark_first_tx(void) {
+    if (atomic_exchange(&s_first_tx_done, true)) return;
+
+    mark(ESPNOW_BOOT_STEP_FIRST_TX);
+    ESP_LOGI(TAG, "⏱️ boot -> first TX: %" PRId64 " ms (%s boot)",
+             s_step_us[ESPNOW_BOOT_STEP_FIRST_TX] / 1000, s_fast_boot ? "fast" : "normal");
+}
+
+int64_t espnow_boot_step_time_us(espnow_boot_step_t step) {
+    if (step < 0 || step >= ESPNOW_BOOT_STEP_MAX) return -1;
+    return s_step_us[step];
+}
+
+void espnow_boot_report(void) {
+    int64_t prev = 0;  // esp_timer เริ่มนับก่อน app_main ไม่นาน
+    ESP_LOGI(TAG, "boot timeline (%s):", s_fast_boot ? "fast" : "normal");
+    for (int i = 0; i < ESPNOW_BOOT_STEP_MAX; i++) {
+        if (s_step_us[i] < 0) {
+            ESP_LOGI(TAG, "   %-12s :      -", s_step_name[i]);
+            continue;
+        }
+        ESP_LOGI(TAG, "   %-12s : %6" PRId64 ".%03" PRId64 " ms  (+%" PRId64 " us)",
+                 s_step_name[i], s_step_us[i] / 1000, s_step_us[i] % 1000, s_step_us[i] - prev);
+        prev = s_step_us[i];
+    }
+}
@@ -0,0 +1,64 @@
+// components/espnow_boot/include/espnow_boot.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ลำดับขั้นตอนตอนบูต (ใช้เป็น index ของ timestamp) */
+typedef enum {
+    ESPNOW_BOOT_STEP_APP_START = 0,  // เข้า espnow_boot_init()
+    ESPNOW_BOOT_STEP_NVS,            // nvs_flash_init (+erase ถ้าจำเป็น)
+    ESPNOW_BOOT_STEP_NETIF,          // esp_netif_init (ข้ามได้ใน fast boot)
+    ESPNOW_BOOT_STEP_EVENT_LOOP,     // esp_event_loop_create_default (ข้ามได้ใน fast boot)
+    ESPNOW_BOOT_STEP_WIFI_INIT,      // esp_wifi_init + set_mode + channel
+    ESPNOW_BOOT_STEP_WIFI_START,     // esp_wifi_start (PHY calibration อยู่ในขั้นนี้)
+    ESPNOW_BOOT_STEP_ESPNOW_INIT,    // esp_now_init
+    ESPNOW_BOOT_STEP_PEER_ADD,       // esp_now_add_peer ครั้งแรก
+    ESPNOW_BOOT_STEP_FIRST_TX,       // send-cb ครั้งแรก = เฟรมแรกออกอากาศแล้ว
+    ESPNOW_BOOT_STEP_MAX
+} espnow_boot_step_t;
+
+typedef struct {
+    uint8_t channel;    // 1..13 หรือ 0 = ไม่ล็อกชานเนล
+    bool    fast_boot;  // ★ ข้าม esp_netif/event loop เมื่อใช้ ESP-NOW อย่างเดียว
+    bool    sta_netif;  // สร้าง netif STA ก่อน wifi start (ต่อ AP ทีหลังได้ เช่น gw_mqtt) — คู่กับ fast_boot = ESP_ERR_INVALID_ARG
+} espnow_boot_config_t;
+
+#define ESPNOW_BOOT_CONFIG_DEFAULT() { \
+    .channel   = 1,                    \
+    .fast_boot = false,                \
+    .sta_netif = false,                \
+}
+
+/* NVS -> (netif -> event loop) -> Wi-Fi STA -> ESP-NOW พร้อมจับเวลาทุกขั้น
+   ยังไม่ลงทะเบียน callback ให้ — แอปลงทะเบียนเองหลังฟังก์ชันนี้คืนค่า */
+esp_err_t espnow_boot_init(const espnow_boot_config_t *cfg);
+
+/* เพิ่ม peer (ข้าม ESP_ERR_ESPNOW_EXIST) — ครั้งแรกถูกบันทึกเป็น STEP_PEER_ADD */
+esp_err_t espnow_boot_add_peer(const uint8_t mac[6], uint8_t channel);
+
+/* สำหรับ peer จำนวนมาก (gateway ตอบทุก sender): เพิ่ม peer + จำลำดับใช้ล่าสุด
+   ลบเฉพาะตอนตาราง ESP-NOW เต็มจริง (add คืน ESP_ERR_ESPNOW_FULL) -> ลบ peer ที่ไม่ได้ใช้นานสุด
+   (เฉพาะที่เพิ่มผ่านฟังก์ชันนี้) แล้วเพิ่มใหม่
+   คืน ESP_ERR_ESPNOW_FULL ถ้าตารางเต็มด้วย peer ของที่อื่นทั้งหมด — ผู้เรียกข้ามการส่งครั้งนั้น */
+#define ESPNOW_BOOT_LRU_PEERS 20        // = ESP_NOW_MAX_TOTAL_PEER_NUM: ช่อง LRU ไม่เต็มก่อนตาราง ESP-NOW
+esp_err_t espnow_boot_touch_peer(const uint8_t mac[6]);
+uint32_t  espnow_boot_peer_evictions(void);
+
+/* เรียกจาก send-cb ได้ทุกครั้ง: บันทึกเฉพาะครั้งแรก แล้ว log boot->first TX */
+void espnow_boot_mark_first_tx(void);
+
+/* เวลา (us นับจาก esp_timer เริ่ม) ของขั้นนั้น, -1 ถ้ายังไม่ถึง/ถูกข้าม */
+int64_t espnow_boot_step_time_us(espnow_boot_step_t step);
+
+/* พิมพ์ตารางเวลาแต่ละขั้น (ms สะสม + ms ที่ใช้ในขั้นนั้น) */
+void espnow_boot_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,487 @@
+// components/espnow_disc/espnow_disc.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "nvs.h"
+#include "espnow_disc.h"
+
+static const char *TAG = "ESPNOW_DISC";
+
+#define NVS_NS       "espnow_disc"
+#define NVS_KEY      "peers"
+#define NVS_KEY_CH   "chan"
+#define RX_QUEUE     8
+#define REPLY_SLOTS  4
+
+static const uint8_t BCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+typedef struct {
+    bool                rescan;       // true = จาก espnow_disc_on_sent (ไม่มี frame, src = peer ที่หาย)
+    uint8_t             src[6];
+    espnow_disc_frame_t f;
+} disc_evt_t;
+
+typedef struct {
+    bool    used;
+    uint8_t target[6];
+    int64_t due_us;
+} pending_reply_t;
+
+static espnow_disc_config_t s_cfg;
+static uint8_t              s_my_mac[6];
+static uint8_t              s_caps;
+static espnow_disc_peer_t   s_peers[ESPNOW_DISC_MAX_PEERS];   // [0] = ยืนยันล่าสุด ... ท้าย = เก่าสุด (ลำดับนี้ลง NVS ด้วย)
+static int                  s_n_peers;
+static pending_reply_t      s_replies[REPLY_SLOTS];
+static espnow_disc_stats_t  s_stats = { .first_peer_us = -1, .last_link_us = -1 };
+static portMUX_TYPE         s_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t        s_rx_q;
+static SemaphoreHandle_t    s_found;
+static volatile bool        s_searching;      // ยังส่ง HELLO อยู่
+static uint32_t             s_hello_ms;       // ช่วงห่าง HELLO ปัจจุบัน (backoff)
+static int64_t              s_next_hello_us;
+static uint8_t              s_channel;        // channel ที่ล็อกอยู่ (home)
+static uint8_t              s_scan_ch;        // 0 = ไม่ได้กวาด, ไม่งั้น channel ที่ฟังอยู่
+static int64_t              s_scan_next_us;   // เวลาย้ายไป channel ถัดไป
+static int64_t              s_sweep_at_us;    // เวลาเริ่มกวาดรอบถัดไป
+static int64_t              s_search_start_us;
+static uint8_t              s_loss;           // unicast FAIL ติดกัน
+
+/* ---------- NVS ---------- */
+
+static void nvs_load(void) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) != ESP_OK) return;
+    size_t len = sizeof(s_peers);
+    if (nvs_get_blob(h, NVS_KEY, s_peers, &len) == ESP_OK && len % sizeof(espnow_disc_peer_t) == 0) {
+        s_n_peers = len / sizeof(espnow_disc_peer_t);
+    }
+    nvs_close(h);
+}
+
+static uint8_t nvs_load_channel(void) {
+    nvs_handle_t h;
+    uint8_t ch = 0;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) != ESP_OK) return 0;
+    if (nvs_get_u8(h, NVS_KEY_CH, &ch) != ESP_OK) ch = 0;
+    nvs_close(h);
+    return (ch >= ESPNOW_DISC_CH_MIN && ch <= ESPNOW_DISC_CH_MAX) ? ch : 0;
+}
+
+static void nvs_save_channel(uint8_t ch) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_u8(h, NVS_KEY_CH, ch) == ESP_OK) nvs_commit(h);
+    nvs_close(h);
+}
+
+static void nvs_save(void) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    espnow_disc_peer_t copy[ESPNOW_DISC_MAX_PEERS];
+    portENTER_CRITICAL(&s_lock);
+    int n = s_n_peers;
+    memcpy(copy, s_peers, sizeof(copy));
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t er = (n > 0) ? nvs_set_blob(h, NVS_KEY, copy, n * sizeof(espnow_disc_peer_t))
+                           : nvs_erase_key(h, NVS_KEY);
+    if (er == ESP_OK || er == ESP_ERR_NVS_NOT_FOUND) nvs_commit(h);
+    nvs_close(h);
+}
+
+/* ---------- peers ---------- */
+
+static esp_err_t add_espnow_peer(const uint8_t mac[6], uint8_t channel) {
+    if (esp_now_is_peer_exist(mac)) return ESP_OK;
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.ifidx   = WIFI_IF_STA;
+    peer.channel = channel;
+    peer.encrypt = false;
+    return esp_now_add_peer(&peer);
+}
+
+/* ---------- TX ---------- */
+
+static void send_frame(uint8_t kind, const uint8_t *target) {
+    espnow_disc_frame_t f = {0};
+    f.hdr.type  = ESPNOW_MSG_DISC;
+    f.kind      = kind;
+    f.role      = s_cfg.my_role;
+    f.want_role = s_cfg.want_role;
+    f.caps      = s_caps;
+    f.channel   = s_scan_ch ? s_scan_ch : s_channel;   // channel ที่ frame นี้ออกไปจริง
+    if (target) memcpy(f.target, target, 6);
+
+    if (esp_now_send(BCAST, (const uint8_t *)&f, sizeof(f)) != ESP_OK) return;
+    portENTER_CRITICAL(&s_lock);
+    if (kind == ESPNOW_DISC_HELLO) s_stats.hellos_tx++;
+    else                           s_stats.replies_tx++;
+    s_stats.bytes_tx += sizeof(f);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* ---------- channel ---------- */
+
+static void tune(uint8_t ch) {
+    esp_err_t er = esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+    if (er != ESP_OK) ESP_LOGW(TAG, "set channel %u failed: %s", ch, esp_err_to_name(er));
+}
+
+/* เจอ role ที่หาแล้ว: หยุดกวาด ล็อก channel ของเขา จับเวลา time-to-link */
+static void lock_channel(uint8_t ch, int64_t now) {
+    bool moved = (ch >= ESPNOW_DISC_CH_MIN && ch <= ESPNOW_DISC_CH_MAX && ch != s_channel);
+    if (moved) s_channel = ch;
+    if (s_scan_ch != 0 || moved) tune(s_channel);
+    s_scan_ch = 0;
+    s_loss    = 0;
+
+    int64_t link_us = now - s_search_start_us;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.channel      = s_channel;
+    s_stats.last_link_us = link_us;
+    if (link_us > s_stats.max_link_us) s_stats.max_link_us = link_us;
+    if (moved) s_stats.retunes++;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (moved) {
+        ESP_LOGI(TAG, "📡 locked on ch=%u after %" PRId64 " ms", s_channel, link_us / 1000);
+        if (s_cfg.use_nvs) nvs_save_channel(s_channel);
+    }
+}
+
+/* เริ่มหาใหม่ (บูต / forget_all / unicast หายติดกัน) */
+static void start_search(int64_t now) {
+    s_hello_ms        = ESPNOW_DISC_HELLO_FIRST_MS;
+    s_next_hello_us   = 0;
+    s_search_start_us = now;
+    s_sweep_at_us     = now + (int64_t)ESPNOW_DISC_HOME_WAIT_MS * 1000;
+    s_searching       = (s_cfg.want_role != ESPNOW_DISC_ROLE_NONE);
+}
+
+/* ทีละ channel: ย้าย -> HELLO -> ฟัง DWELL ms; ครบ 13 แล้วกลับ home พัก */
+static void scan_step(int64_t now) {
+    if (s_scan_ch == 0) {
+        s_scan_ch = ESPNOW_DISC_CH_MIN;
+    } else if (++s_scan_ch > ESPNOW_DISC_CH_MAX) {
+        s_scan_ch = 0;
+        tune(s_channel);
+        s_sweep_at_us = now + (int64_t)(ESPNOW_DISC_SCAN_REST_MS + esp_random() % (ESPNOW_DISC_SCAN_REST_MS + 1)) * 1000;
+        portENTER_CRITICAL(&s_lock);
+        s_stats.sweeps++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    tune(s_scan_ch);
+    send_frame(ESPNOW_DISC_HELLO, NULL);
+    s_scan_next_us = now + (int64_t)ESPNOW_DISC_SCAN_DWELL_MS * 1000;
+}
+
+/* ใต้ s_lock: ย้าย s_peers[from] ไป index to (เลื่อนตัวที่อยู่ระหว่างนั้น) */
+static void move_peer_locked(int from, int to) {
+    espnow_disc_peer_t p = s_peers[from];
+    if (from > to) memmove(&s_peers[to + 1], &s_peers[to], (from - to) * sizeof(p));
+    else           memmove(&s_peers[from], &s_peers[from + 1], (to - from) * sizeof(p));
+    s_peers[to] = p;
+}
+
+/* เรียกจาก disc task: จำ peer ใหม่ / อัปเดต role แล้วขึ้นหัวตาราง (ยืนยันล่าสุด)
+   ตารางเต็ม = ตัวท้าย (ไม่ได้ยินนานสุด) หลุด — คืน true ถ้าเป็น peer ใหม่ */
+static bool learn_peer(const uint8_t mac[6], uint8_t role, uint8_t channel) {
+    bool is_new = true, want = (role == s_cfg.want_role), moved = false, dropped = false;
+    uint8_t evicted[6];
+
+    portENTER_CRITICAL(&s_lock);
+    int idx = -1;
+    for (int i = 0; i < s_n_peers && idx < 0; i++) {
+        if (memcmp(s_peers[i].mac, mac, 6) == 0) idx = i;
+    }
+    if (idx < 0) {
+        if (s_n_peers == ESPNOW_DISC_MAX_PEERS) {
+            memcpy(evicted, s_peers[--s_n_peers].mac, 6);
+            dropped = true;
+        }
+        idx = s_n_peers++;
+        memcpy(s_peers[idx].mac, mac, 6);
+    } else {
+        is_new = false;
+        moved  = (idx != 0);
+    }
+    s_peers[idx].role    = role;
+    s_peers[idx].channel = channel;
+    move_peer_locked(idx, 0);
+    if (want && s_stats.first_peer_us < 0) s_stats.first_peer_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+
+    if (dropped) {
+        ESP_LOGI(TAG, "🗑️ peer table full, dropped stalest %02X:%02X:%02X:%02X:%02X:%02X",
+                 evicted[0], evicted[1], evicted[2], evicted[3], evicted[4], evicted[5]);
+    }
+
+    if (!want) return is_new;
+    if (s_searching) lock_channel(channel, esp_timer_get_time());
+    esp_err_t er = add_espnow_peer(mac, 0);
+    if (er != ESP_OK) ESP_LOGW(TAG, "add peer failed: %s", esp_err_to_name(er));
+    if (is_new) {
+        ESP_LOGI(TAG, "🤝 peer %02X:%02X:%02X:%02X:%02X:%02X role=%u ch=%u",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], role, channel);
+    }
+    if ((is_new || moved) && s_cfg.use_nvs) nvs_save();
+    s_searching = false;
+    xSemaphoreGive(s_found);
+    return is_new;
+}
+
+/* ---------- RX (Wi-Fi task) ---------- */
+
+static void on_disc(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    disc_evt_t e;
+    e.rescan = false;
+    memcpy(e.src, info->src_addr, 6);
+    memcpy(&e.f, data, sizeof(e.f));
+    xQueueSend(s_rx_q, &e, 0);   // เต็มก็ทิ้ง — HELLO รอบหน้าจะมาอีก
+}
+
+static void handle_evt(const disc_evt_t *e, int64_t now) {
+    if (e->rescan) {
+        if (s_searching) return;
+        ESP_LOGW(TAG, "📡 %u unicast failures to %02X:%02X:%02X:%02X:%02X:%02X on ch=%u, demoted, searching again",
+                 ESPNOW_DISC_LOSS_LIMIT, e->src[0], e->src[1], e->src[2], e->src[3], e->src[4], e->src[5], s_channel);
+        // ลงท้ายตาราง (+ NVS): บอร์ดถูกเปลี่ยน -> peer ใหม่ที่เจอขึ้นหัวแทน, ตัวเดิมกลับมาก็ขึ้นหัวเองตอน HELLO
+        portENTER_CRITICAL(&s_lock);
+        s_stats.rescans++;
+        for (int i = 0; i < s_n_peers; i++) {
+            if (memcmp(s_peers[i].mac, e->src, 6) == 0) {
+                move_peer_locked(i, s_n_peers - 1);
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (s_cfg.use_nvs) nvs_save();
+        start_search(now);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.frames_rx++;
+    portEXIT_CRITICAL(&s_lock);
+
+    const espnow_disc_frame_t *f = &e->f;
+    if (f->kind == ESPNOW_DISC_HELLO) {
+        // มีคนหา role เรา -> ตอบหลังสุ่มรอ (กัน reply ชนกันเมื่อมีหลาย node)
+        if (f->want_role == s_cfg.my_role) {
+            for (int i = 0; i < REPLY_SLOTS; i++) {
+                if (s_replies[i].used && memcmp(s_replies[i].target, e->src, 6) == 0) break;
+                if (s_replies[i].used) continue;
+                s_replies[i].used   = true;
+                memcpy(s_replies[i].target, e->src, 6);
+                s_replies[i].due_us = now + (int64_t)(esp_random() % (ESPNOW_DISC_REPLY_JITTER_MS + 1)) * 1000;
+                break;
+            }
+        }
+        // เขาเป็น role ที่เราหาอยู่ -> จำได้เลยไม่ต้องรอ REPLY
+        if (s_cfg.want_role != ESPNOW_DISC_ROLE_NONE && f->role == s_cfg.want_role) {
+            learn_peer(e->src, f->role, f->channel);
+        }
+    } else if (f->kind == ESPNOW_DISC_REPLY && memcmp(f->target, s_my_mac, 6) == 0) {
+        learn_peer(e->src, f->role, f->channel);
+    }
+}
+
+static void disc_task(void *arg) {
+    while (1) {
+        int64_t now = esp_timer_get_time();
+
+        if (!s_searching && s_scan_ch != 0) {   // หยุดหากลางรอบกวาด -> กลับ home
+            s_scan_ch = 0;
+            tune(s_channel);
+        }
+        if (s_searching && s_cfg.scan && (s_scan_ch ? now >= s_scan_next_us : now >= s_sweep_at_us)) {
+            scan_step(now);
+        }
+        if (s_searching && s_scan_ch == 0 && now >= s_next_hello_us) {
+            send_frame(ESPNOW_DISC_HELLO, NULL);
+            s_next_hello_us = now + (int64_t)s_hello_ms * 1000;
+            s_hello_ms = (s_hello_ms * 2 > ESPNOW_DISC_HELLO_MAX_MS) ? ESPNOW_DISC_HELLO_MAX_MS : s_hello_ms * 2;
+        }
+        int64_t next = now + 1000000;
+        if (s_searching) {
+            next = s_scan_ch ? s_scan_next_us : s_next_hello_us;
+            if (s_cfg.scan && s_scan_ch == 0 && s_sweep_at_us < next) next = s_sweep_at_us;
+        }
+        for (int i = 0; i < REPLY_SLOTS; i++) {
+            if (!s_replies[i].used) continue;
+            if (s_replies[i].due_us <= now) {
+                send_frame(ESPNOW_DISC_REPLY, s_replies[i].target);
+                s_replies[i].used = false;
+            } else if (s_replies[i].due_us < next) {
+                next = s_replies[i].due_us;
+            }
+        }
+
+        disc_evt_t e;
+        TickType_t ticks = (next > now) ? pdMS_TO_TICKS((next - now) / 1000) + 1 : 0;
+        if (xQueueReceive(s_rx_q, &e, ticks) == pdTRUE) handle_evt(&e, esp_timer_get_time());
+    }
+}
+
+/* ---------- API ---------- */
+
+esp_err_t espnow_disc_init(const espnow_disc_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "cfg is NULL");
+    ESP_RETURN_ON_FALSE(!s_rx_q, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    s_cfg = *cfg;
+
+    uint32_t ver = 1;
+    s_caps = (esp_now_get_version(&ver) == ESP_OK && ver >= 2) ? 0x01 : 0x00;
+    ESP_RETURN_ON_ERROR(esp_wifi_get_mac(WIFI_IF_STA, s_my_mac), TAG, "get mac");
+    ESP_RETURN_ON_ERROR(add_espnow_peer(BCAST, 0), TAG, "broadcast peer");
+
+    // channel ที่ล็อกได้ครั้งก่อน (หรือที่ gateway ถูกย้ายไป) ชนะค่า compile-time
+    uint8_t saved = cfg->use_nvs ? nvs_load_channel() : 0;
+    s_channel = saved ? saved : cfg->channel;
+    if (saved && saved != cfg->channel) tune(s_channel);
+    s_stats.channel = s_channel;
+
+    s_rx_q  = xQueueCreate(RX_QUEUE, sizeof(disc_evt_t));
+    s_found = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(s_rx_q && s_found, ESP_ERR_NO_MEM, TAG, "queue");
+
+    // peer จาก NVS: ส่งได้ทันที แต่ยังส่ง HELLO ให้อีกฝั่งรู้จักเรา (เผื่อเขาลืมไปแล้ว)
+    if (cfg->use_nvs) nvs_load();
+    for (int i = 0; i < s_n_peers; i++) {
+        if (s_peers[i].role != cfg->want_role) continue;
+        if (add_espnow_peer(s_peers[i].mac, 0) != ESP_OK) continue;
+        if (s_stats.first_peer_us < 0) {
+            s_stats.first_peer_us = esp_timer_get_time();
+            s_stats.from_nvs = true;
+            xSemaphoreGive(s_found);
+        }
+    }
+
+    start_search(esp_timer_get_time());
+    ESP_RETURN_ON_ERROR(espnow_msg_register(ESPNOW_MSG_DISC, sizeof(espnow_disc_frame_t), on_disc), TAG, "register");
+    ESP_RETURN_ON_FALSE(xTaskCreate(disc_task, "espnow_disc", 3072, NULL, 4, NULL) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    ESP_LOGI(TAG, "role=%u want=%u ch=%u%s%s, %d peer(s) from NVS", cfg->my_role, cfg->want_role,
+             s_channel, saved ? " (NVS)" : "", cfg->scan ? " scan" : "", s_n_peers);
+    return ESP_OK;
+}
+
+esp_err_t espnow_disc_wait_peer(uint8_t mac_out[6], uint32_t timeout_ms) {
+    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    while (1) {
+        portENTER_CRITICAL(&s_lock);
+        int found = -1;
+        for (int i = 0; i < s_n_peers && found < 0; i++) {
+            if (s_peers[i].role == s_cfg.want_role) found = i;
+        }
+        if (found >= 0) memcpy(mac_out, s_peers[found].mac, 6);
+        portEXIT_CRITICAL(&s_lock);
+        if (found >= 0) return ESP_OK;
+        if (xSemaphoreTake(s_found, ticks) != pdTRUE) return ESP_ERR_TIMEOUT;
+    }
+}
+
+bool espnow_disc_refresh_peer(uint8_t mac_io[6]) {
+    bool changed = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_n_peers; i++) {
+        if (s_peers[i].role != s_cfg.want_role) continue;
+        changed = (memcmp(mac_io, s_peers[i].mac, 6) != 0);
+        if (changed) memcpy(mac_io, s_peers[i].mac, 6);
+        break;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return changed;
+}
+
+int espnow_disc_get_peers(espnow_disc_peer_t *out, int max) {
+    portENTER_CRITICAL(&s_lock);
+    int n = (s_n_peers < max) ? s_n_peers : max;
+    memcpy(out, s_peers, n * sizeof(espnow_disc_peer_t));
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+esp_err_t espnow_disc_forget_all(void) {
+    portENTER_CRITICAL(&s_lock);
+    s_n_peers = 0;
+    s_stats.first_peer_us = -1;
+    s_stats.from_nvs = false;
+    portEXIT_CRITICAL(&s_lock);
+    if (s_cfg.use_nvs) nvs_save();
+
+    start_search(esp_timer_get_time());
+    return ESP_OK;
+}
+
+void espnow_disc_on_sent(const uint8_t mac[6], bool ok) {
+    if (!s_rx_q || !mac) return;
+    bool known = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_n_peers && !known; i++) {
+        known = (s_peers[i].role == s_cfg.want_role && memcmp(s_peers[i].mac, mac, 6) == 0);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (!known) return;
+
+    if (ok) {
+        s_loss = 0;
+        return;
+    }
+    if (++s_loss != ESPNOW_DISC_LOSS_LIMIT) return;
+    disc_evt_t e = { .rescan = true };
+    memcpy(e.src, mac, 6);
+    xQueueSend(s_rx_q, &e, 0);
+}
+
+esp_err_t espnow_disc_set_channel(uint8_t channel) {
+    ESP_RETURN_ON_FALSE(channel >= ESPNOW_DISC_CH_MIN && channel <= ESPNOW_DISC_CH_MAX,
+                        ESP_ERR_INVALID_ARG, TAG, "bad channel");
+    ESP_RETURN_ON_FALSE(s_rx_q, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    if (channel == s_channel) return ESP_OK;
+
+    s_channel = channel;
+    tune(channel);
+    if (s_cfg.use_nvs) nvs_save_channel(channel);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.channel = channel;
+    s_stats.retunes++;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "📡 moved to ch=%u", channel);
+    return ESP_OK;
+}
+
+uint8_t espnow_disc_channel(void) {
+    return s_channel;
+}
+
+void espnow_disc_get_stats(espnow_disc_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void espnow_disc_report(void) {
+    espnow_disc_stats_t st;
+    espnow_disc_get_stats(&st);
+    ESP_LOGI(TAG, "⏱️ first peer at %" PRId64 " ms (%s), hello=%" PRIu32 " reply=%" PRIu32
+             " rx=%" PRIu32 " tx_bytes=%" PRIu32,
+             st.first_peer_us < 0 ? -1 : st.first_peer_us / 1000, st.from_nvs ? "NVS" : "discovery",
+             st.hellos_tx, st.replies_tx, st.frames_rx, st.bytes_tx);
+    ESP_LOGI(TAG, "📡 ch=%u link=%" PRId64 " ms (max %" PRId64 " ms) sweeps=%" PRIu32
+             " retunes=%" PRIu32 " rescans=%" PRIu32,
+             st.channel, st.last_link_us < 0 ? -1 : st.last_link_us / 1000, st.max_link_us / 1000,
+             st.sweeps, st.retunes, st.rescans);
+}
@@ -0,0 +1,108 @@
+// components/espnow_disc/include/espnow_disc.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ค้นหา/จับคู่ peer อัตโนมัติแทนการ hardcode MAC
+   - broadcast HELLO (role + role ที่ต้องการ) ถี่ตอนบูต แล้วห่างขึ้นเรื่อย ๆ (50 ms -> 1 s)
+   - node ที่ role ตรงตอบ REPLY แบบ broadcast หลังสุ่มรอ 0..JITTER ms (ไม่ต้อง add peer ก่อนตอบ)
+   - peer ที่เจอถูกเก็บใน NVS -> บูตครั้งถัดไปส่งได้ทันทีโดยไม่ต้องรอ discovery
+   - scan=true: ไม่มีใครตอบบน channel ปัจจุบัน -> กวาด ch 1..13 (HELLO + dwell สั้น ๆ)
+     เจอ role ที่หาบน channel ไหนก็ล็อกที่นั่นและจำ channel ใน NVS,
+     unicast หาย LOSS_LIMIT ครั้งติดกัน (espnow_disc_on_sent) -> peer นั้นลงท้ายตาราง (NVS ด้วย) แล้วกวาดใหม่
+   - ตาราง peer เรียงตามที่ยืนยันล่าสุด: wait/refresh คืนตัวบนสุด, เต็มแล้วตัวท้ายหลุด
+     แอปเรียก espnow_disc_refresh_peer() เป็นระยะ -> บอร์ดคู่ถูกเปลี่ยนก็ย้ายตามได้โดยไม่ต้องลบ NVS
+     ย้ายทั้ง fleet = ย้าย gateway ด้วย espnow_disc_set_channel() แล้ว node จะตามไปเอง */
+
+#define ESPNOW_DISC_MAX_PEERS        8
+#define ESPNOW_DISC_HELLO_FIRST_MS   50
+#define ESPNOW_DISC_HELLO_MAX_MS     1000
+#define ESPNOW_DISC_REPLY_JITTER_MS  30
+#define ESPNOW_DISC_HOME_WAIT_MS     300     // รอบน channel เดิมก่อนเริ่มกวาด
+#define ESPNOW_DISC_SCAN_DWELL_MS    40      // ต่อ channel (REPLY jitter สูงสุด 30 ms)
+#define ESPNOW_DISC_SCAN_REST_MS     500     // พักที่ channel เดิมระหว่างรอบ (สุ่ม 0..REST เพิ่ม)
+#define ESPNOW_DISC_LOSS_LIMIT       8       // unicast FAIL ติดกันก่อนกวาดใหม่
+#define ESPNOW_DISC_CH_MIN           1
+#define ESPNOW_DISC_CH_MAX           13
+
+typedef enum {
+    ESPNOW_DISC_ROLE_NONE = 0,      // want_role: ไม่หาใคร (ตอบอย่างเดียว)
+    ESPNOW_DISC_ROLE_LED_CTRL,      // sender_led
+    ESPNOW_DISC_ROLE_LED_NODE,      // receiver_led
+    ESPNOW_DISC_ROLE_SENSOR,        // sender_data
+    ESPNOW_DISC_ROLE_GATEWAY,       // recever_data
+    ESPNOW_DISC_ROLE_CHAT,          // challenge3_a / challenge3_b
+} espnow_disc_role_t;
+
+typedef enum {
+    ESPNOW_DISC_HELLO = 0,
+    ESPNOW_DISC_REPLY = 1,
+} espnow_disc_kind_t;
+
+/* 12 byte ทั้ง HELLO และ REPLY */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;           // ESPNOW_MSG_DISC
+    uint8_t kind;                   // espnow_disc_kind_t
+    uint8_t role;
+    uint8_t want_role;
+    uint8_t caps;                   // bit0 = ESP-NOW v2
+    uint8_t channel;
+    uint8_t target[6];              // REPLY: MAC ของคนที่ส่ง HELLO
+} espnow_disc_frame_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t role;
+    uint8_t channel;
+} espnow_disc_peer_t;
+
+typedef struct {
+    uint8_t  my_role;
+    uint8_t  want_role;             // ESPNOW_DISC_ROLE_NONE = ไม่ส่ง HELLO
+    uint8_t  channel;               // channel เริ่มต้น (channel ใน NVS มาก่อนถ้า use_nvs)
+    bool     use_nvs;               // โหลด/บันทึก peer + channel ที่เจอ
+    bool     scan;                  // กวาด channel เมื่อหา peer ไม่เจอ/ขาดการติดต่อ
+} espnow_disc_config_t;
+
+typedef struct {
+    uint32_t hellos_tx;
+    uint32_t replies_tx;
+    uint32_t frames_rx;
+    uint32_t bytes_tx;
+    int64_t  first_peer_us;         // เวลาจากบูตถึงได้ peer แรก (-1 = ยัง)
+    bool     from_nvs;              // peer แรกมาจาก NVS
+    uint8_t  channel;               // channel ปัจจุบัน
+    uint32_t sweeps;                // จำนวนรอบกวาด 1..13
+    uint32_t retunes;               // ย้าย channel (กวาดเจอที่ใหม่ / set_channel)
+    uint32_t rescans;               // เริ่มกวาดใหม่เพราะ unicast หายติดกัน
+    int64_t  last_link_us;          // เวลาเริ่มหา -> ล็อก channel ครั้งล่าสุด (-1 = ยัง)
+    int64_t  max_link_us;
+} espnow_disc_stats_t;
+
+/* ลงทะเบียน handler + สร้าง task — เรียกหลัง espnow_boot_init() และก่อน register recv-cb */
+esp_err_t espnow_disc_init(const espnow_disc_config_t *cfg);
+/* รอจนรู้จัก peer ที่ role = want_role อย่างน้อย 1 ตัว (peer ถูก add ให้แล้ว) — คืนตัวที่ยืนยันล่าสุด */
+esp_err_t espnow_disc_wait_peer(uint8_t mac_out[6], uint32_t timeout_ms);
+/* ไม่รอ: peer ที่ต้องการตัวที่ยืนยันล่าสุดต่างจาก mac_io -> copy ทับแล้วคืน true (แอปย้าย partner ตาม) */
+bool      espnow_disc_refresh_peer(uint8_t mac_io[6]);
+int       espnow_disc_get_peers(espnow_disc_peer_t *out, int max);
+/* ลบ peer ที่จำไว้ทั้งหมด (RAM + NVS) แล้วเริ่ม HELLO ใหม่ */
+esp_err_t espnow_disc_forget_all(void);
+/* เรียกจาก send-cb: นับ unicast FAIL ติดกันของ peer ที่ discovery รู้จัก */
+void      espnow_disc_on_sent(const uint8_t mac[6], bool ok);
+/* ย้าย channel ของเครื่องนี้ทันที (+ บันทึก NVS) — ใช้กับ gateway เพื่อย้ายทั้ง fleet */
+esp_err_t espnow_disc_set_channel(uint8_t channel);
+uint8_t   espnow_disc_channel(void);
+void      espnow_disc_get_stats(espnow_disc_stats_t *out);
+void      espnow_disc_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+// components/espnow_flow/espnow_flow.c
+#include <string.h>
+#include "esp_timer.h"
+#include "espnow_flow.h"
+
+/* seq a ใหม่กว่า b (รองรับ wrap) */
+static inline bool seq_after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/* ===================== token bucket ===================== */
+
+void espnow_flow_bucket_init(espnow_flow_bucket_t *b, uint32_t rate_per_s, uint32_t burst) {
+    b->rate_per_s   = rate_per_s;
+    b->burst        = burst ? burst : 1;
+    b->tokens_milli = (uint64_t)b->burst * 1000;
+    b->last_us      = esp_timer_get_time();
+}
+
+static void bucket_refill(espnow_flow_bucket_t *b) {
+    int64_t now = esp_timer_get_time();
+    uint64_t add = (uint64_t)(now - b->last_us) * b->rate_per_s / 1000;   // us * tok/s / 1e6 * 1000
+    uint64_t cap = (uint64_t)b->burst * 1000;
+    b->tokens_milli = (b->tokens_milli + add > cap) ? cap : b->tokens_milli + add;
+    b->last_us = now;
+}
+
+bool espnow_flow_bucket_take(espnow_flow_bucket_t *b) {
+    if (b->rate_per_s == 0) return true;
+    bucket_refill(b);
+    if (b->tokens_milli < 1000) return false;
+    b->tokens_milli -= 1000;
+    return true;
+}
+
+int64_t espnow_flow_bucket_wait_us(espnow_flow_bucket_t *b) {
+    if (b->rate_per_s == 0) return 0;
+    bucket_refill(b);
+    if (b->tokens_milli >= 1000) return 0;
+    return (int64_t)((1000 - b->tokens_milli) * 1000 / b->rate_per_s) + 1;
+}
+
+/* ===================== sender ===================== */
+
+void espnow_flow_tx_init(espnow_flow_tx_t *tx) {
+    memset(tx, 0, sizeof(*tx));
+    portMUX_INITIALIZE(&tx->lock);
+    tx->next_seq       = 1;
+    tx->limit          = ESPNOW_FLOW_INITIAL_WINDOW;
+    tx->last_credit_us = esp_timer_get_time();
+}
+
+bool espnow_flow_tx_acquire(espnow_flow_tx_t *tx, uint32_t *seq) {
+    bool ok;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&tx->lock);
+    ok = !seq_after(tx->next_seq, tx->limit);
+    if (!ok && now - tx->last_credit_us >= ESPNOW_FLOW_PROBE_MS * 1000) {
+        // credit หาย/receiver reboot: ส่ง 1 เฟรมให้ receiver ตอบ credit กลับมา
+        ok = true;
+        tx->probes++;
+        tx->last_credit_us = now;
+    }
+    if (ok) {
+        *seq = tx->next_seq++;
+        tx->sent++;
+    } else {
+        tx->stalls++;
+    }
+    portEXIT_CRITICAL(&tx->lock);
+    return ok;
+}
+
+bool espnow_flow_tx_on_credit(espnow_flow_tx_t *tx, const uint8_t *data, int len) {
+    if (len != sizeof(espnow_flow_credit_t)) return false;
+    espnow_flow_credit_t c;
+    memcpy(&c, data, sizeof(c));
+
+    uint32_t limit = c.ack_seq + c.window;
+    bool opened = false;
+
+    portENTER_CRITICAL(&tx->lock);
+    tx->credits_rx++;
+    tx->last_credit_us = esp_timer_get_time();
+    // credit ที่มาช้ากว่า (limit ต่ำกว่า) ไม่ลดหน้าต่างลง ยกเว้น receiver เพิ่งเริ่มใหม่ (ack_seq ถอยหลัง)
+    if (seq_after(limit, tx->limit) || seq_after(tx->next_seq, c.ack_seq + 1 + ESPNOW_FLOW_RESTART_BACK)) {
+        opened = seq_after(limit, tx->limit);
+        tx->limit = limit;
+    }
+    portEXIT_CRITICAL(&tx->lock);
+    return opened;
+}
+
+/* ===================== receiver ===================== */
+
+void espnow_flow_rx_init(espnow_flow_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+    portMUX_INITIALIZE(&rx->lock);
+}
+
+void espnow_flow_rx_on_frame(espnow_flow_rx_t *rx, uint32_t seq) {
+    portENTER_CRITICAL(&rx->lock);
+    rx->received++;
+    if (rx->highest != 0 && (seq == 1 || seq_after(rx->highest, seq + ESPNOW_FLOW_RESTART_BACK))) {
+        // sender รีบูต: ไม่งั้น ack_seq ค้างที่ highest เดิม -> sender ได้ limit = highest เดิม + window (ไม่มี backpressure)
+        rx->restarts++;
+        rx->highest = 0;
+        rx->lost    = 0;
+    }
+    if (rx->highest == 0 || seq_after(seq, rx->highest)) {
+        if (rx->highest != 0) rx->lost += seq - rx->highest - 1;
+        rx->highest = seq;
+    }
+    portEXIT_CRITICAL(&rx->lock);
+}
+
+void espnow_flow_rx_build(espnow_flow_rx_t *rx, uint8_t free_slots, espnow_flow_credit_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->hdr.type = ESPNOW_MSG_FLOW_CREDIT;
+    portENTER_CRITICAL(&rx->lock);
+    out->ack_seq = rx->highest;
+    portEXIT_CRITICAL(&rx->lock);
+    out->window = free_slots;
+}
@@ -0,0 +1,75 @@
+// components/espnow_flow/include/espnow_flow.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* credit-based flow control: receiver บอก "ส่งได้ถึง seq ไหน" (ack_seq + window)
+   ใช้ seq สูงสุดที่เห็นแทนจำนวนเฟรม -> เฟรมหาย/credit หายก็ไม่ทำให้หน้าต่างหดถาวร */
+
+#define ESPNOW_FLOW_INITIAL_WINDOW  1      // ส่งได้กี่เฟรมก่อนได้ credit แรก
+#define ESPNOW_FLOW_PROBE_MS        1000   // ไม่มี credit นานเท่านี้ -> ส่ง probe 1 เฟรม
+#define ESPNOW_FLOW_RESTART_BACK    64     // seq/ack_seq ถอยเกินนี้ = อีกฝั่งรีบูต (เริ่มนับใหม่)
+
+/* Receiver -> Sender (unicast) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;      // ESPNOW_MSG_FLOW_CREDIT
+    uint32_t ack_seq;          // seq สูงสุดที่รับแล้ว
+    uint8_t  window;           // ช่องว่างใน RX queue ตอนนี้
+} espnow_flow_credit_t;
+
+/* ---- token bucket (ต่อ peer) ---- */
+typedef struct {
+    uint32_t rate_per_s;       // token ต่อวินาที (0 = ไม่จำกัด)
+    uint32_t burst;            // token สูงสุดที่สะสมได้
+    uint64_t tokens_milli;     // token x1000 (เติมทีละน้อยได้)
+    int64_t  last_us;
+} espnow_flow_bucket_t;
+
+void    espnow_flow_bucket_init(espnow_flow_bucket_t *b, uint32_t rate_per_s, uint32_t burst);
+bool    espnow_flow_bucket_take(espnow_flow_bucket_t *b);
+/* เวลาที่ต้องรอจนมี token 1 ตัว (0 = ส่งได้เลย) */
+int64_t espnow_flow_bucket_wait_us(espnow_flow_bucket_t *b);
+
+/* ---- ฝั่ง sender ---- */
+typedef struct {
+    portMUX_TYPE lock;
+    uint32_t next_seq;         // seq ของเฟรมถัดไป (เริ่ม 1)
+    uint32_t limit;            // ส่งได้ถึง seq นี้ (รวม)
+    int64_t  last_credit_us;
+    uint32_t sent;
+    uint32_t stalls;           // ครั้งที่ต้องรอ credit
+    uint32_t probes;
+    uint32_t credits_rx;
+} espnow_flow_tx_t;
+
+void     espnow_flow_tx_init(espnow_flow_tx_t *tx);
+/* true = ส่ง seq ถัดไปได้ (มี credit หรือถึงเวลา probe) — ถ้าได้ *seq คือ seq ที่ต้องใส่ในเฟรม */
+bool     espnow_flow_tx_acquire(espnow_flow_tx_t *tx, uint32_t *seq);
+/* handler ของ ESPNOW_MSG_FLOW_CREDIT เรียกต่อ — คืน true ถ้าหน้าต่างเปิดเพิ่ม */
+bool     espnow_flow_tx_on_credit(espnow_flow_tx_t *tx, const uint8_t *data, int len);
+
+/* ---- ฝั่ง receiver ---- */
+typedef struct {
+    portMUX_TYPE lock;
+    uint32_t highest;          // seq สูงสุดที่เห็น
+    uint32_t received;
+    uint32_t lost;             // seq ที่ข้ามไป (gap) — นับใหม่เมื่อ sender รีบูต
+    uint32_t overflow;         // RX queue เต็ม
+    uint32_t restarts;         // sender รีบูต (seq กลับมา 1 / ถอยเกิน RESTART_BACK)
+} espnow_flow_rx_t;
+
+void espnow_flow_rx_init(espnow_flow_rx_t *rx);
+/* เรียกใน recv path ทุกเฟรมที่มี seq */
+void espnow_flow_rx_on_frame(espnow_flow_rx_t *rx, uint32_t seq);
+void espnow_flow_rx_build(espnow_flow_rx_t *rx, uint8_t free_slots, espnow_flow_credit_t *out);
+
+#ifdef __cplusplus
+}
+#endif
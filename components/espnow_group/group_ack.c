@@ -0,0 +1,70 @@
+// components/espnow_group/group_ack.c
+#include <string.h>
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "group_ack.h"
+
+uint8_t group_ack_slots_for(int responders) {
+    int slots = responders * 2;
+    if (slots < GROUP_ACK_MIN_SLOTS) slots = GROUP_ACK_MIN_SLOTS;
+    if (slots > 255) slots = 255;
+    return (uint8_t)slots;
+}
+
+uint32_t group_ack_pick_delay_us(uint8_t slots) {
+    if (slots == 0) slots = 1;
+    uint32_t r = esp_random();
+    uint32_t slot   = r % slots;
+    uint32_t jitter = (r >> 16) % (GROUP_ACK_SLOT_MS * 1000 / 2);   // ครึ่งแรกของ slot
+    return slot * GROUP_ACK_SLOT_MS * 1000 + jitter;
+}
+
+void group_ack_tracker_init(group_ack_tracker_t *t) {
+    memset(t, 0, sizeof(*t));
+    portMUX_INITIALIZE(&t->lock);
+}
+
+void group_ack_tracker_begin(group_ack_tracker_t *t, uint32_t cmd_seq, uint8_t group_id, uint8_t expected) {
+    if (expected > GROUP_ACK_MAX_NODES) expected = GROUP_ACK_MAX_NODES;
+
+    portENTER_CRITICAL(&t->lock);
+    t->cmd_seq     = cmd_seq;
+    t->group_id    = group_id;
+    t->expected    = expected;
+    t->count       = 0;
+    memset(t->acked, 0, sizeof(t->acked));
+    t->start_us    = esp_timer_get_time();
+    t->last_ack_us = 0;
+    portEXIT_CRITICAL(&t->lock);
+}
+
+bool group_ack_tracker_on_ack(group_ack_tracker_t *t, const group_ack_frame_t *ack) {
+    bool fresh = false;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&t->lock);
+    if (ack->cmd_seq == t->cmd_seq && ack->group_id == t->group_id &&
+        ack->node_index < t->expected && !group_bitmap_test(t->acked, ack->node_index)) {
+        group_bitmap_set(t->acked, ack->node_index);
+        t->count++;
+        t->last_ack_us = now;
+        fresh = true;
+    }
+    portEXIT_CRITICAL(&t->lock);
+    return fresh;
+}
+
+int group_ack_tracker_missing(group_ack_tracker_t *t, uint8_t out_pending[GROUP_ACK_BITMAP_LEN]) {
+    int missing = 0;
+    memset(out_pending, 0, GROUP_ACK_BITMAP_LEN);
+
+    portENTER_CRITICAL(&t->lock);
+    for (uint8_t i = 0; i < t->expected; i++) {
+        if (!group_bitmap_test(t->acked, i)) {
+            group_bitmap_set(out_pending, i);
+            missing++;
+        }
+    }
+    portEXIT_CRITICAL(&t->lock);
+    return missing;
+}
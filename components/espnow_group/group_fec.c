@@ -0,0 +1,247 @@
+// components/espnow_group/group_fec.c
+#include <string.h>
+#include "esp_timer.h"
+#include "group_fec.h"
+
+/* ===================== GF(256), poly 0x11D ===================== */
+
+static uint8_t s_exp[512];
+static uint8_t s_log[256];
+static bool    s_gf_ready;
+
+static void gf_init(void) {
+    if (s_gf_ready) return;
+    uint16_t x = 1;
+    for (int i = 0; i < 255; i++) {
+        s_exp[i] = (uint8_t)x;
+        s_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11D;
+    }
+    for (int i = 255; i < 512; i++) s_exp[i] = s_exp[i - 255];
+    s_gf_ready = true;
+}
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    if (!a || !b) return 0;
+    return s_exp[s_log[a] + s_log[b]];
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+    return s_exp[255 - s_log[a]];
+}
+
+/* dst ^= c * src */
+static void gf_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, int len) {
+    if (c == 0) return;
+    if (c == 1) {
+        for (int i = 0; i < len; i++) dst[i] ^= src[i];
+        return;
+    }
+    const uint8_t *row = &s_exp[s_log[c]];
+    for (int i = 0; i < len; i++) {
+        if (src[i]) dst[i] ^= row[s_log[src[i]]];
+    }
+}
+
+/* สัมประสิทธิ์ parity แถว j, data i: m=1 -> XOR, ไม่งั้น Cauchy 1/(x_j + y_i)
+   x_j = k + j, y_i = i (ไม่ซ้ำกัน) ทำให้ทุก submatrix จัตุรัสหาอินเวิร์สได้ (MDS) */
+static inline uint8_t coef(int k, int m, int j, int i) {
+    if (m == 1) return 1;
+    return gf_inv((uint8_t)((k + j) ^ i));
+}
+
+/* ===================== codec ===================== */
+
+void group_fec_encode(const uint8_t *const data[], int k, int m, int row, int len, uint8_t *out) {
+    gf_init();
+    memset(out, 0, len);
+    for (int i = 0; i < k; i++) gf_mul_add(out, data[i], coef(k, m, row, i), len);
+}
+
+int group_fec_decode(const uint8_t *data[], uint8_t *out_bufs[], const uint8_t *const parity[],
+                     int k, int m, int len) {
+    gf_init();
+
+    int lost[GROUP_FEC_MAX_M], rows[GROUP_FEC_MAX_M];
+    int r = 0, p = 0;
+    for (int i = 0; i < k; i++) {
+        if (data[i]) continue;
+        if (r == GROUP_FEC_MAX_M) return -1;
+        lost[r++] = i;
+    }
+    if (r == 0) return 0;
+    for (int j = 0; j < m && p < r; j++) {
+        if (parity[j]) rows[p++] = j;
+    }
+    if (p < r) return -1;
+
+    // syndrome: parity - ส่วนของ data ที่มีอยู่ -> เหลือแค่ผลรวมของเฟรมที่หาย
+    uint8_t syn[GROUP_FEC_MAX_M][GROUP_FEC_SHARD_MAX];
+    for (int t = 0; t < r; t++) {
+        memcpy(syn[t], parity[rows[t]], len);
+        for (int i = 0; i < k; i++) {
+            if (data[i]) gf_mul_add(syn[t], data[i], coef(k, m, rows[t], i), len);
+        }
+    }
+
+    // A[t][u] = coef(row t, lost u) -> หาอินเวิร์สด้วย Gauss-Jordan (r <= 4)
+    uint8_t a[GROUP_FEC_MAX_M][GROUP_FEC_MAX_M], inv[GROUP_FEC_MAX_M][GROUP_FEC_MAX_M];
+    for (int t = 0; t < r; t++) {
+        for (int u = 0; u < r; u++) {
+            a[t][u]   = coef(k, m, rows[t], lost[u]);
+            inv[t][u] = (t == u);
+        }
+    }
+    for (int c = 0; c < r; c++) {
+        int piv = c;
+        while (piv < r && a[piv][c] == 0) piv++;
+        if (piv == r) return -1;
+        if (piv != c) {
+            for (int u = 0; u < r; u++) {
+                uint8_t tmp = a[c][u];   a[c][u] = a[piv][u];     a[piv][u] = tmp;
+                tmp = inv[c][u];         inv[c][u] = inv[piv][u]; inv[piv][u] = tmp;
+            }
+        }
+        uint8_t d = gf_inv(a[c][c]);
+        for (int u = 0; u < r; u++) {
+            a[c][u]   = gf_mul(a[c][u], d);
+            inv[c][u] = gf_mul(inv[c][u], d);
+        }
+        for (int t = 0; t < r; t++) {
+            if (t == c || a[t][c] == 0) continue;
+            uint8_t f = a[t][c];
+            for (int u = 0; u < r; u++) {
+                a[t][u]   ^= gf_mul(f, a[c][u]);
+                inv[t][u] ^= gf_mul(f, inv[c][u]);
+            }
+        }
+    }
+
+    for (int u = 0; u < r; u++) {
+        uint8_t *dst = out_bufs[lost[u]];
+        memset(dst, 0, len);
+        for (int t = 0; t < r; t++) gf_mul_add(dst, syn[t], inv[u][t], len);
+        data[lost[u]] = dst;
+    }
+    return r;
+}
+
+/* ===================== sender ===================== */
+
+void group_fec_tx_init(group_fec_tx_t *tx, uint8_t k, uint8_t m) {
+    memset(tx, 0, sizeof(*tx));
+    tx->k = (k < 1) ? 1 : (k > GROUP_FEC_MAX_K ? GROUP_FEC_MAX_K : k);
+    tx->m = (m < 1) ? 1 : (m > GROUP_FEC_MAX_M ? GROUP_FEC_MAX_M : m);
+}
+
+int group_fec_tx_add(group_fec_tx_t *tx, uint32_t seq, const void *frame, int len,
+                     group_fec_parity_t out[GROUP_FEC_MAX_M]) {
+    if (len <= 0 || len > GROUP_FEC_SHARD_MAX) return 0;
+
+    // seq ต้องต่อเนื่องและยาวเท่ากันทั้ง block ไม่งั้นเริ่ม block ใหม่
+    if (tx->count > 0 && (seq != tx->first + tx->count || len != tx->len)) tx->count = 0;
+    if (tx->count == 0) {
+        tx->first = seq;
+        tx->len   = (uint8_t)len;
+    }
+    memcpy(tx->data[tx->count++], frame, len);
+    if (tx->count < tx->k) return 0;
+
+    int64_t t0 = esp_timer_get_time();
+    const uint8_t *rows[GROUP_FEC_MAX_K];
+    for (int i = 0; i < tx->k; i++) rows[i] = tx->data[i];
+    for (int j = 0; j < tx->m; j++) {
+        group_fec_parity_t *p = &out[j];
+        p->hdr.type    = ESPNOW_MSG_GROUP_FEC;
+        p->block_first = tx->first;
+        p->k           = tx->k;
+        p->m           = tx->m;
+        p->index       = (uint8_t)j;
+        p->shard_len   = tx->len;
+        group_fec_encode(rows, tx->k, tx->m, j, tx->len, p->shard);
+    }
+    tx->encode_us_total += esp_timer_get_time() - t0;
+    tx->blocks++;
+    tx->count = 0;
+    return tx->m;
+}
+
+/* ===================== receiver ===================== */
+
+void group_fec_rx_init(group_fec_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+    rx->blk_done = true;
+}
+
+void group_fec_rx_on_data(group_fec_rx_t *rx, uint32_t seq, const uint8_t *frame, int len) {
+    if (len <= 0 || len > GROUP_FEC_SHARD_MAX) return;
+    int slot = seq % GROUP_FEC_RX_DEPTH;
+    rx->ring[slot].seq = seq;
+    rx->ring[slot].len = (uint8_t)len;
+    memcpy(rx->ring[slot].frame, frame, len);
+}
+
+int group_fec_rx_on_parity(group_fec_rx_t *rx, const uint8_t *data, int len,
+                           group_fec_deliver_fn_t deliver, void *ctx) {
+    if (len < GROUP_FEC_PARITY_LEN(0)) return 0;
+    const group_fec_parity_t *p = (const group_fec_parity_t *)data;
+    if (p->k < 1 || p->k > GROUP_FEC_MAX_K || p->m < 1 || p->m > GROUP_FEC_MAX_M ||
+        p->index >= p->m || p->shard_len > GROUP_FEC_SHARD_MAX ||
+        len < GROUP_FEC_PARITY_LEN(p->shard_len)) {
+        return 0;
+    }
+
+    if (p->block_first != rx->blk_first || p->k != rx->blk_k || rx->blk_have == 0) {
+        if (!rx->blk_done) rx->unrecoverable++;   // block ก่อนหน้าขาดเกินกว่า parity ที่ได้
+        rx->blk_first = p->block_first;
+        rx->blk_k     = p->k;
+        rx->blk_m     = p->m;
+        rx->blk_len   = p->shard_len;
+        rx->blk_have  = 0;
+        rx->blk_done  = false;
+    }
+    if (rx->blk_done) return 0;
+
+    memcpy(rx->parity[p->index], p->shard, p->shard_len);
+    rx->blk_have |= (uint8_t)(1u << p->index);
+
+    const uint8_t *shards[GROUP_FEC_MAX_K];
+    uint8_t       *bufs[GROUP_FEC_MAX_K];
+    uint8_t        scratch[GROUP_FEC_MAX_M][GROUP_FEC_SHARD_MAX];
+    const uint8_t *par[GROUP_FEC_MAX_M] = {0};
+    int missing = 0;
+
+    for (int i = 0; i < rx->blk_k; i++) {
+        uint32_t seq = rx->blk_first + i;
+        int slot = seq % GROUP_FEC_RX_DEPTH;
+        bool have = rx->ring[slot].seq == seq && rx->ring[slot].len == rx->blk_len;
+        shards[i] = have ? rx->ring[slot].frame : NULL;
+        bufs[i]   = have ? NULL : (missing < GROUP_FEC_MAX_M ? scratch[missing] : NULL);
+        if (!have) missing++;
+    }
+    if (missing == 0) {
+        rx->blk_done = true;
+        return 0;
+    }
+    for (int j = 0; j < rx->blk_m; j++) {
+        if (rx->blk_have & (1u << j)) par[j] = rx->parity[j];
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    int n = (missing <= GROUP_FEC_MAX_M)
+            ? group_fec_decode(shards, bufs, par, rx->blk_k, rx->blk_m, rx->blk_len)
+            : -1;
+    if (n <= 0) return 0;   // parity ยังไม่พอ — รอ parity ตัวถัดไป
+    rx->decode_us_total += esp_timer_get_time() - t0;
+
+    rx->blk_done = true;
+    for (int i = 0; i < rx->blk_k; i++) {
+        if (!bufs[i]) continue;
+        uint32_t seq = rx->blk_first + i;
+        group_fec_rx_on_data(rx, seq, shards[i], rx->blk_len);
+        rx->recovered++;
+        if (deliver) deliver(shards[i], rx->blk_len, ctx);
+    }
+    return n;
+}
@@ -0,0 +1,179 @@
+// components/espnow_group/group_nack.c
+#include <string.h>
+#include "group_nack.h"
+
+_Static_assert(GROUP_NACK_TX_DEPTH < GROUP_NACK_RESTART_BACK, "retransmit must not look like a restart");
+
+/* ===================== sender ===================== */
+
+void group_nack_tx_init(group_nack_tx_t *tx) {
+    memset(tx, 0, sizeof(*tx));
+    portMUX_INITIALIZE(&tx->lock);
+}
+
+void group_nack_tx_store(group_nack_tx_t *tx, uint32_t seq, const void *frame, int len) {
+    if (len <= 0 || len > GROUP_NACK_FRAME_MAX) return;
+    group_nack_slot_t *s = &tx->slots[seq % GROUP_NACK_TX_DEPTH];
+
+    portENTER_CRITICAL(&tx->lock);
+    s->seq       = seq;
+    s->len       = (uint16_t)len;
+    s->requested = false;
+    memcpy(s->frame, frame, len);
+    tx->originals++;
+    portEXIT_CRITICAL(&tx->lock);
+}
+
+void group_nack_tx_on_nack(group_nack_tx_t *tx, const uint8_t *data, int len) {
+    if (len < (int)GROUP_NACK_FRAME_LEN(0)) return;
+    const group_nack_frame_t *nack = (const group_nack_frame_t *)data;
+    int n = nack->n_ranges;
+    if (n > GROUP_NACK_MAX_RANGES || len < (int)GROUP_NACK_FRAME_LEN(n)) return;
+
+    portENTER_CRITICAL(&tx->lock);
+    tx->nacks_rx++;
+    for (int r = 0; r < n; r++) {
+        uint32_t first = nack->ranges[r].first;
+        for (uint32_t i = 0; i < nack->ranges[r].count; i++) {
+            group_nack_slot_t *s = &tx->slots[(first + i) % GROUP_NACK_TX_DEPTH];
+            if (s->len && s->seq == first + i) s->requested = true;
+            else tx->too_old++;
+        }
+    }
+    portEXIT_CRITICAL(&tx->lock);
+}
+
+int group_nack_tx_flush(group_nack_tx_t *tx, group_nack_send_fn_t send) {
+    int sent = 0;
+    uint8_t frame[GROUP_NACK_FRAME_MAX];
+    for (int i = 0; i < GROUP_NACK_TX_DEPTH; i++) {
+        group_nack_slot_t *s = &tx->slots[i];
+
+        // flush มาจาก esp_timer ส่วน store มาจาก task ที่ส่งเฟรมใหม่ -> copy ใต้ lock ก่อนส่ง
+        portENTER_CRITICAL(&tx->lock);
+        bool want = s->requested && s->len;
+        uint16_t len = s->len;
+        if (want) memcpy(frame, s->frame, len);
+        s->requested = false;
+        portEXIT_CRITICAL(&tx->lock);
+        if (!want) continue;
+
+        if (send(frame, len) == ESP_OK) {
+            sent++;
+            portENTER_CRITICAL(&tx->lock);
+            tx->retransmits++;
+            portEXIT_CRITICAL(&tx->lock);
+        }
+    }
+    return sent;
+}
+
+/* ===================== receiver ===================== */
+
+void group_nack_rx_init(group_nack_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+static group_nack_peer_t *peer_for(group_nack_rx_t *rx, const uint8_t mac[6]) {
+    group_nack_peer_t *free_slot = NULL;
+    for (int i = 0; i < GROUP_NACK_MAX_SENDERS; i++) {
+        group_nack_peer_t *p = &rx->peers[i];
+        if (p->used && memcmp(p->mac, mac, 6) == 0) return p;
+        if (!p->used && !free_slot) free_slot = p;
+    }
+    if (!free_slot) free_slot = &rx->peers[0];   // เต็ม: ใช้ช่องแรกซ้ำ (sender หลายตัวเกินคาด)
+    memset(free_slot, 0, sizeof(*free_slot));
+    memcpy(free_slot->mac, mac, 6);
+    return free_slot;
+}
+
+group_nack_rx_result_t group_nack_rx_accept(group_nack_rx_t *rx, const uint8_t mac[6],
+                                            uint32_t seq, group_nack_peer_t **out_peer) {
+    group_nack_peer_t *p = peer_for(rx, mac);
+    if (out_peer) *out_peer = p;
+
+    if (!p->used) {
+        p->used    = true;
+        p->first   = seq;
+        p->highest = seq;
+        p->seen    = 1;
+        p->delivered++;
+        return GROUP_NACK_RX_NEW;
+    }
+
+    int32_t diff = (int32_t)(seq - p->highest);
+    if (diff > 0) {
+        p->seen = (diff >= GROUP_NACK_WINDOW) ? 0 : (p->seen << diff);
+        p->seen |= 1;
+        p->highest = seq;
+        p->delivered++;
+        if (diff > 1) p->tries = 0;   // gap ชุดใหม่
+        return GROUP_NACK_RX_NEW;
+    }
+
+    uint32_t back = (uint32_t)(-diff);
+    if (back >= GROUP_NACK_RESTART_BACK) {
+        // ย้อนไกลกว่าที่ส่งซ้ำได้ = sender รีบูต (seq เริ่ม 1 ใหม่) -> เริ่ม stream ใหม่ ไม่งั้นทิ้งเป็น DUP จนเลย highest เดิม
+        uint32_t restarts = p->restarts + 1;
+        memset(p, 0, sizeof(*p));
+        memcpy(p->mac, mac, 6);
+        p->used     = true;
+        p->restarts = restarts;
+        p->first    = seq;
+        p->highest  = seq;
+        p->seen     = 1;
+        p->delivered++;
+        return GROUP_NACK_RX_NEW;
+    }
+    if ( (int32_t)(seq - p->first) < 0 || (p->seen & (1u << back))) {
+        p->duplicates++;
+        return GROUP_NACK_RX_DUP;
+    }
+    p->seen |= 1u << back;
+    p->delivered++;
+    p->recovered++;
+    return GROUP_NACK_RX_RECOVERED;
+}
+
+/* บิตที่ต้องมี (seq ตั้งแต่ first ถึง highest ภายใน window) */
+static uint32_t expected_mask(const group_nack_peer_t *p) {
+    uint32_t span = p->highest - p->first + 1;
+    if (span >= GROUP_NACK_WINDOW) return 0xFFFFFFFFu;
+    return (1u << span) - 1;
+}
+
+bool group_nack_rx_has_gap(const group_nack_peer_t *p) {
+    return p->used && (~p->seen & expected_mask(p)) != 0;
+}
+
+int group_nack_rx_build(group_nack_peer_t *p, group_nack_frame_t *out) {
+    if (!group_nack_rx_has_gap(p) || p->tries >= GROUP_NACK_MAX_TRIES) return 0;
+
+    uint32_t missing = ~p->seen & expected_mask(p);
+    int n = 0;
+
+    // ไล่จาก seq เก่าสุดใน window มาหาใหม่สุด แล้วรวมเป็นช่วงต่อเนื่อง
+    for (int back = GROUP_NACK_WINDOW - 1; back >= 0 && n < GROUP_NACK_MAX_RANGES; back--) {
+        if (!(missing & (1u << back))) continue;
+        uint32_t seq = p->highest - (uint32_t)back;
+        if (n > 0 && out->ranges[n - 1].first + out->ranges[n - 1].count == seq &&
+            out->ranges[n - 1].count < UINT8_MAX) {
+            out->ranges[n - 1].count++;
+        } else {
+            out->ranges[n].first = seq;
+            out->ranges[n].count = 1;
+            n++;
+        }
+    }
+
+    out->hdr.type = ESPNOW_MSG_GROUP_NACK;
+    out->n_ranges = (uint8_t)n;
+    p->tries++;
+    return (int)GROUP_NACK_FRAME_LEN(n);
+}
+
+float group_nack_rx_delivery_ratio(const group_nack_peer_t *p) {
+    if (!p->used) return 0.0f;
+    uint32_t expected = p->highest - p->first + 1;
+    return expected ? (float)p->delivered / (float)expected : 0.0f;
+}
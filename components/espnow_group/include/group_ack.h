@@ -0,0 +1,72 @@
+// components/espnow_group/include/group_ack.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_ACK_MAX_NODES   64    // node_index 0..63 ต่อ group
+#define GROUP_ACK_SLOT_MS     2     // ACK เล็ก ๆ ใช้เวลาบนอากาศ < 1 ms รวม retry ของ MAC
+#define GROUP_ACK_MIN_SLOTS   4
+#define GROUP_ACK_BITMAP_LEN  (GROUP_ACK_MAX_NODES / 8)
+
+/* Receiver -> Master (unicast) : ยืนยันว่าได้ COMMAND seq นี้แล้ว */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;       // ESPNOW_MSG_GROUP_ACK
+    uint8_t  group_id;
+    uint8_t  node_index;        // ตำแหน่งใน bitmap ของ master
+    uint32_t cmd_seq;
+} group_ack_frame_t;
+
+/* Master -> broadcast : ถามซ้ำเฉพาะ node ที่ยังไม่ ACK */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;       // ESPNOW_MSG_GROUP_POLL
+    uint8_t  group_id;
+    uint8_t  slots;             // จำนวน slot ของรอบนี้ (หน้าต่าง = slots * GROUP_ACK_SLOT_MS)
+    uint32_t cmd_seq;
+    uint8_t  pending[GROUP_ACK_BITMAP_LEN];   // bit = 1 -> node นั้นต้องตอบ
+} group_poll_frame_t;
+
+static inline bool group_bitmap_test(const uint8_t *bm, uint8_t idx) {
+    return (bm[idx >> 3] >> (idx & 7)) & 1u;
+}
+
+static inline void group_bitmap_set(uint8_t *bm, uint8_t idx) {
+    bm[idx >> 3] |= (uint8_t)(1u << (idx & 7));
+}
+
+/* ขนาดหน้าต่างตามจำนวนคนที่ต้องตอบ: 2 slot ต่อ node ให้โอกาสชนต่ำ */
+uint8_t group_ack_slots_for(int responders);
+
+/* สุ่ม slot ใน [0, slots) + jitter ภายใน slot -> ดีเลย์ก่อนส่ง ACK (us) */
+uint32_t group_ack_pick_delay_us(uint8_t slots);
+
+/* ---- ฝั่ง Master: ติดตามว่าใครตอบแล้ว ---- */
+typedef struct {
+    portMUX_TYPE lock;
+    uint32_t cmd_seq;
+    uint8_t  group_id;
+    uint8_t  expected;          // จำนวน node ที่คาดว่าจะตอบ (index 0..expected-1)
+    uint8_t  count;
+    uint8_t  acked[GROUP_ACK_BITMAP_LEN];
+    int64_t  start_us;          // เวลาส่ง COMMAND
+    int64_t  last_ack_us;       // เวลาที่ได้ ACK ล่าสุด
+} group_ack_tracker_t;
+
+void group_ack_tracker_init(group_ack_tracker_t *t);
+void group_ack_tracker_begin(group_ack_tracker_t *t, uint32_t cmd_seq, uint8_t group_id, uint8_t expected);
+
+/* เรียกจาก recv handler — true ถ้าเป็น ACK ใหม่ของ COMMAND ปัจจุบัน */
+bool group_ack_tracker_on_ack(group_ack_tracker_t *t, const group_ack_frame_t *ack);
+
+/* เติม bitmap ของ node ที่ยังไม่ตอบ, คืนจำนวน */
+int group_ack_tracker_missing(group_ack_tracker_t *t, uint8_t out_pending[GROUP_ACK_BITMAP_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
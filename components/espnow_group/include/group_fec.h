@@ -0,0 +1,86 @@
+// components/espnow_group/include/group_fec.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_FEC_MAX_K       8     // data frame ต่อ block
+#define GROUP_FEC_MAX_M       4     // parity frame ต่อ block (กู้ได้สูงสุด M เฟรม)
+#define GROUP_FEC_SHARD_MAX   240   // 250 - header ของ parity frame
+#define GROUP_FEC_RX_DEPTH    (2 * GROUP_FEC_MAX_K)
+
+/* parity frame: M=1 เป็น XOR ล้วน, M>1 เป็น Reed-Solomon (Cauchy matrix บน GF(256)) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;       // ESPNOW_MSG_GROUP_FEC
+    uint32_t block_first;       // seq ของ data frame แรกใน block
+    uint8_t  k;
+    uint8_t  m;
+    uint8_t  index;             // parity ลำดับที่ 0..m-1
+    uint8_t  shard_len;         // ความยาว data frame (ทุกเฟรมใน block ยาวเท่ากัน)
+    uint8_t  shard[GROUP_FEC_SHARD_MAX];
+} group_fec_parity_t;
+
+#define GROUP_FEC_PARITY_LEN(shard_len) \
+    ((int)(sizeof(group_fec_parity_t) - GROUP_FEC_SHARD_MAX + (shard_len)))
+
+/* ---- codec (ไม่มีสถานะ) ---- */
+
+/* parity แถวที่ row จาก data k ชิ้น ยาว len ไบต์ */
+void group_fec_encode(const uint8_t *const data[], int k, int m, int row, int len, uint8_t *out);
+
+/* data[i] == NULL = หาย (ต้องชี้ buffer ว่างให้เขียนคืน ผ่าน out_bufs[i])
+   parity[j] == NULL = ไม่ได้รับ; คืนจำนวนเฟรมที่กู้ได้ หรือ -1 ถ้า parity ไม่พอ */
+int group_fec_decode(const uint8_t *data[], uint8_t *out_bufs[], const uint8_t *const parity[],
+                     int k, int m, int len);
+
+/* ---- ฝั่ง sender: สะสมครบ k เฟรมแล้วออก parity m เฟรม ---- */
+typedef struct {
+    uint8_t  k, m;
+    uint8_t  count;
+    uint8_t  len;
+    uint32_t first;
+    uint8_t  data[GROUP_FEC_MAX_K][GROUP_FEC_SHARD_MAX];
+    int64_t  encode_us_total;   // เวลา encode สะสม (benchmark บน target)
+    uint32_t blocks;
+} group_fec_tx_t;
+
+void group_fec_tx_init(group_fec_tx_t *tx, uint8_t k, uint8_t m);
+/* คืนจำนวน parity ที่เติมลง out (0 จนกว่าจะครบ block) */
+int  group_fec_tx_add(group_fec_tx_t *tx, uint32_t seq, const void *frame, int len,
+                      group_fec_parity_t out[GROUP_FEC_MAX_M]);
+
+/* ---- ฝั่ง receiver ---- */
+typedef void (*group_fec_deliver_fn_t)(const uint8_t *frame, int len, void *ctx);
+
+typedef struct {
+    struct {
+        uint32_t seq;
+        uint8_t  len;           // 0 = ว่าง
+        uint8_t  frame[GROUP_FEC_SHARD_MAX];
+    } ring[GROUP_FEC_RX_DEPTH];             // data frame ล่าสุด (index = seq % depth)
+
+    uint32_t blk_first;                     // block ที่กำลังเก็บ parity
+    uint8_t  blk_k, blk_m, blk_len;
+    bool     blk_done;
+    uint8_t  blk_have;                      // bit j = ได้ parity j แล้ว
+    uint8_t  parity[GROUP_FEC_MAX_M][GROUP_FEC_SHARD_MAX];
+
+    uint32_t recovered;
+    uint32_t unrecoverable;                 // block ที่เสียเกิน m (นับตอน block ถัดไปเริ่ม)
+    int64_t  decode_us_total;
+} group_fec_rx_t;
+
+void group_fec_rx_init(group_fec_rx_t *rx);
+void group_fec_rx_on_data(group_fec_rx_t *rx, uint32_t seq, const uint8_t *frame, int len);
+/* เฟรมที่กู้ได้จะถูกส่งให้ deliver (ลำดับ seq) — คืนจำนวนที่กู้ได้ */
+int  group_fec_rx_on_parity(group_fec_rx_t *rx, const uint8_t *data, int len,
+                            group_fec_deliver_fn_t deliver, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
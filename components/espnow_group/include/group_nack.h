@@ -0,0 +1,100 @@
+// components/espnow_group/include/group_nack.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_NACK_TX_DEPTH     16    // จำนวนเฟรมล่าสุดที่ sender เก็บไว้ส่งซ้ำ
+#define GROUP_NACK_FRAME_MAX    250   // ESP_NOW_MAX_DATA_LEN
+#define GROUP_NACK_WINDOW       32    // ช่วง seq ที่ receiver ตามหา gap (bitmap 32 บิต)
+#define GROUP_NACK_MAX_RANGES   8
+#define GROUP_NACK_MAX_SENDERS  4
+#define GROUP_NACK_ROUND_MS     50    // sender ส่งซ้ำรวบทีเดียวต่อรอบ
+#define GROUP_NACK_JITTER_MS    20    // receiver รอสุ่มก่อนส่ง NACK
+#define GROUP_NACK_MAX_TRIES    3     // NACK seq เดิมได้กี่รอบก่อนยอมแพ้
+#define GROUP_NACK_RESTART_BACK GROUP_NACK_WINDOW   // seq ย้อนเกินนี้ = sender รีบูต (ส่งซ้ำย้อนได้แค่ TX_DEPTH)
+
+typedef struct __attribute__((packed)) {
+    uint32_t first;             // seq แรกที่ขาด
+    uint8_t  count;             // จำนวนต่อเนื่อง
+} group_nack_range_t;
+
+/* Receiver -> Sender (unicast), ความยาวแปรผันตามจำนวน range */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t   hdr;     // ESPNOW_MSG_GROUP_NACK
+    uint8_t            n_ranges;
+    group_nack_range_t ranges[GROUP_NACK_MAX_RANGES];
+} group_nack_frame_t;
+
+#define GROUP_NACK_FRAME_LEN(n) \
+    (sizeof(espnow_msg_hdr_t) + 1 + (n) * sizeof(group_nack_range_t))
+
+/* ---- ฝั่ง sender: buffer ส่งซ้ำ ---- */
+typedef struct {
+    uint32_t seq;
+    uint16_t len;               // 0 = ว่าง
+    bool     requested;         // มีคน NACK ในรอบนี้
+    uint8_t  frame[GROUP_NACK_FRAME_MAX];
+} group_nack_slot_t;
+
+typedef struct {
+    portMUX_TYPE      lock;
+    group_nack_slot_t slots[GROUP_NACK_TX_DEPTH];   // index = seq % DEPTH
+    uint32_t originals;         // เฟรมที่ส่งครั้งแรก
+    uint32_t retransmits;       // เฟรมที่ broadcast ซ้ำ
+    uint32_t nacks_rx;          // NACK ที่ได้รับ
+    uint32_t too_old;           // seq ที่ถูกขอแต่หลุด buffer ไปแล้ว
+} group_nack_tx_t;
+
+typedef esp_err_t (*group_nack_send_fn_t)(const uint8_t *frame, int len);
+
+void group_nack_tx_init(group_nack_tx_t *tx);
+void group_nack_tx_store(group_nack_tx_t *tx, uint32_t seq, const void *frame, int len);
+void group_nack_tx_on_nack(group_nack_tx_t *tx, const uint8_t *data, int len);
+/* เรียกทุก GROUP_NACK_ROUND_MS: ส่งซ้ำแต่ละ seq ที่ถูกขอ "ครั้งเดียว" ไม่ว่ามีกี่คนขอ */
+int  group_nack_tx_flush(group_nack_tx_t *tx, group_nack_send_fn_t send);
+
+/* ---- ฝั่ง receiver: ตรวจ gap ต่อ sender ---- */
+typedef enum {
+    GROUP_NACK_RX_NEW = 0,      // seq ใหม่ (ส่งต่อให้แอป)
+    GROUP_NACK_RX_RECOVERED,    // seq ที่เคยขาด แล้วได้มาจากการส่งซ้ำ (ส่งต่อให้แอป)
+    GROUP_NACK_RX_DUP,          // ได้แล้ว / เก่าเกิน window (ทิ้ง)
+} group_nack_rx_result_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint32_t first;             // seq แรกที่เห็น (ไม่ NACK ของก่อนหน้านี้)
+    uint32_t highest;
+    uint32_t seen;              // bit i = ได้ seq (highest - i) แล้ว
+    uint8_t  tries;             // จำนวน NACK ที่ส่งไปแล้วสำหรับ gap ชุดปัจจุบัน
+    uint32_t delivered;         // seq ที่ไม่ซ้ำ
+    uint32_t recovered;
+    uint32_t duplicates;
+    uint32_t restarts;          // sender รีบูต (ตัวนับอื่นเริ่มใหม่ตาม stream)
+} group_nack_peer_t;
+
+typedef struct {
+    group_nack_peer_t peers[GROUP_NACK_MAX_SENDERS];
+} group_nack_rx_t;
+
+void group_nack_rx_init(group_nack_rx_t *rx);
+group_nack_rx_result_t group_nack_rx_accept(group_nack_rx_t *rx, const uint8_t mac[6],
+                                            uint32_t seq, group_nack_peer_t **out_peer);
+/* true ถ้ามี gap ใน window (ควรตั้งเวลา NACK) */
+bool group_nack_rx_has_gap(const group_nack_peer_t *p);
+/* สร้าง NACK จาก gap ปัจจุบัน, คืนความยาวเฟรม (0 = ไม่มีอะไรต้องขอ / เกินจำนวนครั้ง) */
+int  group_nack_rx_build(group_nack_peer_t *p, group_nack_frame_t *out);
+/* อัตราส่งถึง (0..1) นับจาก seq แรกที่เห็นถึง highest */
+float group_nack_rx_delivery_ratio(const group_nack_peer_t *p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,589 @@
+// components/espnow_gw/gw_mqtt.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "mqtt_client.h"
+#include "gw_mqtt.h"
+
+static const char *TAG = "GW_MQTT";
+
+#define NVS_NS            "gw_mqtt"
+#define NVS_KEY_ACK       "acked"
+#define SAMPLE_JSON_MAX   48        // ["xxxxxxxx",4294967295,-32768,-32768,-32768],
+#define HDR_JSON_MAX      96
+#define RECONNECT_MIN_MS  1000
+#define RECONNECT_MAX_MS  30000
+#define ACK_SAVE_EVERY    16        // batch backlog ต่อการเขียน NVS หนึ่งครั้ง
+#define ACK_TIMEOUT_MS    30000     // = CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS: เกินนี้ outbox ทิ้งไปแล้ว -> ส่งใหม่
+#define ACKED_IDS         8         // PUBACK ที่มาก่อน drain_step / seal_live จะบันทึก msg_id ทัน
+#define LIVE_INFL         4         // batch สดที่รอ PUBACK พร้อมกัน (เต็ม = ลง flash เหมือน outbox ค้าง)
+
+typedef struct {
+    espnow_gw_tsdb_sample_t s;
+    int64_t rx_us;
+} item_t;
+
+/* record ใน spill store: 18 B = 14 ต่อ page — seq ไล่ส่งตามลำดับ / รู้ว่าอะไรถูกทับ */
+typedef struct __attribute__((packed)) {
+    espnow_gw_tsdb_sample_t s;
+    uint32_t seq;
+} spill_rec_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t ts;
+} ack_t;
+
+/* batch backlog ที่ publish แล้วรอ PUBACK — ทีละ batch: cursor เลื่อนตามลำดับ seq เสมอ */
+typedef struct {
+    int      msg_id;            // -1 = ไม่มี
+    uint32_t first_seq;
+    ack_t    end;               // record สุดท้ายใน batch
+    uint16_t n;
+    int64_t  sent_us;
+} inflight_t;
+
+/* batch สดที่ publish แล้วรอ PUBACK — เก็บ sample ไว้: outbox ทิ้ง (หมดเวลา) จะได้ลง flash ไม่หาย */
+typedef struct {
+    int      msg_id;            // -1 = ว่าง
+    uint16_t n;
+    int64_t  sent_us;
+    item_t  *items;             // batch_max_samples ช่อง
+} live_infl_t;
+
+static espnow_gw_mqtt_config_t  s_cfg;
+static QueueHandle_t            s_q;
+static esp_mqtt_client_handle_t s_client;
+static espnow_gw_tsdb_t        *s_spill;
+static char                     s_topic[64];
+static char                     s_topic_backlog[64];
+static volatile bool            s_online;
+static bool                     s_mqtt_started;
+static int64_t                  s_reconnect_at;     // 0 = ไม่ต้อง
+static uint32_t                 s_backoff_ms = RECONNECT_MIN_MS;
+
+static espnow_gw_mqtt_stats_t   s_st;
+static int64_t                  s_last_pub_us;
+static portMUX_TYPE             s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* batch สด (task เดียวใช้) — เก็บ sample ไว้ด้วย publish ไม่ได้จะได้ลง flash */
+static item_t  *s_live;
+static uint16_t s_live_n;
+static char    *s_body;         // "[..],[..]"
+static int      s_body_len;
+static char    *s_msg;          // hdr + body
+static uint32_t s_batch_seq;
+static live_infl_t s_live_infl[LIVE_INFL];     // msg_id เปลี่ยนใต้ s_lock, items เขียนเฉพาะ mqtt_task
+
+/* backlog — s_ack / s_infl / s_ack_dirty เลื่อนใน mqtt_handler (PUBACK) ใช้ s_lock */
+static spill_rec_t *s_drain;
+static ack_t        s_ack;              // broker ตอบ PUBACK ถึง record นี้แล้ว (เก็บใน NVS)
+static inflight_t   s_infl = { .msg_id = -1 };
+static int          s_acked_ids[ACKED_IDS];
+static uint8_t      s_acked_head;
+static uint32_t     s_next_seq = 1;
+static uint32_t     s_ack_dirty;
+
+/* ===================== wifi / mqtt events ===================== */
+
+static void wifi_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        const wifi_event_sta_connected_t *ev = data;
+        s_st.channel = ev->channel;
+        ESP_LOGI(TAG, "📶 STA up on ch=%u (ESP-NOW follows)", ev->channel);
+        if (s_cfg.on_channel) s_cfg.on_channel(ev->channel);
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *ev = data;
+        ESP_LOGW(TAG, "📶 STA lost (reason %u), retry in %" PRIu32 " ms", ev->reason, s_backoff_ms);
+        // reconnect สแกนแค่ channel เดิม (ไม่หลุดไปกวาดทั้งย่าน ระหว่างนั้น ESP-NOW ยังรับได้)
+        if (s_st.channel) {
+            wifi_config_t w;
+            if (esp_wifi_get_config(WIFI_IF_STA, &w) == ESP_OK) {
+                w.sta.channel = s_st.channel;
+                esp_wifi_set_config(WIFI_IF_STA, &w);
+            }
+        }
+        s_reconnect_at = esp_timer_get_time() + (int64_t)s_backoff_ms * 1000;
+        s_backoff_ms = s_backoff_ms * 2 > RECONNECT_MAX_MS ? RECONNECT_MAX_MS : s_backoff_ms * 2;
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        s_backoff_ms = RECONNECT_MIN_MS;
+        if (!s_mqtt_started) {          // ครั้งต่อ ๆ ไป client reconnect เอง
+            s_mqtt_started = true;
+            esp_mqtt_client_start(s_client);
+        }
+    }
+}
+
+/* ใต้ s_lock: batch backlog ถึง broker แล้ว -> เลื่อน cursor (เขียน NVS ทีหลังใน mqtt_task) */
+static void ack_inflight_locked(void) {
+    uint32_t lost = s_infl.first_seq - s_ack.seq - 1;      // seq ขาดช่วง = ถูกทับก่อนส่ง
+    s_ack = s_infl.end;
+    s_st.drained += s_infl.n;
+    s_st.lost    += lost;
+    s_st.pending  = (s_st.pending > s_infl.n + lost) ? s_st.pending - s_infl.n - lost : 0;
+    s_ack_dirty   = (s_st.pending == 0) ? ACK_SAVE_EVERY : s_ack_dirty + 1;
+    s_infl.msg_id = -1;
+}
+
+/* ใต้ s_lock: batch สดถึง broker แล้ว -> นับ published ตอนนี้ (ไม่ใช่ตอน publish) */
+static bool ack_live_locked(int msg_id) {
+    for (int i = 0; i < LIVE_INFL; i++) {
+        if (s_live_infl[i].msg_id == msg_id) {
+            s_st.published += s_live_infl[i].n;
+            s_live_infl[i].msg_id = -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ใต้ s_lock: PUBACK ของ msg_id นี้มาก่อนบันทึกทันหรือยัง */
+static bool take_early_ack_locked(int msg_id) {
+    for (int i = 0; i < ACKED_IDS; i++) {
+        if (s_acked_ids[i] == msg_id) {
+            s_acked_ids[i] = -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t json_i64(const char *buf, const char *key) {
+    const char *p = strstr(buf, key);
+    return p ? strtoll(p + strlen(key), NULL, 10) : -1;
+}
+
+static void mqtt_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    esp_mqtt_event_handle_t ev = data;
+    switch ((esp_mqtt_event_id_t)id) {
+    case MQTT_EVENT_CONNECTED:
+        s_online = true;
+        s_st.connects++;
+        ESP_LOGI(TAG, "📡 broker connected (%s)", s_cfg.uri);
+        if (s_cfg.loopback) esp_mqtt_client_subscribe(s_client, s_topic, 0);
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        s_online = false;         // batch ที่รอ PUBACK ยังอยู่ใน outbox: client ส่งซ้ำเองตอนต่อใหม่
+        ESP_LOGW(TAG, "📡 broker disconnected");
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        portENTER_CRITICAL(&s_lock);
+        if (ev->msg_id == s_infl.msg_id) {
+            ack_inflight_locked();
+        } else if (!ack_live_locked(ev->msg_id)) {
+            s_acked_ids[s_acked_head++ % ACKED_IDS] = ev->msg_id;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        break;
+    case MQTT_EVENT_DATA: {
+        // ก้อนแรกของ message มี hdr ครบ (buffer client แบ่งที่เหลือเป็นหลาย event)
+        if (ev->current_data_offset != 0) break;
+        char head[HDR_JSON_MAX];
+        int n = ev->data_len < (int)sizeof(head) - 1 ? ev->data_len : (int)sizeof(head) - 1;
+        memcpy(head, ev->data, n);
+        head[n] = '\0';
+        int64_t old_us = json_i64(head, "\"old_us\":");
+        if (old_us <= 0) break;
+        uint32_t lat = (uint32_t)(esp_timer_get_time() - old_us);
+        portENTER_CRITICAL(&s_lock);
+        s_st.loop_batches++;
+        s_st.loop_us_sum += lat;
+        if (lat > s_st.loop_us_max) s_st.loop_us_max = lat;
+        portEXIT_CRITICAL(&s_lock);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* ===================== batch ===================== */
+
+static int sample_json(char *out, const espnow_gw_tsdb_sample_t *x, bool first) {
+    return sprintf(out, "%s[\"%08" PRIx32 "\",%" PRIu32 ",%d,%d,%d]", first ? "" : ",",
+                   x->sensor, x->ts, x->v[0], x->v[1], x->v[2]);
+}
+
+/* คืน msg_id — broker ไม่อยู่ / outbox ค้างเกิน -> -1 (ให้ผู้เรียกลง flash) */
+static int publish(const char *topic, const char *body, int body_len, int64_t old_us) {
+    if (!s_online || esp_mqtt_client_get_outbox_size(s_client) > s_cfg.outbox_max) return -1;
+
+    int64_t t0 = esp_timer_get_time();
+    int n = snprintf(s_msg, HDR_JSON_MAX, "{\"seq\":%" PRIu32 ",\"t_us\":%" PRId64 ",\"old_us\":%" PRId64 ",\"s\":[",
+                     s_batch_seq, t0, old_us);
+    memcpy(s_msg + n, body, body_len);
+    n += body_len;
+    s_msg[n++] = ']';
+    s_msg[n++] = '}';
+    int id = esp_mqtt_client_publish(s_client, topic, s_msg, n, 1, 0);
+    int64_t t1 = esp_timer_get_time();
+    if (id < 0) return -1;
+
+    s_batch_seq++;
+    portENTER_CRITICAL(&s_lock);
+    s_st.batches++;
+    s_st.bytes += n;
+    if (t1 - t0 > s_st.publish_us_max) s_st.publish_us_max = (uint32_t)(t1 - t0);
+    s_last_pub_us = t1;
+    portEXIT_CRITICAL(&s_lock);
+    return id;
+}
+
+static void spill(const item_t *it, uint16_t n) {
+    if (!s_spill) {
+        portENTER_CRITICAL(&s_lock);
+        s_st.dropped += n;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        spill_rec_t r = { .s = it[i].s, .seq = s_next_seq++ };
+        espnow_gw_tsdb_append(s_spill, &r);
+    }
+    espnow_gw_tsdb_flush(s_spill);     // batch ละครั้ง: ไฟดับหายไม่เกิน batch เดียว
+    portENTER_CRITICAL(&s_lock);
+    s_st.spilled += n;
+    s_st.pending += n;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* ช่องว่างใน s_live_infl — mqtt_handler แค่คืนช่อง (msg_id -> -1) ช่องที่เห็นว่างจึงว่างจนกว่า task นี้จะใช้ */
+static live_infl_t *live_slot(void) {
+    live_infl_t *slot = NULL;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < LIVE_INFL && !slot; i++) {
+        if (s_live_infl[i].msg_id < 0) slot = &s_live_infl[i];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return slot;
+}
+
+static void seal_live(void) {
+    if (!s_live_n) return;
+    live_infl_t *slot = live_slot();
+    int id = slot ? publish(s_topic, s_body, s_body_len, s_live[0].rx_us) : -1;
+    if (id >= 0) {
+        memcpy(slot->items, s_live, s_live_n * sizeof(item_t));
+        portENTER_CRITICAL(&s_lock);
+        slot->n       = s_live_n;
+        slot->sent_us = esp_timer_get_time();
+        slot->msg_id  = id;
+        if (take_early_ack_locked(id)) ack_live_locked(id);
+        portEXIT_CRITICAL(&s_lock);
+    } else {
+        spill(s_live, s_live_n);
+    }
+    s_live_n = 0;
+    s_body_len = 0;
+}
+
+/* batch สดที่ไม่ได้ PUBACK ใน ACK_TIMEOUT_MS = outbox ทิ้งไปแล้ว -> ลง flash ให้ backlog ส่งใหม่
+   (PUBACK มาทีหลังก็แค่ส่งซ้ำ = at-least-once เหมือน backlog) */
+static void expire_live(void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < LIVE_INFL; i++) {
+        live_infl_t *slot = &s_live_infl[i];
+        portENTER_CRITICAL(&s_lock);
+        bool expired = slot->msg_id >= 0 && now - slot->sent_us >= (int64_t)ACK_TIMEOUT_MS * 1000;
+        if (expired) slot->msg_id = -1;
+        portEXIT_CRITICAL(&s_lock);
+        if (!expired) continue;
+        ESP_LOGW(TAG, "💾 no PUBACK for live batch after %d ms, %u samples -> flash", ACK_TIMEOUT_MS, slot->n);
+        spill(slot->items, slot->n);    // ช่องนี้ task เดียวใช้: ยังไม่ถูกจองใหม่ระหว่างนี้
+    }
+}
+
+static void add_live(const item_t *it) {
+    if (s_live_n && s_body_len + SAMPLE_JSON_MAX > s_cfg.batch_max_bytes - HDR_JSON_MAX) seal_live();
+    s_live[s_live_n++] = *it;
+    s_body_len += sample_json(s_body + s_body_len, &it->s, s_live_n == 1);
+    if (s_live_n >= s_cfg.batch_max_samples) seal_live();
+}
+
+/* ===================== backlog (flash) ===================== */
+
+static void ack_save(void) {
+    portENTER_CRITICAL(&s_lock);
+    ack_t a = s_ack;
+    s_ack_dirty = 0;
+    portEXIT_CRITICAL(&s_lock);
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_blob(h, NVS_KEY_ACK, &a, sizeof(a)) == ESP_OK) nvs_commit(h);
+    nvs_close(h);
+}
+
+typedef struct {
+    uint32_t after;             // seq ที่ ack แล้ว
+    uint16_t n;
+} drain_scan_t;
+
+static bool drain_cb(const espnow_gw_tsdb_sample_t *rec, void *ctx) {
+    const spill_rec_t *r = (const spill_rec_t *)rec;
+    drain_scan_t *d = ctx;
+    if (r->seq <= d->after) return true;
+    memcpy(&s_drain[d->n++], r, sizeof(*r));
+    return d->n < s_cfg.batch_max_samples;
+}
+
+/* ส่ง backlog 1 batch (ตอน batch สดว่าง -> ใช้ s_body ร่วมได้) — false = ส่งไม่ได้ / รอ PUBACK (พักก่อน)
+   cursor เลื่อนตอน PUBACK เท่านั้น: รีบูตระหว่างรอ = ส่ง batch นั้นซ้ำ (at-least-once) ไม่หาย */
+static bool drain_step(void) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    bool waiting = (s_infl.msg_id >= 0);
+    bool expired = waiting && now - s_infl.sent_us >= (int64_t)ACK_TIMEOUT_MS * 1000;
+    if (expired) s_infl.msg_id = -1;
+    ack_t a = s_ack;
+    portEXIT_CRITICAL(&s_lock);
+    if (expired) ESP_LOGW(TAG, "💾 no PUBACK for backlog batch after %d ms, resending from seq %" PRIu32,
+                          ACK_TIMEOUT_MS, a.seq + 1);
+    else if (waiting) return false;
+
+    // เริ่มที่ ts ของ record ที่ ack แล้ว กรองด้วย seq — ไม่เจอค่อยกวาดทั้ง store (ts ย้อนตอนตั้งเวลาใหม่)
+    drain_scan_t d = { .after = a.seq };
+    espnow_gw_tsdb_scan(s_spill, a.ts, UINT32_MAX, ESPNOW_GW_TSDB_ANY_SENSOR, drain_cb, &d, NULL);
+    if (d.n == 0 && a.ts) espnow_gw_tsdb_scan(s_spill, 0, UINT32_MAX, ESPNOW_GW_TSDB_ANY_SENSOR, drain_cb, &d, NULL);
+    uint16_t n = d.n;
+    if (n == 0) {                       // ที่เหลือถูกทับหมดแล้ว
+        portENTER_CRITICAL(&s_lock);
+        s_st.lost += s_st.pending;
+        s_st.pending = 0;
+        portEXIT_CRITICAL(&s_lock);
+        ack_save();
+        return true;
+    }
+
+    int len = 0;
+    uint16_t sent = 0;
+    while (sent < n && len + SAMPLE_JSON_MAX <= s_cfg.batch_max_bytes - HDR_JSON_MAX) {
+        len += sample_json(s_body + len, &s_drain[sent].s, sent == 0);
+        sent++;
+    }
+    int id = publish(s_topic_backlog, s_body, len, 0);
+    if (id < 0) return false;
+
+    portENTER_CRITICAL(&s_lock);
+    s_infl = (inflight_t){
+        .msg_id = id, .first_seq = s_drain[0].seq, .n = sent, .sent_us = esp_timer_get_time(),
+        .end = { .seq = s_drain[sent - 1].seq, .ts = s_drain[sent - 1].s.ts },
+    };
+    if (take_early_ack_locked(id)) ack_inflight_locked();
+    portEXIT_CRITICAL(&s_lock);
+    return true;
+}
+
+static bool backlog_waiting(void) {
+    portENTER_CRITICAL(&s_lock);
+    bool waiting = (s_infl.msg_id >= 0);
+    portEXIT_CRITICAL(&s_lock);
+    return waiting;
+}
+
+typedef struct {
+    uint32_t max_seq;
+    uint32_t pending;
+} boot_scan_t;
+
+static bool boot_cb(const espnow_gw_tsdb_sample_t *rec, void *ctx) {
+    const spill_rec_t *r = (const spill_rec_t *)rec;
+    boot_scan_t *b = ctx;
+    if (r->seq > b->max_seq) b->max_seq = r->seq;
+    if (r->seq > s_ack.seq) b->pending++;
+    return true;
+}
+
+static esp_err_t spill_open(void) {
+    ESP_RETURN_ON_ERROR(espnow_gw_tsdb_open(s_cfg.spill_part, sizeof(spill_rec_t), &s_spill), TAG, "spill");
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        size_t len = sizeof(s_ack);
+        if (nvs_get_blob(h, NVS_KEY_ACK, &s_ack, &len) != ESP_OK) memset(&s_ack, 0, sizeof(s_ack));
+        nvs_close(h);
+    }
+    boot_scan_t b = {0};
+    espnow_gw_tsdb_scan(s_spill, 0, UINT32_MAX, ESPNOW_GW_TSDB_ANY_SENSOR, boot_cb, &b, NULL);
+    s_next_seq = (b.max_seq > s_ack.seq ? b.max_seq : s_ack.seq) + 1;
+    s_st.pending = b.pending;
+    if (b.pending) ESP_LOGI(TAG, "💾 %" PRIu32 " samples left in '%s' from last run", b.pending, s_cfg.spill_part);
+    return ESP_OK;
+}
+
+/* ===================== task ===================== */
+
+static void mqtt_task(void *arg) {
+    item_t it;
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        TickType_t wait = pdMS_TO_TICKS(500);
+        if (s_live_n) {
+            int64_t left_ms = (s_live[0].rx_us + (int64_t)s_cfg.batch_max_ms * 1000 - now) / 1000;
+            wait = left_ms > 0 ? pdMS_TO_TICKS(left_ms) : 0;
+        } else if (s_online && s_st.pending) {
+            wait = backlog_waiting() ? pdMS_TO_TICKS(20) : 0;   // ว่าง = ไล่ backlog (รอ PUBACK ก็รับ queue ไปด้วย)
+        }
+        if (xQueueReceive(s_q, &it, wait) == pdTRUE) add_live(&it);
+
+        now = esp_timer_get_time();
+        if (s_live_n && now - s_live[0].rx_us >= (int64_t)s_cfg.batch_max_ms * 1000) seal_live();
+        expire_live();
+        if (s_reconnect_at && now >= s_reconnect_at) {
+            s_reconnect_at = 0;
+            esp_wifi_connect();
+        }
+        if (s_online && s_st.pending && !s_live_n && uxQueueMessagesWaiting(s_q) == 0) {
+            if (!drain_step() && !backlog_waiting()) vTaskDelay(pdMS_TO_TICKS(100));   // publish ไม่ได้
+        }
+        if (s_ack_dirty >= ACK_SAVE_EVERY) ack_save();
+    }
+}
+
+void espnow_gw_mqtt_push(const espnow_gw_tsdb_sample_t *s) {
+    if (!s_q || !s) return;
+    item_t it = { .s = *s, .rx_us = esp_timer_get_time() };
+    bool ok = (xQueueSend(s_q, &it, 0) == pdTRUE);
+    portENTER_CRITICAL(&s_lock);
+    if (ok) s_st.pushed++;
+    else s_st.dropped++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t espnow_gw_mqtt_init(const espnow_gw_mqtt_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->ssid && cfg->uri && cfg->topic_prefix, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(cfg->batch_max_samples > 0 && cfg->batch_max_bytes >= HDR_JSON_MAX + SAMPLE_JSON_MAX + 2,
+                        ESP_ERR_INVALID_ARG, TAG, "batch limits");
+    ESP_RETURN_ON_FALSE(!s_q, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    s_cfg = *cfg;
+
+    uint8_t mac[6];
+    ESP_RETURN_ON_ERROR(esp_wifi_get_mac(WIFI_IF_STA, mac), TAG, "mac");
+    snprintf(s_topic, sizeof(s_topic), "%s/%02x%02x%02x%02x%02x%02x/telemetry",
+             cfg->topic_prefix, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(s_topic_backlog, sizeof(s_topic_backlog), "%s/%02x%02x%02x%02x%02x%02x/backlog",
+             cfg->topic_prefix, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    // msg = hdr + body + "]}" <= batch_max_bytes + 2
+    s_live  = calloc(cfg->batch_max_samples, sizeof(item_t));
+    s_drain = calloc(cfg->batch_max_samples, sizeof(spill_rec_t));
+    s_body  = malloc(cfg->batch_max_bytes);
+    s_msg   = malloc(cfg->batch_max_bytes + 2);
+    s_q     = xQueueCreate(cfg->queue_len, sizeof(item_t));
+    memset(s_acked_ids, 0xFF, sizeof(s_acked_ids));    // -1
+    ESP_RETURN_ON_FALSE(s_live && s_drain && s_body && s_msg && s_q, ESP_ERR_NO_MEM, TAG, "buffers");
+    for (int i = 0; i < LIVE_INFL; i++) {
+        s_live_infl[i].msg_id = -1;
+        s_live_infl[i].items  = calloc(cfg->batch_max_samples, sizeof(item_t));
+        ESP_RETURN_ON_FALSE(s_live_infl[i].items, ESP_ERR_NO_MEM, TAG, "live inflight");
+    }
+    if (cfg->spill_part) ESP_RETURN_ON_ERROR(spill_open(), TAG, "spill");
+
+    const esp_mqtt_client_config_t mcfg = {
+        .broker.address.uri = cfg->uri,
+        .buffer.out_size    = cfg->batch_max_bytes + 64,
+    };
+    s_client = esp_mqtt_client_init(&mcfg);
+    ESP_RETURN_ON_FALSE(s_client, ESP_ERR_NO_MEM, TAG, "mqtt client");
+    ESP_RETURN_ON_ERROR(esp_mqtt_client_register_event(s_client, MQTT_EVENT_ANY, mqtt_handler, NULL), TAG, "mqtt ev");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_handler, NULL), TAG, "wifi ev");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_handler, NULL), TAG, "ip ev");
+
+    ESP_RETURN_ON_FALSE(xTaskCreate(mqtt_task, "gw_mqtt", 4096, NULL, 5, NULL) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+
+    // ★ modem sleep (ค่าเริ่มต้นตอนต่อ AP) ปิดวิทยุระหว่าง beacon -> เฟรม ESP-NOW หาย
+    ESP_RETURN_ON_ERROR(esp_wifi_set_ps(WIFI_PS_NONE), TAG, "ps");
+    wifi_config_t w = {0};
+    ESP_RETURN_ON_ERROR(esp_wifi_get_config(WIFI_IF_STA, &w), TAG, "get config");
+    snprintf((char *)w.sta.ssid, sizeof(w.sta.ssid), "%s", cfg->ssid);
+    snprintf((char *)w.sta.password, sizeof(w.sta.password), "%s", cfg->password ? cfg->password : "");
+    w.sta.scan_method = WIFI_FAST_SCAN;
+    w.sta.channel     = 0;              // ครั้งแรกยังไม่รู้ channel ของ AP -> กวาดทุก channel
+    ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_STA, &w), TAG, "set config");
+    ESP_RETURN_ON_ERROR(esp_wifi_connect(), TAG, "connect");
+
+    ESP_LOGI(TAG, "📡 MQTT bridge -> %s topic %s (batch %u samples / %u B / %u ms, queue %u, spill %s)",
+             cfg->uri, s_topic, cfg->batch_max_samples, cfg->batch_max_bytes, cfg->batch_max_ms,
+             cfg->queue_len, cfg->spill_part ? cfg->spill_part : "off");
+    return ESP_OK;
+}
+
+void espnow_gw_mqtt_get_stats(espnow_gw_mqtt_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    *out = s_st;
+    portEXIT_CRITICAL(&s_lock);
+    out->online = s_online;
+}
+
+void espnow_gw_mqtt_report(void) {
+    if (!s_q) return;
+    static uint32_t last_pub;
+    static int64_t  last_us;
+    espnow_gw_mqtt_stats_t st;
+    espnow_gw_mqtt_get_stats(&st);
+    int64_t now = esp_timer_get_time();
+    uint32_t fwd = st.published + st.drained;
+    uint32_t rate = last_us ? (uint32_t)((uint64_t)(fwd - last_pub) * 1000000 / (now - last_us)) : 0;
+    last_pub = fwd;
+    last_us  = now;
+
+    ESP_LOGI(TAG, "📡 mqtt %s ch=%u: pushed=%" PRIu32 " published=%" PRIu32 " (%" PRIu32 " batches, %" PRIu64 " B, "
+             "%" PRIu32 " samples/s) drops=%" PRIu32 " publish max %" PRIu32 " us",
+             st.online ? "online" : "OFFLINE", st.channel, st.pushed, st.published, st.batches, st.bytes, rate,
+             st.dropped, st.publish_us_max);
+    if (st.spilled || st.pending)
+        ESP_LOGI(TAG, "   backlog: spilled=%" PRIu32 " drained=%" PRIu32 " pending=%" PRIu32 " lost=%" PRIu32,
+                 st.spilled, st.drained, st.pending, st.lost);
+    if (st.loop_batches)
+        ESP_LOGI(TAG, "   e2e (sample in -> back from broker): avg %" PRIu64 " ms, max %" PRIu32 " ms over %" PRIu32 " batches",
+                 st.loop_us_sum / st.loop_batches / 1000, st.loop_us_max / 1000, st.loop_batches);
+}
+
+void espnow_gw_mqtt_bench(uint32_t samples) {
+    if (!s_q) {
+        ESP_LOGE(TAG, "bench: not initialised");
+        return;
+    }
+    for (int i = 0; i < 300 && !s_online; i++) vTaskDelay(pdMS_TO_TICKS(100));
+    if (!s_online) {
+        ESP_LOGE(TAG, "bench: broker not reachable");
+        return;
+    }
+    espnow_gw_mqtt_stats_t a, b;
+    espnow_gw_mqtt_get_stats(&a);
+    uint32_t t = espnow_gw_tsdb_now();
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < samples; i++) {
+        item_t it = {
+            .s = { .ts = t, .sensor = 0xBE000000u | (i & 0xFF), .v = { (int16_t)i, 2500, 5000 } },
+            .rx_us = esp_timer_get_time(),
+        };
+        xQueueSend(s_q, &it, portMAX_DELAY);    // เต็มอัตราที่ task ส่งทัน (ไม่ drop)
+    }
+    do {
+        vTaskDelay(pdMS_TO_TICKS(50));
+        espnow_gw_mqtt_get_stats(&b);
+    } while (b.published + b.spilled - a.published - a.spilled < samples && esp_timer_get_time() - t0 < 60000000LL);
+    vTaskDelay(pdMS_TO_TICKS(s_cfg.loopback ? 2000 : 0));     // รอ loopback ชุดท้าย
+    espnow_gw_mqtt_get_stats(&b);
+
+    int64_t us = s_last_pub_us - t0;
+    uint32_t pub = b.published - a.published, nb = b.batches - a.batches, lb = b.loop_batches - a.loop_batches;
+    ESP_LOGI(TAG, "⏱️ bench: %" PRIu32 " samples -> %" PRIu32 " published in %" PRIu32 " batches (%" PRIu32 " spilled), "
+             "%" PRId64 " ms -> %" PRIu32 " samples/s, %" PRIu64 " B/batch",
+             samples, pub, nb, b.spilled - a.spilled, us / 1000, us > 0 ? (uint32_t)((uint64_t)pub * 1000000 / us) : 0,
+             nb ? (b.bytes - a.bytes) / nb : 0);
+    if (lb)
+        ESP_LOGI(TAG, "   e2e: avg %" PRIu64 " ms over %" PRIu32 " batches (includes batching delay)",
+                 (b.loop_us_sum - a.loop_us_sum) / lb / 1000, lb);
+}
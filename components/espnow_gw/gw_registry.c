@@ -0,0 +1,202 @@
+// components/espnow_gw/gw_registry.c
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gw_registry.h"
+
+static const char *TAG = "GW_REG";
+
+/* FNV-1a 32 บิต บน key 16 byte */
+static inline uint32_t key_hash(const espnow_gw_key_t *k) {
+    const uint8_t *p = (const uint8_t *)k;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(*k); i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline void make_key(espnow_gw_key_t *k, const uint8_t mac[6], const char *id) {
+    memcpy(k->mac, mac, 6);
+    memset(k->id, 0, sizeof(k->id));
+    if (id) strncpy(k->id, id, sizeof(k->id));   // ไม่มี '\0' ก็ได้ (ยาวพอดี 10)
+}
+
+uint32_t espnow_gw_key_hash(const uint8_t mac[6], const char *id) {
+    espnow_gw_key_t k;
+    make_key(&k, mac, id);
+    return key_hash(&k);
+}
+
+espnow_gw_sensor_t *espnow_gw_reg_get(espnow_gw_reg_t *reg, uint16_t handle) {
+    if (handle >= reg->count) return NULL;
+    return &reg->chunks[handle / ESPNOW_GW_REG_CHUNK][handle % ESPNOW_GW_REG_CHUNK];
+}
+
+/* หาใน table หนึ่ง: คืน handle หรือ INVALID, *slot_out = ช่องว่างที่เจอ (ไว้ใส่) */
+static uint16_t probe(espnow_gw_reg_t *reg, const uint16_t *slots, uint32_t cap,
+                      const espnow_gw_key_t *k, uint32_t h, uint32_t *slot_out) {
+    uint32_t mask = cap - 1;
+    for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+        reg->probes++;
+        uint16_t hd = slots[i];
+        if (hd == ESPNOW_GW_REG_INVALID) {
+            if (slot_out) *slot_out = i;
+            return ESPNOW_GW_REG_INVALID;
+        }
+        if (memcmp(&espnow_gw_reg_get(reg, hd)->key, k, sizeof(*k)) == 0) return hd;
+    }
+}
+
+/* ย้าย slot จาก table เก่าทีละนิด (เรียกทุก intern/find) */
+static void migrate_step(espnow_gw_reg_t *reg) {
+    if (!reg->old_slots) return;
+    for (int n = 0; n < ESPNOW_GW_REG_MIGRATE_STEP && reg->migrate_pos < reg->old_cap; n++) {
+        uint16_t hd = reg->old_slots[reg->migrate_pos++];
+        if (hd == ESPNOW_GW_REG_INVALID) continue;
+        const espnow_gw_key_t *k = &espnow_gw_reg_get(reg, hd)->key;
+        uint32_t slot;
+        if (probe(reg, reg->slots, reg->cap, k, key_hash(k), &slot) == ESPNOW_GW_REG_INVALID) {
+            reg->slots[slot] = hd;
+        }
+    }
+    if (reg->migrate_pos >= reg->old_cap) {
+        free(reg->old_slots);
+        reg->old_slots = NULL;
+    }
+}
+
+static uint16_t *alloc_slots(uint32_t cap) {
+    uint16_t *s = malloc(cap * sizeof(uint16_t));
+    if (s) memset(s, 0xFF, cap * sizeof(uint16_t));   // ทุกช่อง = INVALID
+    return s;
+}
+
+esp_err_t espnow_gw_reg_init(espnow_gw_reg_t *reg, uint32_t initial_slots) {
+    ESP_RETURN_ON_FALSE(reg, ESP_ERR_INVALID_ARG, TAG, "reg");
+    memset(reg, 0, sizeof(*reg));
+    uint32_t cap = 16;
+    while (cap < initial_slots) cap <<= 1;
+    reg->slots = alloc_slots(cap);
+    ESP_RETURN_ON_FALSE(reg->slots, ESP_ERR_NO_MEM, TAG, "slots");
+    reg->cap = cap;
+    return ESP_OK;
+}
+
+void espnow_gw_reg_free(espnow_gw_reg_t *reg) {
+    for (int i = 0; i < ESPNOW_GW_REG_MAX_CHUNKS; i++) free(reg->chunks[i]);
+    free(reg->slots);
+    free(reg->old_slots);
+    memset(reg, 0, sizeof(*reg));
+}
+
+uint16_t espnow_gw_reg_find(espnow_gw_reg_t *reg, const uint8_t mac[6], const char *id) {
+    espnow_gw_key_t k;
+    make_key(&k, mac, id);
+    uint32_t h = key_hash(&k);
+    migrate_step(reg);
+    reg->lookups++;
+    uint16_t hd = probe(reg, reg->slots, reg->cap, &k, h, NULL);
+    if (hd == ESPNOW_GW_REG_INVALID && reg->old_slots) hd = probe(reg, reg->old_slots, reg->old_cap, &k, h, NULL);
+    return hd;
+}
+
+uint16_t espnow_gw_reg_intern(espnow_gw_reg_t *reg, const uint8_t mac[6], const char *id, bool *created) {
+    if (created) *created = false;
+    espnow_gw_key_t k;
+    make_key(&k, mac, id);
+    uint32_t h = key_hash(&k);
+    migrate_step(reg);
+    reg->lookups++;
+
+    uint32_t slot;
+    uint16_t hd = probe(reg, reg->slots, reg->cap, &k, h, &slot);
+    if (hd != ESPNOW_GW_REG_INVALID) return hd;
+    if (reg->old_slots) {
+        hd = probe(reg, reg->old_slots, reg->old_cap, &k, h, NULL);
+        if (hd != ESPNOW_GW_REG_INVALID) return hd;
+    }
+
+    // ใหม่: ต่อท้าย dense array (chunk ใหม่เมื่อจำเป็น)
+    uint16_t n = reg->count;
+    if (n >= ESPNOW_GW_REG_CHUNK * ESPNOW_GW_REG_MAX_CHUNKS) return ESPNOW_GW_REG_INVALID;
+    if (!reg->chunks[n / ESPNOW_GW_REG_CHUNK]) {
+        reg->chunks[n / ESPNOW_GW_REG_CHUNK] = calloc(ESPNOW_GW_REG_CHUNK, sizeof(espnow_gw_sensor_t));
+        if (!reg->chunks[n / ESPNOW_GW_REG_CHUNK]) return ESPNOW_GW_REG_INVALID;
+    }
+    // เต็ม 70% และไม่ได้ย้ายอยู่ -> เริ่ม resize แบบค่อยเป็นค่อยไป
+    if (!reg->old_slots && (uint32_t)(n + 1) * 10 > reg->cap * 7) {
+        uint16_t *bigger = alloc_slots(reg->cap * 2);
+        if (bigger) {
+            reg->old_slots   = reg->slots;
+            reg->old_cap     = reg->cap;
+            reg->slots       = bigger;
+            reg->cap        *= 2;
+            reg->migrate_pos = 0;
+            reg->resizes++;
+            probe(reg, reg->slots, reg->cap, &k, h, &slot);
+        }
+    }
+
+    espnow_gw_sensor_t *s = &reg->chunks[n / ESPNOW_GW_REG_CHUNK][n % ESPNOW_GW_REG_CHUNK];
+    memset(s, 0, sizeof(*s));
+    s->key = k;
+    espnow_flow_rx_init(&s->flow);
+    reg->slots[slot] = n;
+    reg->count++;
+    if (created) *created = true;
+    return n;
+}
+
+size_t espnow_gw_reg_bytes(const espnow_gw_reg_t *reg) {
+    size_t b = (reg->cap + reg->old_cap) * sizeof(uint16_t);
+    for (int i = 0; i < ESPNOW_GW_REG_MAX_CHUNKS; i++) {
+        if (reg->chunks[i]) b += ESPNOW_GW_REG_CHUNK * sizeof(espnow_gw_sensor_t);
+    }
+    return b;
+}
+
+void espnow_gw_reg_report(const espnow_gw_reg_t *reg) {
+    ESP_LOGI(TAG, "📇 %u sensors, table %" PRIu32 " slots%s, %u B, resizes=%" PRIu32 " probes/lookup=%.2f",
+             reg->count, reg->cap, reg->old_slots ? " (resizing)" : "", (unsigned)espnow_gw_reg_bytes(reg),
+             reg->resizes, reg->lookups ? (double)reg->probes / reg->lookups : 0.0);
+}
+
+void espnow_gw_reg_bench(uint32_t n) {
+    static espnow_gw_reg_t reg;
+    if (espnow_gw_reg_init(&reg, 16) != ESP_OK) return;
+
+    uint8_t mac[6] = {0x02, 0x42, 0, 0, 0, 0};
+    char id[ESPNOW_GW_REG_ID_LEN] = "BENCH";
+    int64_t worst_us = 0, t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < n; i++) {
+        mac[4] = (uint8_t)(i >> 8);
+        mac[5] = (uint8_t)i;
+        int64_t a = esp_timer_get_time();
+        espnow_gw_reg_intern(&reg, mac, id, NULL);
+        int64_t d = esp_timer_get_time() - a;
+        if (d > worst_us) worst_us = d;
+    }
+    int64_t t1 = esp_timer_get_time();
+
+    const uint32_t lookups = 100000;
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint32_t j = (i * 2654435761u) % n;
+        mac[4] = (uint8_t)(j >> 8);
+        mac[5] = (uint8_t)j;
+        hits += espnow_gw_reg_find(&reg, mac, id) != ESPNOW_GW_REG_INVALID;
+    }
+    int64_t t2 = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "⏱️ bench %" PRIu32 " sensors: intern %" PRId64 " ns avg (worst %" PRId64 " us), "
+             "lookup %" PRIu64 "/s (%" PRIu32 " hits)",
+             n, (t1 - t0) * 1000 / (n ? n : 1), worst_us,
+             (uint64_t)lookups * 1000000 / ((t2 - t1) > 0 ? (t2 - t1) : 1), hits);
+    espnow_gw_reg_report(&reg);
+    espnow_gw_reg_free(&reg);
+}
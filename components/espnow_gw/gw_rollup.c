@@ -0,0 +1,326 @@
+// components/espnow_gw/gw_rollup.c
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gw_rollup.h"
+
+static const char *TAG = "GW_ROLLUP";
+
+static const uint32_t s_bucket_s[ESPNOW_GW_RES_MAX] = { 0, 60, 3600 };
+static const char    *s_res_name[ESPNOW_GW_RES_MAX] = { "raw", "1m", "1h" };
+
+typedef struct {
+    uint32_t start;                 // ต้น bucket
+    uint16_t count;
+    int32_t  sum[ESPNOW_GW_TSDB_FIELDS];
+    int16_t  min[ESPNOW_GW_TSDB_FIELDS];
+    int16_t  max[ESPNOW_GW_TSDB_FIELDS];
+} agg_t;
+
+typedef struct {
+    uint32_t sensor;                // 0 = ว่าง
+    agg_t    m;
+    agg_t    h;
+} slot_t;
+
+static espnow_gw_tsdb_t *s_db[ESPNOW_GW_RES_MAX];
+static slot_t           *s_slots;
+static uint32_t          s_cap;     // power of 2, >= 2 x max_sensors
+static uint16_t          s_max_sensors;
+static uint16_t          s_used;
+
+static espnow_gw_rollup_stats_t s_st;
+
+/* ===================== aggregate ===================== */
+
+static void agg_reset(agg_t *a, uint32_t start) {
+    a->start = start;
+    a->count = 0;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        a->sum[f] = 0;
+        a->min[f] = INT16_MAX;
+        a->max[f] = INT16_MIN;
+    }
+}
+
+static void agg_add(agg_t *a, const int16_t v[ESPNOW_GW_TSDB_FIELDS]) {
+    a->count++;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        a->sum[f] += v[f];
+        if (v[f] < a->min[f]) a->min[f] = v[f];
+        if (v[f] > a->max[f]) a->max[f] = v[f];
+    }
+}
+
+/* รวม record ชั้นล่าง (mean x count = sum เดิม) */
+static void agg_merge(agg_t *a, const espnow_gw_rollup_rec_t *r) {
+    if (a->count + r->count > UINT16_MAX) return;
+    a->count += r->count;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        a->sum[f] += (int32_t)r->base.v[f] * r->count;
+        if (r->min[f] < a->min[f]) a->min[f] = r->min[f];
+        if (r->max[f] > a->max[f]) a->max[f] = r->max[f];
+    }
+}
+
+static void agg_to_rec(const agg_t *a, uint32_t sensor, espnow_gw_rollup_rec_t *r) {
+    r->base.ts     = a->start;
+    r->base.sensor = sensor;
+    r->count       = a->count;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        int32_t s = a->sum[f], n = a->count;
+        r->base.v[f] = (int16_t)((s >= 0 ? s + n / 2 : s - n / 2) / n);
+        r->min[f]    = a->min[f];
+        r->max[f]    = a->max[f];
+    }
+}
+
+static void emit_hour(slot_t *s) {
+    espnow_gw_rollup_rec_t r;
+    agg_to_rec(&s->h, s->sensor, &r);
+    if (espnow_gw_tsdb_append(s_db[ESPNOW_GW_RES_1H], &r) == ESP_OK) s_st.hours++;
+    s->h.count = 0;
+}
+
+/* นาทีปิด -> record 1m แล้วส่งต่อขึ้นชั้นชั่วโมง (ข้ามชั่วโมง = ปิดชั่วโมงเก่าก่อน) */
+static void emit_minute(slot_t *s) {
+    espnow_gw_rollup_rec_t r;
+    agg_to_rec(&s->m, s->sensor, &r);
+    if (espnow_gw_tsdb_append(s_db[ESPNOW_GW_RES_1M], &r) == ESP_OK) s_st.minutes++;
+    s->m.count = 0;
+
+    uint32_t h = r.base.ts / 3600 * 3600;
+    if (s->h.count && s->h.start != h) emit_hour(s);
+    if (s->h.count == 0) agg_reset(&s->h, h);
+    agg_merge(&s->h, &r);
+}
+
+/* ===================== slots ===================== */
+
+static slot_t *slot_get(uint32_t sensor, bool create) {
+    uint32_t mask = s_cap - 1;
+    uint32_t i = (sensor * 2654435761u) & mask;
+    for (uint32_t n = 0; n < s_cap; n++, i = (i + 1) & mask) {
+        if (s_slots[i].sensor == sensor) return &s_slots[i];
+        if (s_slots[i].sensor == 0) {
+            if (!create || s_used >= s_max_sensors) return NULL;
+            s_used++;
+            s_slots[i].sensor = sensor;
+            s_slots[i].m.count = 0;
+            s_slots[i].h.count = 0;
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t espnow_gw_rollup_ingest(const espnow_gw_tsdb_sample_t *x) {
+    ESP_RETURN_ON_FALSE(s_slots, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    ESP_RETURN_ON_FALSE(x && x->sensor != ESPNOW_GW_TSDB_ANY_SENSOR, ESP_ERR_INVALID_ARG, TAG, "sample");
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = espnow_gw_tsdb_append(s_db[ESPNOW_GW_RES_RAW], x);
+
+    slot_t *s = slot_get(x->sensor, true);
+    if (s) {
+        uint32_t m = x->ts / 60 * 60;
+        if (s->m.count && s->m.start != m) emit_minute(s);
+        if (s->m.count == 0) agg_reset(&s->m, m);
+        int16_t v[ESPNOW_GW_TSDB_FIELDS];
+        memcpy(v, x->v, sizeof(v));             // sample เป็น packed
+        agg_add(&s->m, v);
+    } else {
+        s_st.no_slot++;
+    }
+
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+    s_st.ingested++;
+    s_st.ingest_us += dt;
+    if (dt > s_st.ingest_max_us) s_st.ingest_max_us = dt;
+    return err;
+}
+
+void espnow_gw_rollup_tick(uint32_t now) {
+    if (!s_slots) return;
+    for (uint32_t i = 0; i < s_cap; i++) {
+        slot_t *s = &s_slots[i];
+        if (!s->sensor) continue;
+        if (s->m.count && now >= s->m.start + 60 + ESPNOW_GW_ROLLUP_GRACE_S) emit_minute(s);
+        if (s->h.count && now >= s->h.start + 3600 + ESPNOW_GW_ROLLUP_GRACE_S) emit_hour(s);
+    }
+}
+
+esp_err_t espnow_gw_rollup_flush(void) {
+    for (int r = 0; r < ESPNOW_GW_RES_MAX; r++) {
+        if (s_db[r]) ESP_RETURN_ON_ERROR(espnow_gw_tsdb_flush(s_db[r]), TAG, "flush %s", s_res_name[r]);
+    }
+    return ESP_OK;
+}
+
+/* ===================== recovery ===================== */
+
+static bool rebuild_cb(const espnow_gw_tsdb_sample_t *rec, void *ctx) {
+    const espnow_gw_rollup_rec_t *r = (const espnow_gw_rollup_rec_t *)rec;
+    uint32_t h = *(const uint32_t *)ctx;
+    slot_t *s = slot_get(r->base.sensor, true);
+    if (!s) return true;
+    if (s->h.count == 0) agg_reset(&s->h, h);
+    agg_merge(&s->h, r);
+    return true;
+}
+
+/* ชั่วโมงล่าสุดใน 1m ที่ยังไม่มี record 1h -> รวมคืนเข้า slot */
+static void rebuild_hours(void) {
+    espnow_gw_tsdb_stats_t m, h;
+    espnow_gw_tsdb_get_stats(s_db[ESPNOW_GW_RES_1M], &m);
+    espnow_gw_tsdb_get_stats(s_db[ESPNOW_GW_RES_1H], &h);
+    if (!m.newest_ts) return;
+
+    uint32_t hour = m.newest_ts / 3600 * 3600;
+    if (h.newest_ts >= hour) return;
+    espnow_gw_tsdb_scan_stats_t st;
+    espnow_gw_tsdb_scan(s_db[ESPNOW_GW_RES_1M], hour, hour + 3599, ESPNOW_GW_TSDB_ANY_SENSOR,
+                        rebuild_cb, &hour, &st);
+    ESP_LOGI(TAG, "hour %" PRIu32 " rebuilt from %" PRIu32 " minute records (%" PRIu32 " sensors) in %" PRIu32 " us",
+             hour, st.samples_matched, (uint32_t)s_used, st.us);
+}
+
+esp_err_t espnow_gw_rollup_init(const espnow_gw_rollup_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->max_sensors > 0, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(!s_slots, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+
+    ESP_RETURN_ON_ERROR(espnow_gw_tsdb_open(cfg->part_raw, 0, &s_db[ESPNOW_GW_RES_RAW]), TAG, "raw");
+    ESP_RETURN_ON_ERROR(espnow_gw_tsdb_open(cfg->part_1m, sizeof(espnow_gw_rollup_rec_t), &s_db[ESPNOW_GW_RES_1M]),
+                        TAG, "1m");
+    ESP_RETURN_ON_ERROR(espnow_gw_tsdb_open(cfg->part_1h, sizeof(espnow_gw_rollup_rec_t), &s_db[ESPNOW_GW_RES_1H]),
+                        TAG, "1h");
+
+    s_cap = 1;
+    while (s_cap < 2u * cfg->max_sensors) s_cap <<= 1;
+    s_slots = calloc(s_cap, sizeof(slot_t));
+    ESP_RETURN_ON_FALSE(s_slots, ESP_ERR_NO_MEM, TAG, "slots");
+    s_max_sensors = cfg->max_sensors;
+    s_st.ram_bytes = s_cap * sizeof(slot_t) + ESPNOW_GW_RES_MAX * espnow_gw_tsdb_ram_bytes();
+
+    rebuild_hours();
+    for (int r = 0; r < ESPNOW_GW_RES_MAX; r++) {
+        espnow_gw_tsdb_stats_t st;
+        espnow_gw_tsdb_get_stats(s_db[r], &st);
+        ESP_LOGI(TAG, "   %-3s: room for %" PRIu32 " records, holds %" PRIu32 "..%" PRIu32 " s",
+                 s_res_name[r], (st.blocks_total - 1) * st.records_per_block, st.oldest_ts, st.newest_ts);
+    }
+    ESP_LOGI(TAG, "📉 rollup ready: %u sensors, %" PRIu32 " B RAM", s_max_sensors, s_st.ram_bytes);
+    return ESP_OK;
+}
+
+/* ===================== query ===================== */
+
+typedef struct {
+    int      field;
+    bool     raw;
+    uint32_t step;
+    espnow_gw_rollup_point_t cur;
+    double   sum;
+    bool     have;
+    bool     go;
+    espnow_gw_rollup_cb_t cb;
+    void    *ctx;
+} query_t;
+
+static void q_emit(query_t *q) {
+    if (!q->have) return;
+    q->cur.mean = (float)(q->sum / q->cur.count);
+    q->go = q->cb(&q->cur, q->ctx);
+    q->have = false;
+}
+
+static bool query_cb(const espnow_gw_tsdb_sample_t *rec, void *ctx) {
+    query_t *q = ctx;
+    uint32_t n = 1;
+    float lo = rec->v[q->field], hi = lo;
+    if (!q->raw) {
+        const espnow_gw_rollup_rec_t *r = (const espnow_gw_rollup_rec_t *)rec;
+        n  = r->count;
+        lo = r->min[q->field];
+        hi = r->max[q->field];
+    }
+    uint32_t start = q->step ? rec->ts / q->step * q->step : rec->ts;
+    if (q->have && start != q->cur.ts) q_emit(q);
+    if (!q->go) return false;
+    if (!q->have) {
+        q->have = true;
+        q->cur = (espnow_gw_rollup_point_t){ .ts = start, .min = lo, .max = hi };
+        q->sum = 0;
+    }
+    q->cur.count += n;
+    q->sum += (double)rec->v[q->field] * n;
+    if (lo < q->cur.min) q->cur.min = lo;
+    if (hi > q->cur.max) q->cur.max = hi;
+    return true;
+}
+
+/* หยาบสุดที่ bucket <= step และข้อมูลย้อนไปถึง t0, ไม่มี -> ชั้นที่ละเอียดสุดที่ยังครอบ t0, ไม่มีเลย -> 1h */
+static espnow_gw_res_t pick_res(uint32_t t0, uint32_t step_s) {
+    uint32_t oldest[ESPNOW_GW_RES_MAX];
+    for (int r = 0; r < ESPNOW_GW_RES_MAX; r++) {
+        espnow_gw_tsdb_stats_t st;
+        espnow_gw_tsdb_get_stats(s_db[r], &st);
+        oldest[r] = st.oldest_ts ? st.oldest_ts : UINT32_MAX;
+    }
+    for (int r = ESPNOW_GW_RES_MAX - 1; r >= 0; r--) {
+        if (s_bucket_s[r] <= step_s && oldest[r] <= t0) return (espnow_gw_res_t)r;
+    }
+    for (int r = 0; r < ESPNOW_GW_RES_MAX; r++) {
+        if (oldest[r] <= t0) return (espnow_gw_res_t)r;
+    }
+    return ESPNOW_GW_RES_1H;
+}
+
+esp_err_t espnow_gw_rollup_query(uint32_t sensor, int field, uint32_t t0, uint32_t t1, uint32_t step_s,
+                                 espnow_gw_rollup_cb_t cb, void *ctx, espnow_gw_res_t *used) {
+    ESP_RETURN_ON_FALSE(s_slots, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    ESP_RETURN_ON_FALSE(cb && field >= 0 && field < ESPNOW_GW_TSDB_FIELDS && t0 <= t1,
+                        ESP_ERR_INVALID_ARG, TAG, "arg");
+
+    espnow_gw_res_t res = pick_res(t0, step_s);
+    if (used) *used = res;
+    query_t q = {
+        .field = field,
+        .raw   = (res == ESPNOW_GW_RES_RAW),
+        .step  = step_s > s_bucket_s[res] ? step_s : s_bucket_s[res],
+        .go    = true,
+        .cb    = cb,
+        .ctx   = ctx,
+    };
+    // bucket ที่เริ่มก่อน t0 แต่คาบเกี่ยวก็เอา
+    uint32_t from = (res == ESPNOW_GW_RES_RAW) ? t0 : t0 / s_bucket_s[res] * s_bucket_s[res];
+    ESP_RETURN_ON_ERROR(espnow_gw_tsdb_scan(s_db[res], from, t1, sensor, query_cb, &q, NULL), TAG, "scan");
+    if (q.go) q_emit(&q);
+    return ESP_OK;
+}
+
+espnow_gw_tsdb_t *espnow_gw_rollup_store(espnow_gw_res_t res) {
+    return (res < ESPNOW_GW_RES_MAX) ? s_db[res] : NULL;
+}
+
+void espnow_gw_rollup_get_stats(espnow_gw_rollup_stats_t *out) {
+    *out = s_st;
+}
+
+void espnow_gw_rollup_report(void) {
+    if (!s_slots) return;
+    uint64_t flash = 0;
+    for (int r = 0; r < ESPNOW_GW_RES_MAX; r++) {
+        espnow_gw_tsdb_stats_t st;
+        espnow_gw_tsdb_get_stats(s_db[r], &st);
+        flash += st.bytes_written;
+    }
+    uint32_t n = s_st.ingested;
+    ESP_LOGI(TAG, "📉 rollup: %" PRIu32 " samples -> %" PRIu32 " x 1m, %" PRIu32 " x 1h (%u sensors, %" PRIu32 " no slot)",
+             n, s_st.minutes, s_st.hours, s_used, s_st.no_slot);
+    ESP_LOGI(TAG, "   per sample: %" PRIu64 " us avg / %" PRIu32 " us max CPU, %" PRIu64 " B flash; RAM %" PRIu32 " B total",
+             n ? s_st.ingest_us / n : 0, s_st.ingest_max_us, n ? flash / n : 0, s_st.ram_bytes);
+}
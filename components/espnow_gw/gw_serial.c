@@ -0,0 +1,143 @@
+// components/espnow_gw/gw_serial.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "driver/uart.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_rom_crc.h"
+#include "gw_serial.h"
+
+static const char *TAG = "GW_SERIAL";
+
+#define UART_TX_BUF   8192    // ring ของ UART driver (ISR เติม FIFO จากตรงนี้)
+#define REC_MAX       (sizeof(espnow_gw_serial_hdr_t) + ESPNOW_GW_SERIAL_MAX_PAYLOAD + 4)
+
+static espnow_gw_serial_config_t s_cfg;
+static RingbufHandle_t           s_ring;
+static espnow_gw_serial_stats_t  s_stats = { .ring_low_water = ESPNOW_GW_SERIAL_RING_BYTES };
+static portMUX_TYPE              s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+size_t espnow_gw_cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t  code_at = 0, o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (++code == 0xFF) {       // บล็อกเต็ม 254 byte
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+static void push_record(uint8_t kind, const uint8_t mac[6], int8_t rssi, const void *data, int len) {
+    if (!s_ring || len < 0 || len > ESPNOW_GW_SERIAL_MAX_PAYLOAD) return;
+
+    // จองที่ใน ring แล้วเขียน hdr + payload ตรงลงไป (CRC/COBS ทำใน task)
+    void *slot = NULL;
+    size_t need = sizeof(espnow_gw_serial_hdr_t) + len;
+    if (xRingbufferSendAcquire(s_ring, &slot, need, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_lock);
+        s_stats.drops++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    espnow_gw_serial_hdr_t h = {
+        .version = ESPNOW_GW_SERIAL_VERSION,
+        .kind    = kind,
+        .ts_us   = (uint64_t)esp_timer_get_time(),
+        .rssi    = rssi,
+        .len     = (uint16_t)len,
+    };
+    if (mac) memcpy(h.mac, mac, 6);
+    memcpy(slot, &h, sizeof(h));
+    memcpy((uint8_t *)slot + sizeof(h), data, len);
+    xRingbufferSendComplete(s_ring, slot);
+
+    uint32_t free_now = xRingbufferGetCurFreeSize(s_ring);
+    portENTER_CRITICAL(&s_lock);
+    if (free_now < s_stats.ring_low_water) s_stats.ring_low_water = free_now;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void espnow_gw_serial_push(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (!info || !data) return;
+    push_record(ESPNOW_GW_SERIAL_KIND_RX, info->src_addr, info->rx_ctrl ? info->rx_ctrl->rssi : 0, data, len);
+}
+
+void espnow_gw_serial_push_kind(uint8_t kind, const uint8_t mac[6], const void *data, int len) {
+    push_record(kind, mac, 0, data, len);
+}
+
+static void serial_task(void *arg) {
+    static uint8_t rec[REC_MAX];
+    static uint8_t out[REC_MAX + REC_MAX / 254 + 2];
+
+    while (1) {
+        size_t size = 0;
+        uint8_t *item = xRingbufferReceive(s_ring, &size, portMAX_DELAY);
+        if (!item) continue;
+        memcpy(rec, item, size);
+        vRingbufferReturnItem(s_ring, item);
+
+        uint32_t crc = esp_rom_crc32_le(0, rec, size);   // = zlib.crc32
+        memcpy(rec + size, &crc, 4);
+        size_t n = espnow_gw_cobs_encode(rec, size + 4, out);
+        out[n++] = 0x00;
+        uart_write_bytes(s_cfg.uart_port, out, n);   // บล็อกได้ถ้า UART ช้ากว่าอัตราเข้า -> ring เต็ม -> drop
+
+        portENTER_CRITICAL(&s_lock);
+        s_stats.records++;
+        s_stats.bytes += n;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+esp_err_t espnow_gw_serial_init(const espnow_gw_serial_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->baud > 0, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(!s_ring, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    s_cfg = *cfg;
+
+    const uart_config_t ucfg = {
+        .baud_rate  = cfg->baud,
+        .data_bits  = UART_DATA_8_BITS,
+        .parity     = UART_PARITY_DISABLE,
+        .stop_bits  = UART_STOP_BITS_1,
+        .flow_ctrl  = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    ESP_LOGI(TAG, "🔌 binary bridge on UART%d @ %d baud (COBS + CRC32)%s",
+             cfg->uart_port, cfg->baud, cfg->quiet_logs ? ", logs off" : "");
+    ESP_RETURN_ON_ERROR(uart_driver_install(cfg->uart_port, 256, UART_TX_BUF, 0, NULL, 0), TAG, "uart install");
+    ESP_RETURN_ON_ERROR(uart_param_config(cfg->uart_port, &ucfg), TAG, "uart config");
+    ESP_RETURN_ON_ERROR(uart_set_pin(cfg->uart_port,
+                                     cfg->tx_pin < 0 ? UART_PIN_NO_CHANGE : cfg->tx_pin,
+                                     cfg->rx_pin < 0 ? UART_PIN_NO_CHANGE : cfg->rx_pin,
+                                     UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE), TAG, "uart pins");
+    if (cfg->quiet_logs) esp_log_level_set("*", ESP_LOG_ERROR);
+
+    s_ring = xRingbufferCreate(ESPNOW_GW_SERIAL_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    ESP_RETURN_ON_FALSE(s_ring, ESP_ERR_NO_MEM, TAG, "ring");
+    ESP_RETURN_ON_FALSE(xTaskCreate(serial_task, "gw_serial", 3072, NULL, 5, NULL) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    return ESP_OK;
+}
+
+void espnow_gw_serial_get_stats(espnow_gw_serial_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,206 @@
+// components/espnow_gw/gw_stats.c
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gw_stats.h"
+
+static const char *TAG = "GW_STATS";
+
+/* ความยาว bucket ต่อหน้าต่าง: 5 s, 75 s, 5 min (x 12 = 1 min, 15 min, 1 h) */
+static const int64_t s_bucket_ms[ESPNOW_GW_WIN_MAX] = { 5000, 75000, 300000 };
+
+typedef struct {
+    uint32_t n;
+    float    mean;
+    float    m2;
+    float    min;
+    float    max;
+} acc_t;
+
+typedef struct {
+    int64_t epoch;                  // เลข bucket (t_ms / bucket_ms), -1 = ว่าง
+    acc_t   f[ESPNOW_GW_FIELD_MAX];
+} bucket_t;
+
+typedef struct {
+    bucket_t b[ESPNOW_GW_STATS_BUCKETS];
+    float    ema[ESPNOW_GW_FIELD_MAX];
+    int64_t  last_ms;               // -1 = ยังไม่มี sample
+} window_t;
+
+typedef struct {
+    window_t w[ESPNOW_GW_WIN_MAX];
+} sensor_t;
+
+static sensor_t   **s_sensors;
+static uint16_t     s_max;
+static int          s_active;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void acc_add(acc_t *a, float x) {
+    if (a->n == 0 || x < a->min) a->min = x;
+    if (a->n == 0 || x > a->max) a->max = x;
+    a->n++;
+    float d = x - a->mean;
+    a->mean += d / (float)a->n;
+    a->m2   += d * (x - a->mean);
+}
+
+/* Chan et al.: รวม mean/M2 สองกลุ่มโดยไม่ต้องมี sample เดิม */
+static inline void acc_merge(acc_t *a, const acc_t *b) {
+    if (b->n == 0) return;
+    if (a->n == 0) {
+        *a = *b;
+        return;
+    }
+    float n = (float)(a->n + b->n);
+    float d = b->mean - a->mean;
+    a->mean += d * (float)b->n / n;
+    a->m2   += b->m2 + d * d * (float)a->n * (float)b->n / n;
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+    a->n    += b->n;
+}
+
+static void sensor_reset(sensor_t *s) {
+    memset(s, 0, sizeof(*s));
+    for (int w = 0; w < ESPNOW_GW_WIN_MAX; w++) {
+        s->w[w].last_ms = -1;
+        for (int i = 0; i < ESPNOW_GW_STATS_BUCKETS; i++) s->w[w].b[i].epoch = -1;
+    }
+}
+
+static void sensor_add(sensor_t *s, int64_t t_ms, const float v[ESPNOW_GW_FIELD_MAX]) {
+    for (int w = 0; w < ESPNOW_GW_WIN_MAX; w++) {
+        window_t *win   = &s->w[w];
+        int64_t   epoch = t_ms / s_bucket_ms[w];
+        bucket_t *b     = &win->b[epoch % ESPNOW_GW_STATS_BUCKETS];
+        if (b->epoch != epoch) {            // bucket เก่าหลุดหน้าต่างแล้ว -> ใช้ซ้ำ
+            memset(b->f, 0, sizeof(b->f));
+            b->epoch = epoch;
+        }
+
+        // EMA แบบเวลาต่อเนื่อง: alpha = 1 - e^(-dt/tau), tau = ความยาวหน้าต่าง
+        float alpha = 1.0f;
+        if (win->last_ms >= 0 && t_ms > win->last_ms) {
+            float tau = (float)(s_bucket_ms[w] * ESPNOW_GW_STATS_BUCKETS);
+            alpha = 1.0f - expf(-(float)(t_ms - win->last_ms) / tau);
+        } else if (win->last_ms >= 0) {
+            alpha = 0.0f;                   // เวลาเดียวกัน/ย้อน: ไม่ขยับ EMA
+        }
+        for (int f = 0; f < ESPNOW_GW_FIELD_MAX; f++) {
+            acc_add(&b->f[f], v[f]);
+            win->ema[f] += alpha * (v[f] - win->ema[f]);
+        }
+        if (t_ms > win->last_ms) win->last_ms = t_ms;
+    }
+}
+
+static void sensor_query(const sensor_t *s, espnow_gw_win_t w, espnow_gw_field_t f,
+                         int64_t now_ms, espnow_gw_stat_t *out) {
+    const window_t *win = &s->w[w];
+    int64_t now_epoch = now_ms / s_bucket_ms[w];
+    acc_t a = {0};
+    for (int i = 0; i < ESPNOW_GW_STATS_BUCKETS; i++) {
+        const bucket_t *b = &win->b[i];
+        if (b->epoch < 0 || now_epoch - b->epoch >= ESPNOW_GW_STATS_BUCKETS || b->epoch > now_epoch) continue;
+        acc_merge(&a, &b->f[f]);
+    }
+    out->count    = a.n;
+    out->min      = a.min;
+    out->max      = a.max;
+    out->mean     = a.mean;
+    out->variance = (a.n > 1) ? a.m2 / (float)(a.n - 1) : 0.0f;
+    out->ema      = win->ema[f];
+}
+
+esp_err_t espnow_gw_stats_init(uint16_t max_sensors) {
+    ESP_RETURN_ON_FALSE(max_sensors > 0, ESP_ERR_INVALID_ARG, TAG, "max_sensors");
+    ESP_RETURN_ON_FALSE(!s_sensors, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    s_sensors = calloc(max_sensors, sizeof(sensor_t *));
+    ESP_RETURN_ON_FALSE(s_sensors, ESP_ERR_NO_MEM, TAG, "table");
+    s_max = max_sensors;
+    ESP_LOGI(TAG, "%u sensors max, %u B per sensor (allocated on first sample)",
+             max_sensors, (unsigned)espnow_gw_stats_bytes_per_sensor());
+    return ESP_OK;
+}
+
+esp_err_t espnow_gw_stats_add(uint16_t sensor, int64_t t_ms, const float v[ESPNOW_GW_FIELD_MAX]) {
+    ESP_RETURN_ON_FALSE(s_sensors && sensor < s_max, ESP_ERR_INVALID_ARG, TAG, "sensor");
+    if (!s_sensors[sensor]) {
+        sensor_t *s = malloc(sizeof(sensor_t));   // จองนอก lock
+        ESP_RETURN_ON_FALSE(s, ESP_ERR_NO_MEM, TAG, "sensor state");
+        sensor_reset(s);
+        portENTER_CRITICAL(&s_lock);
+        if (!s_sensors[sensor]) {
+            s_sensors[sensor] = s;
+            s_active++;
+            s = NULL;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        free(s);
+    }
+    portENTER_CRITICAL(&s_lock);
+    sensor_add(s_sensors[sensor], t_ms, v);
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t espnow_gw_stats_query(uint16_t sensor, espnow_gw_win_t win, espnow_gw_field_t field,
+                                int64_t now_ms, espnow_gw_stat_t *out) {
+    ESP_RETURN_ON_FALSE(out && win < ESPNOW_GW_WIN_MAX && field < ESPNOW_GW_FIELD_MAX,
+                        ESP_ERR_INVALID_ARG, TAG, "args");
+    if (!s_sensors || sensor >= s_max || !s_sensors[sensor]) return ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    sensor_query(s_sensors[sensor], win, field, now_ms, out);
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+size_t espnow_gw_stats_bytes_per_sensor(void) {
+    return sizeof(sensor_t) + sizeof(sensor_t *);
+}
+
+int espnow_gw_stats_active(void) {
+    return s_active;
+}
+
+void espnow_gw_stats_bench(uint32_t samples) {
+    sensor_t *s = malloc(sizeof(sensor_t));
+    if (!s || samples == 0) {
+        free(s);
+        return;
+    }
+    sensor_reset(s);
+
+    // sample ทุก 5 ms (เวลาจำลอง) -> วน bucket ครบทุกหน้าต่างถ้า samples มากพอ
+    float v[ESPNOW_GW_FIELD_MAX] = { 25.0f, 60.0f, 1000.0f };
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < samples; i++) {
+        v[0] = 25.0f + (float)(i % 17) * 0.1f;
+        v[2] = (float)(i % 4096);
+        sensor_add(s, (int64_t)i * 5, v);
+    }
+    int64_t t1 = esp_timer_get_time();
+
+    espnow_gw_stat_t st;
+    const uint32_t queries = 10000;
+    for (uint32_t i = 0; i < queries; i++) {
+        sensor_query(s, (espnow_gw_win_t)(i % ESPNOW_GW_WIN_MAX), ESPNOW_GW_FIELD_TEMP,
+                     (int64_t)samples * 5, &st);
+    }
+    int64_t t2 = esp_timer_get_time();
+    sensor_query(s, ESPNOW_GW_WIN_1H, ESPNOW_GW_FIELD_TEMP, (int64_t)samples * 5, &st);
+    free(s);
+
+    int64_t add_us = (t1 - t0) > 0 ? (t1 - t0) : 1;
+    ESP_LOGI(TAG, "⏱️ bench: %" PRIu32 " samples in %" PRId64 " us = %" PRIu64 " samples/s, query %" PRId64 " ns",
+             samples, add_us, (uint64_t)samples * 1000000 / add_us, (t2 - t1) * 1000 / queries);
+    ESP_LOGI(TAG, "   1h temp: n=%" PRIu32 " mean=%.2f var=%.3f min=%.1f max=%.1f ema=%.2f",
+             st.count, st.mean, st.variance, st.min, st.max, st.ema);
+}
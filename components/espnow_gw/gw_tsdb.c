@@ -0,0 +1,501 @@
+// components/espnow_gw/gw_tsdb.c
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_partition.h"
+#include "gw_tsdb.h"
+
+static const char *TAG = "GW_TSDB";
+
+#define MAGIC_OPEN      0x31425354u     // "TSB1"
+#define MAGIC_CLOSED    0x43425354u     // "TSBC"
+#define TSDB_VERSION    1
+#define SUM_OFFSET      64              // สรุปอยู่ใน page 0 ถัดจาก header (เขียนคนละจังหวะ)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;                   // เพิ่มทีละ 1 ทุก block ใหม่ -> ตัวมากสุด = head
+    uint16_t version;
+    uint16_t rec_size;              // ไม่ตรงกับที่เปิด = block ของ format อื่น (ไม่นับ)
+    uint32_t crc;
+} blk_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t pages;
+    uint32_t t_min;
+    uint32_t t_max;
+    int16_t  v_min[ESPNOW_GW_TSDB_FIELDS];
+    int16_t  v_max[ESPNOW_GW_TSDB_FIELDS];
+    uint32_t crc;
+} blk_sum_t;
+
+_Static_assert(SUM_OFFSET + sizeof(blk_sum_t) <= ESPNOW_GW_TSDB_PAGE, "page 0 layout");
+
+struct espnow_gw_tsdb {
+    const esp_partition_t *part;
+    const uint8_t         *map;
+    uint32_t               nblk;
+    uint16_t               rec_size;
+    uint16_t               per_page;
+    SemaphoreHandle_t      mx;
+
+    uint32_t  head;                 // sector ของ block ล่าสุด (MAX = ว่างทั้ง partition)
+    uint32_t  head_seq;
+    int       cur_page;             // page ถัดไปใน head, 0 = head ปิดแล้ว
+    blk_sum_t live;                 // สรุปของ head ที่ยังเปิด (อยู่ใน RAM จนปิด)
+    uint8_t   stage[ESPNOW_GW_TSDB_PAGE];
+    int       stage_n;
+
+    espnow_gw_tsdb_stats_t st;
+};
+
+static int64_t s_t_base;            // ts = s_t_base + uptime (วินาที) — ใช้ร่วมทุก store
+
+static inline uint32_t tsdb_crc(const void *p, size_t len) {
+    return esp_rom_crc32_le(0, p, len);
+}
+
+static inline const uint8_t *blk_ptr(const espnow_gw_tsdb_t *db, uint32_t i) {
+    return db->map + (size_t)i * ESPNOW_GW_TSDB_SECTOR;
+}
+
+static inline const uint8_t *page_ptr(const espnow_gw_tsdb_t *db, uint32_t blk, int page) {
+    return blk_ptr(db, blk) + (size_t)page * ESPNOW_GW_TSDB_PAGE;
+}
+
+static inline const espnow_gw_tsdb_sample_t *rec_at(const espnow_gw_tsdb_t *db, const uint8_t *page, int n) {
+    return (const espnow_gw_tsdb_sample_t *)(page + (size_t)n * db->rec_size);
+}
+
+static bool hdr_valid(const espnow_gw_tsdb_t *db, uint32_t i, uint32_t *seq) {
+    const blk_hdr_t *h = (const blk_hdr_t *)blk_ptr(db, i);
+    if (h->magic != MAGIC_OPEN || h->crc != tsdb_crc(h, offsetof(blk_hdr_t, crc))) return false;
+    if (h->version != TSDB_VERSION || h->rec_size != db->rec_size) return false;
+    if (seq) *seq = h->seq;
+    return true;
+}
+
+static const blk_sum_t *sum_valid(const espnow_gw_tsdb_t *db, uint32_t i) {
+    const blk_sum_t *s = (const blk_sum_t *)(blk_ptr(db, i) + SUM_OFFSET);
+    if (s->magic != MAGIC_CLOSED || s->crc != tsdb_crc(s, offsetof(blk_sum_t, crc))) return NULL;
+    return s;
+}
+
+/* 0 = ว่าง (0xFF ทั้ง page), 1 = ใช้ได้, -1 = เขียนค้าง (CRC ผิด) */
+static int page_state(const espnow_gw_tsdb_t *db, uint32_t blk, int page) {
+    const uint8_t  *p = page_ptr(db, blk, page);
+    const uint32_t *w = (const uint32_t *)p;
+    bool erased = true;
+    for (size_t k = 0; k < ESPNOW_GW_TSDB_PAGE / 4; k++) {
+        if (w[k] != 0xFFFFFFFFu) { erased = false; break; }
+    }
+    if (erased) return 0;
+    return w[ESPNOW_GW_TSDB_PAGE / 4 - 1] == tsdb_crc(p, ESPNOW_GW_TSDB_PAGE_DATA) ? 1 : -1;
+}
+
+static void sum_reset(blk_sum_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->t_min = UINT32_MAX;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        s->v_min[f] = INT16_MAX;
+        s->v_max[f] = INT16_MIN;
+    }
+}
+
+static void sum_add(blk_sum_t *s, const espnow_gw_tsdb_sample_t *x) {
+    if (x->ts == ESPNOW_GW_TSDB_TS_EMPTY) return;
+    s->count++;
+    if (x->ts < s->t_min) s->t_min = x->ts;
+    if (x->ts > s->t_max) s->t_max = x->ts;
+    for (int f = 0; f < ESPNOW_GW_TSDB_FIELDS; f++) {
+        if (x->v[f] < s->v_min[f]) s->v_min[f] = x->v[f];
+        if (x->v[f] > s->v_max[f]) s->v_max[f] = x->v[f];
+    }
+}
+
+static esp_err_t flash_write(espnow_gw_tsdb_t *db, size_t off, const void *src, size_t len) {
+    ESP_RETURN_ON_ERROR(esp_partition_write(db->part, off, src, len), TAG, "write @0x%x", (unsigned)off);
+    db->st.bytes_written += len;
+    return ESP_OK;
+}
+
+/* ===================== write path ===================== */
+
+static esp_err_t open_block(espnow_gw_tsdb_t *db) {
+    uint32_t next = (db->head == UINT32_MAX) ? 0 : (db->head + 1) % db->nblk;
+    bool reused = hdr_valid(db, next, NULL);    // วงแหวนเต็ม -> ทับ block เก่าสุด
+
+    ESP_RETURN_ON_ERROR(esp_partition_erase_range(db->part, (size_t)next * ESPNOW_GW_TSDB_SECTOR,
+                                                  ESPNOW_GW_TSDB_SECTOR), TAG, "erase");
+    db->st.erases++;
+
+    blk_hdr_t h = {
+        .magic    = MAGIC_OPEN,
+        .seq      = (db->head == UINT32_MAX) ? 1 : db->head_seq + 1,
+        .version  = TSDB_VERSION,
+        .rec_size = db->rec_size,
+    };
+    h.crc = tsdb_crc(&h, offsetof(blk_hdr_t, crc));
+    ESP_RETURN_ON_ERROR(flash_write(db, (size_t)next * ESPNOW_GW_TSDB_SECTOR, &h, sizeof(h)), TAG, "hdr");
+
+    if (!reused) db->st.blocks_used++;
+    db->head     = next;
+    db->head_seq = h.seq;
+    db->cur_page = 1;
+    sum_reset(&db->live);
+    return ESP_OK;
+}
+
+static esp_err_t close_block(espnow_gw_tsdb_t *db) {
+    db->live.magic = MAGIC_CLOSED;
+    db->live.pages = (uint16_t)(db->cur_page - 1);
+    db->live.crc   = tsdb_crc(&db->live, offsetof(blk_sum_t, crc));
+    ESP_RETURN_ON_ERROR(flash_write(db, (size_t)db->head * ESPNOW_GW_TSDB_SECTOR + SUM_OFFSET,
+                                    &db->live, sizeof(db->live)), TAG, "summary");
+    db->cur_page = 0;
+    return ESP_OK;
+}
+
+static esp_err_t write_stage(espnow_gw_tsdb_t *db) {
+    if (db->cur_page == 0) ESP_RETURN_ON_ERROR(open_block(db), TAG, "open block");
+
+    // ช่องที่เหลือเป็น 0xFF อยู่แล้ว (ts = TS_EMPTY) -> reader ข้าม
+    uint32_t crc = tsdb_crc(db->stage, ESPNOW_GW_TSDB_PAGE_DATA);
+    memcpy(db->stage + ESPNOW_GW_TSDB_PAGE_DATA, &crc, sizeof(crc));
+    ESP_RETURN_ON_ERROR(flash_write(db, (size_t)db->head * ESPNOW_GW_TSDB_SECTOR + (size_t)db->cur_page * ESPNOW_GW_TSDB_PAGE,
+                                    db->stage, sizeof(db->stage)), TAG, "page");
+    for (int k = 0; k < db->stage_n; k++) sum_add(&db->live, rec_at(db, db->stage, k));
+    db->st.pages_written++;
+    db->stage_n = 0;
+    memset(db->stage, 0xFF, sizeof(db->stage));
+
+    if (++db->cur_page > ESPNOW_GW_TSDB_DATA_PAGES) return close_block(db);
+    return ESP_OK;
+}
+
+esp_err_t espnow_gw_tsdb_append(espnow_gw_tsdb_t *db, const void *rec) {
+    ESP_RETURN_ON_FALSE(db && rec, ESP_ERR_INVALID_ARG, TAG, "arg");
+    const espnow_gw_tsdb_sample_t *x = rec;
+    ESP_RETURN_ON_FALSE(x->ts != ESPNOW_GW_TSDB_TS_EMPTY, ESP_ERR_INVALID_ARG, TAG, "ts");
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    memcpy(db->stage + (size_t)db->stage_n++ * db->rec_size, rec, db->rec_size);
+    db->st.appended++;
+    if (x->ts > db->st.newest_ts) db->st.newest_ts = x->ts;
+    if (db->stage_n == db->per_page) {
+        err = write_stage(db);
+        if (err != ESP_OK) {                // flash เสีย: ทิ้ง page นี้ ไม่ให้ staging ล้น
+            db->stage_n = 0;
+            memset(db->stage, 0xFF, sizeof(db->stage));
+        }
+    }
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+    if (dt > db->st.append_max_us) db->st.append_max_us = dt;
+    xSemaphoreGive(db->mx);
+    return err;
+}
+
+esp_err_t espnow_gw_tsdb_flush(espnow_gw_tsdb_t *db) {
+    ESP_RETURN_ON_FALSE(db, ESP_ERR_INVALID_ARG, TAG, "db");
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    if (db->stage_n > 0) err = write_stage(db);
+    xSemaphoreGive(db->mx);
+    return err;
+}
+
+/* ===================== read path ===================== */
+
+static bool visit(const espnow_gw_tsdb_sample_t *x, uint32_t t0, uint32_t t1, uint32_t sensor,
+                  espnow_gw_tsdb_cb_t cb, void *ctx, espnow_gw_tsdb_scan_stats_t *st) {
+    if (x->ts == ESPNOW_GW_TSDB_TS_EMPTY) return true;
+    st->samples_visited++;
+    if (x->ts < t0 || x->ts > t1) return true;
+    if (sensor != ESPNOW_GW_TSDB_ANY_SENSOR && x->sensor != sensor) return true;
+    st->samples_matched++;
+    return cb(x, ctx);
+}
+
+esp_err_t espnow_gw_tsdb_scan(espnow_gw_tsdb_t *db, uint32_t t0, uint32_t t1, uint32_t sensor,
+                              espnow_gw_tsdb_cb_t cb, void *ctx, espnow_gw_tsdb_scan_stats_t *st) {
+    ESP_RETURN_ON_FALSE(db && cb, ESP_ERR_INVALID_ARG, TAG, "arg");
+    espnow_gw_tsdb_scan_stats_t local;
+    if (!st) st = &local;
+    memset(st, 0, sizeof(*st));
+
+    int64_t start = esp_timer_get_time();
+    bool go = true;
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    for (uint32_t k = 0; go && db->head != UINT32_MAX && k < db->nblk; k++) {
+        uint32_t i = (db->head + 1 + k) % db->nblk;     // เก่าสุด -> ใหม่สุด
+        if (!hdr_valid(db, i, NULL)) continue;
+        st->blocks++;
+
+        bool live = (i == db->head && db->cur_page != 0);
+        const blk_sum_t *sum = live ? &db->live : sum_valid(db, i);
+        if (sum && (sum->count == 0 || sum->t_max < t0 || sum->t_min > t1)) {
+            st->blocks_skipped++;
+            continue;
+        }
+        int npages = live ? db->cur_page - 1 : ESPNOW_GW_TSDB_DATA_PAGES;
+        for (int p = 1; go && p <= npages; p++) {
+            int state = page_state(db, i, p);
+            if (state == 0) break;          // block ที่ไม่มีสรุป: ถึงส่วนที่ยังไม่ได้เขียน
+            if (state < 0) continue;
+            st->pages_read++;
+            const uint8_t *pg = page_ptr(db, i, p);
+            for (int n = 0; go && n < db->per_page; n++) {
+                go = visit(rec_at(db, pg, n), t0, t1, sensor, cb, ctx, st);
+            }
+        }
+    }
+    for (int n = 0; go && n < db->stage_n; n++) {   // ยังอยู่ใน RAM
+        go = visit(rec_at(db, db->stage, n), t0, t1, sensor, cb, ctx, st);
+    }
+    xSemaphoreGive(db->mx);
+    st->us = (uint32_t)(esp_timer_get_time() - start);
+    return ESP_OK;
+}
+
+/* ===================== recovery ===================== */
+
+/* หา head จาก seq มากสุด, head ยังไม่ปิด -> สร้างสรุปใหม่จาก page ที่ใช้ได้แล้วเขียนต่อจาก page ว่างแรก */
+static esp_err_t recover(espnow_gw_tsdb_t *db) {
+    int64_t t0 = esp_timer_get_time();
+    db->head = UINT32_MAX;
+    db->head_seq = 0;
+    db->cur_page = 0;
+    db->stage_n = 0;
+    db->st.blocks_used = 0;
+    db->st.torn_pages = 0;
+    db->st.newest_ts = 0;
+
+    for (uint32_t i = 0; i < db->nblk; i++) {
+        uint32_t seq;
+        if (!hdr_valid(db, i, &seq)) continue;
+        db->st.blocks_used++;
+        const blk_sum_t *sum = sum_valid(db, i);
+        if (sum && sum->count && sum->t_max > db->st.newest_ts) db->st.newest_ts = sum->t_max;
+        if (db->head == UINT32_MAX || seq > db->head_seq) {
+            db->head = i;
+            db->head_seq = seq;
+        }
+    }
+
+    if (db->head != UINT32_MAX && !sum_valid(db, db->head)) {
+        sum_reset(&db->live);
+        db->cur_page = ESPNOW_GW_TSDB_DATA_PAGES + 1;
+        for (int p = 1; p <= ESPNOW_GW_TSDB_DATA_PAGES; p++) {
+            int state = page_state(db, db->head, p);
+            if (state == 0) {
+                db->cur_page = p;
+                break;
+            }
+            if (state < 0) {
+                db->st.torn_pages++;        // เขียนทับไม่ได้จนกว่าจะ erase -> ข้ามไป page ถัดไป
+                continue;
+            }
+            const uint8_t *pg = page_ptr(db, db->head, p);
+            for (int n = 0; n < db->per_page; n++) sum_add(&db->live, rec_at(db, pg, n));
+        }
+        if (db->live.count && db->live.t_max > db->st.newest_ts) db->st.newest_ts = db->live.t_max;
+        // ไฟดับหลัง page สุดท้ายแต่ก่อนเขียนสรุป
+        if (db->cur_page > ESPNOW_GW_TSDB_DATA_PAGES) ESP_RETURN_ON_ERROR(close_block(db), TAG, "close");
+    }
+    memset(db->stage, 0xFF, sizeof(db->stage));
+
+    // นาฬิกาของ store เดินต่อจาก record ล่าสุด (ไม่มี RTC) — หลาย store เอาตัวที่ไปไกลสุด
+    int64_t base = (int64_t)db->st.newest_ts + 1 - esp_timer_get_time() / 1000000;
+    if (base > s_t_base) s_t_base = base;
+    db->st.recovery_us = (uint32_t)(esp_timer_get_time() - t0);
+    return ESP_OK;
+}
+
+esp_err_t espnow_gw_tsdb_open(const char *label, uint16_t rec_size, espnow_gw_tsdb_t **out) {
+    ESP_RETURN_ON_FALSE(label && out, ESP_ERR_INVALID_ARG, TAG, "arg");
+    if (rec_size == 0) rec_size = sizeof(espnow_gw_tsdb_sample_t);
+    ESP_RETURN_ON_FALSE(rec_size >= sizeof(espnow_gw_tsdb_sample_t) && rec_size <= ESPNOW_GW_TSDB_PAGE_DATA,
+                        ESP_ERR_INVALID_SIZE, TAG, "rec_size %u", rec_size);
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    ESP_RETURN_ON_FALSE(part, ESP_ERR_NOT_FOUND, TAG, "partition '%s' not found", label);
+    ESP_RETURN_ON_FALSE(part->size >= 2 * ESPNOW_GW_TSDB_SECTOR, ESP_ERR_INVALID_SIZE, TAG, "partition too small");
+
+    espnow_gw_tsdb_t *db = calloc(1, sizeof(*db));
+    ESP_RETURN_ON_FALSE(db, ESP_ERR_NO_MEM, TAG, "db");
+    db->mx = xSemaphoreCreateMutex();
+    esp_partition_mmap_handle_t h;
+    esp_err_t err = db->mx ? esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA,
+                                                (const void **)&db->map, &h)
+                           : ESP_ERR_NO_MEM;
+    if (err != ESP_OK) {
+        if (db->mx) vSemaphoreDelete(db->mx);
+        free(db);
+        ESP_LOGE(TAG, "open '%s': %s", label, esp_err_to_name(err));
+        return err;
+    }
+    db->part     = part;
+    db->nblk     = part->size / ESPNOW_GW_TSDB_SECTOR;
+    db->rec_size = rec_size;
+    db->per_page = ESPNOW_GW_TSDB_PAGE_DATA / rec_size;
+    db->st.blocks_total      = db->nblk;
+    db->st.records_per_block = (uint32_t)db->per_page * ESPNOW_GW_TSDB_DATA_PAGES;
+
+    recover(db);
+    ESP_LOGI(TAG, "💾 tsdb '%s': %" PRIu32 " KiB, %u B records, %" PRIu32 "/%" PRIu32 " blocks used, head page %d, "
+             "torn %" PRIu32 ", recovered in %" PRIu32 " us (now=%" PRIu32 " s)",
+             label, (uint32_t)(part->size / 1024), rec_size, db->st.blocks_used, db->nblk, db->cur_page,
+             db->st.torn_pages, db->st.recovery_us, espnow_gw_tsdb_now());
+    *out = db;
+    return ESP_OK;
+}
+
+uint32_t espnow_gw_tsdb_now(void) {
+    return (uint32_t)(s_t_base + esp_timer_get_time() / 1000000);
+}
+
+size_t espnow_gw_tsdb_ram_bytes(void) {
+    return sizeof(espnow_gw_tsdb_t);
+}
+
+void espnow_gw_tsdb_get_stats(espnow_gw_tsdb_t *db, espnow_gw_tsdb_stats_t *out) {
+    if (!db) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    *out = db->st;
+    out->oldest_ts = 0;
+    for (uint32_t k = 0; db->head != UINT32_MAX && k < db->nblk; k++) {
+        uint32_t i = (db->head + 1 + k) % db->nblk;
+        if (!hdr_valid(db, i, NULL)) continue;
+        const blk_sum_t *sum = (i == db->head && db->cur_page != 0) ? &db->live : sum_valid(db, i);
+        if (sum && sum->count) {
+            out->oldest_ts = sum->t_min;
+            break;
+        }
+    }
+    if (!out->oldest_ts) {                  // ยังอยู่ใน staging อย่างเดียว
+        for (int n = 0; n < db->stage_n; n++) {
+            uint32_t ts = rec_at(db, db->stage, n)->ts;
+            if (!out->oldest_ts || ts < out->oldest_ts) out->oldest_ts = ts;
+        }
+    }
+    xSemaphoreGive(db->mx);
+}
+
+void espnow_gw_tsdb_report(espnow_gw_tsdb_t *db) {
+    if (!db) return;
+    espnow_gw_tsdb_stats_t st;
+    espnow_gw_tsdb_get_stats(db, &st);
+    ESP_LOGI(TAG, "💾 %s: %" PRIu32 "/%" PRIu32 " blocks, appended=%" PRIu32 " pages=%" PRIu32 " erases=%" PRIu32
+             " written=%" PRIu64 " B, span %" PRIu32 "..%" PRIu32 " s, append max %" PRIu32 " us",
+             db->part->label, st.blocks_used, st.blocks_total, st.appended, st.pages_written, st.erases,
+             st.bytes_written, st.oldest_ts, st.newest_ts, st.append_max_us);
+}
+
+/* ===================== bench ===================== */
+
+static bool count_cb(const espnow_gw_tsdb_sample_t *s, void *ctx) {
+    (*(uint32_t *)ctx)++;
+    return true;
+}
+
+static void bench_scan(espnow_gw_tsdb_t *db, const char *name, uint32_t t0, uint32_t t1, uint32_t sensor) {
+    uint32_t n = 0;
+    espnow_gw_tsdb_scan_stats_t st;
+    espnow_gw_tsdb_scan(db, t0, t1, sensor, count_cb, &n, &st);
+    ESP_LOGI(TAG, "   %-16s: %6" PRIu32 " hits in %6" PRIu32 " us (%" PRIu32 "/%" PRIu32 " blocks skipped, "
+             "%" PRIu32 " pages, %" PRIu32 " samples visited)",
+             name, n, st.us, st.blocks_skipped, st.blocks, st.pages_read, st.samples_visited);
+}
+
+static esp_err_t wipe(espnow_gw_tsdb_t *db) {
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    esp_err_t err = esp_partition_erase_range(db->part, 0, db->part->size);
+    if (err == ESP_OK) {
+        uint32_t total = db->st.blocks_total, per_block = db->st.records_per_block;
+        memset(&db->st, 0, sizeof(db->st));
+        db->st.blocks_total      = total;
+        db->st.records_per_block = per_block;
+        err = recover(db);
+    }
+    xSemaphoreGive(db->mx);
+    return err;
+}
+
+void espnow_gw_tsdb_bench(espnow_gw_tsdb_t *db, uint32_t samples) {
+    if (!db) {
+        ESP_LOGE(TAG, "bench: not open");
+        return;
+    }
+    ESP_LOGW(TAG, "⚠️ bench: erasing '%s' (%" PRIu32 " KiB)", db->part->label, (uint32_t)(db->part->size / 1024));
+    int64_t t0 = esp_timer_get_time();
+    if (wipe(db) != ESP_OK) return;
+    ESP_LOGI(TAG, "   erase all       : %" PRId64 " ms", (esp_timer_get_time() - t0) / 1000);
+
+    // 16 sensor ทุก 5 วินาที (เหมือน sender_data)
+    uint8_t rec[ESPNOW_GW_TSDB_PAGE_DATA] = {0};
+    espnow_gw_tsdb_sample_t *x = (espnow_gw_tsdb_sample_t *)rec;
+    const uint32_t ts0 = espnow_gw_tsdb_now();
+    uint32_t ts = ts0;
+    t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < samples; i++) {
+        ts = ts0 + (i / 16) * 5;
+        x->ts     = ts;
+        x->sensor = 0x1000 + i % 16;
+        x->v[0]   = (int16_t)(2500 + i % 300);
+        x->v[1]   = 6000;
+        x->v[2]   = (int16_t)(i % 4096);
+        if (espnow_gw_tsdb_append(db, rec) != ESP_OK) {
+            samples = i;
+            break;
+        }
+    }
+    espnow_gw_tsdb_flush(db);
+    int64_t dt = esp_timer_get_time() - t0;
+    if (!samples || dt <= 0) return;
+
+    espnow_gw_tsdb_stats_t st;
+    espnow_gw_tsdb_get_stats(db, &st);
+    uint64_t payload = (uint64_t)samples * db->rec_size;
+    ESP_LOGI(TAG, "   append %6" PRIu32 ": %" PRId64 " ms -> %" PRIu64 " records/s, avg %" PRIu64 " us, max %" PRIu32 " us",
+             samples, dt / 1000, (uint64_t)samples * 1000000 / dt, dt / samples, st.append_max_us);
+    ESP_LOGI(TAG, "   flash           : %" PRIu64 " B programmed for %" PRIu64 " B payload (x%" PRIu64 ".%02" PRIu64 "), "
+             "%" PRIu32 " erases, %" PRIu32 " pages",
+             st.bytes_written, payload, st.bytes_written / payload, st.bytes_written * 100 / payload % 100,
+             st.erases, st.pages_written);
+    ESP_LOGI(TAG, "   retention       : %" PRIu32 " records max (%" PRIu32 " blocks x %" PRIu32 ")",
+             (st.blocks_total - 1) * st.records_per_block, st.blocks_total, st.records_per_block);
+
+    bench_scan(db, "last 1 h", ts > 3600 ? ts - 3600 : 0, ts, ESPNOW_GW_TSDB_ANY_SENSOR);
+    bench_scan(db, "last 1 h, 1 sens", ts > 3600 ? ts - 3600 : 0, ts, 0x1000);
+    bench_scan(db, "all", st.oldest_ts, ts, ESPNOW_GW_TSDB_ANY_SENSOR);
+    bench_scan(db, "all, 1 sensor", st.oldest_ts, ts, 0x1000);
+
+    // ไฟดับกลาง page: program ครึ่ง page ที่ head แล้ว recover ใหม่
+    xSemaphoreTake(db->mx, portMAX_DELAY);
+    if (db->cur_page >= 1 && db->cur_page <= ESPNOW_GW_TSDB_DATA_PAGES) {
+        uint8_t junk[ESPNOW_GW_TSDB_PAGE / 2];
+        memset(junk, 0x5A, sizeof(junk));
+        flash_write(db, (size_t)db->head * ESPNOW_GW_TSDB_SECTOR + (size_t)db->cur_page * ESPNOW_GW_TSDB_PAGE,
+                    junk, sizeof(junk));
+    }
+    recover(db);
+    ESP_LOGI(TAG, "   recovery        : %" PRIu32 " us over %" PRIu32 " blocks (torn pages %" PRIu32 ", resume page %d)",
+             db->st.recovery_us, db->nblk, db->st.torn_pages, db->cur_page);
+    xSemaphoreGive(db->mx);
+
+    wipe(db);
+    ESP_LOGI(TAG, "   partition erased again (bench data dropped)");
+}
@@ -0,0 +1,79 @@
+// components/espnow_gw/include/gw_mqtt.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "gw_tsdb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bridge gateway -> MQTT: sample ที่ถอดแล้วออก broker เป็นก้อน (แทน console log)
+   - rx_task แค่ push ลง queue (ไม่บล็อก เต็ม = นับ drop) task แยกประกอบ batch + publish QoS 1
+   - ปิด batch เมื่อครบ batch_max_samples / ยาวเกิน batch_max_bytes / sample แรกค้างเกิน batch_max_ms
+   - topic <prefix>/<mac gateway>/telemetry, payload JSON:
+       {"seq":N,"t_us":<esp_timer ตอน publish>,"old_us":<esp_timer ของ sample แรก>,"s":[["<sensor>",ts,v0,v1,v2],...]}
+     v เป็น fixed-point แบบเดียวกับ gw_tsdb (recever_data: temp/hum x100, light ตรง ๆ)
+   - broker ไม่อยู่ / outbox QoS 1 ค้างเกิน outbox_max / batch สดรอ PUBACK ครบ 4 ก้อน -> batch ลง flash (gw_tsdb ใน spill_part)
+     batch สดที่ไม่ได้ PUBACK ใน 30 s (outbox ทิ้งแล้ว) ก็ลง flash ด้วย
+     ต่อได้แล้วค่อยไล่ส่งตามลำดับ (topic .../backlog) จุดที่ broker ตอบ PUBACK แล้วเก็บใน NVS
+     (รีบูตก็ส่งต่อ batch ที่ยังไม่ได้ PUBACK ส่งซ้ำ = at-least-once)
+     partition เต็ม = ทับของเก่าสุด (นับเป็น lost ตอนไล่ส่ง) -> คิวมีขอบเขตทั้ง RAM และ flash
+   - ESP-NOW + STA ใช้วิทยุตัวเดียว: channel ของ ESP-NOW = channel ของ AP เสมอ
+     ต่อ AP ได้ -> on_channel(ch) ให้ app ย้าย ESP-NOW ตาม (sensor กวาดหาเอง), ปิด power save
+     (modem sleep ทำให้พลาดเฟรม ESP-NOW) และ reconnect สแกนแค่ channel เดิม (วิทยุไม่หลุดไปกวาด 13 ch)
+   - loopback = subscribe topic ตัวเอง: วัด latency sample เข้า -> กลับมาจาก broker (ไม่ต้องใช้ clock ฝั่ง host)
+     ทดสอบกับ broker ในเครื่อง: mosquitto -v  แล้ว  mosquitto_sub -t 'espnow/#' -v */
+
+typedef struct {
+    const char *ssid;
+    const char *password;
+    const char *uri;                // "mqtt://192.168.1.10:1883"
+    const char *topic_prefix;
+    uint16_t    batch_max_samples;
+    uint16_t    batch_max_bytes;
+    uint16_t    batch_max_ms;
+    uint16_t    queue_len;          // sample ที่รอใน RAM
+    uint16_t    outbox_max;         // byte ค้างใน outbox QoS 1 ก่อนถือว่า broker ตามไม่ทัน (ลง flash)
+    const char *spill_part;         // NULL = ไม่ลง flash (offline = drop)
+    bool        loopback;
+    void      (*on_channel)(uint8_t channel);
+} espnow_gw_mqtt_config_t;
+
+#define ESPNOW_GW_MQTT_CONFIG_DEFAULT() { \
+    .topic_prefix = "espnow", .batch_max_samples = 64, .batch_max_bytes = 2048, .batch_max_ms = 1000, \
+    .queue_len = 256, .outbox_max = 16384, .spill_part = "mqtt_q", .loopback = true }
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t dropped;               // queue เต็ม
+    uint32_t published;             // sample สดที่ broker ตอบ PUBACK แล้ว
+    uint32_t batches;
+    uint64_t bytes;                 // payload ที่ publish (สด + backlog)
+    uint32_t spilled;               // sample ที่ลง flash
+    uint32_t drained;               // sample จาก flash ที่ส่งแล้ว
+    uint32_t lost;                  // ถูกทับใน flash ก่อนได้ส่ง
+    uint32_t pending;               // ยังค้างใน flash
+    uint32_t publish_us_max;        // esp_mqtt_client_publish ต่อ batch
+    uint32_t loop_batches;          // batch ที่กลับมาทาง loopback
+    uint64_t loop_us_sum;           // sample แรกเข้า -> กลับจาก broker
+    uint32_t loop_us_max;
+    uint32_t connects;
+    bool     online;
+    uint8_t  channel;
+} espnow_gw_mqtt_stats_t;
+
+/* หลัง espnow_boot_init (ต้องเปิด sta_netif) — ต่อ AP + broker เองเบื้องหลัง */
+esp_err_t espnow_gw_mqtt_init(const espnow_gw_mqtt_config_t *cfg);
+/* เรียกจาก rx_task ได้ (ไม่บล็อก) — ยังไม่ init = ไม่ทำอะไร */
+void      espnow_gw_mqtt_push(const espnow_gw_tsdb_sample_t *s);
+void      espnow_gw_mqtt_get_stats(espnow_gw_mqtt_stats_t *out);
+void      espnow_gw_mqtt_report(void);
+/* ยิง sample ปลอม n ตัวเต็มอัตรา -> samples/s ที่ออก broker + latency loopback (รอต่อ broker ได้ก่อน) */
+void      espnow_gw_mqtt_bench(uint32_t samples);
+
+#ifdef __cplusplus
+}
+#endif
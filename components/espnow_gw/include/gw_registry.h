@@ -0,0 +1,69 @@
+// components/espnow_gw/include/gw_registry.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "espnow_flow.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* registry ของ sensor บน gateway: (MAC + sensor_id) -> handle 16 บิต ครั้งเดียว
+   แล้วทุกอย่างหลังจากนั้นใช้ handle เป็น index ตรง ๆ (ไม่ต้อง strcmp อีก)
+   - hash table แบบ open addressing (linear probe) เก็บแค่ handle, key อยู่ใน dense array
+   - dense array เป็น chunk ละ CHUNK entry -> โตโดยไม่ต้อง copy / ไม่ย้าย pointer
+   - table เต็ม 70% -> สร้าง table ใหม่ 2 เท่า แล้วย้ายทีละ MIGRATE_STEP slot ต่อการเรียก
+     (ไม่มีจังหวะหยุดย้ายทั้งก้อน) ระหว่างย้ายค้นทั้ง table ใหม่และเก่า
+   - ไม่ thread-safe: เรียกจาก task เดียว (rx_task) */
+
+#define ESPNOW_GW_REG_INVALID       0xFFFF
+#define ESPNOW_GW_REG_CHUNK         256
+#define ESPNOW_GW_REG_MAX_CHUNKS    64      // 16384 sensor
+#define ESPNOW_GW_REG_MIGRATE_STEP  16
+#define ESPNOW_GW_REG_ID_LEN        10      // = sensor_id[10] ใน sensor_data_t
+
+typedef struct __attribute__((packed)) {
+    uint8_t mac[6];
+    char    id[ESPNOW_GW_REG_ID_LEN];
+} espnow_gw_key_t;
+
+typedef struct {
+    espnow_gw_key_t  key;
+    uint32_t         frames;
+    int64_t          last_seen_us;
+    espnow_flow_rx_t flow;          // credit ของ sender นี้ (seq นับต่อบอร์ด — sender_data มี sensor_id เดียวต่อ MAC)
+    uint8_t          credit_window; // window ที่บอกไปล่าสุด (0 = sender รอ credit อยู่)
+} espnow_gw_sensor_t;
+
+typedef struct {
+    espnow_gw_sensor_t *chunks[ESPNOW_GW_REG_MAX_CHUNKS];
+    uint16_t  count;
+    uint16_t *slots;                // handle หรือ INVALID
+    uint32_t  cap;                  // power of 2
+    uint16_t *old_slots;            // != NULL ระหว่าง resize
+    uint32_t  old_cap;
+    uint32_t  migrate_pos;
+    uint32_t  resizes;
+    uint32_t  probes;               // สะสม (ดูคุณภาพ hash)
+    uint32_t  lookups;
+} espnow_gw_reg_t;
+
+esp_err_t espnow_gw_reg_init(espnow_gw_reg_t *reg, uint32_t initial_slots);
+void      espnow_gw_reg_free(espnow_gw_reg_t *reg);
+/* หา handle ของ key, ไม่มีก็สร้าง (*created = true) — INVALID = เต็ม/หน่วยความจำไม่พอ */
+uint16_t  espnow_gw_reg_intern(espnow_gw_reg_t *reg, const uint8_t mac[6], const char *id, bool *created);
+uint16_t  espnow_gw_reg_find(espnow_gw_reg_t *reg, const uint8_t mac[6], const char *id);
+/* O(1): handle -> state (NULL = handle ไม่มี) */
+espnow_gw_sensor_t *espnow_gw_reg_get(espnow_gw_reg_t *reg, uint16_t handle);
+/* hash ของ key (ไม่ขึ้นกับลำดับที่ intern) -> ใช้เป็น id ถาวรข้ามรีบูตได้ เช่นใน gw_tsdb */
+uint32_t  espnow_gw_key_hash(const uint8_t mac[6], const char *id);
+size_t    espnow_gw_reg_bytes(const espnow_gw_reg_t *reg);
+void      espnow_gw_reg_report(const espnow_gw_reg_t *reg);
+/* วัด intern/lookup ที่ n sensor บนบอร์ด (registry ชั่วคราว) */
+void      espnow_gw_reg_bench(uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,85 @@
+// components/espnow_gw/include/gw_rollup.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "gw_tsdb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* rollup หลายชั้นสำหรับเก็บยาว: raw -> 1 นาที -> 1 ชั่วโมง (min/max/mean/count ต่อ field)
+   - ทำทีละ sample ตอนเข้า (ไม่มีรอบ batch): sample สะสมใน bucket นาทีของ sensor นั้น
+     ข้ามนาที -> เขียน record 1m แล้ว merge เข้า bucket ชั่วโมง, ข้ามชั่วโมง -> เขียน record 1h
+   - RAM คงที่: slot ละ sensor (จองตอน init ตาม max_sensors) + staging 1 page ต่อ store
+   - เก็บใน gw_tsdb 3 store (คนละ partition) อายุข้อมูล = ขนาด partition / อัตราเข้า
+   - บูตใหม่: bucket ชั่วโมงที่ยังไม่ปิด สร้างคืนจาก record 1m ของชั่วโมงนั้น (หายแค่นาทีที่ค้างใน RAM)
+   - query เลือกชั้นหยาบสุดที่ bucket <= step และยังมีข้อมูลครอบ t0 แล้วรวมเป็นช่วงละ step
+   - ingest / tick เรียกจาก task เดียว (rx_task), query จาก task อื่นได้ */
+
+typedef enum {
+    ESPNOW_GW_RES_RAW = 0,
+    ESPNOW_GW_RES_1M,
+    ESPNOW_GW_RES_1H,
+    ESPNOW_GW_RES_MAX,
+} espnow_gw_res_t;
+
+#define ESPNOW_GW_ROLLUP_GRACE_S    5       // รอ sample มาช้าก่อนปิด bucket ตอน tick
+
+/* record ของชั้น 1m / 1h: 28 B = 9 ต่อ page — base.ts = ต้น bucket, base.v = mean */
+typedef struct __attribute__((packed)) {
+    espnow_gw_tsdb_sample_t base;
+    uint16_t count;
+    int16_t  min[ESPNOW_GW_TSDB_FIELDS];
+    int16_t  max[ESPNOW_GW_TSDB_FIELDS];
+} espnow_gw_rollup_rec_t;
+
+typedef struct {
+    const char *part_raw;
+    const char *part_1m;
+    const char *part_1h;
+    uint16_t    max_sensors;
+} espnow_gw_rollup_config_t;
+
+#define ESPNOW_GW_ROLLUP_CONFIG_DEFAULT() { \
+    .part_raw = "tsdb", .part_1m = "roll_1m", .part_1h = "roll_1h", .max_sensors = 32 }
+
+/* ผล query หนึ่งช่วง (ค่าเป็น fixed-point เดียวกับที่ ingest) */
+typedef struct {
+    uint32_t ts;                    // ต้นช่วง
+    uint32_t count;                 // sample ดิบที่อยู่ในช่วง
+    float    min;
+    float    max;
+    float    mean;
+} espnow_gw_rollup_point_t;
+
+typedef bool (*espnow_gw_rollup_cb_t)(const espnow_gw_rollup_point_t *pt, void *ctx);
+
+typedef struct {
+    uint32_t ingested;
+    uint32_t minutes;               // record 1m ที่เขียน
+    uint32_t hours;                 // record 1h ที่เขียน
+    uint32_t no_slot;               // sensor เกิน max_sensors (ลง raw อย่างเดียว)
+    uint64_t ingest_us;             // รวมเวลา ingest (ทั้ง 3 ชั้น + flash)
+    uint32_t ingest_max_us;
+    uint32_t ram_bytes;             // slot + store ทั้งหมด
+} espnow_gw_rollup_stats_t;
+
+esp_err_t espnow_gw_rollup_init(const espnow_gw_rollup_config_t *cfg);
+/* sample ดิบ -> raw store + bucket นาที (sensor = id ถาวร, ห้ามเป็น 0) */
+esp_err_t espnow_gw_rollup_ingest(const espnow_gw_tsdb_sample_t *s);
+/* ปิด bucket ของ sensor ที่เงียบไปแล้ว (เรียกเป็นระยะ) */
+void      espnow_gw_rollup_tick(uint32_t now);
+esp_err_t espnow_gw_rollup_flush(void);
+/* step_s = ความละเอียดที่อยากได้ (0 = ละเอียดสุด) -> *used = ชั้นที่เลือกจริง */
+esp_err_t espnow_gw_rollup_query(uint32_t sensor, int field, uint32_t t0, uint32_t t1, uint32_t step_s,
+                                 espnow_gw_rollup_cb_t cb, void *ctx, espnow_gw_res_t *used);
+espnow_gw_tsdb_t *espnow_gw_rollup_store(espnow_gw_res_t res);
+void      espnow_gw_rollup_get_stats(espnow_gw_rollup_stats_t *out);
+void      espnow_gw_rollup_report(void);
+
+#ifdef __cplusplus
+}
+#endif
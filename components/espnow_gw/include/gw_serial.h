@@ -0,0 +1,67 @@
+// components/espnow_gw/include/gw_serial.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* serial bridge: ส่งทุกเฟรมที่ gateway ได้ออก UART เป็น record ไบนารี (แทนการ scrape ESP_LOGI)
+   record = hdr + payload + CRC32 (LE, แบบเดียวกับ zlib.crc32) -> COBS -> 0x00 ปิดท้าย
+   - 0x00 ไม่มีทางอยู่ในเนื้อ record -> host sync ใหม่ได้ทันทีหลัง byte หาย
+   - recv-cb แค่ copy ลง ring buffer (ไม่บล็อก, เต็มก็นับ drop) task แยก encode + uart_write_bytes
+   - host: tools/espnow_bridge.py แปลงเป็น CSV / คอลัมน์ */
+
+#define ESPNOW_GW_SERIAL_VERSION    1
+#define ESPNOW_GW_SERIAL_MAX_PAYLOAD 1470   // ESP-NOW v2
+#define ESPNOW_GW_SERIAL_RING_BYTES 16384
+
+typedef enum {
+    ESPNOW_GW_SERIAL_KIND_RX = 0,           // เฟรม ESP-NOW ที่รับได้
+    ESPNOW_GW_SERIAL_KIND_STATS = 1,        // เฟรมสถิติ (metrics) — mac = ของ gateway เอง
+} espnow_gw_serial_kind_t;
+
+/* 19 byte + payload + crc32 */
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    uint8_t  kind;                  // espnow_gw_serial_kind_t
+    uint64_t ts_us;                 // esp_timer ตอนรับ
+    uint8_t  mac[6];
+    int8_t   rssi;
+    uint16_t len;
+} espnow_gw_serial_hdr_t;
+
+typedef struct {
+    int      uart_port;
+    int      baud;
+    int      tx_pin;                // -1 = ขาเดิม (UART0 = USB-serial)
+    int      rx_pin;
+    bool     quiet_logs;            // ใช้ UART เดียวกับ console -> ปิด ESP_LOG (เหลือแต่ ERROR)
+} espnow_gw_serial_config_t;
+
+#define ESPNOW_GW_SERIAL_CONFIG_DEFAULT() { \
+    .uart_port = 0, .baud = 921600, .tx_pin = -1, .rx_pin = -1, .quiet_logs = true }
+
+typedef struct {
+    uint32_t records;
+    uint32_t drops;                 // ring buffer เต็ม
+    uint64_t bytes;                 // byte บนสาย (หลัง COBS)
+    uint32_t ring_low_water;        // พื้นที่ว่างต่ำสุดของ ring buffer
+} espnow_gw_serial_stats_t;
+
+esp_err_t espnow_gw_serial_init(const espnow_gw_serial_config_t *cfg);
+/* เรียกใน recv-cb ได้ (ไม่บล็อก) — ยังไม่ init = ไม่ทำอะไร */
+void      espnow_gw_serial_push(const esp_now_recv_info_t *info, const uint8_t *data, int len);
+/* record ชนิดอื่น (เช่น stats) */
+void      espnow_gw_serial_push_kind(uint8_t kind, const uint8_t mac[6], const void *data, int len);
+void      espnow_gw_serial_get_stats(espnow_gw_serial_stats_t *out);
+/* COBS: out ต้องมีที่ len + len/254 + 1, คืนความยาว (ไม่รวม 0x00 ปิดท้าย) */
+size_t    espnow_gw_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
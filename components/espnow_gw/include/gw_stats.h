@@ -0,0 +1,55 @@
+// components/espnow_gw/include/gw_stats.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* สถิติแบบ rolling ต่อ sensor บน gateway (min/max/mean/variance/EMA)
+   - หน้าต่าง 1 นาที / 15 นาที / 1 ชม. แต่ละอันเป็นวงแหวน BUCKETS ช่อง (sub-window)
+   - ใน bucket ใช้ Welford (mean + M2) -> ตอน query รวม bucket ด้วยสูตรของ Chan
+   - เพิ่ม sample = O(WIN x FIELD), query = O(BUCKETS) คงที่ ไม่ขึ้นกับจำนวน sample
+   - หน่วยความจำต่อ sensor คงที่ (จองตอนเห็น sample แรก) ดู espnow_gw_stats_bytes_per_sensor() */
+
+#define ESPNOW_GW_STATS_BUCKETS  12
+
+typedef enum {
+    ESPNOW_GW_WIN_1M = 0,
+    ESPNOW_GW_WIN_15M,
+    ESPNOW_GW_WIN_1H,
+    ESPNOW_GW_WIN_MAX,
+} espnow_gw_win_t;
+
+typedef enum {
+    ESPNOW_GW_FIELD_TEMP = 0,
+    ESPNOW_GW_FIELD_HUM,
+    ESPNOW_GW_FIELD_LIGHT,
+    ESPNOW_GW_FIELD_MAX,
+} espnow_gw_field_t;
+
+typedef struct {
+    uint32_t count;
+    float    min;
+    float    max;
+    float    mean;
+    float    variance;              // sample variance (n-1)
+    float    ema;                   // time constant = ความยาวหน้าต่าง
+} espnow_gw_stat_t;
+
+/* max_sensors = จำนวน handle สูงสุด (0..max_sensors-1) */
+esp_err_t espnow_gw_stats_init(uint16_t max_sensors);
+esp_err_t espnow_gw_stats_add(uint16_t sensor, int64_t t_ms, const float v[ESPNOW_GW_FIELD_MAX]);
+esp_err_t espnow_gw_stats_query(uint16_t sensor, espnow_gw_win_t win, espnow_gw_field_t field,
+                                int64_t now_ms, espnow_gw_stat_t *out);
+size_t    espnow_gw_stats_bytes_per_sensor(void);
+int       espnow_gw_stats_active(void);
+/* วัด ingest/query บนบอร์ด (state ชั่วคราว ไม่แตะตารางจริง) */
+void      espnow_gw_stats_bench(uint32_t samples);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+// components/espnow_gw/include/gw_tsdb.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* time-series store บน flash: sample ไม่หายตอนรีบูต
+   - partition แยก (data) แบ่งเป็น block ละ 1 sector (4 KiB) เขียนต่อท้ายวนเป็นวงแหวน (เต็ม = ลบ block เก่าสุด)
+   - RAM staging แค่ 1 page (256 B = record เต็ม page + CRC32) เต็มเมื่อไหร่ค่อย program ทีเดียว
+     -> ทุก byte ถูกเขียนครั้งเดียว, ลบ sector ละครั้งต่อ 15 page (wear ต่ำ)
+   - page 0 ของ block: header (เขียนตอนเปิด) + สรุป min/max/เวลา (เขียนตอนปิด)
+     -> scan ช่วงเวลา ข้ามทั้ง block ได้จากสรุปอย่างเดียว
+   - อ่านผ่าน esp_partition_mmap: callback ได้ pointer ชี้เข้า flash ตรง ๆ (ไม่ copy)
+   - ไฟดับ: หาย record ที่ยังอยู่ใน staging / page ที่เขียนค้าง = CRC ผิด ข้าม
+   - เวลาเป็นวินาทีของ store เอง (ต่อจาก record ล่าสุดหลังรีบูต, ใช้ร่วมทุก store) ไม่ต้องมี RTC
+   - เปิดได้หลาย store (คนละ partition) ขนาด record ต่างกันได้ แต่ต้องขึ้นต้นด้วย espnow_gw_tsdb_sample_t */
+
+#define ESPNOW_GW_TSDB_FIELDS           3
+#define ESPNOW_GW_TSDB_SECTOR           4096
+#define ESPNOW_GW_TSDB_PAGE             256
+#define ESPNOW_GW_TSDB_PAGE_DATA        (ESPNOW_GW_TSDB_PAGE - 4)      // ท้าย page = CRC32
+#define ESPNOW_GW_TSDB_DATA_PAGES       15      // page 1..15 ของ sector
+#define ESPNOW_GW_TSDB_ANY_SENSOR       0       // scan ทุก sensor
+#define ESPNOW_GW_TSDB_TS_EMPTY         0xFFFFFFFFu   // ช่องว่างใน page ที่ flush ก่อนเต็ม
+
+/* ค่าเป็น fixed-point ที่ app เลือกสเกลเอง (recever_data: temp/hum x100, light ตรง ๆ) */
+typedef struct __attribute__((packed)) {
+    uint32_t ts;                    // วินาที (espnow_gw_tsdb_now)
+    uint32_t sensor;                // id ถาวร เช่น espnow_gw_key_hash()
+    int16_t  v[ESPNOW_GW_TSDB_FIELDS];
+} espnow_gw_tsdb_sample_t;
+
+typedef struct espnow_gw_tsdb espnow_gw_tsdb_t;
+
+/* คืน false = หยุด scan — rec ยาว rec_size ของ store (ขึ้นต้นด้วย sample) */
+typedef bool (*espnow_gw_tsdb_cb_t)(const espnow_gw_tsdb_sample_t *rec, void *ctx);
+
+typedef struct {
+    uint32_t blocks;                // block ที่มีข้อมูล
+    uint32_t blocks_skipped;        // ข้ามจากสรุป
+    uint32_t pages_read;
+    uint32_t samples_visited;
+    uint32_t samples_matched;
+    uint32_t us;
+} espnow_gw_tsdb_scan_stats_t;
+
+typedef struct {
+    uint32_t blocks_total;
+    uint32_t blocks_used;
+    uint32_t records_per_block;
+    uint32_t appended;
+    uint32_t pages_written;
+    uint32_t erases;
+    uint64_t bytes_written;
+    uint32_t torn_pages;            // page ที่ CRC ผิด (เขียนค้างตอนไฟดับ)
+    uint32_t recovery_us;
+    uint32_t append_max_us;         // รวมจังหวะ erase + program
+    uint32_t oldest_ts;
+    uint32_t newest_ts;
+} espnow_gw_tsdb_stats_t;
+
+/* เปิด partition ตาม label แล้ว recover (หา block ล่าสุด, เขียนต่อจาก page ถัดไป)
+   rec_size = 0 -> sizeof(espnow_gw_tsdb_sample_t) */
+esp_err_t espnow_gw_tsdb_open(const char *label, uint16_t rec_size, espnow_gw_tsdb_t **out);
+uint32_t  espnow_gw_tsdb_now(void);
+/* RAM ต่อ store (staging + สรุป block) */
+size_t    espnow_gw_tsdb_ram_bytes(void);
+/* single writer ต่อ store — เรียก scan จาก task อื่นได้ (มี mutex) */
+esp_err_t espnow_gw_tsdb_append(espnow_gw_tsdb_t *db, const void *rec);
+/* เขียน staging page ที่ยังไม่เต็มลง flash (ก่อน restart / เป็นระยะ) */
+esp_err_t espnow_gw_tsdb_flush(espnow_gw_tsdb_t *db);
+/* record ที่ t0 <= ts <= t1 เรียงตามลำดับที่เขียน */
+esp_err_t espnow_gw_tsdb_scan(espnow_gw_tsdb_t *db, uint32_t t0, uint32_t t1, uint32_t sensor,
+                              espnow_gw_tsdb_cb_t cb, void *ctx, espnow_gw_tsdb_scan_stats_t *st);
+void      espnow_gw_tsdb_get_stats(espnow_gw_tsdb_t *db, espnow_gw_tsdb_stats_t *out);
+void      espnow_gw_tsdb_report(espnow_gw_tsdb_t *db);
+/* ⚠️ ลบทั้ง partition: วัด append / write amplification / scan / recovery (+ page ค้างจำลอง) */
+void      espnow_gw_tsdb_bench(espnow_gw_tsdb_t *db, uint32_t samples);
+
+#ifdef __cplusplus
+}
+#endif
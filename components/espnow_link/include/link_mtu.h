@@ -0,0 +1,71 @@
+// components/espnow_link/include/link_mtu.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* payload ใหญ่: ESP-NOW v2 ส่งได้ ~1470 byte ต่อเฟรม, v1 ได้ 250
+   แลก caps กับ peer ก่อน (ESPNOW_MSG_LINK_CAPS) แล้ว
+   - peer v2 -> ส่งเฟรมเดียว
+   - peer v1 / ยังไม่รู้ -> ตัดเป็น ESPNOW_MSG_LINK_FRAG แล้วฝั่งรับประกอบคืนก่อน dispatch
+   ฝั่งรับเห็นเฟรมเดิมเหมือนกันทั้งสองทาง (handler ของ type เดิมถูกเรียก) */
+
+#define ESPNOW_LINK_V1_MTU      250
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+#define ESPNOW_LINK_LARGE_MAX   ESP_NOW_MAX_DATA_LEN_V2
+#else
+#define ESPNOW_LINK_LARGE_MAX   1470    // IDF เก่า: ฝั่งนี้ v1 เสมอ แต่ยังประกอบ fragment ได้
+#endif
+#define ESPNOW_LINK_REASM_SLOTS 2
+#define ESPNOW_LINK_REASM_MS    500     // fragment ไม่ครบในเวลานี้ -> ทิ้ง
+#define ESPNOW_LINK_PROBE_MIN_MS 250    // caps probe ไม่มีคำตอบ -> ส่งซ้ำ ห่างขึ้น x2 ทุกครั้ง
+#define ESPNOW_LINK_PROBE_MAX_MS 30000  // ... จนถึงเพดานนี้ แล้วส่งซ้ำที่เพดานจนกว่าจะได้ caps
+
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;       // ESPNOW_MSG_LINK_CAPS
+    uint8_t  version;           // esp_now_get_version()
+    uint16_t max_len;           // payload สูงสุดที่รับได้
+    uint8_t  is_reply;
+} espnow_link_caps_t;
+
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;       // ESPNOW_MSG_LINK_FRAG
+    uint16_t msg_id;
+    uint8_t  index;
+    uint8_t  count;
+    uint16_t total_len;
+    uint8_t  payload[];
+} espnow_link_frag_t;
+
+#define ESPNOW_LINK_FRAG_CHUNK  (ESPNOW_LINK_V1_MTU - sizeof(espnow_link_frag_t))
+
+typedef struct {
+    uint32_t large_sent;        // ส่งเฟรมเดียว (> 250 byte ถึง peer v2)
+    uint32_t fragmented;        // ข้อความที่ต้องตัด
+    uint32_t frags_sent;
+    uint32_t reassembled;
+    uint32_t reasm_dropped;     // หมดเวลา / ช่องเต็ม / fragment เพี้ยน
+    uint32_t probes_sent;       // caps probe รวมที่ส่งซ้ำ
+    uint64_t bytes_sent;
+} espnow_link_mtu_stats_t;
+
+/* ลงทะเบียน handler ของ CAPS/FRAG — เรียกก่อน esp_now_register_recv_cb(espnow_msg_dispatch) */
+esp_err_t espnow_link_mtu_init(void);
+/* ถาม caps ของ peer (ตอบกลับมาทาง handler) — ส่งซ้ำเองเบื้องหลังจนกว่าจะได้คำตอบ */
+esp_err_t espnow_link_mtu_probe(const uint8_t mac[6]);
+/* payload สูงสุดที่ส่งถึง peer ได้ในเฟรมเดียว (ยังไม่รู้ = 250) */
+uint16_t  espnow_link_mtu(const uint8_t mac[6]);
+/* ส่งเฟรม espnow_msg ขนาดใดก็ได้ถึง ESPNOW_LINK_LARGE_MAX — เรียกจาก task เท่านั้น (อาจรอคิว ESP-NOW) */
+esp_err_t espnow_link_send_large(const uint8_t mac[6], const void *data, int len, uint32_t seq);
+void      espnow_link_mtu_get_stats(espnow_link_mtu_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+// components/espnow_link/include/link_rate.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* เลือก PHY rate ต่อ peer แบบ Minstrel อย่างง่าย
+   - เก็บ success probability (EWMA) ของแต่ละ rate จาก send-cb (wifi_tx_info_t.rate)
+   - ทุก ESPNOW_LINK_RATE_UPDATE เฟรม เลือก rate ที่ prob x bitrate สูงสุด
+   - ทุก ESPNOW_LINK_RATE_PROBE_EVERY เฟรม ลอง rate ที่สูงกว่า 1 เฟรม
+   - FAIL ติดกันที่ rate ปัจจุบัน -> ลดลงทันทีไม่ต้องรอรอบ
+   ใช้งานผ่าน espnow_link_send()/espnow_link_on_sent() อัตโนมัติเมื่อเปิดให้ peer นั้น */
+
+#define ESPNOW_LINK_RATE_PEERS        4
+#define ESPNOW_LINK_RATE_UPDATE       20    // เฟรมต่อรอบคำนวณ
+#define ESPNOW_LINK_RATE_PROBE_EVERY  10
+#define ESPNOW_LINK_RATE_MIN_PROB     100   // ‰ ต่ำกว่านี้ไม่เลือก
+#define ESPNOW_LINK_RATE_DOWN_FAILS   3
+
+typedef struct {
+    uint8_t  mac[6];
+    uint8_t  current;           // index ใน ladder
+    uint32_t changes;
+    uint32_t probes;
+    uint32_t probe_ok;          // ผลของเฟรม probe (นับเข้า prob ของ rate ที่ probe)
+    uint32_t probe_fail;
+    uint32_t step_downs;
+    uint32_t attempts[12];
+    uint32_t success[12];
+    uint16_t prob[12];          // ‰
+} espnow_link_rate_stats_t;
+
+/* เริ่มคุมอัตราให้ peer (ต้อง add peer แล้ว) — เริ่มที่ 1 Mbps แล้วไต่ขึ้นด้วย probe */
+esp_err_t   espnow_link_rate_enable(const uint8_t mac[6]);
+int         espnow_link_rate_ladder_len(void);
+const char *espnow_link_rate_name(int idx);
+bool        espnow_link_rate_get_stats(const uint8_t mac[6], espnow_link_rate_stats_t *out);
+void        espnow_link_rate_report(void);
+
+/* ใช้ภายใน link_track */
+void espnow_link_rate_before_send(const uint8_t mac[6]);
+void espnow_link_rate_on_sent(const wifi_tx_info_t *info, bool ok);
+void espnow_link_rate_send_failed(const uint8_t mac[6]);  // esp_now_send() ไม่รับ -> จะไม่มี cb
+
+#ifdef __cplusplus
+}
+#endif
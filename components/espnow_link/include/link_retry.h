@@ -0,0 +1,59 @@
+// components/espnow_link/include/link_retry.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+#include "link_track.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* retry ของ unicast: ส่งซ้ำเมื่อ send-cb = FAIL หรือ esp_now_send() error
+   backoff = base * 2^(attempt-1) (ไม่เกิน max) แบบสุ่มครึ่งบน [d/2, d]
+   แต่ละเฟรมมีช่องของตัวเอง -> เฟรมที่รอ retry ไม่บังเฟรมใหม่ของ peer อื่น */
+
+#define ESPNOW_LINK_RETRY_SLOTS         8     // เฟรมที่รอผลพร้อมกันได้
+#define ESPNOW_LINK_RETRY_MAX_ATTEMPTS  8     // ขนาด histogram (attempt 1..8)
+#define ESPNOW_LINK_RETRY_CB_MS         ESPNOW_LINK_CB_TIMEOUT_MS   // ไม่มี send-cb ภายในเวลานี้ = ถือว่า FAIL (cb หาย / ถูกจับคู่ผิด)
+
+typedef struct {
+    uint8_t  max_attempts;      // รวมครั้งแรก (1 = ไม่ retry)
+    uint32_t base_ms;
+    uint32_t max_backoff_ms;
+    uint32_t deadline_ms;       // นับจากส่งครั้งแรก เลยแล้วทิ้ง
+} espnow_link_retry_policy_t;
+
+#define ESPNOW_LINK_RETRY_POLICY_DEFAULT() { \
+    .max_attempts   = 4,                      \
+    .base_ms        = 20,                     \
+    .max_backoff_ms = 500,                    \
+    .deadline_ms    = 2000,                   \
+}
+
+typedef struct {
+    uint8_t  mac[6];
+    uint32_t delivered[ESPNOW_LINK_RETRY_MAX_ATTEMPTS];  // [i] = สำเร็จใน attempt ที่ i+1
+    uint32_t gave_up;           // ครบ max_attempts
+    uint32_t expired;           // เลย deadline
+    uint32_t no_slot;           // ช่องเต็ม -> ส่งแบบไม่ retry
+    uint32_t cb_timeout;        // รอ send-cb เกิน ESPNOW_LINK_RETRY_CB_MS
+} espnow_link_retry_stats_t;
+
+/* สร้าง retry task — เรียกหลัง esp_now_init() */
+esp_err_t espnow_link_retry_init(const espnow_link_retry_policy_t *policy);
+
+/* เหมือน espnow_link_send() แต่ copy เฟรมเก็บไว้ส่งซ้ำ (seq ต้องไม่ซ้ำกับเฟรมที่ยังค้างของ peer เดียวกัน) */
+esp_err_t espnow_link_send_reliable(const uint8_t mac[6], const void *data, int len, uint32_t seq);
+
+/* เรียกใน send-cb หลัง espnow_link_on_sent() */
+void espnow_link_retry_on_sent(const wifi_tx_info_t *info, const espnow_link_sent_t *r);
+
+bool espnow_link_retry_get_stats(int idx, espnow_link_retry_stats_t *out);
+void espnow_link_retry_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+// components/espnow_link/include/link_rto.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RTO ต่อ peer จาก RTT ที่วัดได้ (แบบ TCP, RFC 6298)
+   SRTT/RTTVAR เป็น EWMA 1/8 และ 1/4, RTO = SRTT + max(G, 4*RTTVAR)
+   Karn: ไม่เอา RTT ของข้อความที่ส่งซ้ำมาคิด (ไม่รู้ว่า ACK ตอบครั้งไหน) */
+
+#define ESPNOW_LINK_RTO_INIT_MS  1000   // ก่อนมี sample แรก
+#define ESPNOW_LINK_RTO_MIN_MS   20
+#define ESPNOW_LINK_RTO_MAX_MS   4000
+#define ESPNOW_LINK_RTO_G_MS     10     // ความละเอียดของการรอ (1 tick)
+
+typedef struct {
+    uint8_t  mac[6];
+    int64_t  srtt_us;           // 0 = ยังไม่มี sample
+    int64_t  rttvar_us;
+    uint32_t rto_ms;
+    uint32_t samples;
+    uint32_t karn_skipped;      // ACK ของข้อความที่ส่งซ้ำ (ไม่เอามาคิด)
+    uint32_t timeouts;
+} espnow_link_rto_stats_t;
+
+/* RTO ปัจจุบันของ peer (peer ใหม่ = ESPNOW_LINK_RTO_INIT_MS) */
+uint32_t espnow_link_rto_ms(const uint8_t mac[6]);
+/* ได้ ACK: rtt วัดจากการส่งครั้งล่าสุด, retransmitted = ข้อความนี้เคยส่งซ้ำ */
+void     espnow_link_rto_sample(const uint8_t mac[6], int64_t rtt_us, bool retransmitted);
+/* หมดเวลา: RTO x2 (ไม่เกิน MAX) จนกว่าจะได้ sample ใหม่ */
+void     espnow_link_rto_backoff(const uint8_t mac[6]);
+bool     espnow_link_rto_get_stats(const uint8_t mac[6], espnow_link_rto_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,68 @@
+// components/espnow_link/include/link_track.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* TX tracker: จับคู่ send-cb กับเฟรมที่ส่ง (FIFO ต่อปลายทาง — ESP-NOW ส่งเรียงตามลำดับ)
+   เก็บ success rate + latency send->cb + จำนวน retry ต่อ peer */
+
+#define ESPNOW_LINK_MAX_PEERS     8
+#define ESPNOW_LINK_INFLIGHT      8     // เฟรมที่รอ cb ต่อ peer
+#define ESPNOW_LINK_HIST_BUCKETS  8     // latency: <1,<2,<4,...,<64, >=64 ms
+#define ESPNOW_LINK_CB_TIMEOUT_MS 200   // ไม่มี send-cb ภายในเวลานี้ = cb หาย -> ถอดออกจาก FIFO
+
+typedef struct {
+    uint8_t  mac[6];
+    uint32_t sent;              // esp_now_send() ผ่าน (รวม retry)
+    uint32_t ok;                // cb = SUCCESS (ได้ MAC ACK)
+    uint32_t fail;              // cb = FAIL
+    uint32_t send_err;          // esp_now_send() คืน error
+    uint32_t retries;           // เฟรมที่ attempt > 0
+    uint32_t unmatched;         // cb ที่หาเฟรมไม่เจอ / inflight เต็ม
+    uint32_t expired;           // รอ cb เกิน ESPNOW_LINK_CB_TIMEOUT_MS (cb หาย)
+    uint32_t lat_hist[ESPNOW_LINK_HIST_BUCKETS];
+    int64_t  lat_sum_us;
+    int64_t  lat_max_us;
+    uint64_t bytes_ok;          // payload ที่ส่งสำเร็จ (ใช้คิด airtime ต่อ byte)
+} espnow_link_stats_t;
+
+/* ผลของ send-cb หลังจับคู่แล้ว */
+typedef struct {
+    bool     matched;
+    bool     ok;
+    uint32_t seq;
+    uint8_t  attempt;           // 0 = ส่งครั้งแรก
+    uint16_t len;
+    int64_t  latency_us;        // send -> cb
+} espnow_link_sent_t;
+
+/* บันทึกเฟรม แล้ว esp_now_send() — seq/attempt เป็นของแอป (ใช้จับคู่ตอน cb) */
+esp_err_t espnow_link_send(const uint8_t mac[6], const void *data, int len, uint32_t seq, uint8_t attempt);
+
+/* เฟรมควบคุมของ component อื่น (caps probe, TDMA JOIN, stats) ที่อาจไปหา peer ที่ track อยู่:
+   เข้า FIFO ด้วยเพื่อให้ cb ของเฟรมถัดไปจับคู่ถูกตัว แต่ cb ของมันเองคืน matched = false
+   (แอป / retry ไม่เอาไปปนกับ seq ของตัวเอง) — peer ที่ไม่ได้ track = esp_now_send ตรง ๆ */
+esp_err_t espnow_link_send_ctrl(const uint8_t mac[6], const void *data, int len);
+
+/* เรียกใน send-cb ของแอป; out เป็น NULL ได้ */
+void espnow_link_on_sent(const wifi_tx_info_t *info, esp_now_send_status_t status, espnow_link_sent_t *out);
+
+/* อ่านสถิติระหว่างรัน: idx 0..ESPNOW_LINK_MAX_PEERS-1, คืน false ถ้าช่องว่าง */
+bool espnow_link_get_stats(int idx, espnow_link_stats_t *out);
+bool espnow_link_get_stats_by_mac(const uint8_t mac[6], espnow_link_stats_t *out);
+
+/* log ทุก peer: success %, latency avg/max + histogram, retry */
+void      espnow_link_report(void);
+/* เรียก report ของ track/retry/rate ทุก period_ms (esp_timer) */
+esp_err_t espnow_link_start_report(uint32_t period_ms);
+
+#ifdef __cplusplus
+}
+#endif
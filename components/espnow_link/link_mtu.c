@@ -0,0 +1,308 @@
+// components/espnow_link/link_mtu.c
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "link_track.h"
+#include "link_mtu.h"
+
+static const char *TAG = "ESPNOW_MTU";
+
+#define CAPS_PEERS    ESPNOW_LINK_MAX_PEERS
+#define REPLY_QUEUE   4
+#define PROBE_PEERS   4
+
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint8_t  version;
+    uint16_t max_len;
+} peer_caps_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint16_t msg_id;
+    uint8_t  count;
+    uint16_t total_len;
+    uint32_t have;              // bitmap ของ fragment ที่ได้แล้ว
+    int64_t  start_us;
+    uint8_t  buf[ESPNOW_LINK_LARGE_MAX];
+} reasm_t;
+
+/* probe ที่ยังไม่ได้ caps ตอบ: ส่งซ้ำ backoff x2 จาก ESPNOW_LINK_PROBE_MIN_MS ถึง ESPNOW_LINK_PROBE_MAX_MS
+   (probe หรือ reply หายครั้งเดียวต้องไม่ทำให้ peer ติดอยู่ที่ 250 B ตลอดไป) */
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint32_t gap_ms;
+    int64_t  next_us;
+} probe_t;
+
+static peer_caps_t             s_caps[CAPS_PEERS];
+static probe_t                 s_probe[PROBE_PEERS];
+static reasm_t                 s_reasm[ESPNOW_LINK_REASM_SLOTS];   // ใช้ใน Wi-Fi task เท่านั้น
+static uint8_t                 s_reply_mac[REPLY_QUEUE][6];
+static uint8_t                 s_reply_n;
+static espnow_link_mtu_stats_t s_stats;
+static uint8_t                 s_version = 1;
+static uint16_t                s_max_len = ESPNOW_LINK_V1_MTU;
+static uint16_t                s_msg_id;
+static portMUX_TYPE            s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t      s_reply_timer;
+static esp_timer_handle_t      s_probe_timer;
+
+static void build_caps(espnow_link_caps_t *c, bool reply) {
+    c->hdr.type = ESPNOW_MSG_LINK_CAPS;
+    c->version  = s_version;
+    c->max_len  = s_max_len;
+    c->is_reply = reply;
+}
+
+/* ตอบ caps นอก Wi-Fi task: ต้อง add peer ก่อนถึงจะ unicast ได้ */
+static void reply_cb(void *arg) {
+    uint8_t macs[REPLY_QUEUE][6];
+    portENTER_CRITICAL(&s_lock);
+    int n = s_reply_n;
+    memcpy(macs, s_reply_mac, sizeof(macs));
+    s_reply_n = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < n; i++) {
+        if (!esp_now_is_peer_exist(macs[i])) {
+            esp_now_peer_info_t peer = {0};
+            memcpy(peer.peer_addr, macs[i], 6);
+            peer.ifidx = WIFI_IF_STA;
+            if (esp_now_add_peer(&peer) != ESP_OK) continue;
+        }
+        espnow_link_caps_t c;
+        build_caps(&c, true);
+        espnow_link_send_ctrl(macs[i], &c, sizeof(c));
+    }
+}
+
+static void on_caps(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    espnow_link_caps_t c;
+    memcpy(&c, data, sizeof(c));
+
+    bool queued = false;
+    portENTER_CRITICAL(&s_lock);
+    peer_caps_t *slot = NULL;
+    for (int i = 0; i < CAPS_PEERS; i++) {
+        if (s_caps[i].used && memcmp(s_caps[i].mac, info->src_addr, 6) == 0) { slot = &s_caps[i]; break; }
+        if (!slot && !s_caps[i].used) slot = &s_caps[i];
+    }
+    if (slot) {
+        slot->used    = true;
+        memcpy(slot->mac, info->src_addr, 6);
+        slot->version = c.version;
+        slot->max_len = c.max_len < s_max_len ? c.max_len : s_max_len;   // ใช้ค่าที่ทั้งสองฝั่งรับได้
+    }
+    for (int i = 0; i < PROBE_PEERS; i++) {
+        if (s_probe[i].used && memcmp(s_probe[i].mac, info->src_addr, 6) == 0) s_probe[i].used = false;
+    }
+    if (!c.is_reply && s_reply_n < REPLY_QUEUE) {
+        memcpy(s_reply_mac[s_reply_n++], info->src_addr, 6);
+        queued = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (queued) esp_timer_start_once(s_reply_timer, 0);
+}
+
+static void on_frag(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (len < (int)sizeof(espnow_link_frag_t)) return;
+    const espnow_link_frag_t *f = (const espnow_link_frag_t *)data;
+    int chunk = len - (int)sizeof(espnow_link_frag_t);
+    int64_t now = esp_timer_get_time();
+
+    if (f->count == 0 || f->count > 32 || f->index >= f->count ||
+        f->total_len > ESPNOW_LINK_LARGE_MAX || f->total_len < sizeof(espnow_msg_hdr_t) ||
+        (int)(f->index * ESPNOW_LINK_FRAG_CHUNK) + chunk > f->total_len) {
+        s_stats.reasm_dropped++;
+        return;
+    }
+
+    // หา slot ของ (mac, msg_id) — ไม่งั้นใช้ช่องว่าง / ช่องที่หมดเวลา
+    reasm_t *r = NULL, *spare = NULL;
+    for (int i = 0; i < ESPNOW_LINK_REASM_SLOTS; i++) {
+        reasm_t *s = &s_reasm[i];
+        if (s->used && now - s->start_us > ESPNOW_LINK_REASM_MS * 1000) {
+            s->used = false;
+            s_stats.reasm_dropped++;
+        }
+        if (s->used && s->msg_id == f->msg_id && memcmp(s->mac, info->src_addr, 6) == 0) r = s;
+        else if (!s->used && !spare) spare = s;
+    }
+    if (!r) {
+        if (!spare) {
+            s_stats.reasm_dropped++;
+            return;
+        }
+        r = spare;
+        r->used      = true;
+        memcpy(r->mac, info->src_addr, 6);
+        r->msg_id    = f->msg_id;
+        r->count     = f->count;
+        r->total_len = f->total_len;
+        r->have      = 0;
+        r->start_us  = now;
+    }
+    if (f->count != r->count || f->total_len != r->total_len) {
+        r->used = false;
+        s_stats.reasm_dropped++;
+        return;
+    }
+
+    memcpy(&r->buf[f->index * ESPNOW_LINK_FRAG_CHUNK], f->payload, chunk);
+    r->have |= 1u << f->index;
+    if (r->have != ((r->count == 32) ? 0xFFFFFFFFu : ((1u << r->count) - 1))) return;
+
+    r->used = false;
+    s_stats.reassembled++;
+    espnow_msg_dispatch(info, r->buf, r->total_len);   // เหมือนได้เฟรมเดียวมาทั้งก้อน
+}
+
+static void send_probe(const uint8_t mac[6]) {
+    espnow_link_caps_t c;
+    build_caps(&c, false);
+    espnow_link_send_ctrl(mac, &c, sizeof(c));
+}
+
+/* ส่ง probe ที่ถึงเวลา แล้วตั้ง timer ไปที่ตัวถัดไป */
+static void probe_cb(void *arg) {
+    uint8_t due[PROBE_PEERS][6];
+    int n = 0;
+    int64_t now = esp_timer_get_time(), next = INT64_MAX;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < PROBE_PEERS; i++) {
+        probe_t *p = &s_probe[i];
+        if (!p->used) continue;
+        if (now >= p->next_us) {
+            memcpy(due[n++], p->mac, 6);
+            p->gap_ms  = p->gap_ms * 2 > ESPNOW_LINK_PROBE_MAX_MS ? ESPNOW_LINK_PROBE_MAX_MS : p->gap_ms * 2;
+            p->next_us = now + (int64_t)p->gap_ms * 1000;
+            s_stats.probes_sent++;
+        }
+        if (p->next_us < next) next = p->next_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < n; i++) send_probe(due[i]);
+    if (next != INT64_MAX) esp_timer_start_once(s_probe_timer, next - now);
+}
+
+esp_err_t espnow_link_mtu_init(void) {
+    uint32_t ver = 1;
+    if (esp_now_get_version(&ver) == ESP_OK && ver >= 2) {
+        s_version = (uint8_t)ver;
+        s_max_len = ESPNOW_LINK_LARGE_MAX;
+    }
+    if (!s_reply_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = reply_cb,
+            .name     = "caps_reply",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_reply_timer), TAG, "timer");
+    }
+    if (!s_probe_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = probe_cb,
+            .name     = "caps_probe",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_probe_timer), TAG, "timer");
+    }
+    ESP_RETURN_ON_ERROR(espnow_msg_register(ESPNOW_MSG_LINK_CAPS, sizeof(espnow_link_caps_t), on_caps), TAG, "caps");
+    ESP_RETURN_ON_ERROR(espnow_msg_register(ESPNOW_MSG_LINK_FRAG, 0, on_frag), TAG, "frag");
+    ESP_LOGI(TAG, "ESP-NOW v%u, max payload %u", s_version, s_max_len);
+    return ESP_OK;
+}
+
+esp_err_t espnow_link_mtu_probe(const uint8_t mac[6]) {
+    ESP_RETURN_ON_FALSE(mac && s_probe_timer, ESP_ERR_INVALID_STATE, TAG, "mtu not initialised");
+    probe_t *p = NULL;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < PROBE_PEERS; i++) {
+        if (s_probe[i].used && memcmp(s_probe[i].mac, mac, 6) == 0) { p = &s_probe[i]; break; }
+        if (!p && !s_probe[i].used) p = &s_probe[i];
+    }
+    if (p) {
+        p->used    = true;
+        memcpy(p->mac, mac, 6);
+        p->gap_ms  = ESPNOW_LINK_PROBE_MIN_MS;
+        p->next_us = 0;                 // ส่งครั้งแรกทันทีจาก timer
+    }
+    portEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(p, ESP_ERR_NO_MEM, TAG, "probe table full");
+
+    esp_timer_stop(s_probe_timer);
+    return esp_timer_start_once(s_probe_timer, 0);
+}
+
+uint16_t espnow_link_mtu(const uint8_t mac[6]) {
+    uint16_t mtu = ESPNOW_LINK_V1_MTU;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CAPS_PEERS; i++) {
+        if (s_caps[i].used && memcmp(s_caps[i].mac, mac, 6) == 0) {
+            mtu = s_caps[i].max_len;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return mtu;
+}
+
+/* ESP-NOW คิวเต็ม (NO_MEM) ระหว่างส่ง fragment ต่อกัน -> รอ 1 tick แล้วลองใหม่ */
+static esp_err_t send_one(const uint8_t *mac, const void *data, int len, uint32_t seq) {
+    esp_err_t er;
+    for (int tries = 0; tries < 10; tries++) {
+        er = espnow_link_send(mac, data, len, seq, 0);
+        if (er != ESP_ERR_ESPNOW_NO_MEM) break;
+        vTaskDelay(1);
+    }
+    return er;
+}
+
+esp_err_t espnow_link_send_large(const uint8_t mac[6], const void *data, int len, uint32_t seq) {
+    if (!mac || !data || len < (int)sizeof(espnow_msg_hdr_t) || len > ESPNOW_LINK_LARGE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (len <= espnow_link_mtu(mac)) {
+        esp_err_t er = send_one(mac, data, len, seq);
+        if (er == ESP_OK) {
+            if (len > ESPNOW_LINK_V1_MTU) s_stats.large_sent++;
+            s_stats.bytes_sent += len;
+        }
+        return er;
+    }
+
+    static uint8_t buf[ESPNOW_LINK_V1_MTU];
+    espnow_link_frag_t *f = (espnow_link_frag_t *)buf;
+    int count = (len + ESPNOW_LINK_FRAG_CHUNK - 1) / ESPNOW_LINK_FRAG_CHUNK;
+
+    f->hdr.type  = ESPNOW_MSG_LINK_FRAG;
+    f->msg_id    = ++s_msg_id;
+    f->count     = (uint8_t)count;
+    f->total_len = (uint16_t)len;
+    for (int i = 0; i < count; i++) {
+        int off   = i * ESPNOW_LINK_FRAG_CHUNK;
+        int chunk = (len - off < (int)ESPNOW_LINK_FRAG_CHUNK) ? len - off : (int)ESPNOW_LINK_FRAG_CHUNK;
+        f->index  = (uint8_t)i;
+        memcpy(f->payload, (const uint8_t *)data + off, chunk);
+        esp_err_t er = send_one(mac, buf, sizeof(*f) + chunk, seq);
+        if (er != ESP_OK) return er;
+        s_stats.frags_sent++;
+    }
+    s_stats.fragmented++;
+    s_stats.bytes_sent += len;
+    return ESP_OK;
+}
+
+void espnow_link_mtu_get_stats(espnow_link_mtu_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,238 @@
+// components/espnow_link/link_rate.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "link_rate.h"
+
+static const char *TAG = "ESPNOW_RATE";
+
+typedef struct {
+    wifi_phy_mode_t mode;
+    wifi_phy_rate_t rate;
+    uint16_t        kbps;
+    const char     *name;
+} rate_entry_t;
+
+/* เรียงตาม bitrate — index ต่ำ = ทนกว่า ไกลกว่า */
+static const rate_entry_t s_ladder[] = {
+    { WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_1M_L,     1000,  "1M"   },
+    { WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_2M_L,     2000,  "2M"   },
+    { WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_5M_L,     5500,  "5.5M" },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_6M,       6000,  "6M"   },
+    { WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_11M_L,    11000, "11M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_12M,      12000, "12M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_18M,      18000, "18M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_24M,      24000, "24M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_36M,      36000, "36M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_48M,      48000, "48M"  },
+    { WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_54M,      54000, "54M"  },
+    { WIFI_PHY_MODE_HT20, WIFI_PHY_RATE_MCS7_LGI, 65000, "MCS7" },
+};
+#define LADDER_LEN  (int)(sizeof(s_ladder) / sizeof(s_ladder[0]))
+#define RATE_INFLIGHT 8         // = ESPNOW_LINK_INFLIGHT (ESP-NOW ส่งต่อ peer เรียงลำดับ)
+
+typedef struct {
+    bool     used;
+    int8_t   applied;           // rate ที่ตั้งใน driver ล่าสุด (-1 = ยังไม่ตั้ง)
+    int8_t   sent_rate[RATE_INFLIGHT];  // FIFO: rate ที่ตั้งให้แต่ละเฟรมที่ยังรอ cb (probe ได้ผลตรง rate ที่ลอง)
+    uint8_t  sent_head, sent_n;
+    uint8_t  consec_fail;
+    uint16_t frames;            // นับไปรอบ update / probe
+    uint16_t win_att[LADDER_LEN];
+    uint16_t win_ok[LADDER_LEN];
+    bool     sampled[LADDER_LEN];
+    espnow_link_rate_stats_t st;
+} rate_peer_t;
+
+static rate_peer_t  s_peers[ESPNOW_LINK_RATE_PEERS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(LADDER_LEN <= 12, "espnow_link_rate_stats_t arrays");
+
+static rate_peer_t *find(const uint8_t *mac) {
+    for (int i = 0; i < ESPNOW_LINK_RATE_PEERS; i++) {
+        if (s_peers[i].used && memcmp(s_peers[i].st.mac, mac, 6) == 0) return &s_peers[i];
+    }
+    return NULL;
+}
+
+static int ladder_index(wifi_phy_rate_t rate) {
+    for (int i = 0; i < LADDER_LEN; i++) {
+        if (s_ladder[i].rate == rate) return i;
+    }
+    return -1;
+}
+
+/* เรียกภายใต้ s_lock: อัปเดต EWMA แล้วเลือก rate ที่ throughput คาดหวังสูงสุด */
+static void update(rate_peer_t *p) {
+    for (int i = 0; i < LADDER_LEN; i++) {
+        if (p->win_att[i] == 0) continue;
+        uint16_t now = (uint16_t)(p->win_ok[i] * 1000u / p->win_att[i]);
+        p->st.prob[i] = p->sampled[i] ? (uint16_t)((p->st.prob[i] * 3u + now) / 4) : now;
+        p->sampled[i] = true;
+        p->win_att[i] = p->win_ok[i] = 0;
+    }
+
+    int best = 0;
+    uint32_t best_tp = 0;
+    for (int i = 0; i < LADDER_LEN; i++) {
+        if (!p->sampled[i] || p->st.prob[i] < ESPNOW_LINK_RATE_MIN_PROB) continue;
+        uint32_t tp = (uint32_t)p->st.prob[i] * s_ladder[i].kbps;
+        if (tp > best_tp) {
+            best_tp = tp;
+            best = i;
+        }
+    }
+    if (best != p->st.current) {
+        p->st.current = (uint8_t)best;
+        p->st.changes++;
+    }
+}
+
+esp_err_t espnow_link_rate_enable(const uint8_t mac[6]) {
+    ESP_RETURN_ON_FALSE(mac && esp_now_is_peer_exist(mac), ESP_ERR_INVALID_ARG, TAG, "peer not added");
+
+    portENTER_CRITICAL(&s_lock);
+    rate_peer_t *p = find(mac);
+    for (int i = 0; !p && i < ESPNOW_LINK_RATE_PEERS; i++) {
+        if (!s_peers[i].used) p = &s_peers[i];
+    }
+    if (p) {
+        memset(p, 0, sizeof(*p));
+        p->used    = true;
+        p->applied = -1;
+        memcpy(p->st.mac, mac, 6);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(p, ESP_ERR_NO_MEM, TAG, "rate table full");
+    return ESP_OK;
+}
+
+void espnow_link_rate_before_send(const uint8_t mac[6]) {
+    int want = -1;
+    bool apply = false;
+
+    portENTER_CRITICAL(&s_lock);
+    rate_peer_t *p = find(mac);
+    if (p) {
+        want = p->st.current;
+        // probe: ลอง rate สูงกว่า 1..2 ขั้นเป็นครั้งคราว (sample ตามแบบ Minstrel)
+        if (++p->frames % ESPNOW_LINK_RATE_PROBE_EVERY == 0 && p->st.current < LADDER_LEN - 1) {
+            int up = p->st.current + 1 + (int)(esp_random() % 2);
+            want = (up < LADDER_LEN) ? up : LADDER_LEN - 1;
+            p->st.probes++;
+        }
+        if (p->sent_n == RATE_INFLIGHT) {  // cb หาย -> ทิ้งตัวเก่าสุด
+            p->sent_head = (p->sent_head + 1) % RATE_INFLIGHT;
+            p->sent_n--;
+        }
+        p->sent_rate[(p->sent_head + p->sent_n++) % RATE_INFLIGHT] = (int8_t)want;
+        apply = (want != p->applied);
+        if (apply) p->applied = (int8_t)want;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (apply) {
+        esp_now_rate_config_t cfg = {
+            .phymode = s_ladder[want].mode,
+            .rate    = s_ladder[want].rate,
+            .ersu    = false,
+            .dcm     = false,
+        };
+        esp_err_t er = esp_now_set_peer_rate_config(mac, &cfg);
+        if (er != ESP_OK) ESP_LOGW(TAG, "set rate %s failed: %s", s_ladder[want].name, esp_err_to_name(er));
+    }
+}
+
+void espnow_link_rate_on_sent(const wifi_tx_info_t *info, bool ok) {
+    if (!info || !info->des_addr) return;
+
+    portENTER_CRITICAL(&s_lock);
+    rate_peer_t *p = find(info->des_addr);
+    // ผลนับเข้า rate ที่ตั้งให้เฟรมนั้นจริง (เฟรม probe -> rate ที่ probe) — ไม่มีใน FIFO ค่อยใช้ info->rate
+    int idx = -1;
+    if (p && p->sent_n > 0) {
+        idx = p->sent_rate[p->sent_head];
+        p->sent_head = (p->sent_head + 1) % RATE_INFLIGHT;
+        p->sent_n--;
+        if (idx != p->st.current) {
+            if (ok) p->st.probe_ok++;
+            else    p->st.probe_fail++;
+        }
+    } else if (p) {
+        idx = ladder_index(info->rate);
+    }
+    if (p && idx >= 0) {
+        p->win_att[idx]++;
+        p->st.attempts[idx]++;
+        if (ok) {
+            p->win_ok[idx]++;
+            p->st.success[idx]++;
+        }
+
+        if (idx == p->st.current) {
+            p->consec_fail = ok ? 0 : p->consec_fail + 1;
+            if (p->consec_fail >= ESPNOW_LINK_RATE_DOWN_FAILS && p->st.current > 0) {
+                // link แย่ลงกะทันหัน: ลดทันที และลด prob ของ rate เดิม
+                p->st.prob[idx] /= 2;
+                p->st.current--;
+                p->st.step_downs++;
+                p->st.changes++;
+                p->consec_fail = 0;
+            }
+        }
+        if (p->frames >= ESPNOW_LINK_RATE_UPDATE) {
+            p->frames = 0;
+            update(p);
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void espnow_link_rate_send_failed(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&s_lock);
+    rate_peer_t *p = find(mac);
+    if (p && p->sent_n > 0) p->sent_n--;     // ถอนตัวล่าสุดที่ before_send ใส่ไว้
+    portEXIT_CRITICAL(&s_lock);
+}
+
+int espnow_link_rate_ladder_len(void) {
+    return LADDER_LEN;
+}
+
+const char *espnow_link_rate_name(int idx) {
+    return (idx >= 0 && idx < LADDER_LEN) ? s_ladder[idx].name : "?";
+}
+
+bool espnow_link_rate_get_stats(const uint8_t mac[6], espnow_link_rate_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    rate_peer_t *p = find(mac);
+    if (p) *out = p->st;
+    portEXIT_CRITICAL(&s_lock);
+    return p != NULL;
+}
+
+void espnow_link_rate_report(void) {
+    for (int i = 0; i < ESPNOW_LINK_RATE_PEERS; i++) {
+        espnow_link_rate_stats_t st;
+        portENTER_CRITICAL(&s_lock);
+        bool used = s_peers[i].used;
+        if (used) st = s_peers[i].st;
+        portEXIT_CRITICAL(&s_lock);
+        if (!used) continue;
+
+        ESP_LOGI(TAG, "%02X:%02X:%02X:%02X:%02X:%02X rate=%s changes=%" PRIu32 " probes=%" PRIu32
+                 " (ok %" PRIu32 " fail %" PRIu32 ") step_down=%" PRIu32,
+                 st.mac[0], st.mac[1], st.mac[2], st.mac[3], st.mac[4], st.mac[5],
+                 s_ladder[st.current].name, st.changes, st.probes, st.probe_ok, st.probe_fail, st.step_downs);
+        for (int r = 0; r < LADDER_LEN; r++) {
+            if (st.attempts[r] == 0) continue;
+            ESP_LOGI(TAG, "   %-5s %" PRIu32 "/%" PRIu32 " ok, prob %u‰, ~%" PRIu32 " kbps",
+                     s_ladder[r].name, st.success[r], st.attempts[r], st.prob[r],
+                     (uint32_t)st.prob[r] * s_ladder[r].kbps / 1000);
+        }
+    }
+}
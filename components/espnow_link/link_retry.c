@@ -0,0 +1,244 @@
+// components/espnow_link/link_retry.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "link_retry.h"
+
+static const char *TAG = "ESPNOW_RETRY";
+
+#define FRAME_MAX  250   // ESP_NOW_MAX_DATA_LEN
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_WAIT_CB,               // ส่งแล้ว รอ send-cb (ถึง due_us = cb หาย -> นับเป็น FAIL)
+    SLOT_BACKOFF,               // รอถึง due_us แล้วส่งซ้ำ
+} slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    uint8_t      mac[6];
+    uint32_t     seq;
+    uint8_t      attempt;       // attempt ล่าสุดที่ส่ง (0 = ครั้งแรก)
+    int64_t      first_us;
+    int64_t      due_us;
+    uint8_t      len;
+    uint8_t      frame[FRAME_MAX];
+} retry_slot_t;
+
+static espnow_link_retry_policy_t s_policy;
+static retry_slot_t              s_slots[ESPNOW_LINK_RETRY_SLOTS];
+static espnow_link_retry_stats_t s_stats[ESPNOW_LINK_MAX_PEERS];
+static bool                      s_stats_used[ESPNOW_LINK_MAX_PEERS];
+static portMUX_TYPE              s_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t         s_wake;
+
+/* เรียกภายใต้ s_lock — เต็มแล้วนับรวมในช่องสุดท้าย */
+static espnow_link_retry_stats_t *stats_for(const uint8_t *mac) {
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        if (s_stats_used[i] && memcmp(s_stats[i].mac, mac, 6) == 0) return &s_stats[i];
+    }
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        if (s_stats_used[i]) continue;
+        s_stats_used[i] = true;
+        memcpy(s_stats[i].mac, mac, 6);
+        return &s_stats[i];
+    }
+    return &s_stats[ESPNOW_LINK_MAX_PEERS - 1];
+}
+
+static uint32_t backoff_ms(uint8_t attempt) {
+    uint32_t d = s_policy.base_ms;
+    for (int i = 1; i < attempt && d < s_policy.max_backoff_ms; i++) d <<= 1;
+    if (d > s_policy.max_backoff_ms) d = s_policy.max_backoff_ms;
+    return d / 2 + esp_random() % (d / 2 + 1);
+}
+
+/* เรียกภายใต้ s_lock: ตั้งเวลาส่งซ้ำ หรือทิ้งถ้าครบจำนวน/เลย deadline — คืน true ถ้ายังจะ retry */
+static bool schedule_retry(retry_slot_t *s, int64_t now) {
+    espnow_link_retry_stats_t *st = stats_for(s->mac);
+    uint8_t next = s->attempt + 1;
+    if (next >= s_policy.max_attempts) {
+        st->gave_up++;
+        s->state = SLOT_FREE;
+        return false;
+    }
+    int64_t due = now + (int64_t)backoff_ms(next) * 1000;
+    if (due - s->first_us > (int64_t)s_policy.deadline_ms * 1000) {
+        st->expired++;
+        s->state = SLOT_FREE;
+        return false;
+    }
+    s->attempt = next;
+    s->due_us  = due;
+    s->state   = SLOT_BACKOFF;
+    return true;
+}
+
+static void retry_task(void *arg) {
+    static uint8_t frame[FRAME_MAX];
+
+    while (1) {
+        // หา due ที่ใกล้ที่สุด
+        int64_t now = esp_timer_get_time();
+        int64_t next = INT64_MAX;
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < ESPNOW_LINK_RETRY_SLOTS; i++) {
+            retry_slot_t *s = &s_slots[i];
+            if (s->state == SLOT_WAIT_CB && s->due_us <= now) {
+                // cb ไม่มา: ไม่งั้นช่องค้างตลอดไปจน pool หมด
+                stats_for(s->mac)->cb_timeout++;
+                schedule_retry(s, now);
+            }
+            if (s->state != SLOT_FREE && s->due_us < next) next = s->due_us;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (next > now) {
+            TickType_t ticks = (next == INT64_MAX) ? portMAX_DELAY
+                             : pdMS_TO_TICKS((next - now) / 1000) + 1;
+            xSemaphoreTake(s_wake, ticks);
+            continue;
+        }
+
+        // ส่งทุกช่องที่ถึงเวลา (ทีละช่อง — ไม่ถือ lock ระหว่าง esp_now_send)
+        for (int i = 0; i < ESPNOW_LINK_RETRY_SLOTS; i++) {
+            retry_slot_t *s = &s_slots[i];
+            uint8_t mac[6], attempt, len;
+            uint32_t seq;
+
+            portENTER_CRITICAL(&s_lock);
+            bool due = s->state == SLOT_BACKOFF && s->due_us <= now;
+            if (due) {
+                s->state  = SLOT_WAIT_CB;  // ก่อนส่ง: cb อาจมาก่อน send คืนค่า
+                s->due_us = now + ESPNOW_LINK_RETRY_CB_MS * 1000;
+                memcpy(mac, s->mac, 6);
+                memcpy(frame, s->frame, s->len);
+                seq = s->seq;
+                attempt = s->attempt;
+                len = s->len;
+            }
+            portEXIT_CRITICAL(&s_lock);
+            if (!due) continue;
+
+            esp_err_t er = espnow_link_send(mac, frame, len, seq, attempt);
+            if (er != ESP_OK) {
+                portENTER_CRITICAL(&s_lock);
+                if (s->state == SLOT_WAIT_CB && s->seq == seq) schedule_retry(s, esp_timer_get_time());
+                portEXIT_CRITICAL(&s_lock);
+            }
+        }
+    }
+}
+
+esp_err_t espnow_link_retry_init(const espnow_link_retry_policy_t *policy) {
+    ESP_RETURN_ON_FALSE(policy && policy->max_attempts >= 1 && policy->base_ms > 0,
+                        ESP_ERR_INVALID_ARG, TAG, "bad policy");
+    ESP_RETURN_ON_FALSE(!s_wake, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+
+    s_policy = *policy;
+    if (s_policy.max_attempts > ESPNOW_LINK_RETRY_MAX_ATTEMPTS) s_policy.max_attempts = ESPNOW_LINK_RETRY_MAX_ATTEMPTS;
+    if (s_policy.max_backoff_ms < s_policy.base_ms) s_policy.max_backoff_ms = s_policy.base_ms;
+
+    s_wake = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(s_wake, ESP_ERR_NO_MEM, TAG, "semaphore");
+    ESP_RETURN_ON_FALSE(xTaskCreate(retry_task, "link_retry", 3072, NULL, 5, NULL) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    return ESP_OK;
+}
+
+esp_err_t espnow_link_send_reliable(const uint8_t mac[6], const void *data, int len, uint32_t seq) {
+    if (!mac || !data || len <= 0 || len > FRAME_MAX) return ESP_ERR_INVALID_ARG;
+    if (!s_wake) return espnow_link_send(mac, data, len, seq, 0);
+
+    retry_slot_t *s = NULL;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < ESPNOW_LINK_RETRY_SLOTS; i++) {
+        if (s_slots[i].state == SLOT_FREE) {
+            s = &s_slots[i];
+            break;
+        }
+    }
+    if (s) {
+        s->state    = SLOT_WAIT_CB;
+        memcpy(s->mac, mac, 6);
+        s->seq      = seq;
+        s->attempt  = 0;
+        s->first_us = esp_timer_get_time();
+        s->due_us   = s->first_us + ESPNOW_LINK_RETRY_CB_MS * 1000;
+        s->len      = (uint8_t)len;
+        memcpy(s->frame, data, len);
+    } else {
+        stats_for(mac)->no_slot++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t er = espnow_link_send(mac, data, len, seq, 0);
+    if (s && er != ESP_OK) {
+        // เช่น ESP_ERR_ESPNOW_NO_MEM: ลองใหม่หลัง backoff แทนที่จะทิ้ง
+        portENTER_CRITICAL(&s_lock);
+        bool again = (s->state == SLOT_WAIT_CB && s->seq == seq) && schedule_retry(s, esp_timer_get_time());
+        portEXIT_CRITICAL(&s_lock);
+        if (again) {
+            xSemaphoreGive(s_wake);
+            return ESP_OK;
+        }
+    }
+    if (s && er == ESP_OK) xSemaphoreGive(s_wake);   // ให้ retry task รู้ deadline รอ cb ของช่องนี้
+    return er;
+}
+
+void espnow_link_retry_on_sent(const wifi_tx_info_t *info, const espnow_link_sent_t *r) {
+    if (!s_wake || !r || !r->matched || !info || !info->des_addr) return;
+
+    bool wake = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < ESPNOW_LINK_RETRY_SLOTS; i++) {
+        retry_slot_t *s = &s_slots[i];
+        if (s->state != SLOT_WAIT_CB || s->seq != r->seq || s->attempt != r->attempt ||
+            memcmp(s->mac, info->des_addr, 6) != 0) {
+            continue;
+        }
+        if (r->ok) {
+            stats_for(s->mac)->delivered[s->attempt]++;
+            s->state = SLOT_FREE;
+        } else {
+            wake = schedule_retry(s, esp_timer_get_time());
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (wake) xSemaphoreGive(s_wake);
+}
+
+bool espnow_link_retry_get_stats(int idx, espnow_link_retry_stats_t *out) {
+    if (idx < 0 || idx >= ESPNOW_LINK_MAX_PEERS || !out) return false;
+    portENTER_CRITICAL(&s_lock);
+    bool used = s_stats_used[idx];
+    if (used) *out = s_stats[idx];
+    portEXIT_CRITICAL(&s_lock);
+    return used;
+}
+
+void espnow_link_retry_report(void) {
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        espnow_link_retry_stats_t st;
+        if (!espnow_link_retry_get_stats(i, &st)) continue;
+
+        uint32_t first = st.delivered[0], recovered = 0;
+        for (int a = 1; a < ESPNOW_LINK_RETRY_MAX_ATTEMPTS; a++) recovered += st.delivered[a];
+        ESP_LOGI(TAG, "%02X:%02X:%02X:%02X:%02X:%02X first-try=%" PRIu32 " recovered=%" PRIu32
+                 " gave_up=%" PRIu32 " expired=%" PRIu32 " no_slot=%" PRIu32 " cb_timeout=%" PRIu32,
+                 st.mac[0], st.mac[1], st.mac[2], st.mac[3], st.mac[4], st.mac[5],
+                 first, recovered, st.gave_up, st.expired, st.no_slot, st.cb_timeout);
+        ESP_LOGI(TAG, "   attempts: 1:%" PRIu32 " 2:%" PRIu32 " 3:%" PRIu32 " 4:%" PRIu32
+                 " 5:%" PRIu32 " 6:%" PRIu32 " 7:%" PRIu32 " 8:%" PRIu32,
+                 st.delivered[0], st.delivered[1], st.delivered[2], st.delivered[3],
+                 st.delivered[4], st.delivered[5], st.delivered[6], st.delivered[7]);
+    }
+}
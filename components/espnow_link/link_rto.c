@@ -0,0 +1,82 @@
+// components/espnow_link/link_rto.c
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "link_track.h"
+#include "link_rto.h"
+
+static espnow_link_rto_stats_t s_peers[ESPNOW_LINK_MAX_PEERS];
+static bool                    s_used[ESPNOW_LINK_MAX_PEERS];
+static portMUX_TYPE            s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* เรียกภายใต้ s_lock — เต็มแล้วใช้ช่องสุดท้ายร่วมกัน */
+static espnow_link_rto_stats_t *peer_for(const uint8_t *mac) {
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        if (s_used[i] && memcmp(s_peers[i].mac, mac, 6) == 0) return &s_peers[i];
+    }
+    int i = 0;
+    while (i < ESPNOW_LINK_MAX_PEERS - 1 && s_used[i]) i++;
+    memset(&s_peers[i], 0, sizeof(s_peers[i]));
+    memcpy(s_peers[i].mac, mac, 6);
+    s_peers[i].rto_ms = ESPNOW_LINK_RTO_INIT_MS;
+    s_used[i] = true;
+    return &s_peers[i];
+}
+
+static uint32_t clamp_rto(int64_t us) {
+    int64_t ms = (us + 999) / 1000;
+    if (ms < ESPNOW_LINK_RTO_MIN_MS) ms = ESPNOW_LINK_RTO_MIN_MS;
+    if (ms > ESPNOW_LINK_RTO_MAX_MS) ms = ESPNOW_LINK_RTO_MAX_MS;
+    return (uint32_t)ms;
+}
+
+uint32_t espnow_link_rto_ms(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&s_lock);
+    uint32_t rto = peer_for(mac)->rto_ms;
+    portEXIT_CRITICAL(&s_lock);
+    return rto;
+}
+
+void espnow_link_rto_sample(const uint8_t mac[6], int64_t rtt_us, bool retransmitted) {
+    portENTER_CRITICAL(&s_lock);
+    espnow_link_rto_stats_t *p = peer_for(mac);
+    if (retransmitted) {
+        p->karn_skipped++;      // คง RTO ที่ backoff ไว้จนกว่าจะได้ sample ที่ไม่กำกวม
+    } else {
+        if (p->samples == 0) {
+            p->srtt_us   = rtt_us;
+            p->rttvar_us = rtt_us / 2;
+        } else {
+            int64_t err = p->srtt_us - rtt_us;
+            if (err < 0) err = -err;
+            p->rttvar_us += (err - p->rttvar_us) / 4;
+            p->srtt_us   += (rtt_us - p->srtt_us) / 8;
+        }
+        p->samples++;
+        int64_t k = 4 * p->rttvar_us;
+        if (k < ESPNOW_LINK_RTO_G_MS * 1000) k = ESPNOW_LINK_RTO_G_MS * 1000;
+        p->rto_ms = clamp_rto(p->srtt_us + k);
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void espnow_link_rto_backoff(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&s_lock);
+    espnow_link_rto_stats_t *p = peer_for(mac);
+    p->timeouts++;
+    p->rto_ms = (p->rto_ms * 2 > ESPNOW_LINK_RTO_MAX_MS) ? ESPNOW_LINK_RTO_MAX_MS : p->rto_ms * 2;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool espnow_link_rto_get_stats(const uint8_t mac[6], espnow_link_rto_stats_t *out) {
+    bool found = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        if (s_used[i] && memcmp(s_peers[i].mac, mac, 6) == 0) {
+            *out = s_peers[i];
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return found;
+}
@@ -0,0 +1,228 @@
+// components/espnow_link/link_track.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "link_track.h"
+#include "link_retry.h"
+#include "link_rate.h"
+
+static const char *TAG = "ESPNOW_LINK";
+
+typedef struct {
+    uint32_t seq;
+    uint8_t  attempt;
+    bool     ctrl;              // espnow_link_send_ctrl: นับสถิติ แต่ไม่คืนให้แอปจับคู่
+    uint16_t len;
+    int64_t  t_us;
+} inflight_t;
+
+typedef struct {
+    bool                used;
+    int64_t             last_us;            // ใช้เลือกช่องที่จะทับเมื่อเต็ม
+    inflight_t          q[ESPNOW_LINK_INFLIGHT];
+    uint8_t             head, count;
+    espnow_link_stats_t st;
+} peer_t;
+
+static peer_t       s_peers[ESPNOW_LINK_MAX_PEERS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline int hist_bucket(int64_t us) {
+    int64_t ms = us / 1000;
+    int b = 0;
+    while (ms > 0 && b < ESPNOW_LINK_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* เรียกภายใต้ s_lock */
+static peer_t *find_peer(const uint8_t *mac, bool create) {
+    peer_t *oldest = &s_peers[0];
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        peer_t *p = &s_peers[i];
+        if (p->used && memcmp(p->st.mac, mac, 6) == 0) return p;
+        if (!p->used || (oldest->used && p->last_us < oldest->last_us)) oldest = p;
+    }
+    if (!create) return NULL;
+
+    memset(oldest, 0, sizeof(*oldest));   // เต็ม -> ทับ peer ที่เงียบนานสุด
+    oldest->used = true;
+    memcpy(oldest->st.mac, mac, 6);
+    return oldest;
+}
+
+/* เรียกภายใต้ s_lock: cb ที่หายไปทำให้ทุก cb หลังจากนั้นจับคู่เลื่อนไปหนึ่งตัว
+   -> ถอดตัวหัว FIFO ที่รอนานเกิน timeout ทิ้ง (cb ปกติมาภายในไม่กี่ ms) */
+static void expire_locked(peer_t *p, int64_t now) {
+    while (p->count > 0 && now - p->q[p->head].t_us > ESPNOW_LINK_CB_TIMEOUT_MS * 1000LL) {
+        p->head = (p->head + 1) % ESPNOW_LINK_INFLIGHT;
+        p->count--;
+        p->st.expired++;
+    }
+}
+
+static esp_err_t track_send(const uint8_t *mac, const void *data, int len, uint32_t seq, uint8_t attempt, bool ctrl) {
+    int64_t now = esp_timer_get_time();
+
+    // บันทึกก่อนส่ง: cb อาจมาถึงก่อน esp_now_send() คืนค่า
+    portENTER_CRITICAL(&s_lock);
+    peer_t *p = find_peer(mac, !ctrl);
+    if (!p) {
+        portEXIT_CRITICAL(&s_lock);
+        return esp_now_send(mac, data, len);    // ctrl ไป peer ที่ไม่ได้ track: cb ไม่แตะ FIFO อยู่แล้ว
+    }
+    p->last_us = now;
+    expire_locked(p, now);
+    if (p->count == ESPNOW_LINK_INFLIGHT) {
+        // เต็มทั้งที่ยังไม่มีตัวไหนหมดเวลา (ส่งรัวกว่า cb) -> ทิ้งตัวเก่าสุด
+        p->head = (p->head + 1) % ESPNOW_LINK_INFLIGHT;
+        p->count--;
+        p->st.unmatched++;
+    }
+    inflight_t *e = &p->q[(p->head + p->count) % ESPNOW_LINK_INFLIGHT];
+    e->seq     = seq;
+    e->attempt = attempt;
+    e->ctrl    = ctrl;
+    e->len     = (uint16_t)len;
+    e->t_us    = now;
+    p->count++;
+    portEXIT_CRITICAL(&s_lock);
+
+    espnow_link_rate_before_send(mac);   // peer ที่เปิด rate control เท่านั้น
+    esp_err_t er = esp_now_send(mac, data, len);
+
+    // ระหว่าง esp_now_send ช่องของ peer อาจถูกทับ (find_peer(create) ของปลายทางอื่น) -> หาใหม่
+    // ไม่เจอ = ถูกทับไปแล้ว FIFO ใหม่ไม่มีรายการของเรา
+    portENTER_CRITICAL(&s_lock);
+    p = find_peer(mac, false);
+    if (p && er == ESP_OK) {
+        p->st.sent++;
+        if (attempt > 0) p->st.retries++;
+    } else if (p) {
+        // ไม่ได้เข้าคิวของ ESP-NOW -> ถอนรายการล่าสุดของ seq นี้ออก
+        p->st.send_err++;
+        for (int i = p->count - 1; i >= 0; i--) {
+            int idx = (p->head + i) % ESPNOW_LINK_INFLIGHT;
+            if (p->q[idx].seq != seq || p->q[idx].attempt != attempt || p->q[idx].ctrl != ctrl) continue;
+            for (int j = i; j < p->count - 1; j++) {
+                p->q[(p->head + j) % ESPNOW_LINK_INFLIGHT] = p->q[(p->head + j + 1) % ESPNOW_LINK_INFLIGHT];
+            }
+            p->count--;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (er != ESP_OK) espnow_link_rate_send_failed(mac);
+    return er;
+}
+
+esp_err_t espnow_link_send(const uint8_t mac[6], const void *data, int len, uint32_t seq, uint8_t attempt) {
+    return track_send(mac, data, len, seq, attempt, false);
+}
+
+esp_err_t espnow_link_send_ctrl(const uint8_t mac[6], const void *data, int len) {
+    return track_send(mac, data, len, 0, 0, true);
+}
+
+void espnow_link_on_sent(const wifi_tx_info_t *info, esp_now_send_status_t status, espnow_link_sent_t *out) {
+    espnow_link_sent_t r = {0};
+    r.ok = (status == ESP_NOW_SEND_SUCCESS);
+
+    espnow_link_rate_on_sent(info, r.ok);
+    if (info && info->des_addr) {
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&s_lock);
+        peer_t *p = find_peer(info->des_addr, false);
+        if (p) expire_locked(p, now);
+        if (p && p->count > 0) {
+            inflight_t *e = &p->q[p->head];
+            p->head = (p->head + 1) % ESPNOW_LINK_INFLIGHT;
+            p->count--;
+
+            r.matched    = !e->ctrl;
+            r.seq        = e->seq;
+            r.attempt    = e->attempt;
+            r.len        = e->len;
+            r.latency_us = now - e->t_us;
+
+            if (r.ok) {
+                p->st.ok++;
+                p->st.bytes_ok += r.len;
+            } else {
+                p->st.fail++;
+            }
+            p->st.lat_hist[hist_bucket(r.latency_us)]++;
+            p->st.lat_sum_us += r.latency_us;
+            if (r.latency_us > p->st.lat_max_us) p->st.lat_max_us = r.latency_us;
+        } else if (p) {
+            p->st.unmatched++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+    }
+    if (out) *out = r;
+}
+
+bool espnow_link_get_stats(int idx, espnow_link_stats_t *out) {
+    if (idx < 0 || idx >= ESPNOW_LINK_MAX_PEERS || !out) return false;
+    portENTER_CRITICAL(&s_lock);
+    bool used = s_peers[idx].used;
+    if (used) *out = s_peers[idx].st;
+    portEXIT_CRITICAL(&s_lock);
+    return used;
+}
+
+bool espnow_link_get_stats_by_mac(const uint8_t mac[6], espnow_link_stats_t *out) {
+    if (!mac || !out) return false;
+    portENTER_CRITICAL(&s_lock);
+    peer_t *p = find_peer(mac, false);
+    if (p) *out = p->st;
+    portEXIT_CRITICAL(&s_lock);
+    return p != NULL;
+}
+
+void espnow_link_report(void) {
+    for (int i = 0; i < ESPNOW_LINK_MAX_PEERS; i++) {
+        espnow_link_stats_t st;
+        if (!espnow_link_get_stats(i, &st)) continue;
+
+        uint32_t done = st.ok + st.fail;
+        ESP_LOGI(TAG, "%02X:%02X:%02X:%02X:%02X:%02X sent=%" PRIu32 " ok=%" PRIu32 " (%" PRIu32 "%%) fail=%" PRIu32
+                 " err=%" PRIu32 " retry=%" PRIu32 " unmatched=%" PRIu32 " expired=%" PRIu32,
+                 st.mac[0], st.mac[1], st.mac[2], st.mac[3], st.mac[4], st.mac[5],
+                 st.sent, st.ok, done ? st.ok * 100 / done : 0, st.fail,
+                 st.send_err, st.retries, st.unmatched, st.expired);
+        ESP_LOGI(TAG, "   latency avg=%" PRId64 " max=%" PRId64 " us | <1:%" PRIu32 " <2:%" PRIu32 " <4:%" PRIu32
+                 " <8:%" PRIu32 " <16:%" PRIu32 " <32:%" PRIu32 " <64:%" PRIu32 " >=64:%" PRIu32 " ms"
+                 " | %" PRIu64 " ns/byte",
+                 done ? st.lat_sum_us / done : 0, st.lat_max_us,
+                 st.lat_hist[0], st.lat_hist[1], st.lat_hist[2], st.lat_hist[3],
+                 st.lat_hist[4], st.lat_hist[5], st.lat_hist[6], st.lat_hist[7],
+                 st.bytes_ok ? (uint64_t)st.lat_sum_us * 1000 / st.bytes_ok : 0);
+    }
+}
+
+static void report_cb(void *arg) {
+    espnow_link_report();
+    espnow_link_retry_report();
+    espnow_link_rate_report();
+}
+
+esp_err_t espnow_link_start_report(uint32_t period_ms) {
+    static esp_timer_handle_t timer;
+    ESP_RETURN_ON_FALSE(period_ms > 0, ESP_ERR_INVALID_ARG, TAG, "period_ms");
+    if (!timer) {
+        const esp_timer_create_args_t args = {
+            .callback = report_cb,
+            .name     = "link_report",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&args, &timer), TAG, "timer create");
+    } else {
+        esp_timer_stop(timer);
+    }
+    return esp_timer_start_periodic(timer, (uint64_t)period_ms * 1000);
+}
@@ -0,0 +1,283 @@
+// components/espnow_metrics/espnow_metrics.c
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_now.h"
+#include "esp_console.h"
+#include "link_track.h"
+#include "espnow_metrics.h"
+
+static const char *TAG = "METRICS";
+
+struct espnow_metric {
+    const char           *name;
+    uint16_t              key;
+    uint8_t               kind;         // espnow_metric_kind_t
+    atomic_uint_least32_t value;        // counter / gauge (เก็บ i32 เป็นบิตเดียวกัน) / hist: จำนวน
+    atomic_uint_least32_t sum_lo;       // hist: ผลรวม 64 บิตแบบ 32+32 (atomic 64 บิตของ IDF = critical section)
+    atomic_uint_least32_t sum_hi;       // ทดจาก sum_lo — ไม่มี lock ใน hot path
+    atomic_uint_least32_t bucket[ESPNOW_METRICS_HIST_BUCKETS];
+    uint32_t              bounds[ESPNOW_METRICS_HIST_BUCKETS - 1];
+};
+
+static struct espnow_metric s_m[ESPNOW_METRICS_MAX];
+static atomic_int           s_count;        // อ่านได้โดยไม่ lock: ช่อง < s_count ตั้งค่าเสร็จแล้ว
+static portMUX_TYPE         s_reg_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static espnow_metrics_config_t s_cfg;
+static esp_timer_handle_t      s_timer;
+static uint16_t                s_seq;
+static espnow_metric_t        *s_heap_free, *s_heap_min, *s_frames_tx;
+
+static const char *const s_kind_name[] = { "counter", "gauge", "hist" };
+
+uint16_t espnow_metrics_key(const char *name) {
+    uint32_t h = 2166136261u;               // FNV-1a 32 แล้วพับเหลือ 16
+    for (const char *p = name; *p; p++) {
+        h ^= (uint8_t)*p;
+        h *= 16777619u;
+    }
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+/* ===================== registry ===================== */
+
+static espnow_metric_t *reg(const char *name, espnow_metric_kind_t kind, const uint32_t *bounds) {
+    if (!name) return NULL;
+    espnow_metric_t *m = NULL;
+    portENTER_CRITICAL(&s_reg_lock);
+    int n = atomic_load(&s_count);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(s_m[i].name, name) == 0) {
+            m = (s_m[i].kind == kind) ? &s_m[i] : NULL;
+            portEXIT_CRITICAL(&s_reg_lock);
+            return m;
+        }
+    }
+    if (n < ESPNOW_METRICS_MAX) {
+        m = &s_m[n];
+        m->name = name;
+        m->key  = espnow_metrics_key(name);
+        m->kind = kind;
+        if (bounds) memcpy(m->bounds, bounds, sizeof(m->bounds));
+        atomic_store(&s_count, n + 1);
+    }
+    portEXIT_CRITICAL(&s_reg_lock);
+    if (!m) ESP_LOGW(TAG, "registry full, '%s' not tracked", name);
+    return m;
+}
+
+espnow_metric_t *espnow_metrics_counter(const char *name) {
+    return reg(name, ESPNOW_METRIC_COUNTER, NULL);
+}
+
+espnow_metric_t *espnow_metrics_gauge(const char *name) {
+    return reg(name, ESPNOW_METRIC_GAUGE, NULL);
+}
+
+espnow_metric_t *espnow_metrics_hist(const char *name, const uint32_t bounds[ESPNOW_METRICS_HIST_BUCKETS - 1]) {
+    return bounds ? reg(name, ESPNOW_METRIC_HIST, bounds) : NULL;
+}
+
+/* ===================== hot path ===================== */
+
+void espnow_metrics_inc(espnow_metric_t *m) {
+    if (m) atomic_fetch_add_explicit(&m->value, 1, memory_order_relaxed);
+}
+
+void espnow_metrics_add(espnow_metric_t *m, uint32_t n) {
+    if (m) atomic_fetch_add_explicit(&m->value, n, memory_order_relaxed);
+}
+
+void espnow_metrics_set(espnow_metric_t *m, int32_t v) {
+    if (m) atomic_store_explicit(&m->value, (uint32_t)v, memory_order_relaxed);
+}
+
+void espnow_metrics_observe(espnow_metric_t *m, uint32_t v) {
+    if (!m) return;
+    int b = 0;
+    while (b < ESPNOW_METRICS_HIST_BUCKETS - 1 && v >= m->bounds[b]) b++;
+    atomic_fetch_add_explicit(&m->bucket[b], 1, memory_order_relaxed);
+    uint32_t lo = atomic_fetch_add_explicit(&m->sum_lo, v, memory_order_relaxed);
+    if (lo + v < lo) atomic_fetch_add_explicit(&m->sum_hi, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->value, 1, memory_order_relaxed);
+}
+
+uint32_t espnow_metrics_read(espnow_metric_t *m) {
+    return m ? atomic_load_explicit(&m->value, memory_order_relaxed) : 0;
+}
+
+/* ===================== frame ===================== */
+
+static int entry_len(const espnow_metric_t *m) {
+    return 3 + (m->kind == ESPNOW_METRIC_HIST ? 4 * ESPNOW_METRICS_HIST_BUCKETS + 8 : 4);
+}
+
+/* อ่านตอน hi ไม่เปลี่ยนระหว่างอ่าน lo — ช่วงสั้น ๆ ระหว่าง lo ล้นกับ hi +1 อาจได้ค่าต่ำไป 2^32 ครั้งเดียว (stat รับได้) */
+static uint64_t hist_sum(const espnow_metric_t *m) {
+    uint32_t hi, lo;
+    do {
+        hi = atomic_load_explicit(&m->sum_hi, memory_order_relaxed);
+        lo = atomic_load_explicit(&m->sum_lo, memory_order_relaxed);
+    } while (hi != atomic_load_explicit(&m->sum_hi, memory_order_relaxed));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, 4);                       // LE ทั้ง esp32 และ host
+    return p + 4;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t v) {
+    memcpy(p, &v, 8);
+    return p + 8;
+}
+
+int espnow_metrics_build(uint8_t *buf, int cap, int *next) {
+    int n = atomic_load(&s_count);
+    int i = next ? *next : 0;
+    if (i >= n || cap < (int)sizeof(espnow_metrics_frame_hdr_t)) return 0;
+
+    espnow_metrics_frame_hdr_t h = {
+        .hdr.type = ESPNOW_MSG_STATS,
+        .version  = ESPNOW_METRICS_VERSION,
+        .seq      = s_seq,
+        .first    = (uint8_t)i,
+        .uptime_s = (uint32_t)(esp_timer_get_time() / 1000000),
+    };
+
+    uint8_t *p = buf + sizeof(h);
+    for (; i < n && (p - buf) + entry_len(&s_m[i]) <= cap; i++) {
+        espnow_metric_t *m = &s_m[i];
+        memcpy(p, &m->key, 2);
+        p[2] = m->kind;
+        p += 3;
+        if (m->kind == ESPNOW_METRIC_HIST) {    // จำนวน = ผลรวม bucket (ไม่ส่งซ้ำ)
+            for (int b = 0; b < ESPNOW_METRICS_HIST_BUCKETS; b++)
+                p = put_u32(p, atomic_load_explicit(&m->bucket[b], memory_order_relaxed));
+            p = put_u64(p, hist_sum(m));
+        } else {
+            p = put_u32(p, atomic_load_explicit(&m->value, memory_order_relaxed));
+        }
+        h.count++;
+    }
+    memcpy(buf, &h, sizeof(h));
+    if (next) *next = i;
+    return (int)(p - buf);
+}
+
+static bool peer_set(const uint8_t peer[6]) {
+    static const uint8_t zero[6] = {0};
+    return memcmp(peer, zero, 6) != 0;
+}
+
+void espnow_metrics_set_peer(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&s_reg_lock);
+    memcpy(s_cfg.peer, mac, 6);
+    portEXIT_CRITICAL(&s_reg_lock);
+}
+
+static void emit_cb(void *arg) {
+    espnow_metrics_set(s_heap_free, (int32_t)esp_get_free_heap_size());
+    espnow_metrics_set(s_heap_min, (int32_t)esp_get_minimum_free_heap_size());
+    if (s_cfg.collect) s_cfg.collect();
+
+    uint8_t peer[6];
+    portENTER_CRITICAL(&s_reg_lock);
+    memcpy(peer, s_cfg.peer, 6);
+    portEXIT_CRITICAL(&s_reg_lock);
+    bool to_peer = peer_set(peer);
+    uint8_t buf[ESPNOW_METRICS_FRAME_MAX];
+    int next = 0, len;
+    while ((len = espnow_metrics_build(buf, sizeof(buf), &next)) > 0) {
+        if (to_peer) espnow_link_send_ctrl(peer, buf, len);   // ไม่ retry: รอบหน้าก็มีค่าสะสมใหม่
+        if (s_cfg.sink) s_cfg.sink(buf, len, s_cfg.ctx);
+        espnow_metrics_inc(s_frames_tx);
+    }
+    s_seq++;
+}
+
+esp_err_t espnow_metrics_start(const espnow_metrics_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(!s_timer, ESP_ERR_INVALID_STATE, TAG, "already started");
+    s_cfg = *cfg;
+    s_heap_free  = espnow_metrics_gauge("heap_free");
+    s_heap_min   = espnow_metrics_gauge("heap_min");
+    s_frames_tx  = espnow_metrics_counter("stats_tx");
+    if (cfg->period_ms == 0) return ESP_OK;
+
+    const esp_timer_create_args_t targs = { .callback = emit_cb, .name = "metrics" };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&targs, &s_timer), TAG, "timer");
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(s_timer, (uint64_t)cfg->period_ms * 1000), TAG, "timer start");
+    ESP_LOGI(TAG, "📊 stats frame every %" PRIu32 " ms -> %s%s", cfg->period_ms,
+             peer_set(cfg->peer) ? "collector peer" : "no peer", cfg->sink ? " + sink" : "");
+    return ESP_OK;
+}
+
+/* ===================== dump / console ===================== */
+
+void espnow_metrics_dump(void) {
+    espnow_metrics_set(s_heap_free, (int32_t)esp_get_free_heap_size());
+    espnow_metrics_set(s_heap_min, (int32_t)esp_get_minimum_free_heap_size());
+    if (s_cfg.collect) s_cfg.collect();
+
+    int n = atomic_load(&s_count);
+    printf("%-16s %-7s %-4s %12s\n", "name", "kind", "key", "value");
+    for (int i = 0; i < n; i++) {
+        espnow_metric_t *m = &s_m[i];
+        uint32_t v = atomic_load_explicit(&m->value, memory_order_relaxed);
+        if (m->kind == ESPNOW_METRIC_GAUGE) {
+            printf("%-16s %-7s %04x %12" PRId32 "\n", m->name, s_kind_name[m->kind], m->key, (int32_t)v);
+        } else if (m->kind == ESPNOW_METRIC_COUNTER) {
+            printf("%-16s %-7s %04x %12" PRIu32 "\n", m->name, s_kind_name[m->kind], m->key, v);
+        } else {
+            uint64_t sum = hist_sum(m);
+            printf("%-16s %-7s %04x %12" PRIu32 "  mean=%" PRIu64 " |", m->name, s_kind_name[m->kind], m->key, v,
+                   v ? sum / v : 0);
+            for (int b = 0; b < ESPNOW_METRICS_HIST_BUCKETS; b++) {
+                uint32_t c = atomic_load_explicit(&m->bucket[b], memory_order_relaxed);
+                if (b < ESPNOW_METRICS_HIST_BUCKETS - 1) printf(" <%" PRIu32 ":%" PRIu32, m->bounds[b], c);
+                else printf(" >=%" PRIu32 ":%" PRIu32, m->bounds[b - 1], c);
+            }
+            printf("\n");
+        }
+    }
+}
+
+static int cmd_metrics(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "hex") == 0) {
+        uint8_t buf[ESPNOW_METRICS_FRAME_MAX];
+        int next = 0, len;
+        while ((len = espnow_metrics_build(buf, sizeof(buf), &next)) > 0) {
+            for (int i = 0; i < len; i++) printf("%02x", buf[i]);
+            printf("\n");
+        }
+        return 0;
+    }
+    espnow_metrics_dump();
+    return 0;
+}
+
+esp_err_t espnow_metrics_console_init(bool start_repl) {
+    esp_console_repl_t *repl = NULL;
+    if (start_repl) {
+        esp_console_repl_config_t rcfg = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+        rcfg.prompt = "espnow>";
+        esp_console_dev_uart_config_t ucfg = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+        ESP_RETURN_ON_ERROR(esp_console_new_repl_uart(&ucfg, &rcfg, &repl), TAG, "repl");
+    }
+    const esp_console_cmd_t cmd = {
+        .command = "metrics",
+        .help    = "dump runtime metrics ('metrics hex' = binary stats frame)",
+        .func    = cmd_metrics,
+    };
+    ESP_RETURN_ON_ERROR(esp_console_cmd_register(&cmd), TAG, "cmd");
+    if (repl) ESP_RETURN_ON_ERROR(esp_console_start_repl(repl), TAG, "repl start");
+    return ESP_OK;
+}
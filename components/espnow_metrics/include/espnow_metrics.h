@@ -0,0 +1,80 @@
+// components/espnow_metrics/include/espnow_metrics.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ตัวนับ runtime แทนการนับจาก log: counter / gauge / histogram (bucket คงที่)
+   - ลงทะเบียนตอน init (คืน pointer เดิมถ้าชื่อซ้ำ) แล้วอัปเดตจาก task / recv-cb / send-cb ไหนก็ได้
+     ด้วย atomic (32 บิต ยกเว้น sum ของ hist 64 บิต — ไม่มี lock ของเราเอง, ไม่ alloc) — pointer NULL (ตารางเต็ม) = ไม่ทำอะไร
+   - ทุก period_ms สร้าง stats frame ไบนารีส่ง ESP-NOW ไป collector และ/หรือ sink (เช่น serial bridge)
+   - frame ไม่มีชื่อ: key = hash 16 บิตของชื่อ (espnow_metrics_key) — host แปลงกลับจากรายชื่อที่รู้จัก
+     (tools/espnow_bridge.py) — ~7 B ต่อ counter, เฟรมเดียวพอสำหรับ 30 ตัว
+   - console: คำสั่ง "metrics" พิมพ์ตาราง, "metrics hex" พิมพ์เฟรมเป็น hex */
+
+#define ESPNOW_METRICS_MAX          32
+#define ESPNOW_METRICS_HIST_BUCKETS 8       // 7 ขอบบน + ช่องเกิน
+#define ESPNOW_METRICS_VERSION      2       // 2: sum ของ hist เป็น u64
+#define ESPNOW_METRICS_FRAME_MAX    250     // ESP-NOW v1 (เกิน = แบ่งหลายเฟรม)
+
+typedef enum {
+    ESPNOW_METRIC_COUNTER = 0,      // u32 เพิ่มอย่างเดียว (wrap ได้ — host ใช้ผลต่าง)
+    ESPNOW_METRIC_GAUGE   = 1,      // i32 ค่าล่าสุด
+    ESPNOW_METRIC_HIST    = 2,      // u32 x 8 bucket + u64 sum (ค่าเป็น us สะสมเกิน u32 ใน ~72 นาที)
+} espnow_metric_kind_t;
+
+typedef struct espnow_metric espnow_metric_t;
+
+/* stats frame (little-endian): hdr แล้วตามด้วย entry count ตัว
+   entry = key u16, kind u8, ค่า (counter u32 | gauge i32 | hist u32[8] + sum u64) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;           // ESPNOW_MSG_STATS
+    uint8_t  version;
+    uint8_t  count;
+    uint16_t seq;                   // ต่อรอบ (หลายเฟรมในรอบเดียวใช้ seq เดียวกัน)
+    uint8_t  first;                 // index ของ entry แรกในเฟรมนี้ (0 = เฟรมแรกของรอบ)
+    uint32_t uptime_s;
+} espnow_metrics_frame_hdr_t;
+
+typedef void (*espnow_metrics_sink_t)(const uint8_t *frame, int len, void *ctx);
+
+typedef struct {
+    uint32_t period_ms;
+    uint8_t  peer[6];               // collector (ศูนย์ทั้งหมด = ไม่ส่ง ESP-NOW) ต้อง add peer ไว้แล้ว
+    espnow_metrics_sink_t sink;     // NULL = ไม่มี
+    void    *ctx;
+    void   (*collect)(void);        // ก่อนสร้างเฟรม: คัดลอกตัวนับของที่อื่น (espnow_msg, ...) ลง gauge/counter
+} espnow_metrics_config_t;
+
+espnow_metric_t *espnow_metrics_counter(const char *name);
+espnow_metric_t *espnow_metrics_gauge(const char *name);
+/* bounds = ขอบบน (<) ของ 7 bucket แรก เรียงจากน้อยไปมาก */
+espnow_metric_t *espnow_metrics_hist(const char *name, const uint32_t bounds[ESPNOW_METRICS_HIST_BUCKETS - 1]);
+
+void espnow_metrics_inc(espnow_metric_t *m);
+void espnow_metrics_add(espnow_metric_t *m, uint32_t n);
+void espnow_metrics_set(espnow_metric_t *m, int32_t v);
+void espnow_metrics_observe(espnow_metric_t *m, uint32_t v);
+uint32_t espnow_metrics_read(espnow_metric_t *m);    // counter/gauge = ค่า, hist = จำนวน
+
+/* ตั้ง timer ส่งเฟรม (period_ms = 0 = ไม่ส่ง ใช้แค่ console/dump) */
+esp_err_t espnow_metrics_start(const espnow_metrics_config_t *cfg);
+/* ย้าย collector (partner เปลี่ยนจาก discovery) — ต้อง add peer ไว้แล้วเหมือนกัน */
+void      espnow_metrics_set_peer(const uint8_t mac[6]);
+/* สร้างเฟรมจาก metric ลำดับ *next ไปจนเต็ม cap — คืนความยาว (0 = หมดแล้ว) */
+int       espnow_metrics_build(uint8_t *buf, int cap, int *next);
+void      espnow_metrics_dump(void);
+uint16_t  espnow_metrics_key(const char *name);
+/* ลงคำสั่ง "metrics" ใน esp_console — start_repl = เปิด REPL บน UART console ให้ด้วย
+   (อย่าใช้คู่กับ serial bridge บน UART เดียวกัน) */
+esp_err_t espnow_metrics_console_init(bool start_repl);
+
+#ifdef __cplusplus
+}
+#endif
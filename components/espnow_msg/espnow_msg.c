@@ -0,0 +1,49 @@
+// components/espnow_msg/espnow_msg.c
+#include <stdatomic.h>
+#include "espnow_msg.h"
+
+typedef struct {
+    espnow_msg_handler_t handler;
+    uint16_t             frame_len;   // 0 = แปรผัน
+} msg_slot_t;
+
+static msg_slot_t            s_table[ESPNOW_MSG_TYPE_MAX];
+static atomic_uint_least32_t s_unknown;
+static atomic_uint_least32_t s_bad_len;
+
+esp_err_t espnow_msg_register(uint8_t type, uint16_t frame_len, espnow_msg_handler_t handler) {
+    if (type >= ESPNOW_MSG_TYPE_MAX || !handler) return ESP_ERR_INVALID_ARG;
+    if (frame_len != 0 && frame_len < sizeof(espnow_msg_hdr_t)) return ESP_ERR_INVALID_SIZE;
+
+    s_table[type].handler   = handler;
+    s_table[type].frame_len = frame_len;
+    return ESP_OK;
+}
+
+void espnow_msg_dispatch(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (!data || len < (int)sizeof(espnow_msg_hdr_t)) {
+        atomic_fetch_add_explicit(&s_bad_len, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint8_t type = data[0];
+    if (type >= ESPNOW_MSG_TYPE_MAX || !s_table[type].handler) {
+        atomic_fetch_add_explicit(&s_unknown, 1, memory_order_relaxed);
+        return;
+    }
+
+    const msg_slot_t *slot = &s_table[type];
+    if (slot->frame_len != 0 && len != slot->frame_len) {
+        atomic_fetch_add_explicit(&s_bad_len, 1, memory_order_relaxed);
+        return;
+    }
+    slot->handler(info, data, len);
+}
+
+uint32_t espnow_msg_unknown_count(void) {
+    return atomic_load_explicit(&s_unknown, memory_order_relaxed);
+}
+
+uint32_t espnow_msg_bad_len_count(void) {
+    return atomic_load_explicit(&s_bad_len, memory_order_relaxed);
+}
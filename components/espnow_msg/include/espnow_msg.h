@@ -0,0 +1,68 @@
+// components/espnow_msg/include/espnow_msg.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ขนาดตาราง dispatch (static) — type ID ต้อง < ค่านี้ */
+#define ESPNOW_MSG_TYPE_MAX  128
+
+/* type ID ของทุกเฟรมในรีโป (จองช่วงละ 0x10 ต่อกลุ่มแอป) */
+typedef enum {
+    ESPNOW_MSG_NONE       = 0x00,
+    /* LED remote (sender_led / receiver_led) */
+    ESPNOW_MSG_LED_SET    = 0x01,
+    ESPNOW_MSG_LED_ACK    = 0x02,
+    /* chat (challenge3_a / challenge3_b) */
+    ESPNOW_MSG_CHAT       = 0x10,
+    ESPNOW_MSG_CHAT_ACK   = 0x11,
+    /* group broadcast (espnow_broadcaster / group_re) */
+    ESPNOW_MSG_BROADCAST  = 0x20,
+    ESPNOW_MSG_GROUP_ACK  = 0x21,
+    ESPNOW_MSG_GROUP_POLL = 0x22,
+    ESPNOW_MSG_GROUP_NACK = 0x23,
+    ESPNOW_MSG_GROUP_FEC  = 0x24,
+    /* sensor telemetry (sender_data / recever_data) */
+    ESPNOW_MSG_SENSOR     = 0x30,
+    ESPNOW_MSG_SENSOR_BATCH = 0x31,
+    ESPNOW_MSG_SENSOR_SHORT = 0x32,
+    ESPNOW_MSG_SENSOR_HANDLE = 0x33,
+    /* link control ที่ component ร่วมใช้ (espnow_flow, ...) */
+    ESPNOW_MSG_FLOW_CREDIT = 0x40,
+    ESPNOW_MSG_LINK_CAPS   = 0x41,
+    ESPNOW_MSG_LINK_FRAG   = 0x42,
+    ESPNOW_MSG_DISC        = 0x43,
+    ESPNOW_MSG_TDMA_BEACON = 0x44,
+    ESPNOW_MSG_TDMA_JOIN   = 0x45,
+    ESPNOW_MSG_STATS       = 0x46,
+} espnow_msg_type_t;
+
+/* header ร่วมของทุกเฟรม: 1 byte บอกชนิด (แทน char command[20]) */
+typedef struct __attribute__((packed)) {
+    uint8_t type;   // espnow_msg_type_t
+} espnow_msg_hdr_t;
+
+/* handler ได้เฟรมเต็ม (รวม header) ที่ผ่านการเช็กความยาวแล้ว
+   ถูกเรียกใน context ของ Wi-Fi task — ห้าม block นาน */
+typedef void (*espnow_msg_handler_t)(const esp_now_recv_info_t *info, const uint8_t *data, int len);
+
+/* ลงทะเบียน handler ก่อน esp_now_register_recv_cb()
+   frame_len = ขนาดเฟรมที่คาดไว้ (sizeof struct), 0 = ความยาวแปรผัน (>= header) */
+esp_err_t espnow_msg_register(uint8_t type, uint16_t frame_len, espnow_msg_handler_t handler);
+
+/* O(1): อ่าน type แล้วเรียก handler จากตาราง — ใช้เป็น/เรียกจาก recv-cb ได้ตรง ๆ */
+void espnow_msg_dispatch(const esp_now_recv_info_t *info, const uint8_t *data, int len);
+
+/* ตัวนับ (ไม่ log ใน hot path) */
+uint32_t espnow_msg_unknown_count(void);   // type ที่ไม่มี handler
+uint32_t espnow_msg_bad_len_count(void);   // ความยาวไม่ตรงกับที่ลงทะเบียน
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,203 @@
+// components/espnow_replay/espnow_replay.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_partition.h"
+#include "espnow_replay.h"
+
+static const char *TAG = "ESPNOW_REPLAY";
+
+static espnow_replay_config_t s_cfg;
+static const uint8_t         *s_base;       // record แรก
+static const uint8_t         *s_end;        // หลัง record สุดท้ายที่สมบูรณ์
+static uint32_t               s_records;
+static uint16_t               s_rec_hdr_len;
+static TaskHandle_t           s_task;
+
+static espnow_replay_stats_t s_stats;
+static portMUX_TYPE          s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline int hist_bucket(uint32_t us) {
+    int b = 0;
+    while (us && b < ESPNOW_REPLAY_HIST_BUCKETS - 1) { us >>= 1; b++; }
+    return b;
+}
+
+/* เดินทั้งไฟล์ครั้งเดียว: หา record สุดท้ายที่ครบ (ไฟล์ตัดกลาง / flash ว่าง 0xFF = จบ) */
+static esp_err_t scan_capture(const uint8_t *p, size_t len) {
+    const espnow_replay_file_t *fh = (const espnow_replay_file_t *)p;
+    ESP_RETURN_ON_FALSE(len >= sizeof(*fh) && fh->magic == ESPNOW_REPLAY_MAGIC, ESP_ERR_INVALID_ARG,
+                        TAG, "not an .ecap capture");
+    ESP_RETURN_ON_FALSE(fh->version == ESPNOW_REPLAY_VERSION && fh->rec_hdr_len >= sizeof(espnow_replay_rec_t),
+                        ESP_ERR_NOT_SUPPORTED, TAG, "capture v%u (hdr %u)", fh->version, fh->rec_hdr_len);
+
+    s_rec_hdr_len = fh->rec_hdr_len;
+    s_base = p + sizeof(*fh);
+    const uint8_t *q = s_base, *end = p + len;
+    uint64_t first_ts = 0, last_ts = 0;
+    uint32_t n = 0;
+    while (q + s_rec_hdr_len <= end && (fh->records == 0 || n < fh->records)) {
+        espnow_replay_rec_t r;
+        memcpy(&r, q, sizeof(r));
+        if (r.len == 0 || r.len > ESPNOW_REPLAY_SNAPLEN || q + s_rec_hdr_len + r.len > end) break;
+        if (n > 0 && r.ts_us < last_ts) break;      // เวลาถอยหลัง = ขยะต่อท้าย
+        if (n == 0) first_ts = r.ts_us;
+        last_ts = r.ts_us;
+        q += s_rec_hdr_len + r.len;
+        n++;
+    }
+    ESP_RETURN_ON_FALSE(n > 0, ESP_ERR_INVALID_SIZE, TAG, "capture has no records");
+    if (fh->records && n < fh->records) {
+        ESP_LOGW(TAG, "⚠️ capture truncated: %" PRIu32 "/%" PRIu32 " records", n, fh->records);
+    }
+    s_end     = q;
+    s_records = n;
+    ESP_LOGI(TAG, "capture: %" PRIu32 " records, %u bytes, %" PRIu64 ".%03" PRIu64 " s recorded",
+             n, (unsigned)(q - p), (last_ts - first_ts) / 1000000, (last_ts - first_ts) / 1000 % 1000);
+    return ESP_OK;
+}
+
+/* รอจนถึง due: tick ละ vTaskDelay ส่วนเศษต่ำกว่า 1 tick ใช้ busy-wait */
+static void wait_until(int64_t due) {
+    int64_t ahead = due - esp_timer_get_time();
+    const int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    if (ahead > tick_us) {
+        vTaskDelay((TickType_t)((ahead - tick_us) / tick_us));
+        ahead = due - esp_timer_get_time();
+    }
+    if (ahead > 0) esp_rom_delay_us((uint32_t)ahead);
+}
+
+static void log_loop(uint32_t loop, uint32_t frames, int64_t wall_us, uint64_t handler_us) {
+    espnow_replay_stats_t st;
+    espnow_replay_get_stats(&st);
+    ESP_LOGI(TAG, "▶️ loop %" PRIu32 ": %" PRIu32 " frames in %" PRId64 " ms -> %" PRIu64 " fps wall, "
+             "%" PRIu64 " fps handler-only",
+             loop, frames, wall_us / 1000,
+             wall_us > 0 ? (uint64_t)frames * 1000000 / wall_us : 0,
+             handler_us ? (uint64_t)frames * 1000000 / handler_us : 0);
+    ESP_LOGI(TAG, "   handler avg %" PRIu64 " us, max %" PRIu32 " us, pacing late max %" PRIu32 " us",
+             frames ? handler_us / frames : 0, st.handler_max_us, st.late_max_us);
+    for (int b = 0; b < ESPNOW_REPLAY_HIST_BUCKETS; b++) {
+        if (!st.hist[b]) continue;
+        if (b == 0) {
+            ESP_LOGI(TAG, "   %7s us : %" PRIu32, "<1", st.hist[b]);
+        } else if (b == ESPNOW_REPLAY_HIST_BUCKETS - 1) {
+            ESP_LOGI(TAG, "   >=%5u us : %" PRIu32, 1u << (b - 1), st.hist[b]);
+        } else {
+            ESP_LOGI(TAG, "   %3u-%3u us : %" PRIu32, 1u << (b - 1), (1u << b) - 1, st.hist[b]);
+        }
+    }
+}
+
+static void replay_task(void *arg) {
+    static uint8_t buf[ESPNOW_REPLAY_SNAPLEN];   // copy ออกจาก flash mmap: handler อาจแก้ / เก็บ pointer
+    uint8_t src[6], dst[6] = {0};
+    wifi_pkt_rx_ctrl_t rx_ctrl = {0};
+    esp_now_recv_info_t info = { .src_addr = src, .des_addr = dst, .rx_ctrl = &rx_ctrl };
+
+    vTaskDelay(pdMS_TO_TICKS(s_cfg.start_delay_ms));
+    if (s_cfg.speed_pct) {
+        ESP_LOGW(TAG, "🔁 replay %" PRIu32 " frames @ %u%% speed, %u loop(s)",
+                 s_records, s_cfg.speed_pct, s_cfg.loops);
+    } else {
+        ESP_LOGW(TAG, "🔁 replay %" PRIu32 " frames ASAP, %u loop(s)", s_records, s_cfg.loops);
+    }
+
+    for (uint32_t loop = 1; s_cfg.loops == 0 || loop <= s_cfg.loops; loop++) {
+        const uint8_t *q = s_base;
+        uint64_t ts0 = 0, handler_us = 0;
+        uint32_t frames = 0;
+        int64_t  t0 = esp_timer_get_time();
+
+        while (q < s_end) {
+            espnow_replay_rec_t r;
+            memcpy(&r, q, sizeof(r));
+            memcpy(buf, q + s_rec_hdr_len, r.len);
+            q += s_rec_hdr_len + r.len;
+            if (frames == 0) ts0 = r.ts_us;
+
+            uint32_t late = 0;
+            if (s_cfg.speed_pct) {
+                int64_t due = t0 + (int64_t)((r.ts_us - ts0) * 100 / s_cfg.speed_pct);
+                wait_until(due);
+                int64_t now = esp_timer_get_time();
+                late = now > due ? (uint32_t)(now - due) : 0;
+            } else if (frames && frames % ESPNOW_REPLAY_YIELD_EVERY == 0) {
+                vTaskDelay(1);
+            }
+
+            memcpy(src, r.mac, 6);
+            rx_ctrl.rssi    = r.rssi;
+            rx_ctrl.channel = r.channel;
+            int64_t h0 = esp_timer_get_time();
+            s_cfg.recv(&info, buf, r.len);
+            uint32_t dt = (uint32_t)(esp_timer_get_time() - h0);
+            handler_us += dt;
+            frames++;
+
+            portENTER_CRITICAL(&s_lock);
+            s_stats.frames++;
+            s_stats.bytes      += r.len;
+            s_stats.handler_us += dt;
+            if (dt > s_stats.handler_max_us) s_stats.handler_max_us = dt;
+            if (late > s_stats.late_max_us) s_stats.late_max_us = late;
+            s_stats.hist[hist_bucket(dt)]++;
+            portEXIT_CRITICAL(&s_lock);
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        s_stats.loops = loop;
+        portEXIT_CRITICAL(&s_lock);
+        log_loop(loop, frames, esp_timer_get_time() - t0, handler_us);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.running = false;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "replay done");
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t espnow_replay_start(const espnow_replay_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->recv, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(!s_task, ESP_ERR_INVALID_STATE, TAG, "already running");
+    s_cfg = *cfg;
+
+    const uint8_t *p = cfg->data;
+    size_t len = cfg->len;
+    if (!p) {
+        ESP_RETURN_ON_FALSE(cfg->partition, ESP_ERR_INVALID_ARG, TAG, "no data / partition");
+        const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                               ESP_PARTITION_SUBTYPE_ANY, cfg->partition);
+        ESP_RETURN_ON_FALSE(part, ESP_ERR_NOT_FOUND, TAG, "partition '%s' not found", cfg->partition);
+        // map ค้างไว้ตลอด (อ่านอย่างเดียว ไม่ต้อง copy ทั้งไฟล์ลง RAM)
+        esp_partition_mmap_handle_t h;
+        ESP_RETURN_ON_ERROR(esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA,
+                                               (const void **)&p, &h), TAG, "mmap");
+        len = part->size;
+    }
+    ESP_RETURN_ON_ERROR(scan_capture(p, len), TAG, "capture");
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.running = true;
+    ESP_RETURN_ON_FALSE(xTaskCreate(replay_task, "espnow_replay", 4096, NULL, cfg->priority, &s_task) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    return ESP_OK;
+}
+
+void espnow_replay_get_stats(espnow_replay_stats_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool espnow_replay_running(void) {
+    return s_task != NULL;
+}
@@ -0,0 +1,75 @@
+// components/espnow_replay/include/espnow_replay.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* replay: เล่นไฟล์ capture (.ecap) เข้า recv-cb ของ app ตรง ๆ (เหมือน Wi-Fi task เรียก)
+   -> bug / regression ของ handler ทำซ้ำได้ทุกครั้งด้วย traffic ชุดเดิม ไม่ต้องมีบอร์ดส่งจริง
+   - ได้ capture จาก serial bridge (tools/espnow_capture.py convert) หรือสร้างเอง (... synth)
+   - แหล่ง: buffer ใน RAM/flash (EMBED_FILES) หรือ data partition ที่เขียนด้วย parttool.py
+   - speed_pct: 100 = จังหวะเดิมตาม ts_us, 1000 = เร็ว 10 เท่า, 0 = เร็วที่สุด (วัด throughput)
+   - จบแต่ละรอบ: frame/s, เวลาใน handler (avg/max + histogram log2), pacing ช้าสุดกี่ us */
+
+/* ไฟล์ = file hdr + [rec hdr + payload]... (little-endian, แนว pcap) */
+#define ESPNOW_REPLAY_MAGIC         0x50434E45u    // "ENCP"
+#define ESPNOW_REPLAY_VERSION       1
+#define ESPNOW_REPLAY_SNAPLEN       1470           // ESP-NOW v2
+#define ESPNOW_REPLAY_YIELD_EVERY   64             // ASAP: ปล่อย CPU ทุก N เฟรม (กัน task watchdog)
+#define ESPNOW_REPLAY_HIST_BUCKETS  12             // <1, <2, <4 ... >=1024 us
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_hdr_len;           // sizeof(espnow_replay_rec_t) — เผื่อขยาย field ท้าย
+    uint32_t snaplen;
+    uint32_t records;               // 0 = ไม่รู้ (อ่านจนเจอ record เสีย / flash ว่าง)
+} espnow_replay_file_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t ts_us;                 // เวลาที่รับ (esp_timer ของเครื่องที่ capture)
+    uint8_t  mac[6];
+    int8_t   rssi;
+    uint8_t  channel;
+    uint16_t len;
+} espnow_replay_rec_t;
+
+typedef struct {
+    const void *data;               // capture ทั้งไฟล์ (NULL = ใช้ partition)
+    size_t      len;
+    const char *partition;          // label ของ data partition (ถ้า data == NULL)
+    esp_now_recv_cb_t recv;         // receive path ของ app (เช่น on_data_recv, espnow_msg_dispatch)
+    uint16_t    speed_pct;
+    uint16_t    loops;              // 0 = วนไม่จบ
+    uint8_t     priority;
+    uint32_t    start_delay_ms;     // รอ app init เสร็จก่อนเริ่มยิง
+} espnow_replay_config_t;
+
+#define ESPNOW_REPLAY_CONFIG_DEFAULT() { \
+    .data = NULL, .len = 0, .partition = "replay", .recv = NULL, \
+    .speed_pct = 100, .loops = 1, .priority = 23, .start_delay_ms = 1000 }
+
+typedef struct {
+    uint32_t loops;
+    uint32_t frames;                // สะสมทุกรอบ
+    uint64_t bytes;
+    uint64_t handler_us;            // เวลารวมใน recv-cb
+    uint32_t handler_max_us;
+    uint32_t late_max_us;           // ยิงช้ากว่ากำหนดสุด (speed_pct > 0)
+    uint32_t hist[ESPNOW_REPLAY_HIST_BUCKETS];
+    bool     running;
+} espnow_replay_stats_t;
+
+esp_err_t espnow_replay_start(const espnow_replay_config_t *cfg);
+void      espnow_replay_get_stats(espnow_replay_stats_t *out);
+bool      espnow_replay_running(void);
+
+#ifdef __cplusplus
+}
+#endif
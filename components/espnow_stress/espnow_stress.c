@@ -0,0 +1,105 @@
+// components/espnow_stress/espnow_stress.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "espnow_stress.h"
+
+static const char *TAG = "ESPNOW_STRESS";
+
+static const uint8_t PREFIX[3] = ESPNOW_STRESS_MAC_PREFIX;
+
+static espnow_stress_config_t s_cfg;
+static TaskHandle_t           s_task;
+
+bool espnow_stress_is_synthetic(const uint8_t mac[6]) {
+    return mac && memcmp(mac, PREFIX, 3) == 0;
+}
+
+static void stress_task(void *arg) {
+    static uint8_t buf[250];
+    uint8_t src[6] = { PREFIX[0], PREFIX[1], PREFIX[2], 0, 0, 0 };
+    uint8_t dst[6] = {0};
+    wifi_pkt_rx_ctrl_t rx_ctrl = {0};
+    rx_ctrl.rssi = -50;
+    esp_now_recv_info_t info = { .src_addr = src, .des_addr = dst, .rx_ctrl = &rx_ctrl };
+
+    uint32_t seq = 0, capacity_fps = 0;
+    int      senders = s_cfg.senders_start, next_sender = 0;
+    bool     saturated = false;
+
+    espnow_stress_probe_t p0;
+    s_cfg.probe(&p0, true);
+    int64_t step_start = esp_timer_get_time(), next_due = step_start;
+    uint32_t step_injected = 0;
+
+    ESP_LOGI(TAG, " senders | offered fps | ingest fps | drop %% | q hwm | rx busy %%");
+    while (1) {
+        int64_t now    = esp_timer_get_time();
+        int64_t gap_us = (int64_t)s_cfg.interval_ms * 1000 / (senders > 0 ? senders : 1);
+        if (gap_us < 1) gap_us = 1;
+
+        // ยิงทุกเฟรมที่ถึงเวลาแล้ว (ไม่เกิน MAX_BURST ต่อ tick -> ไม่กิน CPU จน watchdog)
+        for (int n = 0; n < ESPNOW_STRESS_MAX_BURST && next_due <= now; n++) {
+            src[4] = (uint8_t)(next_sender >> 8);
+            src[5] = (uint8_t)next_sender;
+            int len = s_cfg.build(next_sender, ++seq, buf, sizeof(buf));
+            if (len > 0) s_cfg.recv(&info, buf, len);
+            step_injected++;
+            next_sender = (next_sender + 1) % senders;
+            next_due += gap_us;
+        }
+        if (next_due < now - 1000000) next_due = now;   // ตามไม่ทันจริง ๆ ไม่ต้องไล่ย้อน
+
+        if (now - step_start >= (int64_t)s_cfg.step_ms * 1000) {
+            espnow_stress_probe_t p1;
+            s_cfg.probe(&p1, true);
+            int64_t  dt_us   = now - step_start;
+            uint32_t offered = (uint32_t)((uint64_t)step_injected * 1000000 / dt_us);
+            uint32_t ingest  = (uint32_t)((uint64_t)(p1.processed - p0.processed) * 1000000 / dt_us);
+            uint32_t drops   = p1.dropped - p0.dropped;
+            uint32_t drop_pct = step_injected ? drops * 100 / step_injected : 0;
+            uint32_t busy_pct = (uint32_t)((p1.busy_us - p0.busy_us) * 100 / dt_us);
+            ESP_LOGI(TAG, " %7d | %11" PRIu32 " | %10" PRIu32 " | %6" PRIu32 " | %5" PRIu32 " | %" PRIu32,
+                     senders, offered, ingest, drop_pct, p1.queue_hwm, busy_pct);
+
+            if (!saturated && (drop_pct > ESPNOW_STRESS_SAT_DROP_PCT || busy_pct > ESPNOW_STRESS_SAT_BUSY_PCT)) {
+                saturated = true;
+                ESP_LOGW(TAG, "⚠️ saturated at %d senders (%" PRIu32 " fps offered) -> capacity ~%" PRIu32 " fps",
+                         senders, offered, capacity_fps ? capacity_fps : ingest);
+            } else if (!saturated) {
+                capacity_fps = ingest;
+            }
+
+            if (senders + s_cfg.senders_step > s_cfg.senders_max || s_cfg.senders_step == 0) {
+                ESP_LOGI(TAG, "done: %" PRIu32 " frames injected, capacity ~%" PRIu32 " fps%s",
+                         seq, capacity_fps, saturated ? "" : " (not saturated)");
+                s_task = NULL;
+                vTaskDelete(NULL);
+            }
+            senders   += s_cfg.senders_step;
+            p0         = p1;
+            step_start = now;
+            step_injected = 0;
+        }
+        vTaskDelay(1);
+    }
+}
+
+esp_err_t espnow_stress_start(const espnow_stress_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->recv && cfg->build && cfg->probe, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(cfg->senders_start > 0 && cfg->interval_ms > 0 && cfg->step_ms > 0,
+                        ESP_ERR_INVALID_ARG, TAG, "rates");
+    ESP_RETURN_ON_FALSE(!s_task, ESP_ERR_INVALID_STATE, TAG, "already running");
+    s_cfg = *cfg;
+
+    ESP_LOGW(TAG, "🔥 stress: %u..%u senders (+%u every %" PRIu32 " ms), 1 frame / %" PRIu32 " ms each",
+             cfg->senders_start, cfg->senders_max, cfg->senders_step, cfg->step_ms, cfg->interval_ms);
+    // priority เท่า Wi-Fi task (23) -> แย่ง CPU กับ consumer เหมือนของจริง
+    ESP_RETURN_ON_FALSE(xTaskCreate(stress_task, "espnow_stress", 4096, NULL, 23, &s_task) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    return ESP_OK;
+}
@@ -0,0 +1,54 @@
+// components/espnow_stress/include/espnow_stress.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* stress harness สำหรับ gateway: สร้าง sender ปลอม N ตัว แล้วยิงเฟรมเข้า recv-cb ตรง ๆ
+   (เหมือน Wi-Fi task เรียก) — ไม่ต้องมีบอร์ดหลายร้อยตัว
+   - เพิ่มจำนวน sender ทีละ step ทุก step_ms จนถึง senders_max
+   - ทุก step พิมพ์ offered/ingest fps, drop %, queue high-water, rx busy %
+   - step แรกที่ drop > SAT_DROP_PCT หรือ busy > SAT_BUSY_PCT = จุดอิ่มตัว -> log ความจุ */
+
+#define ESPNOW_STRESS_SAT_DROP_PCT  1
+#define ESPNOW_STRESS_SAT_BUSY_PCT  95
+#define ESPNOW_STRESS_MAX_BURST     32      // เฟรมสูงสุดต่อ tick (ไล่ตามเวลาที่เลยมา)
+
+/* MAC ปลอม: 02:53:54:00:hi:lo (locally administered) */
+#define ESPNOW_STRESS_MAC_PREFIX    {0x02, 0x53, 0x54}
+
+/* ค่าสะสมที่ app วัดเองฝั่ง receiver (harness เอาไปคิดเป็นต่อ step) */
+typedef struct {
+    uint32_t processed;             // เฟรมที่ consumer ทำเสร็จ
+    uint32_t dropped;               // ทิ้งเพราะคิวเต็ม
+    uint32_t queue_hwm;             // คิวลึกสุด (harness reset ผ่าน probe(reset=true))
+    uint64_t busy_us;               // เวลาที่ consumer ทำงาน (ไม่นับรอคิว)
+} espnow_stress_probe_t;
+
+/* สร้างเฟรมของ sender idx (seq เพิ่มทีละ 1 ทั้ง harness) คืนความยาว */
+typedef int  (*espnow_stress_build_fn_t)(int sender, uint32_t seq, uint8_t *buf, int max);
+typedef void (*espnow_stress_probe_fn_t)(espnow_stress_probe_t *out, bool reset_hwm);
+
+typedef struct {
+    uint16_t senders_start;
+    uint16_t senders_step;
+    uint16_t senders_max;
+    uint32_t interval_ms;           // ต่อ sender
+    uint32_t step_ms;
+    esp_now_recv_cb_t        recv;  // receive path ของ app (เช่น on_data_recv)
+    espnow_stress_build_fn_t build;
+    espnow_stress_probe_fn_t probe;
+} espnow_stress_config_t;
+
+esp_err_t espnow_stress_start(const espnow_stress_config_t *cfg);
+bool      espnow_stress_is_synthetic(const uint8_t mac[6]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,332 @@
+// components/espnow_tdma/espnow_tdma.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "link_track.h"
+#include "espnow_tdma.h"
+
+static const char *TAG = "ESPNOW_TDMA";
+
+static const uint8_t BCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static esp_err_t add_peer(const uint8_t mac[6]) {
+    if (esp_now_is_peer_exist(mac)) return ESP_OK;
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.ifidx   = WIFI_IF_STA;
+    peer.channel = 0;   // channel ปัจจุบัน
+    peer.encrypt = false;
+    return esp_now_add_peer(&peer);
+}
+
+/* ===================== gateway ===================== */
+
+typedef struct {
+    bool    used;
+    uint8_t mac[6];
+    uint8_t fresh;      // beacon ที่เหลือที่ต้องประกาศก่อน
+    uint8_t idle;       // superframe ติดกันที่ไม่ได้เฟรม
+    uint8_t rx;         // เฟรมใน superframe นี้
+} gw_slot_t;
+
+static espnow_tdma_gw_config_t s_gw_cfg;
+static gw_slot_t               s_gw_slots[ESPNOW_TDMA_MAX_SLOTS];
+static espnow_tdma_gw_stats_t  s_gw_stats;
+static portMUX_TYPE            s_gw_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t                s_gw_epoch;
+static int64_t                 s_gw_sf_start_us;
+static int                     s_gw_cursor;      // หน้าถัดไปของ assignment เก่า
+static esp_timer_handle_t      s_gw_timer;
+
+static inline int gw_data_slots(void) {
+    return s_gw_cfg.n_slots - ESPNOW_TDMA_JOIN_SLOTS;
+}
+
+static int gw_find(const uint8_t mac[6]) {
+    for (int i = 0; i < gw_data_slots(); i++) {
+        if (s_gw_slots[i].used && memcmp(s_gw_slots[i].mac, mac, 6) == 0) return i;
+    }
+    return -1;
+}
+
+/* ESPNOW_MSG_TDMA_JOIN (Wi-Fi task) — slot ว่างตัวแรก, ประกาศใน beacon ถัดไป */
+static void on_join(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    portENTER_CRITICAL(&s_gw_lock);
+    int slot = gw_find(info->src_addr);
+    for (int i = 0; i < gw_data_slots() && slot < 0; i++) {
+        if (s_gw_slots[i].used) continue;
+        slot = i;
+        s_gw_slots[i].used = true;
+        memcpy(s_gw_slots[i].mac, info->src_addr, 6);
+        s_gw_slots[i].idle = 0;
+        s_gw_slots[i].rx   = 0;
+        s_gw_stats.assigned++;
+    }
+    if (slot >= 0) {
+        s_gw_slots[slot].fresh = ESPNOW_TDMA_FRESH_SF;
+        s_gw_stats.joins++;
+    } else {
+        s_gw_stats.join_full++;
+    }
+    portEXIT_CRITICAL(&s_gw_lock);
+}
+
+/* ปิดบัญชี superframe ที่จบ แล้วสร้าง beacon ของรอบใหม่ (เรียกใน lock) */
+static int gw_close_and_build(espnow_tdma_beacon_t *b) {
+    s_gw_stats.superframes++;
+    for (int i = 0; i < gw_data_slots(); i++) {
+        gw_slot_t *s = &s_gw_slots[i];
+        if (!s->used) continue;
+        s_gw_stats.expected++;
+        if (s->rx) {
+            s_gw_stats.received++;
+            s->idle = 0;
+        } else if (s->fresh == 0 && ++s->idle >= ESPNOW_TDMA_LEAVE_SF) {
+            s->used = false;   // node หายไป -> คืน slot
+            s_gw_stats.assigned--;
+            s_gw_stats.leaves++;
+        }
+        s->rx = 0;
+    }
+
+    b->hdr.type = ESPNOW_MSG_TDMA_BEACON;
+    b->epoch    = ++s_gw_epoch;
+    b->slot_ms  = s_gw_cfg.slot_ms;
+    b->n_slots  = s_gw_cfg.n_slots;
+    int n = 0;
+
+    // assignment ใหม่ก่อน (node ที่เพิ่ง JOIN รออยู่)
+    for (int i = 0; i < gw_data_slots() && n < ESPNOW_TDMA_BEACON_ENTRIES; i++) {
+        gw_slot_t *s = &s_gw_slots[i];
+        if (!s->used || s->fresh == 0) continue;
+        s->fresh--;
+        memcpy(b->entries[n].mac, s->mac, 6);
+        b->entries[n].slot = (uint16_t)i;
+        n++;
+    }
+    // ที่เหลือวนทีละหน้า: node ที่ slot ถูกให้คนอื่นจะรู้ตัว
+    for (int k = 0; k < gw_data_slots() && n < ESPNOW_TDMA_BEACON_ENTRIES; k++) {
+        int i = s_gw_cursor;
+        s_gw_cursor = (s_gw_cursor + 1) % gw_data_slots();
+        gw_slot_t *s = &s_gw_slots[i];
+        if (!s->used || s->fresh != 0) continue;
+        memcpy(b->entries[n].mac, s->mac, 6);
+        b->entries[n].slot = (uint16_t)i;
+        n++;
+    }
+    b->n_entries = (uint8_t)n;
+    return n;
+}
+
+static void gw_beacon_cb(void *arg) {
+    static espnow_tdma_beacon_t b;
+    portENTER_CRITICAL(&s_gw_lock);
+    int n = gw_close_and_build(&b);
+    s_gw_sf_start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_gw_lock);
+
+    esp_err_t er = esp_now_send(BCAST, (const uint8_t *)&b, ESPNOW_TDMA_BEACON_LEN(n));
+    if (er != ESP_OK) ESP_LOGW(TAG, "beacon send failed: %s", esp_err_to_name(er));
+}
+
+esp_err_t espnow_tdma_gw_init(const espnow_tdma_gw_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg && cfg->slot_ms > 0, ESP_ERR_INVALID_ARG, TAG, "cfg");
+    ESP_RETURN_ON_FALSE(cfg->n_slots > ESPNOW_TDMA_JOIN_SLOTS && cfg->n_slots <= ESPNOW_TDMA_MAX_SLOTS,
+                        ESP_ERR_INVALID_ARG, TAG, "n_slots");
+    ESP_RETURN_ON_FALSE(!s_gw_timer, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    s_gw_cfg = *cfg;
+
+    ESP_RETURN_ON_ERROR(add_peer(BCAST), TAG, "broadcast peer");
+    ESP_RETURN_ON_ERROR(espnow_msg_register(ESPNOW_MSG_TDMA_JOIN, sizeof(espnow_tdma_join_t), on_join), TAG, "register");
+
+    const esp_timer_create_args_t args = {
+        .callback = gw_beacon_cb,
+        .name     = "tdma_beacon",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_gw_timer), TAG, "timer create");
+    uint64_t sf_us = (uint64_t)(cfg->n_slots + 1) * cfg->slot_ms * 1000;
+    s_gw_sf_start_us = esp_timer_get_time();
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(s_gw_timer, sf_us), TAG, "timer start");
+    ESP_LOGI(TAG, "gateway: %u slots x %u ms (superframe %" PRIu64 " ms, %d data slots)",
+             cfg->n_slots, cfg->slot_ms, sf_us / 1000, gw_data_slots());
+    return ESP_OK;
+}
+
+void espnow_tdma_gw_on_rx(const uint8_t src[6]) {
+    if (!s_gw_timer || !src) return;
+    int64_t now = esp_timer_get_time();
+    int64_t slot_us = (int64_t)s_gw_cfg.slot_ms * 1000;
+
+    portENTER_CRITICAL(&s_gw_lock);
+    int slot = gw_find(src);
+    if (slot < 0) {
+        s_gw_stats.unscheduled++;
+    } else {
+        s_gw_slots[slot].rx++;
+        int64_t off   = now - s_gw_sf_start_us;
+        int64_t start = (slot + 1) * slot_us;
+        if (off >= start && off < start + slot_us + ESPNOW_TDMA_GUARD_US) s_gw_stats.in_slot++;
+        else                                                            s_gw_stats.off_slot++;
+    }
+    portEXIT_CRITICAL(&s_gw_lock);
+}
+
+void espnow_tdma_gw_get_stats(espnow_tdma_gw_stats_t *out) {
+    portENTER_CRITICAL(&s_gw_lock);
+    *out = s_gw_stats;
+    portEXIT_CRITICAL(&s_gw_lock);
+}
+
+void espnow_tdma_gw_report(void) {
+    espnow_tdma_gw_stats_t st;
+    espnow_tdma_gw_get_stats(&st);
+    uint32_t capacity = st.superframes * (s_gw_cfg.n_slots - ESPNOW_TDMA_JOIN_SLOTS);
+    ESP_LOGI(TAG, "📊 gw: sf=%" PRIu32 " nodes=%" PRIu32 " joins=%" PRIu32 " full=%" PRIu32 " leaves=%" PRIu32,
+             st.superframes, st.assigned, st.joins, st.join_full, st.leaves);
+    ESP_LOGI(TAG, "📊 gw: loss=%" PRIu32 "/%" PRIu32 " in_slot=%" PRIu32 " off_slot=%" PRIu32
+             " unscheduled=%" PRIu32 " util=%" PRIu32 "%%",
+             st.expected - st.received, st.expected, st.in_slot, st.off_slot, st.unscheduled,
+             capacity ? st.received * 100 / capacity : 0);
+}
+
+/* ===================== node ===================== */
+
+static uint8_t                  s_node_gw[6];
+static espnow_tdma_node_stats_t s_node_stats = { .slot = -1 };
+static portMUX_TYPE             s_node_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t        s_node_beacon;
+static int64_t                  s_node_beacon_us = -1;   // เวลาที่รับ beacon ล่าสุด
+static uint32_t                 s_node_epoch;
+static uint8_t                  s_node_mac[6];
+
+/* ESPNOW_MSG_TDMA_BEACON (Wi-Fi task) */
+static void on_beacon(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    int64_t now = esp_timer_get_time();
+    const espnow_tdma_beacon_t *b = (const espnow_tdma_beacon_t *)data;
+    if (memcmp(info->src_addr, s_node_gw, 6) != 0) return;
+    if (len < (int)ESPNOW_TDMA_BEACON_LEN(0) || b->n_entries > ESPNOW_TDMA_BEACON_ENTRIES ||
+        len < (int)ESPNOW_TDMA_BEACON_LEN(b->n_entries) || b->slot_ms == 0 ||
+        b->n_slots <= ESPNOW_TDMA_JOIN_SLOTS || b->n_slots > ESPNOW_TDMA_MAX_SLOTS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_node_lock);
+    espnow_tdma_node_stats_t *st = &s_node_stats;
+    // gateway รีบูต (epoch เริ่มใหม่) หรือเปลี่ยนรูปแบบ superframe -> slot เดิมใช้ไม่ได้
+    if (st->slot >= 0 && (b->epoch < s_node_epoch || b->n_slots != st->n_slots || b->slot_ms != st->slot_ms)) {
+        st->slot = -1;
+        st->evictions++;
+    }
+    if (s_node_epoch && b->epoch > s_node_epoch + 1) st->missed += b->epoch - s_node_epoch - 1;
+    for (int i = 0; i < b->n_entries; i++) {
+        const espnow_tdma_entry_t *e = &b->entries[i];
+        if (memcmp(e->mac, s_node_mac, 6) == 0) {
+            st->slot = e->slot;
+        } else if (e->slot == st->slot) {
+            st->slot = -1;   // slot เราเป็นของคนอื่นแล้ว
+            st->evictions++;
+        }
+    }
+    st->beacons++;
+    st->slot_ms  = b->slot_ms;
+    st->n_slots  = b->n_slots;
+    s_node_epoch     = b->epoch;
+    s_node_beacon_us = now;
+    portEXIT_CRITICAL(&s_node_lock);
+
+    xSemaphoreGive(s_node_beacon);
+}
+
+esp_err_t espnow_tdma_node_init(const uint8_t gw_mac[6]) {
+    ESP_RETURN_ON_FALSE(gw_mac, ESP_ERR_INVALID_ARG, TAG, "gw_mac");
+    ESP_RETURN_ON_FALSE(!s_node_beacon, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    memcpy(s_node_gw, gw_mac, 6);
+    ESP_RETURN_ON_ERROR(esp_wifi_get_mac(WIFI_IF_STA, s_node_mac), TAG, "get mac");
+    ESP_RETURN_ON_ERROR(add_peer(gw_mac), TAG, "gateway peer");
+
+    s_node_beacon = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(s_node_beacon, ESP_ERR_NO_MEM, TAG, "sem");
+    return espnow_msg_register(ESPNOW_MSG_TDMA_BEACON, 0, on_beacon);
+}
+
+static void sleep_until(int64_t t_us) {
+    int64_t now = esp_timer_get_time();
+    if (t_us > now) vTaskDelay(pdMS_TO_TICKS((t_us - now) / 1000) + 1);
+}
+
+esp_err_t espnow_tdma_node_wait_slot(uint32_t timeout_ms) {
+    ESP_RETURN_ON_FALSE(s_node_beacon, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&s_node_lock);
+        int      slot   = s_node_stats.slot;
+        int64_t  bcn    = s_node_beacon_us;
+        int64_t  slot_us = (int64_t)s_node_stats.slot_ms * 1000;
+        int64_t  sf_us  = (int64_t)(s_node_stats.n_slots + 1) * slot_us;
+        uint32_t epoch  = s_node_epoch;
+        uint16_t n_slots = s_node_stats.n_slots;
+        portEXIT_CRITICAL(&s_node_lock);
+
+        if (bcn >= 0 && now - bcn < ESPNOW_TDMA_MAX_MISSED * sf_us) {
+            if (slot >= 0) {
+                // ต้น slot ถัดไป (ยังอยู่ใน slot ก็ส่งได้เลยถ้าเหลือเวลาพอ)
+                int64_t start = bcn + (slot + 1) * slot_us + ESPNOW_TDMA_GUARD_US;
+                while (start + slot_us - 2 * ESPNOW_TDMA_GUARD_US < now) start += sf_us;
+                if (start > deadline) return ESP_ERR_TIMEOUT;
+                if (start - bcn < ESPNOW_TDMA_MAX_MISSED * sf_us) {
+                    sleep_until(start);
+                    portENTER_CRITICAL(&s_node_lock);
+                    s_node_stats.slots_used++;
+                    portEXIT_CRITICAL(&s_node_lock);
+                    return ESP_OK;
+                }
+            } else {
+                // ยังไม่มี slot: JOIN ใน join slot แบบสุ่มของ superframe นี้
+                int     js    = n_slots - ESPNOW_TDMA_JOIN_SLOTS + (int)(esp_random() % ESPNOW_TDMA_JOIN_SLOTS);
+                int64_t start = bcn + (js + 1) * slot_us + ESPNOW_TDMA_GUARD_US;
+                if (start > now && start < deadline) {
+                    sleep_until(start);
+                    espnow_tdma_join_t j = { .hdr.type = ESPNOW_MSG_TDMA_JOIN, .epoch = epoch };
+                    // gateway เป็น peer ที่แอป track อยู่ -> ผ่าน tracker ไม่ให้ cb ของ JOIN ไปจับคู่เฟรมข้อมูล
+                    if (espnow_link_send_ctrl(s_node_gw, &j, sizeof(j)) == ESP_OK) {
+                        portENTER_CRITICAL(&s_node_lock);
+                        s_node_stats.joins_tx++;
+                        portEXIT_CRITICAL(&s_node_lock);
+                    }
+                }
+            }
+        }
+
+        // รอ beacon ถัดไป (ได้ slot / sync ใหม่)
+        now = esp_timer_get_time();
+        if (now >= deadline) return ESP_ERR_TIMEOUT;
+        xSemaphoreTake(s_node_beacon, 0);   // ทิ้ง beacon ที่ใช้ไปแล้ว
+        if (xSemaphoreTake(s_node_beacon, pdMS_TO_TICKS((deadline - now) / 1000) + 1) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+void espnow_tdma_node_get_stats(espnow_tdma_node_stats_t *out) {
+    portENTER_CRITICAL(&s_node_lock);
+    *out = s_node_stats;
+    portEXIT_CRITICAL(&s_node_lock);
+}
+
+void espnow_tdma_node_report(void) {
+    espnow_tdma_node_stats_t st;
+    espnow_tdma_node_get_stats(&st);
+    ESP_LOGI(TAG, "📊 node: slot=%d/%u (%u ms) beacons=%" PRIu32 " missed=%" PRIu32 " joins=%" PRIu32
+             " evictions=%" PRIu32 " tx_slots=%" PRIu32,
+             st.slot, st.n_slots, st.slot_ms, st.beacons, st.missed, st.joins_tx, st.evictions, st.slots_used);
+}
@@ -0,0 +1,100 @@
+// components/espnow_tdma/include/espnow_tdma.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "espnow_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* TDMA แบบมี beacon: gateway broadcast beacon ทุก superframe พร้อมตาราง slot
+   superframe = [beacon][slot 0][slot 1]...[slot N-1]  แต่ละ slot ยาว slot_ms
+   - node ไม่มี slot -> ส่ง JOIN ใน slot ท้าย ๆ (JOIN_SLOTS ช่อง, สุ่มเลือก) แล้วรอ beacon ถัดไป
+   - node ส่งเฉพาะใน slot ตัวเอง นับเวลาจาก beacon ที่รับล่าสุด (พลาด beacon ได้ MAX_MISSED รอบ)
+   - slot ที่เงียบ LEAVE_SF superframe ติดกันถูกคืน; node ที่เห็น slot ตัวเองเป็นของคนอื่น -> JOIN ใหม่
+   beacon ใส่ได้ BEACON_ENTRIES รายการ: assignment ใหม่มาก่อน ที่เหลือวนทีละหน้า */
+
+#define ESPNOW_TDMA_MAX_SLOTS       128
+#define ESPNOW_TDMA_JOIN_SLOTS      4       // slot ท้าย superframe สำหรับ JOIN (แย่งกัน)
+#define ESPNOW_TDMA_BEACON_ENTRIES  29      // (250 - header) / sizeof(entry)
+#define ESPNOW_TDMA_GUARD_US        2000    // เริ่มส่งหลังต้น slot เท่านี้ (beacon jitter)
+#define ESPNOW_TDMA_MAX_MISSED      3       // ใช้ beacon เก่าได้กี่ superframe
+#define ESPNOW_TDMA_LEAVE_SF        3       // เงียบกี่ superframe -> คืน slot
+#define ESPNOW_TDMA_FRESH_SF        2       // assignment ใหม่อยู่หน้า beacon กี่รอบ
+
+typedef struct __attribute__((packed)) {
+    uint8_t  mac[6];
+    uint16_t slot;
+} espnow_tdma_entry_t;
+
+/* Gateway -> broadcast */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;           // ESPNOW_MSG_TDMA_BEACON
+    uint32_t epoch;                 // เลข superframe (เริ่ม 1 ทุกครั้งที่ gateway บูต)
+    uint16_t slot_ms;
+    uint16_t n_slots;               // รวม JOIN slot
+    uint8_t  n_entries;
+    espnow_tdma_entry_t entries[ESPNOW_TDMA_BEACON_ENTRIES];
+} espnow_tdma_beacon_t;
+
+#define ESPNOW_TDMA_BEACON_LEN(n) (offsetof(espnow_tdma_beacon_t, entries) + (n) * sizeof(espnow_tdma_entry_t))
+
+/* Node -> gateway (unicast) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;           // ESPNOW_MSG_TDMA_JOIN
+    uint32_t epoch;                 // beacon ที่เห็นล่าสุด
+} espnow_tdma_join_t;
+
+/* ---- gateway ---- */
+typedef struct {
+    uint16_t slot_ms;
+    uint16_t n_slots;               // รวม JOIN slot, <= MAX_SLOTS
+} espnow_tdma_gw_config_t;
+
+/* 40 ms x (124 + beacon) = 5 s = TX_INTERVAL_MS เดิมของ sender_data */
+#define ESPNOW_TDMA_GW_CONFIG_DEFAULT() { .slot_ms = 40, .n_slots = 124 }
+
+typedef struct {
+    uint32_t superframes;
+    uint32_t assigned;              // slot ที่มีเจ้าของตอนนี้
+    uint32_t joins;
+    uint32_t join_full;             // ไม่มี slot ว่าง
+    uint32_t leaves;
+    uint32_t expected;              // slot-superframe ที่มีเจ้าของ
+    uint32_t received;              // ...ที่ได้เฟรมอย่างน้อย 1
+    uint32_t in_slot;               // เฟรมที่มาตรง slot ตัวเอง
+    uint32_t off_slot;              // มาผิดช่วงเวลา (clock drift / beacon หาย)
+    uint32_t unscheduled;           // จาก node ที่ไม่มี slot (โหมด free-running)
+} espnow_tdma_gw_stats_t;
+
+esp_err_t espnow_tdma_gw_init(const espnow_tdma_gw_config_t *cfg);
+/* เรียกเมื่อได้เฟรม data จาก src (ใน Wi-Fi task ได้) */
+void      espnow_tdma_gw_on_rx(const uint8_t src[6]);
+void      espnow_tdma_gw_get_stats(espnow_tdma_gw_stats_t *out);
+void      espnow_tdma_gw_report(void);
+
+/* ---- node ---- */
+typedef struct {
+    uint32_t beacons;
+    uint32_t missed;                // superframe ที่ไม่ได้ beacon
+    uint32_t joins_tx;
+    uint32_t evictions;             // slot ถูกให้คนอื่น / gateway รีบูต
+    uint32_t slots_used;
+    int      slot;                  // -1 = ยังไม่มี
+    uint16_t slot_ms;
+    uint16_t n_slots;
+} espnow_tdma_node_stats_t;
+
+esp_err_t espnow_tdma_node_init(const uint8_t gw_mac[6]);
+/* บล็อกจนถึงต้น slot ของเรา — ESP_ERR_TIMEOUT = ยังไม่มี slot/ไม่มี beacon (ให้ส่งแบบเดิม) */
+esp_err_t espnow_tdma_node_wait_slot(uint32_t timeout_ms);
+void      espnow_tdma_node_get_stats(espnow_tdma_node_stats_t *out);
+void      espnow_tdma_node_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,201 @@
+// components/espnow_txq/espnow_txq.c
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_now.h"
+#include "espnow_txq.h"
+
+static const char *TAG = "ESPNOW_TXQ";
+
+static const char *const s_cls_name[ESPNOW_TXQ_CLASS_MAX] = {
+    [ESPNOW_TXQ_ALERT]   = "alert",
+    [ESPNOW_TXQ_COMMAND] = "command",
+    [ESPNOW_TXQ_INFO]    = "info",
+};
+
+typedef struct {
+    uint8_t  mac[6];
+    uint8_t  len;
+    int64_t  enq_us;
+    uint8_t  frame[ESPNOW_TXQ_FRAME_MAX];
+} txq_entry_t;
+
+typedef struct {
+    espnow_txq_class_cfg_t cfg;
+    txq_entry_t        ring[ESPNOW_TXQ_MAX_DEPTH];
+    uint8_t            head;    // index ของเฟรมเก่าสุด
+    uint8_t            count;
+    uint8_t            credit;  // โควตา WRR ที่เหลือในรอบนี้
+    espnow_txq_stats_t stats;
+} txq_class_t;
+
+static txq_class_t       s_cls[ESPNOW_TXQ_CLASS_MAX];
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_pending;     // นับเฟรมในคิวทั้งหมด
+static SemaphoreHandle_t s_sent;        // send-cb มาแล้ว
+static uint8_t           s_rr;          // คลาสถัดไปที่ WRR จะเริ่มดู
+static uint32_t          s_sent_timeout_ms;
+
+/* bucket ของ histogram: log2 ของ delay (ms) */
+static inline int hist_bucket(int64_t delay_us) {
+    int64_t ms = delay_us / 1000;
+    int b = 0;
+    while (ms > 0 && b < ESPNOW_TXQ_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* เรียกภายใต้ s_lock: ALERT ก่อน แล้ว WRR ระหว่างคลาสที่เหลือ */
+static int pick_class(void) {
+    if (s_cls[ESPNOW_TXQ_ALERT].count > 0) return ESPNOW_TXQ_ALERT;
+
+    const int first = ESPNOW_TXQ_ALERT + 1;
+    const int n     = ESPNOW_TXQ_CLASS_MAX - first;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < n; i++) {
+            int c = first + (s_rr + i) % n;
+            if (s_cls[c].count > 0 && s_cls[c].credit > 0) {
+                s_cls[c].credit--;
+                // หมดโควตาแล้วค่อยเลื่อนไปคลาสถัดไป
+                s_rr = (s_cls[c].credit == 0) ? (uint8_t)((c - first + 1) % n) : (uint8_t)(c - first);
+                return c;
+            }
+        }
+        // ทุกคลาสที่มีของหมดโควตา -> เริ่มรอบใหม่
+        for (int c = first; c < ESPNOW_TXQ_CLASS_MAX; c++) {
+            s_cls[c].credit = s_cls[c].cfg.weight ? s_cls[c].cfg.weight : 1;
+        }
+    }
+    return -1;
+}
+
+static void txq_task(void *arg) {
+    static txq_entry_t e;   // ใหญ่ — ไม่เอาไว้บน stack
+
+    while (1) {
+        xSemaphoreTake(s_pending, portMAX_DELAY);
+
+        portENTER_CRITICAL(&s_lock);
+        int c = pick_class();
+        if (c >= 0) {
+            txq_class_t *q = &s_cls[c];
+            memcpy(&e, &q->ring[q->head], sizeof(e));
+            q->head = (q->head + 1) % q->cfg.depth;
+            q->count--;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (c < 0) continue;
+
+        int64_t delay = esp_timer_get_time() - e.enq_us;
+        xSemaphoreTake(s_sent, 0);   // ล้าง cb ค้างจากเฟรมที่ timeout ไปแล้ว
+        esp_err_t er = esp_now_send(e.mac, e.frame, e.len);
+
+        portENTER_CRITICAL(&s_lock);
+        espnow_txq_stats_t *st = &s_cls[c].stats;
+        if (er == ESP_OK) {
+            st->sent++;
+            st->hist[hist_bucket(delay)]++;
+            if (delay > st->max_delay_us) st->max_delay_us = delay;
+        } else {
+            st->send_err++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (er == ESP_OK) {
+            xSemaphoreTake(s_sent, pdMS_TO_TICKS(s_sent_timeout_ms));
+        } else {
+            ESP_LOGW(TAG, "%s send failed: %s", s_cls_name[c], esp_err_to_name(er));
+        }
+    }
+}
+
+esp_err_t espnow_txq_init(const espnow_txq_config_t *cfg) {
+    ESP_RETURN_ON_FALSE(cfg, ESP_ERR_INVALID_ARG, TAG, "cfg is NULL");
+    ESP_RETURN_ON_FALSE(!s_pending, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+
+    int total = 0;
+    for (int c = 0; c < ESPNOW_TXQ_CLASS_MAX; c++) {
+        ESP_RETURN_ON_FALSE(cfg->cls[c].depth >= 1 && cfg->cls[c].depth <= ESPNOW_TXQ_MAX_DEPTH,
+                            ESP_ERR_INVALID_ARG, TAG, "bad depth for %s", s_cls_name[c]);
+        memset(&s_cls[c], 0, sizeof(s_cls[c]));
+        s_cls[c].cfg    = cfg->cls[c];
+        s_cls[c].credit = cfg->cls[c].weight ? cfg->cls[c].weight : 1;
+        total += cfg->cls[c].depth;
+    }
+    s_sent_timeout_ms = cfg->sent_timeout_ms ? cfg->sent_timeout_ms : 100;
+
+    s_pending = xSemaphoreCreateCounting(total, 0);
+    s_sent    = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(s_pending && s_sent, ESP_ERR_NO_MEM, TAG, "semaphore");
+    ESP_RETURN_ON_FALSE(xTaskCreate(txq_task, "espnow_txq", 3072, NULL, cfg->task_prio, NULL) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "task");
+    return ESP_OK;
+}
+
+esp_err_t espnow_txq_send(espnow_txq_class_t cls, const uint8_t mac[6], const void *data, int len) {
+    if (cls >= ESPNOW_TXQ_CLASS_MAX || !mac || !data || len <= 0 || len > ESPNOW_TXQ_FRAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_pending) return ESP_ERR_INVALID_STATE;
+
+    bool give = true;
+    esp_err_t ret = ESP_OK;
+    txq_class_t *q = &s_cls[cls];
+
+    portENTER_CRITICAL(&s_lock);
+    if (q->count == q->cfg.depth) {
+        q->stats.dropped++;
+        if (q->cfg.drop == ESPNOW_TXQ_DROP_NEWEST) {
+            ret = ESP_ERR_NO_MEM;
+        } else {
+            // ทับเฟรมเก่าสุด — จำนวนในคิวเท่าเดิม จึงไม่ give semaphore เพิ่ม
+            q->head = (q->head + 1) % q->cfg.depth;
+            q->count--;
+            give = false;
+        }
+    }
+    if (ret == ESP_OK) {
+        txq_entry_t *e = &q->ring[(q->head + q->count) % q->cfg.depth];
+        memcpy(e->mac, mac, 6);
+        memcpy(e->frame, data, len);
+        e->len    = (uint8_t)len;
+        e->enq_us = esp_timer_get_time();
+        q->count++;
+        q->stats.enqueued++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK && give) xSemaphoreGive(s_pending);
+    return ret;
+}
+
+void espnow_txq_on_sent(void) {
+    if (s_sent) xSemaphoreGive(s_sent);
+}
+
+void espnow_txq_get_stats(espnow_txq_class_t cls, espnow_txq_stats_t *out) {
+    if (cls >= ESPNOW_TXQ_CLASS_MAX || !out) return;
+    portENTER_CRITICAL(&s_lock);
+    *out = s_cls[cls].stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void espnow_txq_report(void) {
+    for (int c = 0; c < ESPNOW_TXQ_CLASS_MAX; c++) {
+        espnow_txq_stats_t st;
+        espnow_txq_get_stats(c, &st);
+        ESP_LOGI(TAG, "%-7s enq=%" PRIu32 " sent=%" PRIu32 " drop=%" PRIu32 " err=%" PRIu32
+                 " max=%" PRId64 " us | <1:%" PRIu32 " <2:%" PRIu32 " <4:%" PRIu32 " <8:%" PRIu32
+                 " <16:%" PRIu32 " <32:%" PRIu32 " <64:%" PRIu32 " >=64:%" PRIu32 " ms",
+                 s_cls_name[c], st.enqueued, st.sent, st.dropped, st.send_err, st.max_delay_us,
+                 st.hist[0], st.hist[1], st.hist[2], st.hist[3],
+                 st.hist[4], st.hist[5], st.hist[6], st.hist[7]);
+    }
+}
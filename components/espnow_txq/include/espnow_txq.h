@@ -0,0 +1,77 @@
+// components/espnow_txq/include/espnow_txq.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* คิวส่งหลายคลาส: ALERT = strict priority, ที่เหลือแบ่งกันแบบ weighted round robin
+   ส่งทีละเฟรม (รอ send-cb) เพื่อให้ backlog ค้างอยู่ในคิวนี้ ไม่ใช่ใน FIFO ของ ESP-NOW */
+
+#define ESPNOW_TXQ_MAX_DEPTH     16    // ช่องสูงสุดต่อคลาส (static)
+#define ESPNOW_TXQ_FRAME_MAX     250   // ESP_NOW_MAX_DATA_LEN
+#define ESPNOW_TXQ_HIST_BUCKETS  8     // queueing delay: <1,<2,<4,...,<64, >=64 ms
+
+typedef enum {
+    ESPNOW_TXQ_ALERT = 0,       // ส่งก่อนเสมอ
+    ESPNOW_TXQ_COMMAND,
+    ESPNOW_TXQ_INFO,
+    ESPNOW_TXQ_CLASS_MAX,
+} espnow_txq_class_t;
+
+typedef enum {
+    ESPNOW_TXQ_DROP_NEWEST = 0, // คิวเต็ม -> ปฏิเสธเฟรมใหม่ (send คืน ESP_ERR_NO_MEM)
+    ESPNOW_TXQ_DROP_OLDEST,     // คิวเต็ม -> ทิ้งเฟรมเก่าสุด (ข้อมูลเก่าหมดค่าแล้ว)
+} espnow_txq_drop_t;
+
+typedef struct {
+    uint8_t           depth;    // 1..ESPNOW_TXQ_MAX_DEPTH
+    uint8_t           weight;   // เฟรมต่อรอบ WRR (ALERT ไม่ใช้)
+    espnow_txq_drop_t drop;
+} espnow_txq_class_cfg_t;
+
+typedef struct {
+    espnow_txq_class_cfg_t cls[ESPNOW_TXQ_CLASS_MAX];
+    UBaseType_t task_prio;
+    uint32_t    sent_timeout_ms;   // รอ send-cb นานสุดก่อนส่งเฟรมถัดไป
+} espnow_txq_config_t;
+
+#define ESPNOW_TXQ_CONFIG_DEFAULT() {                                          \
+    .cls = {                                                                   \
+        [ESPNOW_TXQ_ALERT]   = { .depth = 8,  .weight = 0, .drop = ESPNOW_TXQ_DROP_NEWEST }, \
+        [ESPNOW_TXQ_COMMAND] = { .depth = 8,  .weight = 3, .drop = ESPNOW_TXQ_DROP_NEWEST }, \
+        [ESPNOW_TXQ_INFO]    = { .depth = 16, .weight = 1, .drop = ESPNOW_TXQ_DROP_OLDEST }, \
+    },                                                                         \
+    .task_prio       = 5,                                                      \
+    .sent_timeout_ms = 100,                                                    \
+}
+
+typedef struct {
+    uint32_t enqueued;
+    uint32_t sent;
+    uint32_t dropped;           // ตาม drop policy
+    uint32_t send_err;          // esp_now_send() ไม่ผ่าน
+    uint32_t hist[ESPNOW_TXQ_HIST_BUCKETS];
+    int64_t  max_delay_us;
+} espnow_txq_stats_t;
+
+/* สร้าง TX task — เรียกหลัง esp_now_init() */
+esp_err_t espnow_txq_init(const espnow_txq_config_t *cfg);
+
+/* ไม่ block: copy เฟรมเข้าคิวของคลาส แล้วคืนทันที (เรียกจาก esp_timer / task ได้) */
+esp_err_t espnow_txq_send(espnow_txq_class_t cls, const uint8_t mac[6], const void *data, int len);
+
+/* เรียกจาก send-cb ของแอป: ปล่อยให้ TX task ส่งเฟรมถัดไป */
+void espnow_txq_on_sent(void);
+
+void espnow_txq_get_stats(espnow_txq_class_t cls, espnow_txq_stats_t *out);
+void espnow_txq_report(void);
+
+#ifdef __cplusplus
+}
+#endif
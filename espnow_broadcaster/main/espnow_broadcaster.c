@@ -12,6 +12,12 @@
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "group_ack.h"
+#include "group_nack.h"
+#include "group_fec.h"
+#include "espnow_txq.h"
 #include "esp_timer.h"  // ★ ต้องมี
 
 static const char* TAG = "ESP_NOW_BROADCASTER";
@@ -20,61 +26,87 @@ static const char* TAG = "ESP_NOW_BROADCASTER";
 static const uint8_t BROADCAST_MAC[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
 #define CHANNEL 1  // ★ ให้ตั้งเท่ากันทุกบอร์ด
 
+/* group ACK: จำนวน node ต่อ group (node_index 0..N-1) และจำนวนรอบ re-poll สูงสุด */
+#define GROUP_EXPECTED_NODES  4
+#define GROUP_ACK_MAX_ROUNDS  4
+
+/* reliable multicast: เก็บเฟรมล่าสุดไว้ส่งซ้ำเมื่อมี NACK (0 = broadcast ธรรมดา) */
+#define RELIABLE_MULTICAST    1
+
+/* FEC: ทุก FEC_K data frame ส่ง parity FEC_M เฟรม -> receiver กู้ได้ถึง FEC_M เฟรมโดยไม่ต้องขอ
+   (FEC_M = 1 เป็น XOR, > 1 เป็น Reed-Solomon) 0 = ปิด */
+#define FEC_MODE              0
+#define FEC_K                 4
+#define FEC_M                 1
+
+/* ทดสอบ scheduler: ยัด Info เพิ่มทีละกี่เฟรมต่อรอบ (0 = ปิด) เพื่อดูว่า Alert ยังออกได้เร็ว */
+#define BULK_INFO_BURST       0
+
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;    // ESPNOW_MSG_BROADCAST
     char     sender_id[20];
     char     message[180];
     uint8_t  message_type;   // 1=Info, 2=Command, 3=Alert
     uint8_t  group_id;       // 0=All, 1=Group1, 2=Group2
+    uint8_t  ack_slots;      // COMMAND: จำนวน slot ของ group ACK (0 = ไม่ต้อง ACK)
     uint32_t sequence_num;
     uint32_t timestamp_ms;
 } broadcast_data_t;
 
 static uint32_t sequence_counter = 0;
+static group_ack_tracker_t ack_tracker;
+static group_nack_tx_t     nack_tx;
+static group_fec_tx_t      fec_tx;
 
 /* --- callback แบบใหม่ใน IDF v5.x --- */
 static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
+    espnow_boot_mark_first_tx();
+    espnow_txq_on_sent();
     ESP_LOGI(TAG, "Send status: %s", status == ESP_NOW_SEND_SUCCESS ? "SUCCESS" : "FAIL");
 }
 
-static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-    // โดยปกติฝั่ง Broadcaster ไม่ค่อยมีคนตอบกลับ (ยกเว้น Receiver ส่ง ACK กลับ)
-    if (!data || len <= 0) return;
-
-    if (info && info->src_addr) {
-        ESP_LOGI(TAG, "📥 Reply from %02X:%02X:%02X:%02X:%02X:%02X",
-                 info->src_addr[0], info->src_addr[1], info->src_addr[2],
-                 info->src_addr[3], info->src_addr[4], info->src_addr[5]);
-    }
+/* group ACK จาก Receiver (unicast) — แค่ตั้ง bit ใน tracker */
+static void on_group_ack(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    group_ack_frame_t ack;
+    memcpy(&ack, data, sizeof(ack));
+    group_ack_tracker_on_ack(&ack_tracker, &ack);
+}
 
-    broadcast_data_t rx = {0};
-    memcpy(&rx, data, len < (int)sizeof(rx) ? len : (int)sizeof(rx));
-    ESP_LOGI(TAG, "   Reply msg=\"%s\" type=%u group=%u seq=%" PRIu32 " ts=%" PRIu32 "ms",
-             rx.message, rx.message_type, rx.group_id, rx.sequence_num, rx.timestamp_ms);
+/* NACK จาก Receiver — แค่ทำเครื่องหมาย seq ที่ถูกขอ รอรอบส่งซ้ำ */
+static void on_group_nack(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    group_nack_tx_on_nack(&nack_tx, data, len);
 }
 
-/* --- Wi-Fi STA & lock channel --- */
-static void wifi_init_for_espnow(uint8_t ch) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+/* message_type 1/2/3 -> คลาสของ TX scheduler */
+static espnow_txq_class_t txq_class_for(uint8_t msg_type) {
+    switch (msg_type) {
+        case 3:  return ESPNOW_TXQ_ALERT;
+        case 2:  return ESPNOW_TXQ_COMMAND;
+        default: return ESPNOW_TXQ_INFO;
+    }
+}
 
-    wifi_init_config_t wcfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&wcfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+/* เฟรมส่งซ้ำเข้าคิวคลาสเดียวกับต้นฉบับ */
+static esp_err_t rebroadcast(const uint8_t *frame, int len) {
+    const broadcast_data_t *b = (const broadcast_data_t *)frame;
+    return espnow_txq_send(txq_class_for(b->message_type), BROADCAST_MAC, frame, len);
+}
 
-    if (ch >= 1 && ch <= 13) {
-        wifi_config_t sta = {0};
-        sta.sta.channel = ch;
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta));
-    }
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", ch);
+/* รอบส่งซ้ำ: seq เดียวกันถูก broadcast ครั้งเดียวต่อรอบ ไม่ว่าจะมีกี่ node ขอ */
+static void nack_round_cb(void *arg) {
+    int n = group_nack_tx_flush(&nack_tx, rebroadcast);
+    if (n > 0) ESP_LOGI(TAG, "🔁 re-broadcast %d frame(s)", n);
 }
 
-/* --- ESP-NOW init + add broadcast peer --- */
+/* --- ESP-NOW callbacks + add broadcast peer --- */
 static void espnow_init_and_add_broadcast_peer(uint8_t ch) {
-    ESP_ERROR_CHECK(esp_now_init());
+    // ฝั่ง Broadcaster มีแค่ group ACK ตอบกลับมา (หลัง COMMAND)
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_GROUP_ACK, sizeof(group_ack_frame_t), on_group_ack));
+#if RELIABLE_MULTICAST
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_GROUP_NACK, 0, on_group_nack));
+#endif
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
-    ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_msg_dispatch));
 
     esp_now_peer_info_t peer = {0};
     memcpy(peer.peer_addr, BROADCAST_MAC, 6);
@@ -92,40 +124,105 @@ static void espnow_init_and_add_broadcast_peer(uint8_t ch) {
     ESP_LOGI(TAG, "ESP-NOW ready & broadcast peer added");
 }
 
+/* รอ group ACK ทีละหน้าต่าง แล้ว re-poll เฉพาะ node ที่ขาด (broadcast ครั้งเดียวต่อรอบ) */
+static void collect_group_acks(uint32_t cmd_seq, uint8_t group_id, uint8_t slots) {
+    int round = 0;
+    int missing = GROUP_EXPECTED_NODES;
+    uint8_t pending[GROUP_ACK_BITMAP_LEN];
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(slots * GROUP_ACK_SLOT_MS + 10) + 1);   // +10 ms เผื่อ retry ของ MAC
+        missing = group_ack_tracker_missing(&ack_tracker, pending);
+        if (missing == 0 || ++round >= GROUP_ACK_MAX_ROUNDS) break;
+
+        group_poll_frame_t poll = {0};
+        poll.hdr.type = ESPNOW_MSG_GROUP_POLL;
+        poll.group_id = group_id;
+        poll.cmd_seq  = cmd_seq;
+        poll.slots    = slots = group_ack_slots_for(missing);
+        memcpy(poll.pending, pending, sizeof(poll.pending));
+
+        esp_err_t er = espnow_txq_send(ESPNOW_TXQ_COMMAND, BROADCAST_MAC, &poll, sizeof(poll));
+        if (er != ESP_OK) ESP_LOGE(TAG, "re-poll send failed: %s", esp_err_to_name(er));
+    }
+
+    int got = GROUP_EXPECTED_NODES - missing;
+    int64_t last = ack_tracker.last_ack_us ? ack_tracker.last_ack_us - ack_tracker.start_us : 0;
+    ESP_LOGI(TAG, "📬 group ACK seq=%" PRIu32 ": %d/%d nodes, %d re-poll(s), last ACK at %" PRId64 " ms",
+             cmd_seq, got, GROUP_EXPECTED_NODES, round, last / 1000);
+}
+
 static void send_broadcast(const char* message, uint8_t msg_type, uint8_t group_id) {
     broadcast_data_t tx = {0};
+    tx.hdr.type = ESPNOW_MSG_BROADCAST;
     snprintf(tx.sender_id, sizeof(tx.sender_id), "%s", "MASTER_001");
     snprintf(tx.message, sizeof(tx.message), "%s", message);
     tx.message_type = msg_type;
     tx.group_id     = group_id;
     tx.sequence_num = ++sequence_counter;
     tx.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000ULL);
+    if (msg_type == 2) {   // COMMAND ต้องได้ ACK จากทุก node ใน group
+        tx.ack_slots = group_ack_slots_for(GROUP_EXPECTED_NODES);
+        group_ack_tracker_begin(&ack_tracker, tx.sequence_num, group_id, GROUP_EXPECTED_NODES);
+    }
 
     ESP_LOGI(TAG, "📡 TX: type=%u group=%u seq=%" PRIu32 " msg=\"%s\"",
              tx.message_type, tx.group_id, tx.sequence_num, tx.message);
 
-    esp_err_t er = esp_now_send(BROADCAST_MAC, (const uint8_t*)&tx, sizeof(tx));
+    // เข้าคิวตามคลาส: Alert แซงทุกอย่าง, Command/Info แบ่งกันตาม weight
+    esp_err_t er = espnow_txq_send(txq_class_for(msg_type), BROADCAST_MAC, &tx, sizeof(tx));
     if (er != ESP_OK) {
-        ESP_LOGE(TAG, "esp_now_send failed: %s", esp_err_to_name(er));
+        ESP_LOGE(TAG, "TX queue rejected seq=%" PRIu32 ": %s", tx.sequence_num, esp_err_to_name(er));
+        return;
+    }
+#if RELIABLE_MULTICAST
+    group_nack_tx_store(&nack_tx, tx.sequence_num, &tx, sizeof(tx));
+#endif
+#if FEC_MODE
+    static group_fec_parity_t parity[GROUP_FEC_MAX_M];
+    int np = group_fec_tx_add(&fec_tx, tx.sequence_num, &tx, sizeof(tx), parity);
+    for (int j = 0; j < np; j++) {
+        er = espnow_txq_send(ESPNOW_TXQ_INFO, BROADCAST_MAC, &parity[j], GROUP_FEC_PARITY_LEN(parity[j].shard_len));
+        if (er != ESP_OK) ESP_LOGE(TAG, "FEC parity send failed: %s", esp_err_to_name(er));
     }
+    if (np > 0) {
+        ESP_LOGI(TAG, "🧩 FEC block %" PRIu32 "..%" PRIu32 ": %d parity, encode avg %" PRId64 " us/block",
+                 parity[0].block_first, parity[0].block_first + FEC_K - 1, np,
+                 fec_tx.encode_us_total / fec_tx.blocks);
+    }
+#endif
+    if (tx.ack_slots > 0) collect_group_acks(tx.sequence_num, group_id, tx.ack_slots);
 }
 
 void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
-    }
-
-    wifi_init_for_espnow(CHANNEL);
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น) — Master ใช้ ESP-NOW อย่างเดียว จึงใช้ fast boot
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel   = CHANNEL;
+    boot_cfg.fast_boot = true;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    espnow_txq_config_t txq_cfg = ESPNOW_TXQ_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(espnow_txq_init(&txq_cfg));
+    group_ack_tracker_init(&ack_tracker);
+    group_nack_tx_init(&nack_tx);
+    group_fec_tx_init(&fec_tx, FEC_K, FEC_M);
     espnow_init_and_add_broadcast_peer(CHANNEL);
 
+#if RELIABLE_MULTICAST
+    esp_timer_handle_t nack_timer;
+    const esp_timer_create_args_t nargs = {
+        .callback = nack_round_cb,
+        .name     = "nack_round",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&nargs, &nack_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(nack_timer, GROUP_NACK_ROUND_MS * 1000));
+#endif
+
     // log MAC ตัวเอง
     uint8_t mac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mac));
     ESP_LOGI(TAG, "📍 Broadcaster MAC: %02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    espnow_boot_report();
 
     int i = 0;
     while (1) {
@@ -135,7 +232,15 @@ void app_main(void) {
             case 2: send_broadcast("Alert for Group 2 devices",          3, 2); break;
             case 3: send_broadcast("Status update for all groups",       1, 0); break;
         }
+        for (int b = 0; b < BULK_INFO_BURST; b++) {
+            send_broadcast("Bulk info", 1, 0);
+        }
         i++;
+        if (i % 12 == 0) espnow_txq_report();
+        if (RELIABLE_MULTICAST && i % 12 == 0) {
+            ESP_LOGI(TAG, "📊 multicast: original=%" PRIu32 " retransmit=%" PRIu32 " nack=%" PRIu32 " too_old=%" PRIu32,
+                     nack_tx.originals, nack_tx.retransmits, nack_tx.nacks_rx, nack_tx.too_old);
+        }
         vTaskDelay(pdMS_TO_TICKS(5000));
     }
 }
\ No newline at end of file
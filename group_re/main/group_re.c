@@ -4,54 +4,100 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
+#include "esp_random.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_now.h"
 #include "esp_timer.h"  // สำหรับ esp_timer_get_time()
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "group_ack.h"
+#include "group_nack.h"
+#include "group_fec.h"
+#include "espnow_replay.h"
+#include "espnow_metrics.h"
 
 static const char* TAG = "ESP_NOW_RECEIVER";
 
 // กำหนด ID และ Group ของ Node นี้
 #define MY_NODE_ID "NODE_001"
 #define MY_GROUP_ID 1  // เปลี่ยนเป็น 1 หรือ 2 ตาม Group
+#define MY_NODE_INDEX 0  // ★ ลำดับใน group (0..GROUP_ACK_MAX_NODES-1) ห้ามซ้ำกันใน group เดียวกัน
+#define REPLAY_SPEED_PCT -1  // >= 0 -> เล่น capture จาก partition "replay" เข้า dispatch (0 = เร็วสุด)
+#define METRICS_PERIOD_MS 0  // > 0 -> broadcast stats frame (gateway ที่อยู่ channel เดียวกันเก็บไป)
+#define CONSOLE_REPL 0  // 1 -> เปิด REPL บน UART console (คำสั่ง "metrics") — ปิดไว้ UART ไม่ถูกแย่ง
 
 // MAC ของ Broadcaster (ใส่ MAC จริงของ Master)
 static uint8_t broadcaster_mac[6] = {0x94, 0xB5, 0x55, 0xF4, 0x19, 0x48};
 
-// โครงสร้างข้อมูลเหมือน Broadcaster
-typedef struct {
+// โครงสร้างข้อมูลเหมือน Broadcaster (packed ให้ขนาดตรงกันทุก byte)
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;  // ESPNOW_MSG_BROADCAST
     char sender_id[20];
     char message[180];
     uint8_t message_type;  // 1=Info, 2=Command, 3=Alert
     uint8_t group_id;      // 0=All, 1=Group1, 2=Group2
+    uint8_t ack_slots;     // COMMAND: จำนวน slot ของ group ACK (0 = ไม่ต้อง ACK)
     uint32_t sequence_num;
     uint32_t timestamp;
 } broadcast_data_t;
 
-// เก็บ sequence number ที่รับล่าสุด (ป้องกันการรับซ้ำ)
-static uint32_t last_sequence = 0;
+// ตรวจ seq ต่อ sender: กันรับซ้ำ + หา gap เพื่อขอส่งซ้ำ (NACK)
+static group_nack_rx_t    nack_rx;
+static portMUX_TYPE       nack_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t nack_timer;
 
-// Forward declaration ของ send_reply
-void send_reply(const uint8_t* target_mac, const char* reply_message);
+// FEC: เก็บ data frame ล่าสุดไว้ประกอบกับ parity (ใช้ใน Wi-Fi task เท่านั้น)
+static group_fec_rx_t     fec_rx;
 
-// Callback เมื่อรับข้อมูล Broadcast (ปรับรูปแบบ v5.x)
-void on_data_recv(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
-    const uint8_t *mac_addr = recv_info->src_addr;
-    broadcast_data_t *recv_data = (broadcast_data_t*)data;
+// ACK ที่รอส่งตาม slot ที่สุ่มได้ (ส่งจาก esp_timer task)
+static esp_timer_handle_t ack_timer;
+static group_ack_frame_t  pending_ack;
+static uint32_t           last_command_seq = 0;   // COMMAND ล่าสุดที่รับได้ (ใช้ตอบ POLL)
 
-    // ตรวจสอบ sequence number (ป้องกันการรับซ้ำ)
-    if (recv_data->sequence_num <= last_sequence) {
+// ตัวนับ runtime (espnow_metrics) — อัปเดตได้จาก callback ทุกตัวโดยไม่ต้อง lock
+static espnow_metric_t *m_rx, *m_dup, *m_recovered, *m_fec_rebuilt, *m_not_mine;
+static espnow_metric_t *m_tx_ok, *m_tx_fail, *m_send_err, *m_bad_len, *m_unknown;
+
+// Forward declaration ของ schedule_group_ack
+void schedule_group_ack(uint32_t cmd_seq, uint8_t group_id, uint8_t slots);
+
+// Handler ของ ESPNOW_MSG_BROADCAST (เรียกผ่าน espnow_msg_dispatch, ความยาวเช็กแล้ว)
+void on_broadcast(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
+    const broadcast_data_t *recv_data = (const broadcast_data_t*)data;
+    espnow_metrics_inc(m_rx);
+
+    group_fec_rx_on_data(&fec_rx, recv_data->sequence_num, data, len);
+
+    // ตรวจสอบ sequence number (ป้องกันการรับซ้ำ + หา gap)
+    group_nack_peer_t *peer;
+    portENTER_CRITICAL(&nack_lock);
+    group_nack_rx_result_t res = group_nack_rx_accept(&nack_rx, recv_info->src_addr,
+                                                      recv_data->sequence_num, &peer);
+    bool gap = group_nack_rx_has_gap(peer);
+    portEXIT_CRITICAL(&nack_lock);
+
+    if (res == GROUP_NACK_RX_DUP) {
+        espnow_metrics_inc(m_dup);
         ESP_LOGW(TAG, "⚠️  Duplicate message ignored (seq: %lu)", recv_data->sequence_num);
         return;
     }
-    last_sequence = recv_data->sequence_num;
+    if (res == GROUP_NACK_RX_RECOVERED) {
+        espnow_metrics_inc(m_recovered);
+        ESP_LOGI(TAG, "🩹 Recovered seq %lu from retransmission", recv_data->sequence_num);
+    }
+    if (gap && !esp_timer_is_active(nack_timer)) {
+        // หน่วงแบบสุ่ม: node อื่นอาจ NACK ไปก่อนแล้ว และการส่งซ้ำเป็น broadcast ถึงเราด้วย
+        esp_timer_start_once(nack_timer, (esp_random() % GROUP_NACK_JITTER_MS + 1) * 1000);
+    }
 
     // ตรวจสอบว่าข้อความนี้สำหรับเราหรือไม่
     bool for_me = (recv_data->group_id == 0) || (recv_data->group_id == MY_GROUP_ID);
 
     if (!for_me) {
+        espnow_metrics_inc(m_not_mine);
         ESP_LOGI(TAG, "📋 Message for Group %d (not for me)", recv_data->group_id);
         return;
     }
@@ -77,8 +123,11 @@ void on_data_recv(const esp_now_recv_info_t *recv_info, const uint8_t *data, int
         ESP_LOGI(TAG, "🔧 Processing command...");
         // ใส่การประมวลผล Command ที่นี่
 
-        // ส่งตอบกลับ
-        send_reply(mac_addr, "Command received and processed");
+        // ตอบกลับแบบ group ACK: สุ่ม slot ในหน้าต่างที่ Master กำหนด (กันทุก node ตอบพร้อมกัน)
+        last_command_seq = recv_data->sequence_num;
+        if (recv_data->ack_slots > 0) {
+            schedule_group_ack(recv_data->sequence_num, recv_data->group_id, recv_data->ack_slots);
+        }
     } else if (recv_data->message_type == 3) { // ALERT
         ESP_LOGW(TAG, "🚨 ALERT RECEIVED: %s", recv_data->message);
         // ใส่การจัดการ Alert ที่นี่
@@ -87,68 +136,191 @@ void on_data_recv(const esp_now_recv_info_t *recv_info, const uint8_t *data, int
     ESP_LOGI(TAG, "--------------------------------");
 }
 
-// ฟังก์ชันส่งตอบกลับไปยัง Broadcaster
-void send_reply(const uint8_t* target_mac, const char* reply_message) {
-    broadcast_data_t reply_data;
+// เฟรมที่ FEC กู้คืนได้ เข้าทางเดียวกับเฟรมปกติ
+static void fec_deliver(const uint8_t *frame, int len, void *ctx) {
+    espnow_metrics_inc(m_fec_rebuilt);
+    ESP_LOGI(TAG, "🧩 FEC rebuilt a lost frame");
+    on_broadcast((const esp_now_recv_info_t *)ctx, frame, len);
+}
+
+// Handler ของ ESPNOW_MSG_GROUP_FEC (parity, ความยาวแปรผัน)
+void on_group_fec(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
+    group_fec_rx_on_parity(&fec_rx, data, len, fec_deliver, (void *)recv_info);
+}
+
+// ส่ง NACK ของ gap ที่ยังเหลือ (esp_timer task) แล้วนัดเช็กใหม่หลังรอบส่งซ้ำถัดไป
+static void nack_timer_cb(void *arg) {
+    bool again = false;
+
+    for (int i = 0; i < GROUP_NACK_MAX_SENDERS; i++) {
+        group_nack_frame_t nack;
+        uint8_t dst[6];
+
+        portENTER_CRITICAL(&nack_lock);
+        group_nack_peer_t *p = &nack_rx.peers[i];
+        int len = group_nack_rx_build(p, &nack);
+        memcpy(dst, p->mac, 6);
+        portEXIT_CRITICAL(&nack_lock);
+        if (len == 0) continue;
+
+        esp_err_t er = esp_now_send(dst, (const uint8_t*)&nack, len);
+        if (er != ESP_OK) {
+            espnow_metrics_inc(m_send_err);
+            ESP_LOGE(TAG, "NACK send failed: %s", esp_err_to_name(er));
+        } else ESP_LOGI(TAG, "📤 NACK %u range(s), first seq %lu", nack.n_ranges, nack.ranges[0].first);
+        again = true;
+    }
+
+    if (again) {
+        esp_timer_start_once(nack_timer,
+                             (GROUP_NACK_ROUND_MS + esp_random() % GROUP_NACK_JITTER_MS) * 1000);
+    }
+}
+
+// ส่ง group ACK เมื่อถึง slot (esp_timer task)
+static void ack_timer_cb(void *arg) {
+    esp_err_t er = esp_now_send(broadcaster_mac, (const uint8_t*)&pending_ack, sizeof(pending_ack));
+    if (er != ESP_OK) {
+        espnow_metrics_inc(m_send_err);
+        ESP_LOGE(TAG, "group ACK send failed: %s", esp_err_to_name(er));
+    }
+}
+
+// ตั้งเวลาส่ง ACK หลัง slot สุ่ม — ถ้ามี ACK ค้างอยู่จะถูกแทนด้วยอันใหม่
+void schedule_group_ack(uint32_t cmd_seq, uint8_t group_id, uint8_t slots) {
+    uint32_t delay_us = group_ack_pick_delay_us(slots);
+
+    esp_timer_stop(ack_timer);   // ไม่ได้ทำงานอยู่ก็ไม่เป็นไร
+    pending_ack.hdr.type   = ESPNOW_MSG_GROUP_ACK;
+    pending_ack.group_id   = group_id;
+    pending_ack.node_index = MY_NODE_INDEX;
+    pending_ack.cmd_seq    = cmd_seq;
+    ESP_ERROR_CHECK(esp_timer_start_once(ack_timer, delay_us));
+
+    ESP_LOGI(TAG, "📤 Group ACK seq=%lu in %lu us (%u slots)",
+             cmd_seq, delay_us, slots);
+}
+
+// Handler ของ ESPNOW_MSG_GROUP_POLL: Master ถามซ้ำเฉพาะ node ที่ยังไม่ได้ ACK
+void on_group_poll(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
+    group_poll_frame_t poll;
+    memcpy(&poll, data, sizeof(poll));
 
-    strcpy(reply_data.sender_id, MY_NODE_ID);
-    strncpy(reply_data.message, reply_message, sizeof(reply_data.message) - 1);
-    reply_data.message[sizeof(reply_data.message)-1] = '\0';
-    reply_data.message_type = 1; // Info
-    reply_data.group_id = MY_GROUP_ID;
-    reply_data.sequence_num = 0; // Reply ไม่ต้องใช้ sequence
-    reply_data.timestamp = esp_timer_get_time() / 1000;
+    if (poll.group_id != 0 && poll.group_id != MY_GROUP_ID) return;
+    if (!group_bitmap_test(poll.pending, MY_NODE_INDEX)) return;   // ACK ของเราไปถึงแล้ว
+    if (poll.cmd_seq != last_command_seq) return;                   // ไม่ได้รับ COMMAND นี้ -> ไม่มีอะไรให้ยืนยัน
 
-    ESP_LOGI(TAG, "📤 Sending reply: %s", reply_message);
-    esp_now_send(target_mac, (uint8_t*)&reply_data, sizeof(reply_data));
+    ESP_LOGI(TAG, "🔁 Re-poll for seq=%lu", poll.cmd_seq);
+    schedule_group_ack(poll.cmd_seq, poll.group_id, poll.slots);
 }
 
 // Callback เมื่อส่งข้อมูลเสร็จ (ปรับรูปแบบ v5.x)
 void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Reply sent: %s", (status == ESP_NOW_SEND_SUCCESS) ? "✅" : "❌");
+    espnow_boot_mark_first_tx();
+    espnow_metrics_inc(status == ESP_NOW_SEND_SUCCESS ? m_tx_ok : m_tx_fail);
+    ESP_LOGI(TAG, "Group ACK sent: %s", (status == ESP_NOW_SEND_SUCCESS) ? "✅" : "❌");
+}
+
+// ขนาดไม่ตรง / type ไม่รู้จัก นับอยู่ใน espnow_msg แล้ว -> คัดลอกตอนสร้างเฟรม
+static void metrics_collect(void) {
+    espnow_metrics_set(m_bad_len, (int32_t)espnow_msg_bad_len_count());
+    espnow_metrics_set(m_unknown, (int32_t)espnow_msg_unknown_count());
+}
+
+static void metrics_init(void) {
+    m_rx          = espnow_metrics_counter("rx_frames");
+    m_dup         = espnow_metrics_counter("rx_dup");
+    m_recovered   = espnow_metrics_counter("rx_recovered");
+    m_fec_rebuilt = espnow_metrics_counter("fec_rebuilt");
+    m_not_mine    = espnow_metrics_counter("rx_other_group");
+    m_tx_ok       = espnow_metrics_counter("tx_ok");
+    m_tx_fail     = espnow_metrics_counter("tx_fail");
+    m_send_err    = espnow_metrics_counter("send_err");
+    m_bad_len     = espnow_metrics_gauge("rx_bad_len");
+    m_unknown     = espnow_metrics_gauge("rx_unknown");
+
+    espnow_metrics_config_t cfg = {
+        .period_ms = METRICS_PERIOD_MS,
+        .peer      = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        .collect   = metrics_collect,
+    };
+    if (METRICS_PERIOD_MS > 0) ESP_ERROR_CHECK(espnow_boot_add_peer(cfg.peer, 0));
+    ESP_ERROR_CHECK(espnow_metrics_start(&cfg));
+    ESP_ERROR_CHECK(espnow_metrics_console_init(CONSOLE_REPL));
 }
 
 // ฟังก์ชันเริ่มต้น WiFi และ ESP-NOW
 void init_espnow(void) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น), channel 0 = ไม่ล็อกชานเนล
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel = 0;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    metrics_init();
+
+    // timer ของ ACK/NACK ต้องพร้อมก่อน recv-cb ตัวแรกจะมา
+    const esp_timer_create_args_t targs = {
+        .callback = ack_timer_cb,
+        .name     = "group_ack",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&targs, &ack_timer));
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    group_nack_rx_init(&nack_rx);
+    group_fec_rx_init(&fec_rx);
+    const esp_timer_create_args_t nargs = {
+        .callback = nack_timer_cb,
+        .name     = "group_nack",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&nargs, &nack_timer));
 
-    ESP_ERROR_CHECK(esp_now_init());
-    ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_BROADCAST, sizeof(broadcast_data_t), on_broadcast));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_GROUP_POLL, sizeof(group_poll_frame_t), on_group_poll));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_GROUP_FEC, 0, on_group_fec));
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_msg_dispatch));
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
 
-    // เพิ่ม Broadcaster เป็น Peer (สำหรับส่ง Reply)
-    esp_now_peer_info_t peer_info = {};
-    memcpy(peer_info.peer_addr, broadcaster_mac, 6);
-    peer_info.channel = 0;
-    peer_info.encrypt = false;
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer_info));
+    // เพิ่ม Broadcaster เป็น Peer (สำหรับส่ง group ACK / NACK)
+    ESP_ERROR_CHECK(espnow_boot_add_peer(broadcaster_mac, 0));
 
     ESP_LOGI(TAG, "ESP-NOW Receiver initialized");
 }
 
 void app_main(void) {
-    ESP_ERROR_CHECK(nvs_flash_init());
     init_espnow();
+#if REPLAY_SPEED_PCT >= 0
+    espnow_replay_config_t replay = ESPNOW_REPLAY_CONFIG_DEFAULT();
+    replay.recv      = espnow_msg_dispatch;
+    replay.speed_pct = REPLAY_SPEED_PCT;
+    ESP_ERROR_CHECK(espnow_replay_start(&replay));
+#endif
 
     // แสดง Node Info
     uint8_t mac[6];
     esp_wifi_get_mac(WIFI_IF_STA, mac);
     ESP_LOGI(TAG, "📍 Node ID: %s", MY_NODE_ID);
-    ESP_LOGI(TAG, "📍 Group ID: %d", MY_GROUP_ID);
+    ESP_LOGI(TAG, "📍 Group ID: %d (node index %d)", MY_GROUP_ID, MY_NODE_INDEX);
     ESP_LOGI(TAG, "📍 MAC Address: %02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    espnow_boot_report();
 
     ESP_LOGI(TAG, "🎯 ESP-NOW Receiver ready - Waiting for broadcasts...");
 
-    // Receiver จะทำงานใน callback
+    // Receiver จะทำงานใน callback — ที่นี่แค่รายงานอัตราส่งถึงทุก 30 วินาที
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(30000));
+        if (fec_rx.recovered || fec_rx.unrecoverable) {
+            ESP_LOGI(TAG, "📊 FEC recovered=%lu unrecoverable_blocks=%lu decode_avg=%lld us",
+                     fec_rx.recovered, fec_rx.unrecoverable,
+                     fec_rx.recovered ? (long long)(fec_rx.decode_us_total / fec_rx.recovered) : 0LL);
+        }
+        for (int i = 0; i < GROUP_NACK_MAX_SENDERS; i++) {
+            group_nack_peer_t p;
+            portENTER_CRITICAL(&nack_lock);
+            p = nack_rx.peers[i];
+            portEXIT_CRITICAL(&nack_lock);
+            if (!p.used) continue;
+            ESP_LOGI(TAG, "📊 from %02X:%02X:%02X:%02X:%02X:%02X delivered=%lu recovered=%lu dup=%lu ratio=%.3f restarts=%lu",
+                     p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5],
+                     p.delivered, p.recovered, p.duplicates, group_nack_rx_delivery_ratio(&p), p.restarts);
+        }
     }
 }
\ No newline at end of file
@@ -2,21 +2,29 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "espnow_disc.h"
+#include "espnow_replay.h"
+#include "espnow_metrics.h"
 #include "driver/ledc.h"     // LEDC PWM
 
 static const char* TAG = "ESP_NOW_LED_RX";
 
-/* ★★ ใส่ STA MAC ของ “ฝั่ง A (รีโมต)” ★★ */
-static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 }; 
+/* STA MAC ของ “ฝั่ง A (รีโมต)” — ได้จาก discovery (role LED_CTRL) */
+static uint8_t partner_mac[6];
 
 #define CHANNEL          1      // ★★ ให้ตรงกับฝั่ง A ★★
 #define LED_PIN          2      // ★★ เปลี่ยนให้ตรงกับบอร์ดคุณ
@@ -25,13 +33,42 @@ static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 };
 #define LEDC_CHANNEL     LEDC_CHANNEL_0
 #define LEDC_BITS        LEDC_TIMER_8_BIT   // 8 บิต = 0..255
 #define LEDC_FREQ_HZ     5000
+#define LED_FADE_MS      200    // เวลา fade ด้วย hardware ต่อคำสั่ง
+#define REPLAY_SPEED_PCT -1     // >= 0 -> เล่น capture จาก partition "replay" เข้า on_data_recv (0 = เร็วสุด)
+#define METRICS_PERIOD_MS 0     // > 0 -> broadcast stats frame (gateway ที่อยู่ channel เดียวกันเก็บไป)
+#define CONSOLE_REPL     0      // 1 -> เปิด REPL บน UART console (คำสั่ง "metrics") — ปิดไว้ UART ไม่ถูกแย่ง
 
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;      // ESPNOW_MSG_LED_SET / ESPNOW_MSG_LED_ACK
     bool     led_state;
     uint8_t  brightness;       // 0..255
-    char     command[20];      // "SET_LED" / "LED_ACK"
+    uint16_t seq;              // เพิ่มทีละ 1 ต่อคำสั่ง, ACK ส่ง seq ที่ apply จริงกลับ
+    uint32_t epoch;            // ของ sender ต่อบูต — เปลี่ยน = seq เริ่มนับใหม่ (ไม่ถือว่า stale)
 } led_control_t;
 
+/* mailbox ระหว่าง recv-cb กับ LED task: queue ยาว 1 + xQueueOverwrite = เก็บแค่คำสั่งล่าสุด */
+typedef struct {
+    led_control_t cmd;
+    uint8_t       src[6];
+    int64_t       rx_us;       // เวลาที่ callback ได้รับ (ใช้วัด latency)
+} led_mail_t;
+
+static espnow_metric_t  *m_rx, *m_foreign, *m_tx_ok, *m_tx_fail, *m_send_err;
+static espnow_metric_t  *m_overwritten, *m_bad_len, *m_unknown, *m_start_us;
+
+static QueueHandle_t     s_led_mailbox;
+static volatile uint32_t s_led_overwritten;   // คำสั่งที่ถูกทับใน mailbox ก่อน LED task มารับ
+
+/* สถิติ (เขียนจาก LED task เท่านั้น) */
+static struct {
+    uint32_t applied;          // คำสั่งที่ถูก apply
+    uint32_t coalesced;        // คำสั่งที่มาแทนเป้าหมายระหว่าง fade (ไม่ได้ ACK)
+    uint32_t stale;            // seq เก่ากว่าที่ apply ไปแล้ว
+    uint32_t acks;
+    int64_t  start_us_min, start_us_max, start_us_sum;   // recv -> เริ่ม fade
+    int64_t  final_us_min, final_us_max, final_us_sum;   // recv -> ถึง duty สุดท้าย (ตอนส่ง ACK)
+} s_led_stats = { .start_us_min = INT64_MAX, .final_us_min = INT64_MAX };
+
 static inline bool mac_eq(const uint8_t *a, const uint8_t *b) {
     return memcmp(a, b, 6) == 0;
 }
@@ -64,126 +101,240 @@ static void led_pwm_init(void) {
     ESP_ERROR_CHECK(ledc_channel_config(&ccfg));
 }
 
-/* ตั้งค่า LED ตามคำสั่ง */
-static void led_apply(bool on, uint8_t bright) {
+/* เริ่ม fade ไปยัง duty เป้าหมาย (ไม่รอ) — fade เดิมที่ยังไม่จบจะถูกหยุดก่อน */
+static void led_fade_to(bool on, uint8_t bright) {
     uint32_t duty = on ? bright : 0; // 0..255
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, duty));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_MODE, LEDC_CHANNEL));
-    ESP_LOGI(TAG, "LED %s, duty=%u/255", on ? "ON" : "OFF", (unsigned)duty);
+    ledc_fade_stop(LEDC_MODE, LEDC_CHANNEL);
+    ESP_ERROR_CHECK(ledc_set_fade_time_and_start(LEDC_MODE, LEDC_CHANNEL, duty,
+                                                 LED_FADE_MS, LEDC_FADE_NO_WAIT));
+}
+
+static void send_led_ack(const uint8_t *dst, const led_control_t *applied) {
+    if (!esp_now_is_peer_exist(dst)) {
+        esp_now_peer_info_t p = {0};
+        memcpy(p.peer_addr, dst, 6);
+        p.ifidx   = WIFI_IF_STA;
+        p.channel = 0;          // 0 = channel ปัจจุบัน (ตาม discovery ถ้าย้าย)
+        p.encrypt = false;
+        esp_err_t er = esp_now_add_peer(&p);
+        if (er != ESP_OK && er != ESP_ERR_ESPNOW_EXIST) {
+            ESP_LOGE(TAG, "add_peer(A) failed: %d", er);
+            return;
+        }
+    }
+
+    led_control_t ack = *applied;
+    ack.hdr.type = ESPNOW_MSG_LED_ACK;
+
+    esp_err_t er = esp_now_send(dst, (const uint8_t*)&ack, sizeof(ack));
+    if (er != ESP_OK) {
+        espnow_metrics_inc(m_send_err);
+        ESP_LOGE(TAG, "esp_now_send(ACK) failed: %d", er);
+    } else ESP_LOGI(TAG, "📤 ACK sent (seq=%u)", (unsigned)ack.seq);
+}
+
+/* seq แบบวนรอบ 16 บิต: true ถ้า a ใหม่กว่า b */
+static inline bool seq_newer(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+static inline void stat_add(int64_t v, int64_t *mn, int64_t *mx, int64_t *sum) {
+    if (v < *mn) *mn = v;
+    if (v > *mx) *mx = v;
+    *sum += v;
+}
+
+/* ==== LED task: apply คำสั่งล่าสุดด้วย hardware fade แล้ว ACK ครั้งเดียวเมื่อนิ่ง ==== */
+static void led_task(void *arg) {
+    led_mail_t cur;            // คำสั่งที่กำลัง fade อยู่
+    led_mail_t mail;
+    bool       have_applied = false;
+    bool       fading = false;
+
+    while (1) {
+        // ระหว่าง fade รอคำสั่งใหม่ได้ไม่เกินเวลา fade, ถ้าไม่ได้ fade รอไปเรื่อย ๆ
+        TickType_t wait = fading ? pdMS_TO_TICKS(LED_FADE_MS) + 1 : portMAX_DELAY;
+        if (xQueueReceive(s_led_mailbox, &mail, wait) != pdTRUE) {
+            // fade จบ และไม่มีคำสั่งค้าง -> ยืนยันสถานะสุดท้ายครั้งเดียว
+            fading = false;
+            stat_add(esp_timer_get_time() - cur.rx_us, &s_led_stats.final_us_min,
+                     &s_led_stats.final_us_max, &s_led_stats.final_us_sum);
+            ESP_LOGI(TAG, "LED %s, duty=%u/255 (seq=%u)", cur.cmd.led_state ? "ON" : "OFF",
+                     (unsigned)(cur.cmd.led_state ? cur.cmd.brightness : 0), (unsigned)cur.cmd.seq);
+            send_led_ack(cur.src, &cur.cmd);
+            s_led_stats.acks++;
+            continue;
+        }
+
+        if (have_applied && mail.cmd.epoch != cur.cmd.epoch) {
+            ESP_LOGI(TAG, "🔄 sender restarted (epoch %08" PRIx32 " -> %08" PRIx32 "), seq reset",
+                     cur.cmd.epoch, mail.cmd.epoch);
+            have_applied = false;
+        }
+        if (have_applied && !seq_newer(mail.cmd.seq, cur.cmd.seq)) {
+            s_led_stats.stale++;
+            continue;
+        }
+        if (fading) s_led_stats.coalesced++;   // เปลี่ยนเป้าหมายกลางทาง ไม่ ACK ตัวกลาง
+
+        led_fade_to(mail.cmd.led_state, mail.cmd.brightness);
+        int64_t start_us = esp_timer_get_time() - mail.rx_us;
+        stat_add(start_us, &s_led_stats.start_us_min, &s_led_stats.start_us_max, &s_led_stats.start_us_sum);
+        espnow_metrics_observe(m_start_us, (uint32_t)start_us);
+        s_led_stats.applied++;
+        cur = mail;
+        have_applied = true;
+        fading = true;
+    }
+}
+
+static void log_led_stats(void) {
+    uint32_t n = s_led_stats.applied;
+    uint32_t k = s_led_stats.acks;
+    if (n == 0 || k == 0) return;
+    ESP_LOGI(TAG, "📊 applied=%u overwritten=%u coalesced=%u stale=%u acks=%u",
+             (unsigned)n, (unsigned)s_led_overwritten, (unsigned)s_led_stats.coalesced,
+             (unsigned)s_led_stats.stale, (unsigned)k);
+    ESP_LOGI(TAG, "   cmd->PWM start  us: min=%lld avg=%lld max=%lld",
+             (long long)s_led_stats.start_us_min, (long long)(s_led_stats.start_us_sum / n),
+             (long long)s_led_stats.start_us_max);
+    ESP_LOGI(TAG, "   cmd->final duty us: min=%lld avg=%lld max=%lld",
+             (long long)s_led_stats.final_us_min, (long long)(s_led_stats.final_us_sum / k),
+             (long long)s_led_stats.final_us_max);
 }
 
 /* ==== SEND-CB (log สถานะส่ง ACK) ==== */
 static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
+    espnow_boot_mark_first_tx();
+    espnow_disc_on_sent(info->des_addr, status == ESP_NOW_SEND_SUCCESS);
+    espnow_metrics_inc(status == ESP_NOW_SEND_SUCCESS ? m_tx_ok : m_tx_fail);
     ESP_LOGI(TAG, "ACK send status: %s", status == ESP_NOW_SEND_SUCCESS ? "SUCCESS" : "FAIL");
 }
 
-/* ==== RECV-CB (รับคำสั่งจากฝั่ง A และตอบกลับ) ==== */
+/* ==== SET_LED handler: แค่ฝากคำสั่งลง mailbox (ทับของเดิม) — ไม่แตะ LEDC ใน Wi-Fi task ==== */
+static void on_led_set(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    led_mail_t mail;
+    mail.rx_us = esp_timer_get_time();
+    memcpy(&mail.cmd, data, sizeof(mail.cmd));
+    memcpy(mail.src, info->src_addr, 6);
+    if (uxQueueMessagesWaiting(s_led_mailbox) > 0) s_led_overwritten++;
+    xQueueOverwrite(s_led_mailbox, &mail);
+}
+
+/* ==== RECV-CB (กรอง partner แล้วส่งต่อให้ตาราง dispatch) ==== */
 static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
     if (!info || !info->src_addr || !data || len <= 0) return;
+    espnow_metrics_inc(m_rx);
 
     // รับเฉพาะจาก partner เท่านั้น (กันสัญญาณคนนอก)
-    if (!mac_eq(info->src_addr, partner_mac)) {
+    if (data[0] != ESPNOW_MSG_DISC && !mac_eq(info->src_addr, partner_mac)) {
+        espnow_metrics_inc(m_foreign);
         ESP_LOGW(TAG, "Ignore from %02X:%02X:%02X:%02X:%02X:%02X len=%d",
                  info->src_addr[0],info->src_addr[1],info->src_addr[2],
                  info->src_addr[3],info->src_addr[4],info->src_addr[5], len);
         return;
     }
 
-    if (len != sizeof(led_control_t)) {
-        ESP_LOGW(TAG, "Size mismatch: %d != %d", len, (int)sizeof(led_control_t));
-        return;
-    }
-
-    led_control_t cmd = {0};
-    memcpy(&cmd, data, sizeof(cmd));
-
-    if (strncmp(cmd.command, "SET_LED", sizeof(cmd.command)) == 0) {
-        ESP_LOGI(TAG, "📥 SET_LED: state=%s, bright=%u",
-                 cmd.led_state ? "ON" : "OFF", (unsigned)cmd.brightness);
-
-        // ใช้งานจริง: clamp ความสว่าง
-        if (cmd.brightness > 255) cmd.brightness = 255;
-        led_apply(cmd.led_state, cmd.brightness);
-
-        // เตรียมส่ง ACK กลับ
-        if (!esp_now_is_peer_exist(info->src_addr)) {
-            esp_now_peer_info_t p = {0};
-            memcpy(p.peer_addr, info->src_addr, 6);
-            p.ifidx   = WIFI_IF_STA;
-            p.channel = CHANNEL;
-            p.encrypt = false;
-            esp_err_t er = esp_now_add_peer(&p);
-            if (er != ESP_OK && er != ESP_ERR_ESPNOW_EXIST) {
-                ESP_LOGE(TAG, "add_peer(A) failed: %d", er);
-                return;
-            }
-        }
-
-        led_control_t ack = {0};
-        ack.led_state  = cmd.led_state;
-        ack.brightness = cmd.brightness;
-        snprintf(ack.command, sizeof(ack.command), "LED_ACK");
+    // type ไม่รู้จัก / ขนาดไม่ตรง -> นับใน espnow_msg (ไม่ log)
+    espnow_msg_dispatch(info, data, len);
+}
 
-        esp_err_t er = esp_now_send(info->src_addr, (const uint8_t*)&ack, sizeof(ack));
-        if (er != ESP_OK) ESP_LOGE(TAG, "esp_now_send(ACK) failed: %d", er);
-        else ESP_LOGI(TAG, "📤 ACK sent");
-    } else {
-        ESP_LOGW(TAG, "Unknown command: %s", cmd.command);
-    }
+/* ==== metrics: ตัวนับของ espnow_msg / mailbox คัดลอกตอนสร้างเฟรม ==== */
+static void metrics_collect(void) {
+    espnow_metrics_set(m_overwritten, (int32_t)s_led_overwritten);
+    espnow_metrics_set(m_bad_len, (int32_t)espnow_msg_bad_len_count());
+    espnow_metrics_set(m_unknown, (int32_t)espnow_msg_unknown_count());
 }
 
-static void wifi_init_for_espnow(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+static void metrics_init(void) {
+    static const uint32_t start_bounds[ESPNOW_METRICS_HIST_BUCKETS - 1] = {50, 100, 200, 500, 1000, 2000, 5000};
+    m_rx          = espnow_metrics_counter("rx_frames");
+    m_foreign     = espnow_metrics_counter("rx_foreign");
+    m_tx_ok       = espnow_metrics_counter("tx_ok");
+    m_tx_fail     = espnow_metrics_counter("tx_fail");
+    m_send_err    = espnow_metrics_counter("send_err");
+    m_overwritten = espnow_metrics_gauge("led_overwritten");
+    m_bad_len     = espnow_metrics_gauge("rx_bad_len");
+    m_unknown     = espnow_metrics_gauge("rx_unknown");
+    m_start_us    = espnow_metrics_hist("led_start_us", start_bounds);
 
-    if (channel >= 1 && channel <= 13) {
-        wifi_config_t sta_cfg = {0};
-        sta_cfg.sta.channel = channel;
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
-    }
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", channel);
+    espnow_metrics_config_t cfg = {
+        .period_ms = METRICS_PERIOD_MS,
+        .peer      = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        .collect   = metrics_collect,
+    };
+    if (METRICS_PERIOD_MS > 0) ESP_ERROR_CHECK(espnow_boot_add_peer(cfg.peer, 0));
+    ESP_ERROR_CHECK(espnow_metrics_start(&cfg));
+    ESP_ERROR_CHECK(espnow_metrics_console_init(CONSOLE_REPL));
 }
 
 static void espnow_init_and_add_partner(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_LED_SET, sizeof(led_control_t), on_led_set));
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
 
-    // เพิ่ม peer ของฝั่ง A ไว้ล่วงหน้า (ทางเลือก — มี dynamic add ใน callback อยู่แล้ว)
-    esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, partner_mac, 6);
-    peer.ifidx   = WIFI_IF_STA;
-    peer.channel = channel;
-    peer.encrypt = false;
-    esp_err_t er = esp_now_add_peer(&peer);
-    if (er == ESP_OK || er == ESP_ERR_ESPNOW_EXIST) {
+    // รอ partner จาก discovery (NVS = ทันที, ไม่งั้นรอ HELLO/REPLY)
+    ESP_ERROR_CHECK(espnow_disc_wait_peer(partner_mac, UINT32_MAX));
+    log_mac("🤝 Partner:", partner_mac);
+
+    // เพิ่ม peer ของฝั่ง A ไว้ล่วงหน้า (ทางเลือก — มี dynamic add ตอนส่ง ACK อยู่แล้ว)
+    esp_err_t er = espnow_boot_add_peer(partner_mac, channel);
+    if (er == ESP_OK) {
         ESP_LOGI(TAG, "Peer(A) pre-added");
     } else {
         ESP_LOGW(TAG, "add_peer(partner) warn: %d (จะอาศัย dynamic add ก็ได้)", er);
     }
 }
 
+/* discovery ยืนยัน controller ตัวอื่นแทน (บอร์ดเดิมหาย/ถูกเปลี่ยน) -> รับคำสั่งจากตัวใหม่ ไม่ต้องลบ NVS */
+static void follow_partner(void) {
+    if (!espnow_disc_refresh_peer(partner_mac)) return;
+    log_mac("🔄 Partner changed:", partner_mac);
+    esp_err_t er = espnow_boot_add_peer(partner_mac, 0);
+    if (er != ESP_OK) ESP_LOGW(TAG, "follow partner: %s", esp_err_to_name(er));
+}
+
 void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
-    }
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น)
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel = CHANNEL;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
 
-    wifi_init_for_espnow(CHANNEL);
+    s_led_mailbox = xQueueCreate(1, sizeof(led_mail_t));
+    // ★ ไม่ต้อง hardcode MAC: หา partner ด้วย discovery (จำไว้ใน NVS)
+    espnow_disc_config_t disc_cfg = {
+        .my_role   = ESPNOW_DISC_ROLE_LED_NODE,
+        .want_role = ESPNOW_DISC_ROLE_LED_CTRL,
+        .channel   = CHANNEL,
+        .use_nvs   = true,
+        .scan      = true,
+    };
+    ESP_ERROR_CHECK(espnow_disc_init(&disc_cfg));
     espnow_init_and_add_partner(CHANNEL);
+    metrics_init();
     led_pwm_init();
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
+    xTaskCreate(led_task, "led_task", 3072, NULL, 5, NULL);
+#if REPLAY_SPEED_PCT >= 0
+    espnow_replay_config_t replay = ESPNOW_REPLAY_CONFIG_DEFAULT();
+    replay.recv      = on_data_recv;
+    replay.speed_pct = REPLAY_SPEED_PCT;
+    ESP_ERROR_CHECK(espnow_replay_start(&replay));
+#endif
 
     // พิมพ์ MAC ตัวเองช่วยตั้งค่า
     uint8_t mymac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mymac));
     log_mac("📍 My STA MAC:", mymac);
+    espnow_boot_report();
+    espnow_disc_report();
 
-    ESP_LOGI(TAG, "LED Controller ready (pin=%d, 8-bit PWM)", LED_PIN);
-    while (1) vTaskDelay(pdMS_TO_TICKS(1000));
+    ESP_LOGI(TAG, "LED Controller ready (pin=%d, 8-bit PWM, fade=%dms)", LED_PIN, LED_FADE_MS);
+    while (1) {
+        for (int i = 0; i < 10; i++) {      // partner ใหม่ถูกกรองทิ้งจนกว่าจะ follow -> เช็กทุกวินาที
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            follow_partner();
+        }
+        log_led_stats();
+    }
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 // main/espnow_sensor_rx.c
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "esp_system.h"
 #include "esp_event.h"
@@ -14,87 +17,618 @@
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_now.h"
+#include "driver/gpio.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "espnow_disc.h"
+#include "espnow_flow.h"
+#include "espnow_tdma.h"
+#include "espnow_stress.h"
+#include "espnow_replay.h"
+#include "gw_stats.h"
+#include "gw_registry.h"
+#include "gw_serial.h"
+#include "gw_tsdb.h"
+#include "gw_rollup.h"
+#include "gw_mqtt.h"
+#include "espnow_metrics.h"
+#include "link_mtu.h"
 
 static const char* TAG = "ESP_NOW_SENSOR_RX";
 
+/* flow control: recv-cb แค่ใส่คิว งานหนัก (log) อยู่ใน rx_task แล้วคืน credit ตามช่องที่ว่าง */
+#define RX_QUEUE_DEPTH    8
+#define RX_PROCESS_MS     0      // จำลอง consumer ช้า (ms ต่อเฟรม)
+#define CREDIT_PERIOD_MS  500    // ส่ง credit ซ้ำให้ sender ที่ค้าง window 0 (credit หายอย่างอื่น sender probe เอง)
+#define CREDIT_ACTIVE_MS  10000  // sender ที่ส่งมาภายในนี้ได้ส่วนแบ่งของคิว RX
+#define TDMA_BEACON       0      // 1 = broadcast beacon + แจก slot ให้ sender (คู่กับ TDMA_MODE ของ sender, ดู espnow_tdma.h)
+
+/* rolling stats ต่อ sensor (1 นาที / 15 นาที / 1 ชม.) — STATS_BENCH > 0 = วัด ingest ตอนบูต
+   GW_MAX_SENSORS = ขนาดเดียวกันทั้ง gw_stats / registry (เริ่มต้น) / rollup: handle ของ registry ใช้เป็น index
+   registry โตเกินนี้ได้ -> sample ของ handle ที่เกินไม่มี rolling stats (นับใน stats_skip) */
+#define GW_MAX_SENSORS       64
+#define STATS_BENCH          0
+#define REG_BENCH            0      // > 0 = วัด registry ที่ N sensor ตอนบูต
+
+/* ทุก sample ลง flash (partition "tsdb") + rollup 1 นาที / 1 ชม. (roll_1m / roll_1h) — temp/hum เก็บ x100, light ตรง ๆ
+   staging page เขียนเองเมื่อเต็ม, flush ส่วนที่ค้างทุก TSDB_FLUSH_MS
+   อายุข้อมูลที่ 16 sensor x 1 sample / 5 s: raw ~1.8 ชม., 1m ~16 ชม., 1h ~5 วัน (ขยายตาม partition) */
+#define TSDB_FLUSH_MS        60000
+#define TSDB_BENCH           0      // > 0 = ⚠️ ลบ partition raw แล้ววัด append/scan/recovery N sample
+
+/* SERIAL_BRIDGE = 1 -> ทุกเฟรมที่รับได้ออก UART0 @ 921600 เป็น record ไบนารี (COBS + CRC32)
+   log ปิดเหลือ ERROR — ฝั่ง host ใช้ tools/espnow_bridge.py */
+#define SERIAL_BRIDGE        0
+
+/* MQTT_BRIDGE = 1 -> ต่อ AP แล้วส่ง sample ที่ถอดแล้วเข้า broker เป็น batch (ดู gw_mqtt.h)
+   channel ของ ESP-NOW ย้ายตาม AP (ปุ่ม BOOT ย้าย channel ใช้ไม่ได้)
+   broker ไม่อยู่ = ลง partition "mqtt_q" (~3k sample = ~16 นาทีที่ 16 sensor)
+   MQTT_BENCH > 0 = ยิง N sample ปลอมตอนบูต วัด samples/s + latency (ลอง: mosquitto -v บนเครื่อง dev) */
+#define MQTT_BRIDGE          0
+#define MQTT_WIFI_SSID       "my-ap"
+#define MQTT_WIFI_PASS       "my-password"
+#define MQTT_BROKER_URI      "mqtt://192.168.1.10:1883"
+#define MQTT_BENCH           0
+
+/* metrics ของ gateway เอง: SERIAL_BRIDGE = 1 -> stats frame ออก bridge ทุก METRICS_PERIOD_MS (record KIND_STATS)
+   ไม่งั้นดูผ่าน console "metrics" (UART เดียวกับ bridge จึงใช้พร้อมกันไม่ได้)
+   stats frame จาก node (ESPNOW_MSG_STATS) ออก bridge เป็นเฟรม RX ปกติอยู่แล้ว — ที่นี่แค่นับ */
+#define METRICS_PERIOD_MS    30000
+
+/* STRESS_SENDERS_MAX > 0 -> ยิง sender ปลอมเข้า on_data_recv เพื่อหาความจุ gateway
+   เริ่ม STRESS_SENDERS_STEP ตัว เพิ่มทีละ STRESS_SENDERS_STEP ทุก STRESS_STEP_MS */
+#define STRESS_SENDERS_MAX   0
+#define STRESS_SENDERS_STEP  25
+#define STRESS_INTERVAL_MS   5000   // เท่า TX_INTERVAL_MS ของ sender_data
+#define STRESS_STEP_MS       10000
+
+/* REPLAY_SPEED_PCT >= 0 -> เล่น capture (.ecap) จาก partition "replay" เข้า on_data_recv
+   100 = จังหวะเดิม, 0 = เร็วที่สุด (วัด handler) — สร้างไฟล์ด้วย tools/espnow_capture.py */
+#define REPLAY_SPEED_PCT     -1
+#define REPLAY_LOOPS         1
+
+/* กดปุ่ม BOOT = ย้าย gateway ไป channel ถัดไป (1 -> 6 -> 11) จำใน NVS
+   sensor จะส่งไม่ผ่านติดกันแล้วกวาดตามมาเอง — ย้ายทั้ง fleet ได้โดยไม่ต้องแฟลชใหม่ */
+#define CHANNEL_BTN_GPIO  GPIO_NUM_0
+
 /* โครงสร้างต้องเหมือนฝั่งส่งทุก byte */
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;    // ESPNOW_MSG_SENSOR
     float    temperature;
     float    humidity;
     int32_t  light_level;
     char     sensor_id[10];
     uint32_t timestamp_ms;
+    uint32_t seq;            // ใช้คิด credit
 } sensor_data_t;
 
+/* หลัง gateway แจก handle (ESPNOW_MSG_SENSOR_HANDLE) ส่งแบบสั้น: handle 2 byte แทน sensor_id[10] */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_SHORT
+    uint16_t handle;
+    float    temperature;
+    float    humidity;
+    int32_t  light_level;
+    uint32_t timestamp_ms;
+    uint32_t seq;
+} sensor_short_t;
+
+/* gateway -> sender: handle ของ sensor_id นี้ (0xFFFF = ไม่รู้จักแล้ว กลับไปส่งแบบเต็ม) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_HANDLE
+    uint16_t handle;
+    char     sensor_id[10];
+} sensor_handle_t;
+
+/* batch: รวมหลาย sample เป็นเฟรมเดียว -> peer v2 ได้เฟรมใหญ่เฟรมเดียว, peer v1 ได้เป็น fragment */
+#define BATCH_MAX         90      // (1470 - header 16 B) / sizeof(sensor_sample_t) 16 B
+
+typedef struct __attribute__((packed)) {
+    float    temperature;
+    float    humidity;
+    int32_t  light_level;
+    uint32_t timestamp_ms;
+} sensor_sample_t;
+
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_BATCH
+    char     sensor_id[10];
+    uint32_t seq;             // ใช้ seq เดียวกับ sensor_data_t (credit)
+    uint8_t  count;
+    sensor_sample_t samples[BATCH_MAX];
+} sensor_batch_t;
+
+#define SENSOR_BATCH_LEN(n) (offsetof(sensor_batch_t, samples) + (n) * sizeof(sensor_sample_t))
+_Static_assert(SENSOR_BATCH_LEN(BATCH_MAX) <= 1470, "batch must fit one ESP-NOW v2 frame");
+
+/* สถิติ batch (นับและ log ใน rx_task เท่านั้น) */
+static uint32_t s_batches, s_batch_samples, s_batch_bytes;
+
+/* ความจุ: คิวลึกสุด (Wi-Fi task), เฟรมที่ทำเสร็จ + เวลาที่ rx_task ทำงาน (rx_task) */
+static volatile uint32_t s_q_hwm;
+static volatile uint32_t s_processed;
+static volatile uint64_t s_busy_us;
+
+/* (MAC + sensor_id) -> handle, handle = index ของ gw_stats ด้วย (ใช้ใน rx_task เท่านั้น) */
+static espnow_gw_reg_t s_reg;
+
+typedef struct {
+    sensor_data_t   data;
+    uint8_t         src[6];
+    uint16_t        handle;  // ESPNOW_GW_REG_INVALID = เฟรมเต็ม (มี sensor_id)
+    sensor_batch_t *batch;   // != NULL = เฟรม batch (data มีแค่ sensor_id + seq) — rx_task free
+} rx_item_t;
+
+static QueueHandle_t    rx_q;
+/* flow control แยกต่อ sender (registry entry) — ที่นี่แค่ยอดรวมไว้ report */
+static portMUX_TYPE     s_ovf_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t         s_overflow;                     // RX queue เต็ม (Wi-Fi task)
+static uint32_t         s_flow_received, s_flow_lost;   // rx_task
+static uint32_t         s_peer_full;                    // ตาราง peer เต็ม -> ข้าม credit/handle (rx_task)
+static uint32_t         s_stats_skip;                   // sample ของ handle >= GW_MAX_SENSORS (rx_task)
+static uint16_t         s_active_senders;               // ส่งมาภายใน CREDIT_ACTIVE_MS (นับทุก credit_sweep)
+
+static espnow_metric_t *m_rx, *m_stats_rx, *m_send_err, *m_proc_us;
+static espnow_metric_t *m_q_depth, *m_overflow, *m_lost, *m_peer_full, *m_bad_len, *m_unknown;
+
 /* พิมพ์ MAC ให้อ่านง่าย */
 static void log_mac(const char *prefix, const uint8_t mac[6]) {
     ESP_LOGI(TAG, "%s %02X:%02X:%02X:%02X:%02X:%02X",
              prefix, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
-/* Wi-Fi STA + (ถ้าต้องการ) ล็อกชานเนลให้ตรงกับฝั่งส่ง */
-static void wifi_init_for_espnow(uint8_t channel /*1..13 หรือ 0=ไม่ล็อก*/) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+/* ESPNOW_MSG_SENSOR handler (ขนาดเช็กแล้วใน espnow_msg_dispatch) — ห้าม log ตรงนี้ */
+static bool enqueue(rx_item_t *item, const esp_now_recv_info_t *info) {
+    memcpy(item->src, info->src_addr, 6);
+    espnow_tdma_gw_on_rx(info->src_addr);
+    bool ok = xQueueSend(rx_q, item, 0) == pdTRUE;
+    if (!ok) {
+        portENTER_CRITICAL(&s_ovf_lock);
+        s_overflow++;
+        portEXIT_CRITICAL(&s_ovf_lock);
+    }
+    uint32_t depth = uxQueueMessagesWaiting(rx_q);
+    if (depth > s_q_hwm) s_q_hwm = depth;
+    return ok;
+}
 
-    wifi_init_config_t wcfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&wcfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+static void on_sensor(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    rx_item_t item;
+    memcpy(&item.data, data, sizeof(item.data));
+    item.handle = ESPNOW_GW_REG_INVALID;
+    item.batch  = NULL;
+    enqueue(&item, info);
+}
 
-    if (channel >= 1 && channel <= 13) {
-        wifi_config_t sta_cfg = {0};
-        sta_cfg.sta.channel = channel;
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
-    }
+/* ESPNOW_MSG_SENSOR_SHORT: sensor_id มาจาก registry ใน rx_task */
+static void on_sensor_short(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    const sensor_short_t *s = (const sensor_short_t *)data;
+    rx_item_t item = {0};
+    item.data.hdr.type     = ESPNOW_MSG_SENSOR;
+    item.data.temperature  = s->temperature;
+    item.data.humidity     = s->humidity;
+    item.data.light_level  = s->light_level;
+    item.data.timestamp_ms = s->timestamp_ms;
+    item.data.seq          = s->seq;
+    item.handle            = s->handle;
+    enqueue(&item, info);
+}
+
+/* ESPNOW_MSG_SENSOR_BATCH (ความยาวแปรผัน — มาได้ทั้งเฟรม v2 เดียว หรือประกอบจาก fragment)
+   ทั้ง batch เป็น item เดียวในคิว (= credit 1 ช่อง) — ตัว sample คัดลอกไว้ใน heap ให้ rx_task แตก */
+static void on_sensor_batch(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    const sensor_batch_t *b = (const sensor_batch_t *)data;
+    if (len < (int)SENSOR_BATCH_LEN(0) || b->count > BATCH_MAX || len != (int)SENSOR_BATCH_LEN(b->count)) return;
 
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", channel);
+    rx_item_t item = {0};
+    item.batch = malloc(len);
+    if (!item.batch) return;
+    memcpy(item.batch, data, len);
+    item.data.hdr.type = ESPNOW_MSG_SENSOR;
+    memcpy(item.data.sensor_id, b->sensor_id, sizeof(item.data.sensor_id));
+    item.data.seq = b->seq;
+    item.handle   = ESPNOW_GW_REG_INVALID;
+    if (!enqueue(&item, info)) free(item.batch);
 }
 
-/* recv callback (รูปแบบใหม่ v5.x) */
-static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-    if (!data || len <= 0) return;
+static void send_handle(const uint8_t mac[6], uint16_t handle, const char *id) {
+    sensor_handle_t m = { .hdr.type = ESPNOW_MSG_SENSOR_HANDLE, .handle = handle };
+    if (id) memcpy(m.sensor_id, id, sizeof(m.sensor_id));
+    if (espnow_boot_touch_peer(mac) != ESP_OK) {
+        s_peer_full++;
+        return;
+    }
+    esp_err_t er = esp_now_send(mac, (const uint8_t *)&m, sizeof(m));
+    if (er != ESP_OK) {
+        espnow_metrics_inc(m_send_err);
+        ESP_LOGW(TAG, "handle send failed: %s", esp_err_to_name(er));
+    }
+}
 
-    if (info && info->src_addr) {
-        log_mac("📥 From", info->src_addr);
+/* หา handle ของเฟรม: เฟรมเต็ม -> intern (แล้วบอก handle ให้ sender), เฟรมสั้น -> ตรวจว่าเป็นของ MAC นี้จริง */
+static espnow_gw_sensor_t *resolve_sensor(rx_item_t *item, bool synthetic) {
+    sensor_data_t *rx = &item->data;
+    if (item->handle == ESPNOW_GW_REG_INVALID) {
+        item->handle = espnow_gw_reg_intern(&s_reg, item->src, rx->sensor_id, NULL);
+        if (item->handle == ESPNOW_GW_REG_INVALID) return NULL;
+        // ส่งซ้ำจนกว่า sender จะเปลี่ยนเป็นเฟรมสั้น (batch ใช้ sensor_id เต็มเสมอ ไม่ต้องบอก)
+        if (!synthetic && !item->batch) send_handle(item->src, item->handle, rx->sensor_id);
     }
+    espnow_gw_sensor_t *s = espnow_gw_reg_get(&s_reg, item->handle);
+    if (!s || memcmp(s->key.mac, item->src, 6) != 0) {
+        if (!synthetic) send_handle(item->src, ESPNOW_GW_REG_INVALID, NULL);   // gateway รีบูต/handle ผิด
+        return NULL;
+    }
+    memcpy(rx->sensor_id, s->key.id, sizeof(rx->sensor_id));
+    s->frames++;
+    s->last_seen_us = esp_timer_get_time();
+    return s;
+}
 
-    if (len != sizeof(sensor_data_t)) {
-        ESP_LOGW(TAG, "size mismatch: %d (expect %u)", len, (unsigned)sizeof(sensor_data_t));
+/* credit ของ sender นี้เอง (ack_seq จาก seq ของมัน, window = ช่องว่างในคิวรวม) */
+static void send_credit(espnow_gw_sensor_t *s) {
+    // แบ่งที่ว่างในคิวร่วมให้ sender ที่ active — ไม่งั้น N ตัวได้คนละเต็มคิว (จองเกิน N เท่า)
+    // ว่างน้อยกว่าจำนวน sender ก็ยังให้ 1 (จองเกินได้ไม่เกิน N - ที่ว่าง) ไม่งั้นบางตัวไม่ได้ส่งเลย
+    UBaseType_t free_slots = uxQueueSpacesAvailable(rx_q);
+    UBaseType_t share = free_slots / (s_active_senders ? s_active_senders : 1);
+    if (free_slots && !share) share = 1;
+    espnow_flow_credit_t c;
+    espnow_flow_rx_build(&s->flow, (uint8_t)(share > UINT8_MAX ? UINT8_MAX : share), &c);
+    s->credit_window = c.window;
+    if (espnow_boot_touch_peer(s->key.mac) != ESP_OK) {   // เต็มด้วย peer ของที่อื่น: sender probe เอง
+        s_peer_full++;
         return;
     }
+    esp_err_t er = esp_now_send(s->key.mac, (const uint8_t *)&c, sizeof(c));
+    if (er != ESP_OK) {
+        espnow_metrics_inc(m_send_err);
+        ESP_LOGW(TAG, "credit send failed: %s", esp_err_to_name(er));
+    }
+}
 
-    sensor_data_t rx = {0};
-    memcpy(&rx, data, sizeof(rx));
+static inline int16_t to_fixed(float x) {
+    if (x > INT16_MAX) return INT16_MAX;
+    if (x < INT16_MIN) return INT16_MIN;
+    return (int16_t)(x < 0 ? x - 0.5f : x + 0.5f);
+}
 
-    ESP_LOGI(TAG, "   ID   : %s", rx.sensor_id);
-    ESP_LOGI(TAG, "   Temp : %.2f C", rx.temperature);
-    ESP_LOGI(TAG, "   Hum  : %.2f %%", rx.humidity);
-    ESP_LOGI(TAG, "   LDR  : %ld", (long)rx.light_level);
-    ESP_LOGI(TAG, "   Time : %" PRIu32 " ms", rx.timestamp_ms);
-    ESP_LOGI(TAG, "--------------------------------");
+static bool count_point(const espnow_gw_rollup_point_t *pt, void *ctx) {
+    (*(uint32_t *)ctx)++;
+    return true;
 }
 
-void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
+/* ต่อ AP แล้ววิทยุอยู่ channel ของ AP -> ESP-NOW (และ REPLY ของ discovery) ต้องตามไป */
+static void follow_ap_channel(uint8_t channel) {
+    espnow_disc_set_channel(channel);
+}
+
+/* sample เดียว (rx มี sensor_id แล้ว) -> rolling stats / rollup / MQTT — คืน key ถาวรของ sensor
+   age_ms = อายุ sample เทียบกับตอนรับ (batch: ห่างจาก sample ใหม่สุดตาม timestamp_ms ของ sender)
+   log ต่อเฟรมเป็น DEBUG: ที่ INFO ตอน stress จะวัดได้แค่ความเร็ว UART (มีรายงานรวมทุก 10 s แทน) */
+static uint32_t ingest_sample(const rx_item_t *item, const sensor_data_t *rx, int64_t now_us, uint32_t age_ms) {
+    ESP_LOGD(TAG, "📥 From %02X:%02X:%02X:%02X:%02X:%02X",
+             item->src[0], item->src[1], item->src[2], item->src[3], item->src[4], item->src[5]);
+    ESP_LOGD(TAG, "   ID   : %s #%u (seq %" PRIu32 ")", rx->sensor_id, item->handle, rx->seq);
+    ESP_LOGD(TAG, "   Temp : %.2f C", rx->temperature);
+    ESP_LOGD(TAG, "   Hum  : %.2f %%", rx->humidity);
+    ESP_LOGD(TAG, "   LDR  : %ld", (long)rx->light_level);
+    ESP_LOGD(TAG, "   Time : %" PRIu32 " ms", rx->timestamp_ms);
+    if (item->handle < GW_MAX_SENSORS) {
+        const float v[ESPNOW_GW_FIELD_MAX] = { rx->temperature, rx->humidity, (float)rx->light_level };
+        espnow_gw_stats_add(item->handle, now_us / 1000 - age_ms, v);
+    } else if (s_stats_skip++ == 0) {
+        ESP_LOGW(TAG, "⚠️ sensor #%u beyond GW_MAX_SENSORS=%d: no rolling stats (counted as stats_skip)",
+                 item->handle, GW_MAX_SENSORS);
+    }
+    const espnow_gw_tsdb_sample_t x = {
+        .ts = espnow_gw_tsdb_now() - age_ms / 1000,
+        .sensor = espnow_gw_key_hash(item->src, rx->sensor_id),
+        .v = { to_fixed(rx->temperature * 100.0f), to_fixed(rx->humidity * 100.0f),
+               to_fixed((float)rx->light_level) },
+    };
+    espnow_gw_rollup_ingest(&x);
+    if (MQTT_BRIDGE) espnow_gw_mqtt_push(&x);
+    return x.sensor;
+}
+
+/* นับ sender ที่ active (แบ่ง window) + sender ที่ได้ window 0 ไปล่าสุดและยังเงียบไม่นาน = รอ credit อยู่
+   -> บอกใหม่เมื่อคิวมีที่ว่าง */
+static void credit_sweep(void) {
+    int64_t now = esp_timer_get_time();
+    uint16_t active = 0;
+    for (uint16_t h = 0; h < s_reg.count; h++) {
+        espnow_gw_sensor_t *s = espnow_gw_reg_get(&s_reg, h);
+        if (s && s->frames && now - s->last_seen_us < CREDIT_ACTIVE_MS * 1000LL &&
+            !espnow_stress_is_synthetic(s->key.mac)) {
+            active++;
+        }
+    }
+    s_active_senders = active;
+
+    if (uxQueueSpacesAvailable(rx_q) == 0) return;
+    for (uint16_t h = 0; h < s_reg.count; h++) {
+        espnow_gw_sensor_t *s = espnow_gw_reg_get(&s_reg, h);
+        if (s && s->credit_window == 0 && s->frames && now - s->last_seen_us < CREDIT_ACTIVE_MS * 1000LL &&
+            !espnow_stress_is_synthetic(s->key.mac)) {
+            send_credit(s);
+        }
+    }
+}
+
+/* consumer: log ข้อมูล แล้วคืน credit ให้ sender ของเฟรมนั้น + sender ที่ค้าง window 0 ทุก CREDIT_PERIOD_MS */
+static void rx_task(void *arg) {
+    rx_item_t item;
+    int64_t last_report = esp_timer_get_time(), last_flush = last_report, last_sweep = last_report;
+    uint32_t last_key = 0;
+
+    while (1) {
+        if (xQueueReceive(rx_q, &item, pdMS_TO_TICKS(CREDIT_PERIOD_MS)) == pdTRUE) {
+            int64_t t0 = esp_timer_get_time();
+            bool synthetic = espnow_stress_is_synthetic(item.src);   // ไม่ add peer / ไม่ส่ง credit / ไม่ลง store
+
+            sensor_data_t *rx = &item.data;
+            espnow_gw_sensor_t *s = resolve_sensor(&item, synthetic);   // handle ผิด -> ทิ้ง (บอก sender แล้ว)
+            if (s) {
+                uint32_t lost0 = s->flow.lost;
+                espnow_flow_rx_on_frame(&s->flow, rx->seq);
+                s_flow_received++;
+                if (s->flow.lost >= lost0) s_flow_lost += s->flow.lost - lost0;   // ต่ำลง = sender รีบูต นับใหม่
+                rx->sensor_id[sizeof(rx->sensor_id) - 1] = '\0';
+                // stress วัด pipeline RX/flow เท่านั้น — sample สังเคราะห์ไม่ลง tsdb/rollup/MQTT
+                if (!synthetic && !item.batch) {
+                    last_key = ingest_sample(&item, rx, t0, 0);
+                } else if (!synthetic && item.batch->count > 0) {
+                    const sensor_batch_t *b = item.batch;
+                    uint32_t newest_ms = b->samples[b->count - 1].timestamp_ms;
+                    for (int i = 0; i < b->count; i++) {
+                        rx->temperature  = b->samples[i].temperature;
+                        rx->humidity     = b->samples[i].humidity;
+                        rx->light_level  = b->samples[i].light_level;
+                        rx->timestamp_ms = b->samples[i].timestamp_ms;
+                        last_key = ingest_sample(&item, rx, t0, newest_ms - b->samples[i].timestamp_ms);
+                    }
+                }
+                if (item.batch) {
+                    const sensor_batch_t *b = item.batch;
+                    s_batches++;
+                    s_batch_samples += b->count;
+                    s_batch_bytes   += SENSOR_BATCH_LEN(b->count);
+                }
+            }
+            free(item.batch);
+            if (s && !synthetic) send_credit(s);
+            if (RX_PROCESS_MS > 0) vTaskDelay(pdMS_TO_TICKS(RX_PROCESS_MS));
+            int64_t busy = esp_timer_get_time() - t0;
+            espnow_metrics_observe(m_proc_us, (uint32_t)busy);
+            s_busy_us += busy;
+            s_processed++;
+        }
+        if (esp_timer_get_time() - last_sweep >= CREDIT_PERIOD_MS * 1000LL) {
+            last_sweep = esp_timer_get_time();
+            credit_sweep();
+        }
+
+        if (esp_timer_get_time() - last_report >= 10 * 1000000LL) {
+            last_report = esp_timer_get_time();
+            ESP_LOGI(TAG, "📊 flow: received=%" PRIu32 " lost=%" PRIu32 " overflow=%" PRIu32
+                     " peer_full=%" PRIu32 " evicted=%" PRIu32 " stats_skip=%" PRIu32,
+                     s_flow_received, s_flow_lost, s_overflow, s_peer_full, espnow_boot_peer_evictions(), s_stats_skip);
+            if (s_batches) {
+                ESP_LOGI(TAG, "📦 batch: %" PRIu32 " frames, %" PRIu32 " samples, %" PRIu32 " bytes (%" PRIu32 " B/s)",
+                         s_batches, s_batch_samples, s_batch_bytes, s_batch_bytes / 10);
+                s_batches = s_batch_samples = s_batch_bytes = 0;
+            }
+            if (TDMA_BEACON) espnow_tdma_gw_report();
+            espnow_gw_reg_report(&s_reg);
+            espnow_gw_rollup_tick(espnow_gw_tsdb_now());
+            if (last_report - last_flush >= TSDB_FLUSH_MS * 1000LL) {
+                last_flush = last_report;
+                espnow_gw_rollup_flush();
+            }
+            espnow_gw_tsdb_report(espnow_gw_rollup_store(ESPNOW_GW_RES_RAW));
+            espnow_gw_rollup_report();
+            if (MQTT_BRIDGE) espnow_gw_mqtt_report();
+            if (last_key) {
+                uint32_t now = espnow_gw_tsdb_now();
+                espnow_gw_res_t res;
+                int64_t q0 = esp_timer_get_time();
+                uint32_t pts = 0;
+                espnow_gw_rollup_query(last_key, 0, now > 86400 ? now - 86400 : 0, now, 3600, count_point, &pts, &res);
+                ESP_LOGI(TAG, "📉 24 h temp of %08" PRIx32 ": %" PRIu32 " hourly points from %s level in %" PRId64 " us",
+                         last_key, pts, res == ESPNOW_GW_RES_RAW ? "raw" : res == ESPNOW_GW_RES_1M ? "1m" : "1h",
+                         esp_timer_get_time() - q0);
+            }
+            if (SERIAL_BRIDGE) {
+                espnow_gw_serial_stats_t ss;
+                espnow_gw_serial_get_stats(&ss);
+                ESP_LOGI(TAG, "🔌 bridge: records=%" PRIu32 " drops=%" PRIu32 " bytes=%" PRIu64 " ring_min_free=%" PRIu32,
+                         ss.records, ss.drops, ss.bytes, ss.ring_low_water);
+            }
+            for (int i = 0; i < s_reg.count && i < 4; i++) {
+                espnow_gw_stat_t m1, h1;
+                if (espnow_gw_stats_query(i, ESPNOW_GW_WIN_1M, ESPNOW_GW_FIELD_TEMP, last_report / 1000, &m1) != ESP_OK) continue;
+                espnow_gw_stats_query(i, ESPNOW_GW_WIN_1H, ESPNOW_GW_FIELD_TEMP, last_report / 1000, &h1);
+                ESP_LOGI(TAG, "🌡️ #%d 1m: n=%" PRIu32 " %.2f..%.2f mean=%.2f sd²=%.3f | 1h: n=%" PRIu32 " mean=%.2f ema=%.2f",
+                         i, m1.count, m1.min, m1.max, m1.mean, m1.variance, h1.count, h1.mean, h1.ema);
+            }
+        }
     }
+}
+
+/* recv callback (รูปแบบใหม่ v5.x) */
+static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (!data || len <= 0 || !info || !info->src_addr) return;
 
-    const uint8_t CHANNEL = 1;   // ★★ ตั้งเท่ากับฝั่ง TX ★★
-    wifi_init_for_espnow(CHANNEL);
+    espnow_metrics_inc(m_rx);
+    espnow_gw_serial_push(info, data, len);   // ไม่ได้เปิด bridge = ไม่ทำอะไร
 
-    // แสดง MAC ตัวเอง (คัดลอกไปใส่ partner_mac ในฝั่ง TX)
+    // type ไม่รู้จัก / ขนาดไม่ตรง -> นับใน espnow_msg
+    espnow_msg_dispatch(info, data, len);
+}
+
+/* ESPNOW_MSG_STATS จาก node: ตัวเฟรมไปถึง host ทาง bridge แล้ว (ถอดด้วย tools/espnow_bridge.py) */
+static void on_stats(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    espnow_metrics_inc(m_stats_rx);
+}
+
+static void metrics_collect(void) {
+    espnow_metrics_set(m_q_depth, (int32_t)uxQueueMessagesWaiting(rx_q));
+    espnow_metrics_set(m_overflow, (int32_t)s_overflow);
+    espnow_metrics_set(m_lost, (int32_t)s_flow_lost);
+    espnow_metrics_set(m_peer_full, (int32_t)s_peer_full);
+    espnow_metrics_set(m_bad_len, (int32_t)espnow_msg_bad_len_count());
+    espnow_metrics_set(m_unknown, (int32_t)espnow_msg_unknown_count());
+}
+
+static void metrics_to_bridge(const uint8_t *frame, int len, void *ctx) {
+    espnow_gw_serial_push_kind(ESPNOW_GW_SERIAL_KIND_STATS, (const uint8_t *)ctx, frame, len);
+}
+
+static void metrics_init(const uint8_t my_mac[6]) {
+    static const uint32_t proc_bounds[ESPNOW_METRICS_HIST_BUCKETS - 1] = {100, 250, 500, 1000, 2500, 5000, 10000};
+    static uint8_t mac[6];
+    memcpy(mac, my_mac, 6);
+    m_rx        = espnow_metrics_counter("rx_frames");
+    m_stats_rx  = espnow_metrics_counter("stats_rx");
+    m_send_err  = espnow_metrics_counter("send_err");
+    m_proc_us   = espnow_metrics_hist("rx_proc_us", proc_bounds);
+    m_q_depth   = espnow_metrics_gauge("rx_q_depth");
+    m_overflow  = espnow_metrics_gauge("rx_overflow");
+    m_lost      = espnow_metrics_gauge("rx_lost");
+    m_peer_full = espnow_metrics_gauge("peer_full");
+    m_bad_len   = espnow_metrics_gauge("rx_bad_len");
+    m_unknown   = espnow_metrics_gauge("rx_unknown");
+
+    espnow_metrics_config_t cfg = {
+        .period_ms = SERIAL_BRIDGE ? METRICS_PERIOD_MS : 0,
+        .sink      = SERIAL_BRIDGE ? metrics_to_bridge : NULL,
+        .ctx       = mac,
+        .collect   = metrics_collect,
+    };
+    ESP_ERROR_CHECK(espnow_metrics_start(&cfg));
+    ESP_ERROR_CHECK(espnow_metrics_console_init(!SERIAL_BRIDGE));
+}
+
+#if STRESS_SENDERS_MAX > 0
+static int stress_build(int sender, uint32_t seq, uint8_t *buf, int max) {
+    sensor_data_t d = {0};
+    d.hdr.type     = ESPNOW_MSG_SENSOR;
+    d.temperature  = 25.0f;
+    d.humidity     = 60.0f;
+    d.light_level  = sender;
+    d.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000ULL);
+    d.seq          = seq;
+    snprintf(d.sensor_id, sizeof(d.sensor_id), "SIM_%03d", sender % 1000);
+    memcpy(buf, &d, sizeof(d));
+    return sizeof(d);
+}
+
+static void stress_probe(espnow_stress_probe_t *out, bool reset_hwm) {
+    out->processed = s_processed;
+    out->dropped   = s_overflow;
+    out->queue_hwm = s_q_hwm;
+    out->busy_us   = s_busy_us;
+    if (reset_hwm) s_q_hwm = 0;
+}
+#endif
+
+void app_main(void) {
+    const uint8_t CHANNEL = 1;   // channel เริ่มต้น (ครั้งถัดไปใช้ค่าใน NVS, ฝั่ง TX กวาดหาเอง)
+
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น)
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel = CHANNEL;
+    boot_cfg.sta_netif = MQTT_BRIDGE;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+
+    // แสดง MAC ตัวเอง (ฝั่ง TX หาเราเจอเองด้วย discovery)
     uint8_t mac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mac));
     log_mac("📍 My MAC:", mac);
 
-    // เริ่ม ESP-NOW + ลงทะเบียน callback
-    ESP_ERROR_CHECK(esp_now_init());
+    // gateway: ไม่หาใคร แค่ตอบ HELLO ของ sensor (NVS จำ channel ที่ถูกย้ายไป)
+    espnow_disc_config_t disc_cfg = {
+        .my_role   = ESPNOW_DISC_ROLE_GATEWAY,
+        .want_role = ESPNOW_DISC_ROLE_NONE,
+        .channel   = CHANNEL,
+        .use_nvs   = true,
+    };
+    ESP_ERROR_CHECK(espnow_disc_init(&disc_cfg));
+    if (SERIAL_BRIDGE) {
+        espnow_gw_serial_config_t ser_cfg = ESPNOW_GW_SERIAL_CONFIG_DEFAULT();
+        ESP_ERROR_CHECK(espnow_gw_serial_init(&ser_cfg));
+    }
+    ESP_ERROR_CHECK(espnow_gw_stats_init(GW_MAX_SENSORS));
+    ESP_ERROR_CHECK(espnow_gw_reg_init(&s_reg, GW_MAX_SENSORS));
+    if (REG_BENCH > 0) espnow_gw_reg_bench(REG_BENCH);
+    if (STATS_BENCH > 0) espnow_gw_stats_bench(STATS_BENCH);
+    espnow_gw_rollup_config_t roll_cfg = ESPNOW_GW_ROLLUP_CONFIG_DEFAULT();
+    roll_cfg.max_sensors = GW_MAX_SENSORS;
+    ESP_ERROR_CHECK(espnow_gw_rollup_init(&roll_cfg));
+    if (TSDB_BENCH > 0) espnow_gw_tsdb_bench(espnow_gw_rollup_store(ESPNOW_GW_RES_RAW), TSDB_BENCH);
+    if (MQTT_BRIDGE) {
+        espnow_gw_mqtt_config_t mqtt_cfg = ESPNOW_GW_MQTT_CONFIG_DEFAULT();
+        mqtt_cfg.ssid       = MQTT_WIFI_SSID;
+        mqtt_cfg.password   = MQTT_WIFI_PASS;
+        mqtt_cfg.uri        = MQTT_BROKER_URI;
+        mqtt_cfg.on_channel = follow_ap_channel;
+        ESP_ERROR_CHECK(espnow_gw_mqtt_init(&mqtt_cfg));
+    }
+    rx_q = xQueueCreate(RX_QUEUE_DEPTH, sizeof(rx_item_t));
+    metrics_init(mac);
+    xTaskCreate(rx_task, "rx_task", 4096, NULL, 4, NULL);
+
+    // ลงทะเบียน handler + callback
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_SENSOR, sizeof(sensor_data_t), on_sensor));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_SENSOR_BATCH, 0, on_sensor_batch));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_SENSOR_SHORT, sizeof(sensor_short_t), on_sensor_short));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_STATS, 0, on_stats));
+    ESP_ERROR_CHECK(espnow_link_mtu_init());
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
+    if (TDMA_BEACON) {
+        espnow_tdma_gw_config_t tdma_cfg = ESPNOW_TDMA_GW_CONFIG_DEFAULT();
+        ESP_ERROR_CHECK(espnow_tdma_gw_init(&tdma_cfg));
+    }
+    espnow_boot_report();
     ESP_LOGI(TAG, "ESP-NOW RX ready…");
+    if (MQTT_BRIDGE && MQTT_BENCH > 0) espnow_gw_mqtt_bench(MQTT_BENCH);
 
-    while (1) vTaskDelay(pdMS_TO_TICKS(1000));
+#if STRESS_SENDERS_MAX > 0
+    espnow_stress_config_t stress = {
+        .senders_start = STRESS_SENDERS_STEP,
+        .senders_step  = STRESS_SENDERS_STEP,
+        .senders_max   = STRESS_SENDERS_MAX,
+        .interval_ms   = STRESS_INTERVAL_MS,
+        .step_ms       = STRESS_STEP_MS,
+        .recv          = on_data_recv,
+        .build         = stress_build,
+        .probe         = stress_probe,
+    };
+    ESP_ERROR_CHECK(espnow_stress_start(&stress));
+#endif
+#if REPLAY_SPEED_PCT >= 0
+    espnow_replay_config_t replay = ESPNOW_REPLAY_CONFIG_DEFAULT();
+    replay.recv      = on_data_recv;
+    replay.speed_pct = REPLAY_SPEED_PCT;
+    replay.loops     = REPLAY_LOOPS;
+    ESP_ERROR_CHECK(espnow_replay_start(&replay));
+#endif
+
+    gpio_set_direction(CHANNEL_BTN_GPIO, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(CHANNEL_BTN_GPIO, GPIO_PULLUP_ONLY);
+    static const uint8_t hop[] = {1, 6, 11};
+    int last = 1;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        int level = gpio_get_level(CHANNEL_BTN_GPIO);
+        if (!MQTT_BRIDGE && last == 1 && level == 0) {   // กดลง (active low) — MQTT: channel ตาม AP
+            uint8_t cur = espnow_disc_channel(), next = hop[0];
+            for (int i = 0; i < 3; i++) {
+                if (hop[i] > cur) { next = hop[i]; break; }
+            }
+            ESP_ERROR_CHECK(espnow_disc_set_channel(next));
+            espnow_disc_report();
+        }
+        last = level;
+    }
 }
\ No newline at end of file
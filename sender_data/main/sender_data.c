@@ -2,10 +2,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "esp_system.h"
 #include "esp_random.h"
@@ -18,6 +20,16 @@
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "espnow_disc.h"
+#include "espnow_flow.h"
+#include "espnow_tdma.h"
+#include "link_track.h"
+#include "link_retry.h"
+#include "link_mtu.h"
+#include "link_rate.h"
+#include "espnow_metrics.h"
 
 #include "driver/gpio.h"
 #include "driver/adc.h"
@@ -25,9 +37,8 @@
 
 static const char* TAG = "ESP_NOW_SENSOR_TX";
 
-/* ★★ ตั้ง MAC ของ “ตัวรับ” (อีกบอร์ด) ให้ถูกต้องก่อนใช้งาน ★★
-   ตัวอย่าง 94:B5:55:F8:5D:50 -> {0x94,0xB5,0x55,0xF8,0x5D,0x50} */
-static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 };
+/* MAC ของ “ตัวรับ” (gateway) — ได้จาก discovery (role GATEWAY) */
+static uint8_t partner_mac[6];
 
 /* === กำหนดขาเซ็นเซอร์ ===
    DHT11: ต่อที่ GPIO4 (ปรับตามการต่อจริง)
@@ -36,51 +47,147 @@ static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 };
 #define DHT_PIN           GPIO_NUM_4
 #define LDR_ADC_CHANNEL   ADC1_CHANNEL_6
 
+/* อัตราส่ง: TX_INTERVAL_MS ระหว่างเฟรม, TX_RATE_PER_S = token bucket ต่อ peer (0 = ไม่จำกัด)
+   FLOW_CONTROL = 1 -> รอ credit จาก receiver ก่อนส่ง (ไม่ท่วม consumer ที่ช้า) */
+#define TX_INTERVAL_MS    5000
+#define TX_RATE_PER_S     0
+#define TX_BURST          4
+#define FLOW_CONTROL      1
+
+/* TDMA_MODE = 1 (คู่กับ TDMA_BEACON ของ gateway) -> ส่งเฉพาะใน slot ที่ gateway แจกผ่าน beacon (จังหวะ = superframe ของ gateway)
+   ไม่มี beacon ภายใน TX_INTERVAL_MS -> ส่งแบบ free-running เหมือน TDMA_MODE = 0 */
+#define TDMA_MODE         0
+
+/* 0 = ส่งทีละ sample, N = รวม N sample ต่อเฟรม (ต้องไม่เกิน BATCH_MAX) */
+#define BATCH_SAMPLES     0
+
+/* stats frame (ESPNOW_MSG_STATS) ไป gateway ทุก METRICS_PERIOD_MS (0 = ไม่ส่ง ดูได้แค่ console "metrics" เมื่อ CONSOLE_REPL = 1)
+   ส่งจาก esp_timer นอก slot TDMA — 1 เฟรมต่อรอบ ไม่รบกวน slot คนอื่นจนมีผล */
+#define METRICS_PERIOD_MS 30000
+#define CONSOLE_REPL      0       // 1 -> เปิด REPL บน UART console (คำสั่ง "metrics")
+
 /* โครงสร้าง payload (แพ็กเพื่อลดปัญหา alignment) */
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR
     float    temperature;
     float    humidity;
     int32_t  light_level;     // ค่า raw ADC (0..4095 ที่ความกว้าง 12 บิต)
     char     sensor_id[10];   // เช่น "TEMP_01"
     uint32_t timestamp_ms;    // esp_timer_get_time()/1000
+    uint32_t seq;             // ใช้คิด credit (เริ่ม 1)
 } sensor_data_t;
 
-/* ---------- ESP-NOW callbacks (v5.x) ---------- */
-static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Send status: %s", (status == ESP_NOW_SEND_SUCCESS) ? "SUCCESS" : "FAIL");
-}
+/* หลัง gateway แจก handle (ESPNOW_MSG_SENSOR_HANDLE) ส่งแบบสั้น: handle 2 byte แทน sensor_id[10] */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_SHORT
+    uint16_t handle;
+    float    temperature;
+    float    humidity;
+    int32_t  light_level;
+    uint32_t timestamp_ms;
+    uint32_t seq;
+} sensor_short_t;
+
+/* gateway -> sender: handle ของ sensor_id นี้ (0xFFFF = ไม่รู้จักแล้ว กลับไปส่งแบบเต็ม) */
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_HANDLE
+    uint16_t handle;
+    char     sensor_id[10];
+} sensor_handle_t;
 
-/* ---------- Wi-Fi & ESP-NOW init ---------- */
-static void wifi_init_for_espnow(uint8_t channel /*1..13 หรือ 0=ไม่ล็อก*/) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+#define SENSOR_ID         "TEMP_01"
+#define HANDLE_NONE       0xFFFF
 
-    wifi_init_config_t wcfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&wcfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+/* batch: รวมหลาย sample เป็นเฟรมเดียว -> peer v2 ได้เฟรมใหญ่เฟรมเดียว, peer v1 ได้เป็น fragment */
+#define BATCH_MAX         90      // (1470 - header 16 B) / sizeof(sensor_sample_t) 16 B
 
-    if (channel >= 1 && channel <= 13) {
-        wifi_config_t sta_cfg = {0};
-        sta_cfg.sta.channel = channel;  // ★ ให้ตรงกับอีกบอร์ด
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
+typedef struct __attribute__((packed)) {
+    float    temperature;
+    float    humidity;
+    int32_t  light_level;
+    uint32_t timestamp_ms;
+} sensor_sample_t;
+
+typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;     // ESPNOW_MSG_SENSOR_BATCH
+    char     sensor_id[10];
+    uint32_t seq;             // ใช้ seq เดียวกับ sensor_data_t (credit)
+    uint8_t  count;
+    sensor_sample_t samples[BATCH_MAX];
+} sensor_batch_t;
+
+#define SENSOR_BATCH_LEN(n) (offsetof(sensor_batch_t, samples) + (n) * sizeof(sensor_sample_t))
+_Static_assert(SENSOR_BATCH_LEN(BATCH_MAX) <= 1470, "batch must fit one ESP-NOW v2 frame");
+
+static espnow_flow_tx_t     flow_tx;
+static espnow_flow_bucket_t tx_bucket;
+static SemaphoreHandle_t    credit_sem;   // ได้ credit ที่เปิดหน้าต่างเพิ่ม
+static volatile uint16_t    s_handle = HANDLE_NONE;   // handle จาก gateway (ส่งเฟรมสั้น)
+
+static espnow_metric_t *m_tx_ok, *m_tx_fail, *m_send_err, *m_tx_latency;
+static espnow_metric_t *m_flow_stalls, *m_flow_probes, *m_bad_len, *m_unknown;
+
+/* ---------- ESP-NOW callbacks (v5.x) ---------- */
+static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
+    espnow_boot_mark_first_tx();
+    espnow_link_sent_t r;
+    espnow_link_on_sent(info, status, &r);
+    espnow_disc_on_sent(info->des_addr, r.ok);   // FAIL ติดกัน -> กวาด channel ใหม่
+    espnow_link_retry_on_sent(info, &r);
+    espnow_metrics_inc(r.ok ? m_tx_ok : m_tx_fail);
+    if (r.matched) {
+        espnow_metrics_observe(m_tx_latency, (uint32_t)r.latency_us);
+        ESP_LOGI(TAG, "Send sensor #%" PRIu32 ": %s (%lld us)", r.seq,
+                 r.ok ? "SUCCESS" : "FAIL", (long long)r.latency_us);
+    } else {
+        ESP_LOGI(TAG, "Send status: %s", r.ok ? "SUCCESS" : "FAIL");
     }
+}
+
+/* ESPNOW_MSG_FLOW_CREDIT จาก receiver */
+static void on_flow_credit(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (espnow_flow_tx_on_credit(&flow_tx, data, len)) xSemaphoreGive(credit_sem);
+}
 
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", channel);
+/* ESPNOW_MSG_SENSOR_HANDLE จาก gateway: ได้ handle -> เฟรมถัดไปเป็นแบบสั้น, HANDLE_NONE -> กลับไปเฟรมเต็ม */
+static void on_sensor_handle(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    const sensor_handle_t *m = (const sensor_handle_t *)data;
+    if (memcmp(info->src_addr, partner_mac, 6) != 0) return;
+    if (m->handle != HANDLE_NONE && strncmp(m->sensor_id, SENSOR_ID, sizeof(m->sensor_id)) != 0) return;
+    s_handle = m->handle;
 }
 
+/* ---------- ESP-NOW peer ---------- */
 static void espnow_init_and_add_peer(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_FLOW_CREDIT, sizeof(espnow_flow_credit_t), on_flow_credit));
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_SENSOR_HANDLE, sizeof(sensor_handle_t), on_sensor_handle));
+    ESP_ERROR_CHECK(espnow_link_mtu_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_msg_dispatch));
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
 
-    esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, partner_mac, 6);
-    peer.ifidx   = WIFI_IF_STA;
-    peer.channel = channel;
-    peer.encrypt = false;
-
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer));
+    // รอ partner จาก discovery (NVS = ทันที, ไม่งั้นรอ HELLO/REPLY)
+    ESP_ERROR_CHECK(espnow_disc_wait_peer(partner_mac, UINT32_MAX));
+    ESP_LOGI(TAG, "🤝 Gateway: %02X:%02X:%02X:%02X:%02X:%02X",
+             partner_mac[0], partner_mac[1], partner_mac[2], partner_mac[3], partner_mac[4], partner_mac[5]);
+    ESP_ERROR_CHECK(espnow_boot_add_peer(partner_mac, channel));
     ESP_LOGI(TAG, "ESP-NOW init OK & peer added");
+
+    // ถาม payload สูงสุดของ peer (ยังไม่ตอบ = 250, batch จะถูกตัดเป็น fragment)
+    esp_err_t er = espnow_link_mtu_probe(partner_mac);
+    if (er != ESP_OK) ESP_LOGW(TAG, "caps probe failed: %s", esp_err_to_name(er));
+}
+
+/* discovery ยืนยัน gateway ตัวอื่นแทน (บอร์ดเดิมหาย/ถูกเปลี่ยน) -> ย้ายตาม ไม่ต้องลบ NVS */
+static void follow_partner(void) {
+    if (!espnow_disc_refresh_peer(partner_mac)) return;
+    ESP_LOGI(TAG, "🔄 Gateway changed: %02X:%02X:%02X:%02X:%02X:%02X",
+             partner_mac[0], partner_mac[1], partner_mac[2], partner_mac[3], partner_mac[4], partner_mac[5]);
+    s_handle = HANDLE_NONE;                 // handle เป็นของ gateway เดิม
+    esp_err_t er = espnow_boot_add_peer(partner_mac, 0);
+    if (er == ESP_OK) er = espnow_link_rate_enable(partner_mac);
+    if (er == ESP_OK) er = espnow_link_mtu_probe(partner_mac);
+    if (er != ESP_OK) ESP_LOGW(TAG, "follow gateway: %s", esp_err_to_name(er));
+    espnow_metrics_set_peer(partner_mac);
 }
 
 /* ---------- DHT11 bit-bang อ่านค่าพื้นฐาน ---------- */
@@ -160,33 +267,85 @@ static void sample_sensor(float *t, float *h, int *ldr) {
     *ldr = read_light_raw();
 }
 
+/* ---------- metrics ---------- */
+static void metrics_collect(void) {
+    espnow_metrics_set(m_flow_stalls, (int32_t)flow_tx.stalls);
+    espnow_metrics_set(m_flow_probes, (int32_t)flow_tx.probes);
+    espnow_metrics_set(m_bad_len, (int32_t)espnow_msg_bad_len_count());
+    espnow_metrics_set(m_unknown, (int32_t)espnow_msg_unknown_count());
+}
+
+static void metrics_init(void) {
+    static const uint32_t lat_bounds[ESPNOW_METRICS_HIST_BUCKETS - 1] = {500, 1000, 2000, 5000, 10000, 20000, 50000};
+    m_tx_ok       = espnow_metrics_counter("tx_ok");
+    m_tx_fail     = espnow_metrics_counter("tx_fail");
+    m_send_err    = espnow_metrics_counter("send_err");
+    m_tx_latency  = espnow_metrics_hist("tx_latency_us", lat_bounds);
+    m_flow_stalls = espnow_metrics_gauge("flow_stalls");
+    m_flow_probes = espnow_metrics_gauge("flow_probes");
+    m_bad_len     = espnow_metrics_gauge("rx_bad_len");
+    m_unknown     = espnow_metrics_gauge("rx_unknown");
+
+    espnow_metrics_config_t cfg = {
+        .period_ms = METRICS_PERIOD_MS,
+        .collect   = metrics_collect,
+    };
+    memcpy(cfg.peer, partner_mac, 6);       // add ไว้แล้วใน espnow_init_and_add_peer
+    ESP_ERROR_CHECK(espnow_metrics_start(&cfg));
+    ESP_ERROR_CHECK(espnow_metrics_console_init(CONSOLE_REPL));
+}
+
 /* ---------- main ---------- */
 void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
-    }
-
     const uint8_t CHANNEL = 1;  // ★★ ให้ตรงกันทั้งสองบอร์ด ★★
-    wifi_init_for_espnow(CHANNEL);
+
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น) — sensor node ใช้ ESP-NOW อย่างเดียว จึงใช้ fast boot
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel   = CHANNEL;
+    boot_cfg.fast_boot = true;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    espnow_flow_tx_init(&flow_tx);
+    espnow_flow_bucket_init(&tx_bucket, TX_RATE_PER_S, TX_BURST);
+    credit_sem = xSemaphoreCreateBinary();
+    espnow_link_retry_policy_t retry = ESPNOW_LINK_RETRY_POLICY_DEFAULT();
+    ESP_ERROR_CHECK(espnow_link_retry_init(&retry));
+    // ★ ไม่ต้อง hardcode MAC: หา partner ด้วย discovery (จำไว้ใน NVS)
+    espnow_disc_config_t disc_cfg = {
+        .my_role   = ESPNOW_DISC_ROLE_SENSOR,
+        .want_role = ESPNOW_DISC_ROLE_GATEWAY,
+        .channel   = CHANNEL,
+        .use_nvs   = true,
+        .scan      = true,
+    };
+    ESP_ERROR_CHECK(espnow_disc_init(&disc_cfg));
     espnow_init_and_add_peer(CHANNEL);
+    metrics_init();
 
     // แสดง MAC ตัวเอง
     uint8_t mac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mac));
     ESP_LOGI(TAG, "My MAC: %02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    espnow_boot_report();
+    espnow_disc_report();
+    ESP_ERROR_CHECK(espnow_link_rate_enable(partner_mac));
+    ESP_ERROR_CHECK(espnow_link_start_report(30000));
+    if (TDMA_MODE) ESP_ERROR_CHECK(espnow_tdma_node_init(partner_mac));
 
     // เตรียม GPIO/ADC
     gpio_set_pull_mode(DHT_PIN, GPIO_PULLUP_ONLY);
     adc_init();
 
     sensor_data_t pkt = {0};
-    strcpy(pkt.sensor_id, "TEMP_01");
+    pkt.hdr.type = ESPNOW_MSG_SENSOR;
+    strcpy(pkt.sensor_id, SENSOR_ID);
+
+    static sensor_batch_t batch;
+    batch.hdr.type = ESPNOW_MSG_SENSOR_BATCH;
+    strcpy(batch.sensor_id, pkt.sensor_id);
 
     while (1) {
+        follow_partner();
         float t = 0, h = 0;
         int   l = 0;
         sample_sensor(&t, &h, &l);
@@ -199,11 +358,80 @@ void app_main(void) {
         ESP_LOGI(TAG, "TX -> T=%.2fC H=%.2f%% LDR=%d ts=%" PRIu32 "ms",
                  pkt.temperature, pkt.humidity, pkt.light_level, pkt.timestamp_ms);
 
-        esp_err_t er = esp_now_send(partner_mac, (const uint8_t *)&pkt, sizeof(pkt));
+#if BATCH_SAMPLES > 0
+        sensor_sample_t *s = &batch.samples[batch.count++];
+        s->temperature  = pkt.temperature;
+        s->humidity     = pkt.humidity;
+        s->light_level  = pkt.light_level;
+        s->timestamp_ms = pkt.timestamp_ms;
+        if (batch.count < BATCH_SAMPLES && batch.count < BATCH_MAX) {
+            vTaskDelay(pdMS_TO_TICKS(TX_INTERVAL_MS));
+            continue;
+        }
+#endif
+
+        // token bucket: จำกัดอัตราต่อ peer
+        int64_t wait_us;
+        while ((wait_us = espnow_flow_bucket_wait_us(&tx_bucket)) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+        }
+        espnow_flow_bucket_take(&tx_bucket);
+
+        // credit: รอจน receiver มีที่ว่าง (หรือครบเวลา probe)
+        uint32_t seq = 0;
+        while (FLOW_CONTROL && !espnow_flow_tx_acquire(&flow_tx, &seq)) {
+            xSemaphoreTake(credit_sem, pdMS_TO_TICKS(ESPNOW_FLOW_PROBE_MS));
+        }
+        pkt.seq = FLOW_CONTROL ? seq : pkt.seq + 1;
+
+        // TDMA: รอต้น slot ตัวเอง (ใน slot ส่งครั้งเดียว ไม่ retry ล้นไป slot คนอื่น)
+        bool in_slot = TDMA_MODE && espnow_tdma_node_wait_slot(TX_INTERVAL_MS) == ESP_OK;
+
+        esp_err_t er;
+        if (BATCH_SAMPLES > 0) {
+            int len = SENSOR_BATCH_LEN(batch.count);
+            uint16_t mtu = espnow_link_mtu(partner_mac);
+            batch.seq = pkt.seq;
+            ESP_LOGI(TAG, "📦 batch #%" PRIu32 ": %u samples, %d bytes -> %s (peer mtu %u)",
+                     batch.seq, batch.count, len, len <= mtu ? "1 frame" : "fragments", mtu);
+            er = espnow_link_send_large(partner_mac, &batch, len, batch.seq);
+            batch.count = 0;
+        } else {
+            // มี handle แล้ว -> เฟรมสั้น (ไม่ต้องส่ง sensor_id ทุกเฟรม)
+            sensor_short_t sh;
+            const void *frame = &pkt;
+            int len = sizeof(pkt);
+            uint16_t handle = s_handle;
+            if (handle != HANDLE_NONE) {
+                sh.hdr.type     = ESPNOW_MSG_SENSOR_SHORT;
+                sh.handle       = handle;
+                sh.temperature  = pkt.temperature;
+                sh.humidity     = pkt.humidity;
+                sh.light_level  = pkt.light_level;
+                sh.timestamp_ms = pkt.timestamp_ms;
+                sh.seq          = pkt.seq;
+                frame = &sh;
+                len   = sizeof(sh);
+            }
+            er = in_slot ? espnow_link_send(partner_mac, frame, len, pkt.seq, 1)
+                         : espnow_link_send_reliable(partner_mac, frame, len, pkt.seq);
+        }
         if (er != ESP_OK) {
+            espnow_metrics_inc(m_send_err);
             ESP_LOGE(TAG, "esp_now_send failed: %s", esp_err_to_name(er));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(5000));  // ส่งทุก 5 วิ
+        if (pkt.seq % 20 == 0) {
+            ESP_LOGI(TAG, "📊 flow: sent=%" PRIu32 " stalls=%" PRIu32 " probes=%" PRIu32 " credits=%" PRIu32,
+                     flow_tx.sent, flow_tx.stalls, flow_tx.probes, flow_tx.credits_rx);
+            espnow_link_mtu_stats_t ms;
+            espnow_link_mtu_get_stats(&ms);
+            ESP_LOGI(TAG, "📊 large: single=%" PRIu32 " fragmented=%" PRIu32 " frags=%" PRIu32 " bytes=%" PRIu64,
+                     ms.large_sent, ms.fragmented, ms.frags_sent, ms.bytes_sent);
+            if (TDMA_MODE) espnow_tdma_node_report();
+        }
+
+        // TDMA: จังหวะมาจาก wait_slot แล้ว (ได้ slot หรือรอจน timeout)
+        if (!TDMA_MODE) vTaskDelay(pdMS_TO_TICKS(TX_INTERVAL_MS));
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -9,25 +10,38 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "nvs_flash.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "espnow_msg.h"
+#include "espnow_disc.h"
+#include "link_track.h"
+#include "link_retry.h"
+#include "link_rate.h"
 
 static const char* TAG = "ESP_NOW_LED_TX";
 
-/* ★★ ใส่ STA MAC ของ “ฝั่ง B (ตัวควบคุม LED)” ★★
-   ตัวอย่าง 94:B5:55:F8:5D:50 -> {0x94,0xB5,0x55,0xF8,0x5D,0x50} */
-static uint8_t partner_mac[6] = { 0x94,0xB5,0x55,0xF8,0x22,0x78 };
+/* STA MAC ของ “ฝั่ง B (ตัวควบคุม LED)” — ได้จาก discovery (role LED_NODE) */
+static uint8_t partner_mac[6];
 
 #define SEND_PERIOD_MS   3000
 #define CHANNEL          1       // ★★ ให้ตรงกับอีกเครื่อง
 
 /* Payload คำสั่งควบคุม LED (packed กันเพี้ยน) */
 typedef struct __attribute__((packed)) {
+    espnow_msg_hdr_t hdr;        // ESPNOW_MSG_LED_SET / ESPNOW_MSG_LED_ACK
     bool     led_state;          // true = ON
     uint8_t  brightness;         // 0..255
-    char     command[20];        // "SET_LED" / "LED_ACK"
+    uint16_t seq;                // ฝั่งรับทิ้งคำสั่งที่ seq เก่ากว่า และ ACK เฉพาะสถานะสุดท้าย
+    uint32_t epoch;              // สุ่มใหม่ทุกบูต (32 บิต: 8 บิตชนกันได้ 1/256) เปลี่ยน = sender รีบูต (seq เริ่มใหม่) ฝั่งรับล้าง seq เดิม
 } led_control_t;
 
+/* ใช้วัด SET -> ACK (ฝั่งรับ ACK เฉพาะคำสั่งล่าสุดหลัง fade จบ) */
+static volatile uint16_t s_last_seq;
+static volatile int64_t  s_last_send_us;
+
 /* เทียบ MAC แบบสั้น */
 static inline bool mac_eq(const uint8_t *a, const uint8_t *b) {
     return memcmp(a, b, 6) == 0;
@@ -40,7 +54,29 @@ static void log_mac(const char *prefix, const uint8_t mac[6]) {
 
 /* ==== SEND-CB (รูปแบบใหม่ v5.x) ==== */
 static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Send status: %s", status == ESP_NOW_SEND_SUCCESS ? "SUCCESS" : "FAIL");
+    espnow_boot_mark_first_tx();
+    espnow_link_sent_t r;
+    espnow_link_on_sent(info, status, &r);
+    espnow_disc_on_sent(info->des_addr, r.ok);   // FAIL ติดกัน -> กวาด channel ใหม่
+    espnow_link_retry_on_sent(info, &r);
+    if (r.matched) {
+        ESP_LOGI(TAG, "Send SET #%" PRIu32 ": %s (%lld us)", r.seq,
+                 r.ok ? "SUCCESS" : "FAIL", (long long)r.latency_us);
+    } else {
+        ESP_LOGI(TAG, "Send status: %s", r.ok ? "SUCCESS" : "FAIL");
+    }
+}
+
+/* ==== LED_ACK handler ==== */
+static void on_led_ack(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    led_control_t rx;
+    memcpy(&rx, data, sizeof(rx));
+    log_mac("📥 ACK from", info->src_addr);
+    ESP_LOGI(TAG, "   LED: %s, Brightness: %u, seq=%u",
+             rx.led_state ? "ON" : "OFF", (unsigned)rx.brightness, (unsigned)rx.seq);
+    if (rx.seq == s_last_seq) {
+        ESP_LOGI(TAG, "   SET->ACK: %lld ms", (long long)((esp_timer_get_time() - s_last_send_us) / 1000));
+    }
 }
 
 /* ==== RECV-CB (รับ ACK กลับ) ==== */
@@ -48,90 +84,88 @@ static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, i
     if (!info || !info->src_addr || !data || len <= 0) return;
 
     // รับเฉพาะจาก partner เท่านั้น
-    if (!mac_eq(info->src_addr, partner_mac)) {
+    if (data[0] != ESPNOW_MSG_DISC && !mac_eq(info->src_addr, partner_mac)) {
         ESP_LOGW(TAG, "Ignore from %02X:%02X:%02X:%02X:%02X:%02X len=%d",
                  info->src_addr[0],info->src_addr[1],info->src_addr[2],
                  info->src_addr[3],info->src_addr[4],info->src_addr[5], len);
         return;
     }
 
-    if (len != sizeof(led_control_t)) {
-        ESP_LOGW(TAG, "Size mismatch: %d != %d", len, (int)sizeof(led_control_t));
-        return;
-    }
-
-    led_control_t rx = {0};
-    memcpy(&rx, data, sizeof(rx));
-    if (strncmp(rx.command, "LED_ACK", sizeof(rx.command)) == 0) {
-        log_mac("📥 ACK from", info->src_addr);
-        ESP_LOGI(TAG, "   LED: %s, Brightness: %u",
-                 rx.led_state ? "ON" : "OFF", (unsigned)rx.brightness);
-    } else {
-        ESP_LOGW(TAG, "Unknown command in reply: %s", rx.command);
-    }
-}
-
-static void wifi_init_for_espnow(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-
-    if (channel >= 1 && channel <= 13) {
-        wifi_config_t sta_cfg = {0};
-        sta_cfg.sta.channel = channel;
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
-    }
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", channel);
+    espnow_msg_dispatch(info, data, len);
 }
 
 static void espnow_init_and_add_peer(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(espnow_msg_register(ESPNOW_MSG_LED_ACK, sizeof(led_control_t), on_led_ack));
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
 
-    esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, partner_mac, 6);
-    peer.ifidx   = WIFI_IF_STA;
-    peer.channel = channel;
-    peer.encrypt = false;
-    esp_err_t er = esp_now_add_peer(&peer);
-    if (er != ESP_OK && er != ESP_ERR_ESPNOW_EXIST) {
+    // รอ partner จาก discovery (NVS = ทันที, ไม่งั้นรอ HELLO/REPLY)
+    ESP_ERROR_CHECK(espnow_disc_wait_peer(partner_mac, UINT32_MAX));
+    log_mac("🤝 Partner:", partner_mac);
+
+    esp_err_t er = espnow_boot_add_peer(partner_mac, channel);
+    if (er != ESP_OK) {
         ESP_LOGE(TAG, "add_peer failed: %d", er);
         ESP_ERROR_CHECK(er);
     }
     ESP_LOGI(TAG, "Peer added");
 }
 
-void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
-    }
+/* discovery ยืนยัน partner ตัวอื่นแทน (บอร์ดเดิมหาย/ถูกเปลี่ยน) -> ย้ายตาม ไม่ต้องลบ NVS */
+static void follow_partner(void) {
+    if (!espnow_disc_refresh_peer(partner_mac)) return;
+    log_mac("🔄 Partner changed:", partner_mac);
+    esp_err_t er = espnow_boot_add_peer(partner_mac, 0);
+    if (er == ESP_OK) er = espnow_link_rate_enable(partner_mac);
+    if (er != ESP_OK) ESP_LOGW(TAG, "follow partner: %s", esp_err_to_name(er));
+}
 
-    wifi_init_for_espnow(CHANNEL);
+void app_main(void) {
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น) — ฝั่งส่งใช้ ESP-NOW อย่างเดียว จึงใช้ fast boot
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel   = CHANNEL;
+    boot_cfg.fast_boot = true;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    espnow_link_retry_policy_t retry = ESPNOW_LINK_RETRY_POLICY_DEFAULT();
+    ESP_ERROR_CHECK(espnow_link_retry_init(&retry));
+    // ★ ไม่ต้อง hardcode MAC: หา partner ด้วย discovery (จำไว้ใน NVS)
+    espnow_disc_config_t disc_cfg = {
+        .my_role   = ESPNOW_DISC_ROLE_LED_CTRL,
+        .want_role = ESPNOW_DISC_ROLE_LED_NODE,
+        .channel   = CHANNEL,
+        .use_nvs   = true,
+        .scan      = true,
+    };
+    ESP_ERROR_CHECK(espnow_disc_init(&disc_cfg));
     espnow_init_and_add_peer(CHANNEL);
 
     // พิมพ์ MAC ตัวเอง (ช่วยตั้งค่า)
     uint8_t mymac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mymac));
     log_mac("📍 My STA MAC:", mymac);
+    espnow_boot_report();
+    espnow_disc_report();
+    ESP_ERROR_CHECK(espnow_link_rate_enable(partner_mac));
+    ESP_ERROR_CHECK(espnow_link_start_report(30000));
 
     // ส่งคำสั่งสลับ ON/OFF + ปรับความสว่าง demo
     bool state = true;
     uint8_t brightness = 64;
+    uint16_t seq = 0;
+    uint32_t epoch = esp_random();
     while (1) {
+        follow_partner();
         led_control_t cmd = {0};
+        cmd.hdr.type   = ESPNOW_MSG_LED_SET;
         cmd.led_state  = state;
         cmd.brightness = brightness;
-        snprintf(cmd.command, sizeof(cmd.command), "SET_LED");
+        cmd.seq        = ++seq;
+        cmd.epoch      = epoch;
+        s_last_seq     = cmd.seq;
+        s_last_send_us = esp_timer_get_time();
 
         ESP_LOGI(TAG, "📤 SET_LED: state=%s, bright=%u", state ? "ON" : "OFF", (unsigned)brightness);
-        esp_err_t er = esp_now_send(partner_mac, (const uint8_t*)&cmd, sizeof(cmd));
+        esp_err_t er = espnow_link_send_reliable(partner_mac, &cmd, sizeof(cmd), cmd.seq);
         if (er != ESP_OK) ESP_LOGE(TAG, "esp_now_send failed: %d", er);
 
         // เดโม่: ไล่สว่าง + toggle
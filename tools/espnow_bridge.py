@@ -0,0 +1,327 @@
+#!/usr/bin/env python3
+# tools/espnow_bridge.py
+"""ถอด stream ไบนารีจาก gateway (components/espnow_gw/gw_serial.c) เป็น CSV / ไฟล์คอลัมน์
+
+record บนสาย = COBS(hdr + payload + crc32) + 0x00
+  hdr (19 B, little-endian): version u8, kind u8, ts_us u64, mac[6], rssi i8, len u16
+stats frame (components/espnow_metrics) — จาก node (kind RX, type 0x46) หรือของ gateway เอง (kind STATS)
+  ถอดลงคอลัมน์ metrics เป็น "ชื่อ=ค่า;..." (hist = จำนวน/mean/[bucket...])
+SENSOR_BATCH (0x31) แตกเป็น 1 แถวต่อ sample (ts_us / mac / rssi / seq ของเฟรมเดียวกัน)
+
+ตัวอย่าง:
+  python3 tools/espnow_bridge.py /dev/ttyUSB0 --baud 921600 --csv out.csv
+  python3 tools/espnow_bridge.py capture.bin --columns out_dir     (ต้องมี numpy)
+  python3 tools/espnow_bridge.py --bench 200000                    (วัดความเร็วถอดบน host)
+"""
+import argparse
+import csv
+import os
+import struct
+import sys
+import time
+import zlib
+
+HDR = struct.Struct("<BBQ6sbH")
+VERSION = 1
+KIND_RX, KIND_STATS = 0, 1
+
+# payload ที่รู้จัก (ต้องตรงกับ struct packed ใน sender_data.c / recever_data.c)
+MSG_SENSOR = 0x30
+MSG_SENSOR_BATCH = 0x31
+MSG_SENSOR_SHORT = 0x32
+SENSOR = struct.Struct("<Bffi10sII")
+SENSOR_SHORT = struct.Struct("<BHffiII")
+BATCH_HDR = struct.Struct("<B10sIB")        # type, sensor_id, seq, count แล้ว sample x count
+BATCH_SAMPLE = struct.Struct("<ffiI")       # temperature, humidity, light_level, timestamp_ms
+
+# stats frame: type u8, version u8, count u8, seq u16, first u8, uptime_s u32 แล้ว entry
+# entry = key u16, kind u8, ค่า (counter u32 | gauge i32 | hist u32 x 8 + sum u64)
+MSG_STATS = 0x46
+STATS_HDR = struct.Struct("<BBBHBI")
+METRIC_COUNTER, METRIC_GAUGE, METRIC_HIST = 0, 1, 2
+HIST_BUCKETS = 8
+STATS_VERSION = 2
+HIST = struct.Struct("<%dIQ" % HIST_BUCKETS)
+
+# เฟรมมีแค่ hash ของชื่อ — ชื่อที่ firmware ลงทะเบียน (เพิ่มที่นี่เมื่อเพิ่ม metric ใหม่)
+METRIC_NAMES = [
+    "heap_free", "heap_min", "stats_tx", "stats_rx",
+    "rx_frames", "rx_foreign", "rx_dup", "rx_recovered", "rx_other_group", "rx_bad_len", "rx_unknown",
+    "rx_q_depth", "rx_overflow", "rx_lost", "rx_proc_us", "peer_full",
+    "tx_ok", "tx_fail", "send_err", "tx_latency_us", "flow_stalls", "flow_probes",
+    "fec_rebuilt", "led_overwritten", "led_start_us",
+]
+
+COLUMNS = ["ts_us", "mac", "rssi", "kind", "type", "len", "sensor", "temperature",
+           "humidity", "light", "sensor_ts_ms", "seq", "metrics", "payload_hex"]
+
+
+def metric_key(name):
+    """เหมือน espnow_metrics_key(): FNV-1a 32 พับเหลือ 16 บิต"""
+    h = 2166136261
+    for b in name.encode():
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return (h ^ (h >> 16)) & 0xFFFF
+
+
+METRIC_BY_KEY = {metric_key(n): n for n in METRIC_NAMES}
+
+
+def cobs_decode(buf):
+    out = bytearray()
+    i, n = 0, len(buf)
+    while i < n:
+        code = buf[i]
+        if code == 0 or i + code > n:
+            raise ValueError("bad COBS block")
+        out += buf[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_at, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_at] = code
+            code_at, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_at] = code
+            code_at, code = len(out), 1
+            out.append(0)
+    out[code_at] = code
+    return bytes(out)
+
+
+def decode_stats(payload):
+    """คืน (seq, uptime_s, "ชื่อ=ค่า;...") หรือ None ถ้าเฟรมไม่ครบ"""
+    if len(payload) < STATS_HDR.size:
+        return None
+    _, ver, count, seq, _, uptime = STATS_HDR.unpack_from(payload)
+    if ver != STATS_VERSION:
+        return None
+    out, off = [], STATS_HDR.size
+    for _ in range(count):
+        if off + 3 > len(payload):
+            return None
+        key, kind = struct.unpack_from("<HB", payload, off)
+        off += 3
+        name = METRIC_BY_KEY.get(key, "%04x" % key)
+        if kind == METRIC_HIST:
+            if off + HIST.size > len(payload):
+                return None
+            vals = HIST.unpack_from(payload, off)
+            off += HIST.size
+            n = sum(vals[:HIST_BUCKETS])
+            out.append("%s=%d/%d/[%s]" % (name, n, vals[-1] // n if n else 0,
+                                          ",".join(str(v) for v in vals[:HIST_BUCKETS])))
+        else:
+            if off + 4 > len(payload):
+                return None
+            v = struct.unpack_from("<i" if kind == METRIC_GAUGE else "<I", payload, off)[0]
+            off += 4
+            out.append("%s=%d" % (name, v))
+    return seq, uptime, ";".join(out)
+
+
+def decode_batch(row, payload):
+    """SENSOR_BATCH -> list ของแถว (1 ต่อ sample) หรือ None ถ้าความยาวไม่ตรง count"""
+    if len(payload) < BATCH_HDR.size:
+        return None
+    _, sid, seq, count = BATCH_HDR.unpack_from(payload)
+    if len(payload) != BATCH_HDR.size + count * BATCH_SAMPLE.size:
+        return None
+    sensor = sid.split(b"\0")[0].decode(errors="replace")
+    rows = []
+    for t, h, l, sts in BATCH_SAMPLE.iter_unpack(payload[BATCH_HDR.size:]):
+        rows.append(dict(row, sensor=sensor, temperature=round(t, 3), humidity=round(h, 3), light=l,
+                         sensor_ts_ms=sts, seq=seq))
+    return rows
+
+
+def decode_record(frame):
+    """คืน list ของแถว (batch = หลายแถว) หรือ None ถ้า CRC/รูปแบบผิด"""
+    raw = cobs_decode(frame)
+    if len(raw) < HDR.size + 4:
+        return None
+    body, crc = raw[:-4], struct.unpack("<I", raw[-4:])[0]
+    if zlib.crc32(body) & 0xFFFFFFFF != crc:
+        return None
+    ver, kind, ts, mac, rssi, ln = HDR.unpack_from(body)
+    payload = body[HDR.size:]
+    if ver != VERSION or ln != len(payload):
+        return None
+
+    row = {"ts_us": ts, "mac": mac.hex(":"), "rssi": rssi, "kind": kind,
+           "type": payload[0] if payload else "", "len": ln}
+    if kind == KIND_RX and payload[:1] == bytes([MSG_SENSOR]) and ln == SENSOR.size:
+        _, t, h, l, sid, sts, seq = SENSOR.unpack(payload)
+        row.update(sensor=sid.split(b"\0")[0].decode(errors="replace"), temperature=round(t, 3),
+                   humidity=round(h, 3), light=l, sensor_ts_ms=sts, seq=seq)
+    elif kind == KIND_RX and payload[:1] == bytes([MSG_SENSOR_SHORT]) and ln == SENSOR_SHORT.size:
+        _, hd, t, h, l, sts, seq = SENSOR_SHORT.unpack(payload)
+        row.update(sensor="#%d" % hd, temperature=round(t, 3), humidity=round(h, 3), light=l,
+                   sensor_ts_ms=sts, seq=seq)
+    elif kind == KIND_RX and payload[:1] == bytes([MSG_SENSOR_BATCH]):
+        rows = decode_batch(row, payload)
+        if rows is None:
+            row["payload_hex"] = payload.hex()
+            rows = [row]
+        return rows
+    else:
+        st = decode_stats(payload) if kind == KIND_STATS or payload[:1] == bytes([MSG_STATS]) else None
+        if st:
+            row.update(seq=st[0], sensor_ts_ms=st[1] * 1000, metrics=st[2])
+        else:
+            row["payload_hex"] = payload.hex()
+    return [row]
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.records = 0
+        self.bad = 0
+
+    def feed(self, chunk):
+        self.buf += chunk
+        while True:
+            end = self.buf.find(0)
+            if end < 0:
+                return
+            frame = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if not frame:
+                continue
+            try:
+                rows = decode_record(frame)
+            except ValueError:
+                rows = None
+            if rows is None:
+                self.bad += 1      # ข้อความ log / byte หาย -> ข้ามถึง 0x00 ถัดไป
+                continue
+            self.records += 1
+            yield from rows
+
+
+def open_source(src, baud):
+    if src == "-":
+        return sys.stdin.buffer, None
+    if os.path.exists(src) and not src.startswith("/dev/"):
+        return open(src, "rb"), None
+    import serial  # pyserial
+    port = serial.Serial(src, baud, timeout=0.1)
+    return port, port
+
+
+class ColumnSink:
+    """เก็บแต่ละคอลัมน์เป็น .npy (ตัวเลข) / .txt (ข้อความ) ใน dir"""
+
+    def __init__(self, path):
+        import numpy  # noqa: F401  (เช็กก่อนเริ่มอ่าน)
+        self.path = path
+        self.cols = {c: [] for c in COLUMNS}
+        os.makedirs(path, exist_ok=True)
+
+    def add(self, row):
+        for c in COLUMNS:
+            self.cols[c].append(row.get(c, ""))
+
+    def close(self):
+        import numpy as np
+        for c, vals in self.cols.items():
+            try:
+                arr = np.array([float("nan") if v == "" else v for v in vals], dtype=np.float64)
+                np.save(os.path.join(self.path, c + ".npy"), arr)
+            except (TypeError, ValueError):
+                with open(os.path.join(self.path, c + ".txt"), "w") as f:
+                    f.write("\n".join(str(v) for v in vals))
+
+
+def bench(n):
+    payload = SENSOR.pack(MSG_SENSOR, 25.5, 60.25, 1234, b"TEMP_01", 123456, 0)
+    stream = bytearray()
+    for i in range(n):
+        body = HDR.pack(VERSION, KIND_RX, i * 1000, b"\x24\x6f\x28\x00\x00\x01", -50, len(payload)) + payload
+        stream += cobs_encode(body + struct.pack("<I", zlib.crc32(body) & 0xFFFFFFFF)) + b"\0"
+    dec = Decoder()
+    t0 = time.perf_counter()
+    rows = 0
+    for i in range(0, len(stream), 4096):
+        for _ in dec.feed(stream[i:i + 4096]):
+            rows += 1
+    dt = time.perf_counter() - t0
+    rec_bytes = len(stream) / n
+    print("decoded %d records (%.1f B each on wire) in %.3f s: %.0f rec/s, %.2f MB/s, bad=%d"
+          % (rows, rec_bytes, dt, rows / dt, len(stream) / dt / 1e6, dec.bad))
+    for baud in (115200, 921600, 2000000):
+        print("  line rate @ %7d baud: %6.0f rec/s" % (baud, baud / 10 / rec_bytes))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", nargs="?", help="serial port, capture file หรือ - (stdin)")
+    ap.add_argument("--baud", type=int, default=921600)
+    ap.add_argument("--csv", help="ไฟล์ CSV ผลลัพธ์ (- = stdout)")
+    ap.add_argument("--columns", help="dir สำหรับไฟล์คอลัมน์ (.npy)")
+    ap.add_argument("--raw", help="บันทึก byte ที่อ่านได้ทั้งหมดลงไฟล์ (เอาไปเล่นซ้ำทีหลัง)")
+    ap.add_argument("--bench", type=int, metavar="N", help="วัดความเร็วถอด N record แล้วจบ")
+    args = ap.parse_args()
+
+    if args.bench:
+        bench(args.bench)
+        return
+    if not args.source:
+        ap.error("ต้องระบุ source")
+
+    src, port = open_source(args.source, args.baud)
+    out_f = None
+    writer = None
+    if args.csv:
+        out_f = sys.stdout if args.csv == "-" else open(args.csv, "w", newline="")
+        writer = csv.DictWriter(out_f, fieldnames=COLUMNS, extrasaction="ignore")
+        writer.writeheader()
+    cols = ColumnSink(args.columns) if args.columns else None
+    raw = open(args.raw, "wb") if args.raw else None
+
+    dec = Decoder()
+    t0 = time.monotonic()
+    nbytes = 0
+    try:
+        while True:
+            chunk = src.read(4096) if port is None else port.read(max(1, port.in_waiting))
+            if not chunk:
+                if port is None:
+                    break
+                continue
+            nbytes += len(chunk)
+            if raw:
+                raw.write(chunk)
+            for row in dec.feed(chunk):
+                if writer:
+                    writer.writerow(row)
+                if cols:
+                    cols.add(row)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if cols:
+            cols.close()
+        if out_f and out_f is not sys.stdout:
+            out_f.close()
+        if raw:
+            raw.close()
+        dt = max(time.monotonic() - t0, 1e-6)
+        print("records=%d bad=%d bytes=%d (%.0f B/s, %.0f rec/s)"
+              % (dec.records, dec.bad, nbytes, nbytes / dt, dec.records / dt), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
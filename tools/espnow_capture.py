@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# tools/espnow_capture.py
+"""สร้าง / ดูไฟล์ capture (.ecap) สำหรับ components/espnow_replay
+
+.ecap (little-endian, แนว pcap):
+  file hdr (16 B): magic "ENCP", version u16, rec_hdr_len u16, snaplen u32, records u32
+  record  (18 B + payload): ts_us u64, mac[6], rssi i8, channel u8, len u16
+
+ตัวอย่าง:
+  python3 tools/espnow_bridge.py /dev/ttyUSB0 --raw gw.bin          (เก็บ traffic จริงจาก gateway)
+  python3 tools/espnow_capture.py convert gw.bin gw.ecap
+  python3 tools/espnow_capture.py synth sim.ecap --senders 200 --duration 600 --loss 0.05
+  python3 tools/espnow_capture.py info gw.ecap
+  parttool.py -p /dev/ttyUSB0 write_partition --partition-name replay --input gw.ecap
+"""
+import argparse
+import os
+import random
+import struct
+import sys
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from espnow_bridge import HDR, VERSION, KIND_RX, MSG_SENSOR, SENSOR, cobs_decode  # noqa: E402
+
+MAGIC = 0x50434E45
+ECAP_VERSION = 1
+SNAPLEN = 1470
+FILE_HDR = struct.Struct("<IHHII")
+REC_HDR = struct.Struct("<Q6sbBH")
+
+
+class Writer:
+    def __init__(self, path):
+        self.f = open(path, "wb")
+        self.records = 0
+        self.f.write(FILE_HDR.pack(MAGIC, ECAP_VERSION, REC_HDR.size, SNAPLEN, 0))
+
+    def add(self, ts_us, mac, rssi, channel, payload):
+        if not payload or len(payload) > SNAPLEN:
+            return
+        self.f.write(REC_HDR.pack(ts_us, mac, rssi, channel, len(payload)) + payload)
+        self.records += 1
+
+    def close(self):
+        # จำนวน record เขียนทีหลัง (เหมือน pcapng) -> ฝั่ง replay รู้ว่าไฟล์ถูกตัดหรือเปล่า
+        self.f.seek(FILE_HDR.size - 4)
+        self.f.write(struct.pack("<I", self.records))
+        self.f.close()
+
+
+def read_ecap(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, ver, rec_len, snaplen, records = FILE_HDR.unpack_from(data)
+    if magic != MAGIC or ver != ECAP_VERSION or rec_len < REC_HDR.size:
+        raise ValueError("not an .ecap v%d file" % ECAP_VERSION)
+    off, n = FILE_HDR.size, 0
+    while off + rec_len <= len(data) and (records == 0 or n < records):
+        ts, mac, rssi, ch, ln = REC_HDR.unpack_from(data, off)
+        if ln == 0 or ln > snaplen or off + rec_len + ln > len(data):
+            break
+        yield ts, mac, rssi, ch, data[off + rec_len:off + rec_len + ln]
+        off += rec_len + ln
+        n += 1
+
+
+def cmd_convert(args):
+    """raw stream ของ serial bridge (--raw) -> .ecap (เฉพาะ record ชนิด RX)"""
+    with open(args.input, "rb") as f:
+        stream = f.read()
+    out = Writer(args.output)
+    bad = skipped = 0
+    for frame in stream.split(b"\0"):
+        if not frame:
+            continue
+        try:
+            raw = cobs_decode(frame)
+        except ValueError:
+            bad += 1
+            continue
+        if len(raw) < HDR.size + 4 or zlib.crc32(raw[:-4]) & 0xFFFFFFFF != struct.unpack("<I", raw[-4:])[0]:
+            bad += 1
+            continue
+        ver, kind, ts, mac, rssi, ln = HDR.unpack_from(raw)
+        payload = raw[HDR.size:-4]
+        if ver != VERSION or ln != len(payload):
+            bad += 1
+            continue
+        if kind != KIND_RX:
+            skipped += 1
+            continue
+        out.add(ts, mac, rssi, args.channel, payload)
+    out.close()
+    print("%s: %d records (bad=%d, non-RX=%d)" % (args.output, out.records, bad, skipped))
+
+
+def cmd_synth(args):
+    """จำลองวิทยุ: sensor N ตัวส่ง SENSOR ทุก interval (+jitter) มี loss / rssi แกว่ง"""
+    rnd = random.Random(args.seed)
+    events = []
+    for s in range(args.senders):
+        mac = bytes([0x02, 0x53, 0x54, 0x00, s >> 8, s & 0xFF])   # = ESPNOW_STRESS_MAC_PREFIX (gateway ไม่ตอบกลับ)
+        sid = ("SIM_%03d" % s).encode()
+        base_rssi = rnd.randint(-85, -40)
+        t = rnd.uniform(0, args.interval) * 1000
+        seq = 0
+        while t < args.duration * 1e6:
+            seq += 1
+            if rnd.random() >= args.loss:
+                temp = 25.0 + 5.0 * rnd.random()
+                hum = 50.0 + 20.0 * rnd.random()
+                payload = SENSOR.pack(MSG_SENSOR, temp, hum, rnd.randint(0, 4095), sid,
+                                      int(t / 1000) & 0xFFFFFFFF, seq)
+                rssi = max(-100, min(-20, base_rssi + rnd.randint(-4, 4)))
+                events.append((int(t), mac, rssi, payload))
+            t += (args.interval + rnd.uniform(-args.jitter, args.jitter)) * 1000
+    events.sort(key=lambda e: e[0])
+
+    out = Writer(args.output)
+    for ts, mac, rssi, payload in events:
+        out.add(ts, mac, rssi, args.channel, payload)
+    out.close()
+    rate = out.records / args.duration if args.duration else 0
+    print("%s: %d records from %d senders over %d s (%.1f fps avg)"
+          % (args.output, out.records, args.senders, args.duration, rate))
+
+
+def cmd_info(args):
+    n = nbytes = 0
+    first = last = None
+    macs, types = {}, {}
+    max_gap = 0
+    for ts, mac, _rssi, _ch, payload in read_ecap(args.input):
+        if first is None:
+            first = ts
+        elif ts - last > max_gap:
+            max_gap = ts - last
+        last = ts
+        n += 1
+        nbytes += len(payload)
+        macs[mac] = macs.get(mac, 0) + 1
+        types[payload[0]] = types.get(payload[0], 0) + 1
+    if not n:
+        print("%s: empty" % args.input)
+        return
+    dur = (last - first) / 1e6
+    print("%s: %d records, %d payload bytes, %.3f s, %d senders, %.1f fps avg, max gap %.1f ms"
+          % (args.input, n, nbytes, dur, len(macs), n / dur if dur else 0, max_gap / 1000))
+    for t, c in sorted(types.items()):
+        print("  type 0x%02X: %d" % (t, c))
+    if args.senders:
+        for mac, c in sorted(macs.items(), key=lambda kv: -kv[1]):
+            print("  %s: %d" % (mac.hex(":"), c))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("convert", help="raw stream จาก espnow_bridge.py --raw -> .ecap")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("--channel", type=int, default=1, help="channel ที่ gateway ฟังอยู่ตอน capture")
+    p.set_defaults(fn=cmd_convert)
+
+    p = sub.add_parser("synth", help="สร้าง capture จำลอง (SENSOR frame)")
+    p.add_argument("output")
+    p.add_argument("--senders", type=int, default=50)
+    p.add_argument("--interval", type=float, default=5000, help="ms ต่อ sender")
+    p.add_argument("--jitter", type=float, default=50, help="+/- ms")
+    p.add_argument("--duration", type=int, default=300, help="วินาที")
+    p.add_argument("--loss", type=float, default=0.0, help="สัดส่วนเฟรมที่หาย 0..1")
+    p.add_argument("--channel", type=int, default=1)
+    p.add_argument("--seed", type=int, default=1)
+    p.set_defaults(fn=cmd_synth)
+
+    p = sub.add_parser("info", help="สรุปไฟล์ .ecap")
+    p.add_argument("input")
+    p.add_argument("--senders", action="store_true", help="แจกแจงต่อ MAC")
+    p.set_defaults(fn=cmd_info)
+
+    args = ap.parse_args()
+    args.fn(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -9,6 +10,10 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_now.h"
+#include "espnow_boot.h"
+#include "link_track.h"
+#include "link_retry.h"
+#include "link_rate.h"
 #include "esp_timer.h"
 
 static const char* TAG = "ESP_NOW_DEVICE_A";
@@ -31,7 +36,16 @@ static void log_mac(const char *prefix, const uint8_t mac[6]) {
 
 /* send-cb (รูปแบบใหม่ v5.x) */
 static void on_data_sent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Send status: %s", status == ESP_NOW_SEND_SUCCESS ? "SUCCESS" : "FAIL");
+    espnow_boot_mark_first_tx();
+    espnow_link_sent_t r;
+    espnow_link_on_sent(info, status, &r);
+    espnow_link_retry_on_sent(info, &r);
+    if (r.matched) {
+        ESP_LOGI(TAG, "Send message #%" PRIu32 ": %s (%lld us)", r.seq,
+                 r.ok ? "SUCCESS" : "FAIL", (long long)r.latency_us);
+    } else {
+        ESP_LOGI(TAG, "Send status: %s", r.ok ? "SUCCESS" : "FAIL");
+    }
 }
 
 /* recv-cb (รูปแบบใหม่ v5.x) : A แค่รับ reply และ log — ไม่ตอบกลับซ้ำ */
@@ -48,37 +62,12 @@ static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data, i
     ESP_LOGI(TAG, "   ⏰ Timestamp(ms): %u", (unsigned)rx.timestamp_ms);
 }
 
-static void wifi_init_for_espnow(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-
-    if (channel >= 1 && channel <= 13) {
-        wifi_config_t sta_cfg = {0};
-        sta_cfg.sta.channel = channel;   // ★ ให้ตรงกับอีกเครื่อง
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
-    }
-
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "WiFi STA started (channel=%u)", channel);
-}
-
 static void espnow_init_and_add_peer(uint8_t channel) {
-    ESP_ERROR_CHECK(esp_now_init());
     ESP_ERROR_CHECK(esp_now_register_send_cb(on_data_sent));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
 
-    esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, partner_mac, 6);   // ★ MAC ของ B
-    peer.ifidx   = WIFI_IF_STA;
-    peer.channel = channel;
-    peer.encrypt = false;
-
-    esp_err_t er = esp_now_add_peer(&peer);
-    if (er != ESP_OK && er != ESP_ERR_ESPNOW_EXIST) {
+    esp_err_t er = espnow_boot_add_peer(partner_mac, channel);   // ★ MAC ของ B
+    if (er != ESP_OK) {
         ESP_LOGE(TAG, "esp_now_add_peer failed: %d", er);
         ESP_ERROR_CHECK(er);
     }
@@ -86,21 +75,23 @@ static void espnow_init_and_add_peer(uint8_t channel) {
 }
 
 void app_main(void) {
-    // NVS
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ESP_ERROR_CHECK(nvs_flash_init());
-    }
-
     const uint8_t CHANNEL = 1;  // ★★ ให้ตรงกับ Device B ★★
-    wifi_init_for_espnow(CHANNEL);
+
+    // NVS + Wi-Fi + ESP-NOW (จับเวลาทุกขั้น)
+    espnow_boot_config_t boot_cfg = ESPNOW_BOOT_CONFIG_DEFAULT();
+    boot_cfg.channel = CHANNEL;
+    ESP_ERROR_CHECK(espnow_boot_init(&boot_cfg));
+    espnow_link_retry_policy_t retry = ESPNOW_LINK_RETRY_POLICY_DEFAULT();
+    ESP_ERROR_CHECK(espnow_link_retry_init(&retry));
     espnow_init_and_add_peer(CHANNEL);
 
     // แสดง MAC ตัวเอง
     uint8_t mymac[6];
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mymac));
     log_mac("📍 My MAC:", mymac);
+    espnow_boot_report();
+    ESP_ERROR_CHECK(espnow_link_rate_enable(partner_mac));
+    ESP_ERROR_CHECK(espnow_link_start_report(30000));
 
     // ส่งทุก 5 วินาที
     bidirectional_data_t tx = {0};
@@ -112,7 +103,7 @@ void app_main(void) {
         tx.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000ULL);
 
         ESP_LOGI(TAG, "📤 Sending message #%d", tx.counter);
-        esp_err_t er = esp_now_send(partner_mac, (const uint8_t *)&tx, sizeof(tx));
+        esp_err_t er = espnow_link_send_reliable(partner_mac, &tx, sizeof(tx), (uint32_t)tx.counter);
         if (er != ESP_OK) ESP_LOGE(TAG, "esp_now_send failed: %d", er);
 
         vTaskDelay(pdMS_TO_TICKS(5000));